@@ -73,8 +73,15 @@ public:
      */
     void resolve() final override;
 
+    /*!
+     * @brief Resolves logical drives of single target LUNs.
+     * LUNs whose device is gone are cleared. Requires initialize().
+     * @param target Target to be resolved
+     * @return true if any LUN has changed
+     */
+    bool resolve_iscsi_target(Target::TargetSharedPtr target);
+
 private:
-    void resolve_iscsi_target(Target::TargetSharedPtr target);
     std::map<std::string, LogicalDriveSharedPtr> m_logical_drive_map{};
 };
 
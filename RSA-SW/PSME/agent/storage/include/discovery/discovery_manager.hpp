@@ -28,8 +28,12 @@
 
 #include "agent-framework/discovery/discovery_manager.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "agent-framework/eventing/event_msg.hpp"
 #include "agent-framework/logger_ext.hpp"
 
+#include <chrono>
+#include <vector>
+
 using agent_framework::generic::Module;
 using agent_framework::generic::Submodule;
 using agent_framework::generic::ModuleManager;
@@ -62,18 +66,85 @@ public:
      */
     void wait_for_discovery_complete() const;
 
+    /*!
+     * @brief Wait for discovery to complete with timeout.
+     * @param timeout Maximum time to wait
+     * @return true if discovery is complete
+     */
+    bool wait_for_discovery_complete(
+            const std::chrono::milliseconds& timeout) const;
+
     /*!
      * @brief Default destructor.
      */
     virtual ~DiscoveryManager();
 
+    /*!
+     * @brief Discover module and reconcile it with the current model.
+     *
+     * The module may already be populated from a discovery snapshot.
+     * Components are matched with discovered ones, so restored components
+     * keep their UUIDs. Events of all changes are available through
+     * take_discovery_events() when discovery is complete.
+     *
+     * @param module Module to be discovered
+     */
     void discover(Module & module) const override;
 
-private:
-    void discovery_hard_drives(Module& module) const;
-    void discovery_iscsi_targets(Module& module) const;
-    void discovery_logical_drives(Module& module) const;
-    void resolve_dependencies(Module& module) const;
+    /*! @brief Component events produced by incremental discovery */
+    using EventMsgs = std::vector<agent_framework::generic::EventMsg>;
+
+    /*!
+     * @brief Take events of components changed by the last discovery.
+     * @return Events of changed components, empty on next call
+     */
+    EventMsgs take_discovery_events() const;
+
+    /*!
+     * @brief Rediscover all hard drives.
+     *
+     * Drives are matched by block device name, missing ones are removed.
+     *
+     * @param module Module to be updated
+     * @return Events of changed components
+     */
+    EventMsgs update_hard_drives(Module& module) const;
+
+    /*!
+     * @brief Rediscover single hard drive after hotplug event.
+     *
+     * Drive is matched by its block device name and added, updated in place
+     * (so it keeps its UUID) or removed from the module. The drive is probed
+     * without the model lock, the lock is held while the module is changed.
+     *
+     * @param module Module to be updated
+     * @param name Block device name, e.g. "sdb"
+     * @return Events of changed components
+     */
+    EventMsgs update_hard_drive(Module& module, const std::string& name) const;
+
+    /*!
+     * @brief Rescan LVM and apply differences to the module.
+     *
+     * Volume groups are matched by name, physical and logical volumes
+     * by name within their volume group. Only changed drives and targets
+     * exposing them are touched, unchanged ones keep their UUIDs.
+     *
+     * @param module Module to be updated
+     * @return Events of changed components
+     */
+    EventMsgs update_logical_drives(Module& module) const;
+
+    /*!
+     * @brief Rediscover iSCSI targets.
+     *
+     * Targets are matched by IQN, missing ones are removed. LUNs are
+     * linked to logical drives by update_logical_drives().
+     *
+     * @param module Module to be updated
+     * @return Events of changed components
+     */
+    EventMsgs update_iscsi_targets(Module& module) const;
 
 private:
     struct DiscoveryComplete;
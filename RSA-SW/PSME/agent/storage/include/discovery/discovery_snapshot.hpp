@@ -0,0 +1,84 @@
+/*!
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * @file discovery_snapshot.hpp
+ *
+ * @brief Last discovered storage model persisted between agent restarts.
+ * */
+
+#ifndef DISCOVERY_SNAPSHOT_HPP
+#define	DISCOVERY_SNAPSHOT_HPP
+
+#include "agent-framework/module/module_manager.hpp"
+
+#include <string>
+
+namespace agent {
+namespace storage {
+namespace discovery {
+
+/*!
+ * @brief Discovery snapshot.
+ *
+ * Stores modules with their hard drives, logical drives and iSCSI targets
+ * in a compact JSON file. Components restored from the snapshot keep their
+ * UUIDs and are marked with "Starting" state until discovery confirms them.
+ */
+class DiscoverySnapshot {
+public:
+    /*! @brief Modules stored in the snapshot */
+    using Modules = agent_framework::generic::ModuleManager::module_vec_t;
+
+    /*!
+     * @brief Constructor
+     * @param path Snapshot file path, empty path disables the snapshot
+     */
+    explicit DiscoverySnapshot(const std::string& path);
+
+    /*!
+     * @brief Restore modules from the snapshot.
+     *
+     * Modules are matched by IPv4 address. Nothing is restored if the file
+     * does not exist, is invalid or does not match the configured modules.
+     *
+     * @param modules Modules created from configuration, without components
+     * @return true if modules have been restored
+     */
+    bool load(Modules& modules) const;
+
+    /*!
+     * @brief Write modules to the snapshot.
+     *
+     * The file is replaced atomically, so a crash never leaves
+     * a partially written snapshot.
+     *
+     * @param modules Modules to be stored
+     * @return true if the snapshot has been written
+     */
+    bool save(const Modules& modules) const;
+
+private:
+    std::string m_path;
+};
+
+}
+}
+}
+#endif	/* DISCOVERY_SNAPSHOT_HPP */
@@ -0,0 +1,53 @@
+/*!
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * @file model_lock.hpp
+ *
+ * @brief Lock of the storage model shared by discovery and commands.
+ * */
+
+#ifndef MODEL_LOCK_HPP
+#define	MODEL_LOCK_HPP
+
+#include <mutex>
+
+namespace agent {
+namespace storage {
+namespace discovery {
+
+/*!
+ * @brief Get lock of the storage model.
+ *
+ * JSON-RPC commands are served while discovery and the storage monitor
+ * add, update and remove hard drives, logical drives and targets of modules.
+ * Commands hold the lock while they use components, discovery holds it
+ * while it applies probed data to components but not while it probes.
+ *
+ * @return Storage model mutex
+ */
+std::mutex& get_model_mutex();
+
+/*! @brief Scoped lock of the storage model */
+using ModelLock = std::lock_guard<std::mutex>;
+
+}
+}
+}
+#endif	/* MODEL_LOCK_HPP */
@@ -0,0 +1,112 @@
+/*!
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * @file storage_monitor.hpp
+ *
+ * @brief Incremental discovery driven by udev and LVM change notifications.
+ * */
+
+#ifndef STORAGE_MONITOR_HPP
+#define	STORAGE_MONITOR_HPP
+
+#include "discovery/discovery_manager.hpp"
+#include "discovery/discovery_snapshot.hpp"
+#include "agent-framework/eventing/event_publisher.hpp"
+#include "storage_config.hpp"
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+
+#ifdef UDEV_FOUND
+struct udev;
+struct udev_monitor;
+#endif
+
+namespace agent {
+namespace storage {
+namespace discovery {
+
+/*!
+ * @brief Storage monitor.
+ *
+ * Publishes changes found by the initial discovery, which may run while
+ * the agent already serves the model restored from the discovery snapshot.
+ * Then listens for udev block device events and for changes of LVM metadata
+ * backups. Changes are collected until the system settles down and then
+ * only the affected components are rediscovered. Every added, removed
+ * or changed component is published as a separate event and the snapshot
+ * is updated.
+ */
+class StorageMonitor : public agent_framework::generic::EventPublisher {
+public:
+    /*!
+     * @brief Constructor
+     * @param discovery_manager Discovery manager used for rediscovery
+     * @param snapshot Discovery snapshot updated after changes
+     */
+    StorageMonitor(const DiscoveryManager& discovery_manager,
+                   const DiscoverySnapshot& snapshot);
+
+    /*! @brief Copy constructor */
+    StorageMonitor(const StorageMonitor&) = delete;
+
+    /*! @brief Assignment operator */
+    StorageMonitor& operator=(const StorageMonitor&) = delete;
+
+    /*! @brief Stops monitor thread */
+    ~StorageMonitor();
+
+    /*! @brief Start monitor thread */
+    void start();
+
+    /*! @brief Stop monitor thread */
+    void stop();
+
+private:
+    void m_task();
+    bool m_open();
+    void m_close();
+    void m_read_udev_events();
+    void m_read_lvm_events();
+    bool m_wait_for_discovery();
+    void m_handle_changes();
+    void m_publish(const DiscoveryManager::EventMsgs& events);
+
+    const DiscoveryManager& m_discovery_manager;
+    const DiscoverySnapshot& m_snapshot;
+    std::thread m_thread{};
+    std::atomic<bool> m_running{false};
+
+    std::set<std::string> m_changed_drives{};
+    bool m_lvm_changed{false};
+
+#ifdef UDEV_FOUND
+    struct udev* m_udev{nullptr};
+    struct udev_monitor* m_udev_monitor{nullptr};
+#endif
+    int m_inotify_fd{-1};
+};
+
+}
+}
+}
+#endif	/* STORAGE_MONITOR_HPP */
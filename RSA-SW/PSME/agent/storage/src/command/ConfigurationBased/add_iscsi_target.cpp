@@ -24,6 +24,7 @@
 
 #include "agent-framework/command/storage/add_iscsi_target.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 #include "agent-framework/module/iscsi_data.hpp"
 #include "agent-framework/exceptions/exception.hpp"
 #include "iscsi/manager.hpp"
@@ -33,6 +34,8 @@
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
 using namespace agent::storage::iscsi::tgt::config;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! AddISCSITarget implementation */
 class AddISCSITarget : public storage::AddISCSITarget {
@@ -42,6 +45,8 @@ public:
     using storage::AddISCSITarget::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         if (ModuleManager::get_modules().empty()) {
             THROW(agent_framework::exceptions::InvalidParameters,
                  "rpc", "Module not found!");
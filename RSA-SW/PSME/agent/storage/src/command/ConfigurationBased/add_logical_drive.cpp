@@ -24,6 +24,7 @@
 
 #include "agent-framework/command/storage/add_logical_drive.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 #include "agent-framework/action/task_runner.hpp"
 #include "agent-framework/exceptions/exception.hpp"
 #include "lvm/lvm_api.hpp"
@@ -34,6 +35,8 @@ using namespace agent_framework::action;
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
 using namespace agent::storage::lvm;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! AddLogicalDrive implementation */
 class AddLogicalDrive : public storage::AddLogicalDrive {
@@ -43,6 +46,8 @@ public:
     using storage::AddLogicalDrive::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         const auto master_drive =
                 ModuleManager::find_logical_drive(request.get_master()).lock();
 
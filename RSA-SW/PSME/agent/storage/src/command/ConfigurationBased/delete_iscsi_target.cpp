@@ -24,6 +24,7 @@
 
 #include "agent-framework/command/storage/delete_iscsi_target.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 #include "agent-framework/exceptions/exception.hpp"
 #include "iscsi/manager.hpp"
 #include "iscsi/response.hpp"
@@ -32,6 +33,8 @@
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
 using namespace agent::storage::iscsi::tgt::config;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! DeleteISCSITarget implementation */
 class DeleteISCSITarget : public storage::DeleteISCSITarget {
@@ -41,6 +44,8 @@ public:
     using storage::DeleteISCSITarget::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         const auto target_uuid = request.get_target();
         const auto target_obj = ModuleManager::find_target(target_uuid).lock();
         if (!target_obj) {
@@ -24,6 +24,7 @@
 
 #include "agent-framework/command/storage/delete_logical_drive.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 #include "agent-framework/exceptions/exception.hpp"
 #include "lvm/lvm_api.hpp"
 
@@ -32,6 +33,8 @@
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
 using namespace agent::storage::lvm;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! DeleteLogicalDrive implementation */
 class DeleteLogicalDrive : public storage::DeleteLogicalDrive {
@@ -42,6 +45,8 @@ public:
     bool has_target(const std::string& logical_drive_uuid);
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         const auto logical_drive_uuid = request.get_drive();
         const auto logical_drive = ModuleManager::find_logical_drive(logical_drive_uuid).lock();
         if (!logical_drive) {
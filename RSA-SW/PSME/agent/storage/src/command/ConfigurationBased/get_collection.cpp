@@ -25,11 +25,14 @@
 
 #include "agent-framework/command/storage/get_collection.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using std::vector;
 
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! GetCollection implementation */
 class GetCollection : public storage::GetCollection {
@@ -39,6 +42,8 @@ public:
     using storage::GetCollection::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
 
         auto uuid = request.get_component();
         auto collection_name = request.get_name();
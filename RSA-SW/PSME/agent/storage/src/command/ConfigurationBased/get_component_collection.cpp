@@ -24,11 +24,14 @@
 
 #include "agent-framework/command/storage/get_component_collection.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using std::vector;
 
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! Dummy GetComponentCollection implementation */
 class GetComponentCollection : public storage::GetComponentCollection {
@@ -38,6 +41,8 @@ public:
     using storage::GetComponentCollection::execute;
 
     void execute(const Request&, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
 
         const auto& modules = ModuleManager::get_modules();
 
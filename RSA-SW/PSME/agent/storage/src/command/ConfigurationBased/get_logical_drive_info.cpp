@@ -24,12 +24,15 @@
 
 #include "agent-framework/command/storage/get_logical_drive_info.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 #include "agent-framework/action/task_status_manager.hpp"
 
 #include <algorithm>
 
 using namespace agent_framework::generic;
 using namespace agent_framework::command;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! GetLogicalDriveInfo implementation */
 class GetLogicalDriveInfo : public storage::GetLogicalDriveInfo {
@@ -40,6 +43,8 @@ public:
     using LogicalDriveSharedPtr = LogicalDrive::LogicalDriveSharedPtr;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         auto drive_uuid = request.get_drive();
         auto& module = ModuleManager::get_modules().front();
         if (!module->get_submodules().size()) {
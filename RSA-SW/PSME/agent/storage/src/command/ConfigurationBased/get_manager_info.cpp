@@ -24,9 +24,12 @@
 
 #include "agent-framework/command/storage/get_manager_info.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using namespace agent_framework::generic;
 using namespace agent_framework::command;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 using std::string;
 using agent_framework::command::exception::NotFound;
@@ -39,6 +42,8 @@ public:
     using storage::GetManagerInfo::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         auto uuid = request.get_component();
         auto module = ModuleManager::get_module(uuid);
         auto submodule = ModuleManager::get_submodule(uuid);
@@ -24,9 +24,12 @@
 
 #include "agent-framework/command/storage/get_physical_drive_info.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! GetPhysicalDriveInfo implementation */
 class GetPhysicalDriveInfo : public storage::GetPhysicalDriveInfo {
@@ -36,6 +39,8 @@ public:
     using storage::GetPhysicalDriveInfo::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         auto drive = request.get_drive();
 
         auto hard_drive = ModuleManager::find_hard_drive(drive).lock();
@@ -25,9 +25,12 @@
 
 #include "agent-framework/command/storage/get_storage_services_info.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 using std::out_of_range;
 
@@ -40,6 +43,8 @@ public:
     using storage::GetStorageServicesInfo::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
         auto services = request.get_services();
 
         auto submodule = ModuleManager::get_submodule(services);
@@ -24,9 +24,12 @@
 
 #include "agent-framework/command/storage/get_target_info.hpp"
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! Dummy GetTargetInfo implementation */
 class GetTargetInfo : public storage::GetTargetInfo {
@@ -36,6 +39,8 @@ public:
     using storage::GetTargetInfo::execute;
 
     void execute(const Request& request, Response& response) {
+        ModelLock lock{get_model_mutex()};
+
        const auto target = ModuleManager::find_target(
                                                 request.get_target()).lock();
         if (!target) {
@@ -25,9 +25,12 @@
 #include "agent-framework/command/storage/set_component_attributes.hpp"
 
 #include "agent-framework/module/module_manager.hpp"
+#include "discovery/model_lock.hpp"
 
 using namespace agent_framework::command;
 using namespace agent_framework::generic;
+using agent::storage::discovery::ModelLock;
+using agent::storage::discovery::get_model_mutex;
 
 /*! SetComponentAttributes implementation */
 class SetComponentAttributes : public storage::SetComponentAttributes {
@@ -37,6 +40,8 @@ public:
     using storage::SetComponentAttributes::execute;
 
     void execute(const Request& request, Response&) {
+        ModelLock lock{get_model_mutex()};
+
         const auto& uuid = request.get_component();
 
         auto logical_drive = ModuleManager::find_logical_drive(uuid).lock();
@@ -28,6 +28,8 @@
 
 #include "discovery/dependency_resolver/iscsi_target_dependency_resolver.hpp"
 
+#include <algorithm>
+
 using namespace agent::storage::discovery;
 
 using LogicalDrive = agent_framework::generic::LogicalDrive;
@@ -41,19 +43,34 @@ void IscsiTargetDependencyResolver::resolve() {
     }
 }
 
-void IscsiTargetDependencyResolver::resolve_iscsi_target(Target::TargetSharedPtr target) {
+bool IscsiTargetDependencyResolver::resolve_iscsi_target(Target::TargetSharedPtr target) {
+    bool changed{false};
     auto& target_lun_vec = target->get_target_lun();
     for (auto& target_lun : target_lun_vec) {
         auto& target_device_path = target_lun.get_device_path();
         auto found = m_logical_drive_map.find(target_device_path);
         if (found != m_logical_drive_map.end()) {
-            target_lun.set_logical_drive_uuid(found->second->get_uuid());
-            target->add_logical_drive(found->second);
+            const auto uuid = found->second->get_uuid();
+            if (uuid != target_lun.get_logical_drive_uuid()) {
+                target_lun.set_logical_drive_uuid(uuid);
+                changed = true;
+            }
+            const auto& logical_drives = target->get_logical_drives();
+            if (logical_drives.cend() == std::find(logical_drives.cbegin(),
+                                        logical_drives.cend(), found->second)) {
+                target->add_logical_drive(found->second);
+            }
+        }
+        else if (!target_lun.get_logical_drive_uuid().empty()) {
+            target_lun.set_logical_drive_uuid({});
+            changed = true;
         }
     }
+    return changed;
 }
 
 void IscsiTargetDependencyResolver::initialize() {
+    m_logical_drive_map.clear();
     auto& submodule = m_module.get_submodules().front();
     auto& volume_groups = submodule->get_logical_drives();
     for (auto& volume_group : volume_groups) {
@@ -29,6 +29,8 @@
 #include "sysfs/sysfs_api.hpp"
 #include "lvm/lvm_api.hpp"
 
+#include <algorithm>
+
 using namespace agent::storage::discovery;
 using namespace agent::storage::lvm;
 
@@ -57,7 +59,11 @@ void LogicalDriveDependencyResolver::resolve_physical_volume(LogicalDriveSharedP
 void LogicalDriveDependencyResolver::resolve_physical_volume_hard_disk(LogicalDriveSharedPtr physical_volume) {
     auto& hard_drive = m_hard_drive_map[physical_volume->get_name()];
     if (auto hd = hard_drive.lock()) {
-        physical_volume->add_hard_drive(hd);
+        const auto& hard_drives = physical_volume->get_hard_drives();
+        if (hard_drives.cend() == std::find(hard_drives.cbegin(),
+                                            hard_drives.cend(), hd)) {
+            physical_volume->add_hard_drive(hd);
+        }
     }
 }
 
@@ -73,6 +79,7 @@ void LogicalDriveDependencyResolver::resolve_volume_group(LogicalDriveSharedPtr
 }
 
 void LogicalDriveDependencyResolver::initialize() {
+    m_hard_drive_map.clear();
     auto& submodule = m_module.get_submodules().front();
     auto& storage_controller = submodule->get_storage_controllers().front();
     auto& hard_drives = storage_controller->get_hard_drives();
@@ -26,9 +26,12 @@
  * @brief ...
  * */
 #include "discovery/discovery_manager.hpp"
-#include "discovery/dependency_resolver/storage_dependency_resolver.hpp"
+#include "discovery/model_lock.hpp"
+#include "discovery/dependency_resolver/logical_drive_dependency_resolver.hpp"
+#include "discovery/dependency_resolver/iscsi_target_dependency_resolver.hpp"
 #include "sysfs/sysfs_api.hpp"
 #include "lvm/lvm_api.hpp"
+#include "lvm/lvm_session.hpp"
 #include "iscsi/manager.hpp"
 #include "iscsi/response.hpp"
 #include "iscsi/target_parser.hpp"
@@ -38,8 +41,10 @@
 #include "agent-framework/module/target.hpp"
 #include "agent-framework/module/logical_drive.hpp"
 
+#include <algorithm>
 #include <mutex>
 #include <condition_variable>
+#include <tuple>
 
 using namespace agent::storage::discovery;
 using namespace agent::storage::iscsi;
@@ -51,10 +56,246 @@ using HardDrivePartition = agent_framework::generic::HardDrivePartition;
 using FruInfo = agent_framework::generic::FruInfo;
 using LogicalDrive = agent_framework::generic::LogicalDrive;
 using Target = agent_framework::generic::Target;
+using IscsiData = agent_framework::generic::IscsiData;
+using EventMsg = agent_framework::generic::EventMsg;
+using ModuleState = agent_framework::generic::ModuleState;
+using Transition = agent_framework::generic::StateMachineTransition::Transition;
+
+namespace {
+
+constexpr const char HARD_DRIVE_TYPE[] = "HardDrive";
+constexpr const char LOGICAL_DRIVE_TYPE[] = "LogicalDrive";
+constexpr const char TARGET_TYPE[] = "Target";
+constexpr const char LVM_TYPE_NAME[] = "LVM";
+
+EventMsg make_event(const std::string& uuid, const std::string& parent,
+                    const char* type, const Transition transition) {
+    EventMsg event{uuid, Transition::EXTRACTION == transition ?
+            ModuleState::State::ABSENT : ModuleState::State::ENABLED,
+            transition};
+    event.set_type(type);
+    event.set_parent(parent);
+    return event;
+}
+
+/* Properties compared to decide if an UPDATE event has to be sent */
+using HardDriveState = std::tuple<std::string, std::string, uint32_t,
+      std::string, std::string, uint32_t, std::string, std::string, std::string,
+      std::string, std::string>;
+
+HardDriveState get_state(const HardDrive& hard_drive) {
+    const auto& fru_info = hard_drive.get_fru_info();
+    return HardDriveState{hard_drive.get_name(), hard_drive.get_device_path(),
+        hard_drive.get_capacity_gb(), hard_drive.get_type(),
+        hard_drive.get_interface(), hard_drive.get_rpm(),
+        fru_info.get_manufacturer(), fru_info.get_model_number(),
+        fru_info.get_serial_number(), hard_drive.get_status().get_state(),
+        hard_drive.get_status().get_health()};
+}
+
+using LogicalDriveState = std::tuple<double, std::string, bool, bool,
+      std::string, std::string>;
+
+LogicalDriveState get_state(const LogicalDrive& logical_drive) {
+    return LogicalDriveState{logical_drive.get_capacity_gb(),
+        logical_drive.get_device_path(), logical_drive.is_protected(),
+        logical_drive.is_snapshot(), logical_drive.get_status().get_state(),
+        logical_drive.get_status().get_health()};
+}
+
+using TargetState = std::tuple<std::int32_t, std::string, std::string,
+      std::uint32_t, std::string, std::string, std::string>;
+
+TargetState get_state(const Target& target) {
+    return TargetState{target.get_target_id(), target.get_target_iqn(),
+        target.get_target_address(), target.get_target_port(),
+        target.get_initiator_iqn(), target.get_status().get_state(),
+        target.get_status().get_health()};
+}
+
+bool set_hard_drive_data(HardDrive& hard_drive,
+                         const SysfsAPI::HardDrive& bd_drive) {
+    const auto before = get_state(hard_drive);
+
+    hard_drive.set_name(bd_drive.get_name());
+    hard_drive.set_device_path(bd_drive.get_device_path());
+    hard_drive.set_capacity_gb(bd_drive.get_capacity_gb());
+    hard_drive.set_type(bd_drive.get_type());
+    hard_drive.set_interface(bd_drive.get_interface());
+    hard_drive.set_rpm(bd_drive.get_rpm());
+
+    FruInfo fru_info;
+    fru_info.set_manufacturer(bd_drive.get_manufacturer());
+    fru_info.set_model_number(bd_drive.get_model());
+    fru_info.set_serial_number(bd_drive.get_serial_number());
+    hard_drive.set_fru_info(fru_info);
+
+    hard_drive.set_status({"Enabled", "OK"});
+
+    return before != get_state(hard_drive);
+}
+
+bool set_volume_group_data(LogicalDrive& logical_drive,
+                           const LvmAPI::VolumeGroup& volume_group) {
+    const auto before = get_state(logical_drive);
+
+    logical_drive.set_bootable(false);
+    logical_drive.set_name(volume_group.get_name());
+    logical_drive.set_mode(LogicalDrive::LvmTypes::VOLUME_GROUP);
+    logical_drive.set_type(LVM_TYPE_NAME);
+    logical_drive.set_capacity_gb(volume_group.get_capacity_gb());
+    logical_drive.set_device_path("/dev/" + volume_group.get_name());
+    logical_drive.set_protected(volume_group.get_protection_status());
+    logical_drive.set_status({volume_group.get_status(), volume_group.get_health()});
+
+    return before != get_state(logical_drive);
+}
+
+bool set_physical_volume_data(LogicalDrive& physical_drive,
+                              const LvmAPI::PhysicalVolume& physical_volume) {
+    const auto before = get_state(physical_drive);
+
+    physical_drive.set_name(physical_volume.get_name());
+    physical_drive.set_capacity_gb(physical_volume.get_capacity_gb());
+    physical_drive.set_type(LVM_TYPE_NAME);
+    physical_drive.set_protected(physical_volume.get_protection_status());
+    physical_drive.set_device_path(physical_volume.get_name());
+    physical_drive.set_mode(LogicalDrive::LvmTypes::PHYSICAL_VOLUME);
+    physical_drive.set_status({physical_volume.get_status(), physical_volume.get_health()});
+
+    return before != get_state(physical_drive);
+}
+
+bool set_logical_volume_data(LogicalDrive& logical_drive,
+                             const LvmAPI::LogicalVolume& logical_volume,
+                             const std::string& volume_group_name) {
+    const auto before = get_state(logical_drive);
+
+    logical_drive.set_name(logical_volume.get_name());
+    logical_drive.set_protected(logical_volume.get_protection_status());
+    logical_drive.set_snapshot(logical_volume.get_snapshot_status());
+    logical_drive.set_mode(LogicalDrive::LvmTypes::LOGICAL_VOLUME);
+    logical_drive.set_capacity_gb(logical_volume.get_capacity_gb());
+    logical_drive.set_type(LVM_TYPE_NAME);
+    logical_drive.set_device_path("/dev/" + volume_group_name
+                                  + "/" + logical_volume.get_name());
+    logical_drive.set_status({logical_volume.get_status(), logical_volume.get_health()});
+
+    return before != get_state(logical_drive);
+}
+
+bool set_target_data(Target& target_data, const tgt::TargetData& target,
+                     const IscsiData& iscsi_data) {
+    const auto before = get_state(target_data);
+
+    target_data.set_target_id(target.get_target_id());
+    target_data.set_target_iqn(target.get_target_iqn());
+    target_data.set_target_address(iscsi_data.get_portal_ip());
+    target_data.set_target_port(iscsi_data.get_portal_port());
+    target_data.set_status({"Enabled", "OK"});
+    target_data.set_initiator_iqn(target.get_target_initiator());
+
+    // LUNs are replaced only if changed, so resolved links are kept
+    const auto& luns = target.get_luns();
+    auto& target_luns = target_data.get_target_lun();
+    bool luns_changed = luns.size() != target_luns.size();
+    for (std::size_t i = 0; !luns_changed && i < luns.size(); ++i) {
+        luns_changed = luns[i]->get_lun() != target_luns[i].get_lun_id()
+            || luns[i]->get_device_path() != target_luns[i].get_device_path();
+    }
+    if (luns_changed) {
+        target_luns.clear();
+        for (const auto& lun : luns) {
+            Target::Lun lun_obj;
+            lun_obj.set_lun_id(lun->get_lun());
+            lun_obj.set_device_path(lun->get_device_path());
+            target_data.add_target_lun(std::move(lun_obj));
+        }
+    }
+
+    return luns_changed || before != get_state(target_data);
+}
+
+LogicalDrive::LogicalDriveSharedPtr
+make_volume_group(const LvmAPI::VolumeGroup& volume_group) {
+    auto logical_drive = LogicalDrive::make_logical_drive();
+    set_volume_group_data(*logical_drive, volume_group);
+
+    for (const auto& physical_volume : volume_group.physical_volumes) {
+        auto physical_drive = LogicalDrive::make_logical_drive();
+        set_physical_volume_data(*physical_drive, physical_volume);
+        logical_drive->add_logical_drive(physical_drive);
+    }
+
+    for (const auto& logical_volume : volume_group.logical_volumes) {
+        auto logical_drive_child = LogicalDrive::make_logical_drive();
+        set_logical_volume_data(*logical_drive_child, logical_volume,
+                                volume_group.get_name());
+        logical_drive->add_logical_drive(logical_drive_child);
+    }
+
+    return logical_drive;
+}
+
+/*!
+ * Apply discovered physical or logical volumes of one kind to volume group
+ * children, volumes are matched by name. Returns true if any child was
+ * added or removed.
+ * */
+template <typename Volume, typename Setter>
+bool update_volumes(LogicalDrive& volume_group, const char* mode,
+                    const std::vector<Volume>& volumes, Setter set_data,
+                    const std::string& parent,
+                    DiscoveryManager::EventMsgs& events) {
+    std::vector<LogicalDrive::LogicalDriveSharedPtr> current{};
+    for (const auto& child : volume_group.get_logical_drives()) {
+        if (0 == child->get_mode().compare(mode)) {
+            current.push_back(child);
+        }
+    }
+
+    bool structure_changed{false};
+    for (const auto& volume : volumes) {
+        auto it = std::find_if(current.begin(), current.end(),
+            [&volume](const LogicalDrive::LogicalDriveSharedPtr& child) {
+                return child->get_name() == volume.get_name();
+            });
+        if (current.end() == it) {
+            auto child = LogicalDrive::make_logical_drive();
+            set_data(*child, volume);
+            volume_group.add_logical_drive(child);
+            events.push_back(make_event(child->get_uuid(), parent,
+                    LOGICAL_DRIVE_TYPE, Transition::DISCOVERY_UP));
+            structure_changed = true;
+            continue;
+        }
+        if (set_data(**it, volume)) {
+            events.push_back(make_event((*it)->get_uuid(), parent,
+                    LOGICAL_DRIVE_TYPE, Transition::UPDATE));
+        }
+        current.erase(it);
+    }
+
+    for (const auto& removed : current) {
+        events.push_back(make_event(removed->get_uuid(), parent,
+                LOGICAL_DRIVE_TYPE, Transition::EXTRACTION));
+        volume_group.delete_logical_drive(removed->get_uuid());
+        structure_changed = true;
+    }
+    return structure_changed;
+}
+
+}
+
+std::mutex& agent::storage::discovery::get_model_mutex() {
+    static std::mutex model_mutex{};
+    return model_mutex;
+}
 
 struct DiscoveryManager::DiscoveryComplete {
-    void notify_discovery_complete() {
+    void notify_discovery_complete(EventMsgs&& events) {
         std::unique_lock<std::mutex> lock{m_mutex};
+        m_events.insert(m_events.end(), events.begin(), events.end());
         m_discovery_done = true;
         m_cv.notify_all();
         log_info(GET_LOGGER("storage"), " Discovery complete!");
@@ -65,10 +306,23 @@ struct DiscoveryManager::DiscoveryComplete {
         std::unique_lock<std::mutex> lock{m_mutex};
         m_cv.wait(lock, [this] { return m_discovery_done; });
     }
+
+    bool wait_for_discovery_complete(const std::chrono::milliseconds& timeout) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        return m_cv.wait_for(lock, timeout, [this] { return m_discovery_done; });
+    }
+
+    EventMsgs take_events() {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        EventMsgs events{};
+        events.swap(m_events);
+        return events;
+    }
 private:
     std::mutex m_mutex{};
     std::condition_variable m_cv{};
     volatile bool m_discovery_done{false};
+    EventMsgs m_events{};
 };
 
 DiscoveryManager::DiscoveryManager()
@@ -77,62 +331,88 @@ DiscoveryManager::DiscoveryManager()
 DiscoveryManager::~DiscoveryManager() {}
 
 void DiscoveryManager::discover(Module& module) const {
-    discovery_hard_drives(module);
-    discovery_logical_drives(module);
-    discovery_iscsi_targets(module);
-    resolve_dependencies(module);
-    m_discovery_complete->notify_discovery_complete();
+    // hard drives and targets go first, logical drives update links to them
+    auto events = update_hard_drives(module);
+    auto target_events = update_iscsi_targets(module);
+    events.insert(events.end(), target_events.begin(), target_events.end());
+    auto lvm_events = update_logical_drives(module);
+    events.insert(events.end(), lvm_events.begin(), lvm_events.end());
+    m_discovery_complete->notify_discovery_complete(std::move(events));
 }
 
 void DiscoveryManager::wait_for_discovery_complete() const {
     m_discovery_complete->wait_for_discovery_complete();
 }
 
-void DiscoveryManager::resolve_dependencies(Module& module) const {
-    StorageDependencyResolver storageDependencyResolver(module);
-    storageDependencyResolver.resolve();
+bool DiscoveryManager::wait_for_discovery_complete(
+        const std::chrono::milliseconds& timeout) const {
+    return m_discovery_complete->wait_for_discovery_complete(timeout);
 }
 
-void DiscoveryManager::discovery_hard_drives(Module& module) const {
+DiscoveryManager::EventMsgs DiscoveryManager::take_discovery_events() const {
+    return m_discovery_complete->take_events();
+}
+
+DiscoveryManager::EventMsgs
+DiscoveryManager::update_hard_drives(Module& module) const {
+    EventMsgs events{};
+    if (!module.get_submodules().size()) {
+        log_error(GET_LOGGER("storage"), "Submodules empty!");
+        return events;
+    }
     auto& submodule = module.get_submodules().front();
     auto& storage_controller = submodule->get_storage_controllers().front();
+    const auto parent = submodule->get_name();
     std::vector<SysfsAPI::HardDrive> bd_drives;
-    SysfsAPI* sysfs = SysfsAPI::get_instance();
-
-    sysfs->get_hard_drives(bd_drives);
-
-    for (auto& bd_drive : bd_drives) {
-
-        auto hard_drive = std::make_shared<HardDrive>();
-
-        hard_drive->set_name(bd_drive.get_name());
-        hard_drive->set_device_path(bd_drive.get_device_path());
-        hard_drive->set_capacity_gb(bd_drive.get_capacity_gb());
-        hard_drive->set_type(bd_drive.get_type());
-        hard_drive->set_interface(bd_drive.get_interface());
-        hard_drive->set_rpm(bd_drive.get_rpm());
-
-        FruInfo fru_info;
-        fru_info.set_manufacturer(bd_drive.get_manufacturer());
-        fru_info.set_model_number(bd_drive.get_model());
-        fru_info.set_serial_number(bd_drive.get_serial_number());
-        hard_drive->set_fru_info(fru_info);
+    SysfsAPI::get_instance()->get_hard_drives(bd_drives);
+
+    ModelLock lock{get_model_mutex()};
+    auto current = storage_controller->get_hard_drives();
+    for (const auto& bd_drive : bd_drives) {
+        auto it = std::find_if(current.begin(), current.end(),
+            [&bd_drive](const HardDrive::HardDriveSharedPtr& drive) {
+                return drive->get_name() == bd_drive.get_name();
+            });
+
+        if (current.end() == it) {
+            auto hard_drive = std::make_shared<HardDrive>();
+            set_hard_drive_data(*hard_drive, bd_drive);
+            storage_controller->add_hard_drive(hard_drive);
+            events.push_back(make_event(hard_drive->get_uuid(), parent,
+                    HARD_DRIVE_TYPE, Transition::DISCOVERY_UP));
+            continue;
+        }
 
-        hard_drive->set_status({"Enabled", "OK"});
+        if (set_hard_drive_data(**it, bd_drive)) {
+            events.push_back(make_event((*it)->get_uuid(), parent,
+                    HARD_DRIVE_TYPE, Transition::UPDATE));
+        }
+        current.erase(it);
+    }
 
-        storage_controller->add_hard_drive(std::move(hard_drive));
+    for (const auto& removed : current) {
+        log_info(GET_LOGGER("storage"), "Hard drive removed: "
+                << removed->get_name());
+        events.push_back(make_event(removed->get_uuid(), parent,
+                HARD_DRIVE_TYPE, Transition::EXTRACTION));
+        storage_controller->delete_hard_drive(removed->get_uuid());
     }
+    return events;
 }
 
-void DiscoveryManager::discovery_iscsi_targets(Module& module) const {
+DiscoveryManager::EventMsgs
+DiscoveryManager::update_iscsi_targets(Module& module) const {
     using namespace agent::storage::iscsi::tgt;
 
+    EventMsgs events{};
     if (!module.get_submodules().size()) {
         log_error(GET_LOGGER("storage"), "Submodules empty!");
-        return;
+        return events;
     }
     auto& submodule = module.get_submodules().front();
     const auto& iscsi_data = submodule->get_iscsi_data();
+    auto& target_manager = submodule->get_target_manager();
+    const auto parent = submodule->get_name();
 
     Manager manager;
     auto response = manager.show_targets();
@@ -140,90 +420,186 @@ void DiscoveryManager::discovery_iscsi_targets(Module& module) const {
         log_error(GET_LOGGER("storage"),
                 "ISCSI show target invalid response!" +
                 Errors::get_error_str(response.get_error()));
-        return;
+        return events;
     }
 
     auto& extra_data = response.get_extra_data();
     TargetParser parser{};
     std::string iscsi_text(extra_data.cbegin(), extra_data.cend());
     const auto targets = parser.parse(iscsi_text);
+
+    ModelLock lock{get_model_mutex()};
+    auto current = target_manager.get_targets();
     for (const auto& target : targets) {
-        auto target_data = Target::make_target();
-        target_data->set_target_id(target->get_target_id());
-        target_data->set_target_iqn(target->get_target_iqn());
-        target_data->set_target_address(iscsi_data.get_portal_ip());
-        target_data->set_target_port(iscsi_data.get_portal_port());
-        target_data->set_status({"Enabled", "OK"});
-        target_data->set_initiator_iqn(target->get_target_initiator());
-        for (const auto& lun : target->get_luns()) {
-            Target::Lun lun_obj;
-            lun_obj.set_lun_id(lun->get_lun());
-            lun_obj.set_device_path(lun->get_device_path());
-            target_data->add_target_lun(std::move(lun_obj));
+        auto it = std::find_if(current.begin(), current.end(),
+            [&target](const Target::TargetSharedPtr& target_data) {
+                return target_data->get_target_iqn() == target->get_target_iqn();
+            });
+
+        if (current.end() == it) {
+            auto target_data = Target::make_target();
+            set_target_data(*target_data, *target, iscsi_data);
+            log_debug(GET_LOGGER("storage"),
+                    "Add ISCSI Target: " << target_data->get_uuid());
+            target_manager.add_target(target_data);
+            events.push_back(make_event(target_data->get_uuid(), parent,
+                    TARGET_TYPE, Transition::DISCOVERY_UP));
+            continue;
+        }
+
+        if (set_target_data(**it, *target, iscsi_data)) {
+            events.push_back(make_event((*it)->get_uuid(), parent,
+                    TARGET_TYPE, Transition::UPDATE));
         }
+        current.erase(it);
+    }
 
-        log_debug(GET_LOGGER("storage"),
-                "Add ISCSI Target: " << target_data->get_uuid());
-        submodule->get_target_manager().add_target(std::move(target_data));
+    for (const auto& removed : current) {
+        events.push_back(make_event(removed->get_uuid(), parent,
+                TARGET_TYPE, Transition::EXTRACTION));
+        target_manager.remove_target(removed);
     }
+    return events;
 }
 
-void DiscoveryManager::discovery_logical_drives(Module& module) const {
+DiscoveryManager::EventMsgs
+DiscoveryManager::update_hard_drive(Module& module, const std::string& name) const {
+    EventMsgs events{};
     if (!module.get_submodules().size()) {
         log_error(GET_LOGGER("storage"), "Submodules empty!");
-        return;
+        return events;
     }
     auto& submodule = module.get_submodules().front();
+    auto& storage_controller = submodule->get_storage_controllers().front();
+    const auto parent = submodule->get_name();
+
+    // probe the drive first, it may take a while
+    SysfsAPI::HardDrive bd_drive{};
+    const bool present = SysfsAPI::get_instance()->get_hard_drive(name, bd_drive);
+
+    ModelLock lock{get_model_mutex()};
+    HardDrive::HardDriveSharedPtr hard_drive{};
+    for (const auto& drive : storage_controller->get_hard_drives()) {
+        if (drive->get_name() == name) {
+            hard_drive = drive;
+            break;
+        }
+    }
 
-    LvmAPI lvm_api;
+    if (!present) {
+        if (hard_drive) {
+            log_info(GET_LOGGER("storage"), "Hard drive removed: " << name);
+            events.push_back(make_event(hard_drive->get_uuid(), parent,
+                    HARD_DRIVE_TYPE, Transition::EXTRACTION));
+            storage_controller->delete_hard_drive(hard_drive->get_uuid());
+        }
+        return events;
+    }
+
+    if (!hard_drive) {
+        log_info(GET_LOGGER("storage"), "Hard drive added: " << name);
+        hard_drive = std::make_shared<HardDrive>();
+        set_hard_drive_data(*hard_drive, bd_drive);
+        storage_controller->add_hard_drive(hard_drive);
+        events.push_back(make_event(hard_drive->get_uuid(), parent,
+                HARD_DRIVE_TYPE, Transition::DISCOVERY_UP));
+    }
+    else if (set_hard_drive_data(*hard_drive, bd_drive)) {
+        events.push_back(make_event(hard_drive->get_uuid(), parent,
+                HARD_DRIVE_TYPE, Transition::UPDATE));
+    }
+    return events;
+}
 
-    static constexpr const char lvm_type_name[] = "LVM";
+DiscoveryManager::EventMsgs
+DiscoveryManager::update_logical_drives(Module& module) const {
+    EventMsgs events{};
+    if (!module.get_submodules().size()) {
+        log_error(GET_LOGGER("storage"), "Submodules empty!");
+        return events;
+    }
+    auto& submodule = module.get_submodules().front();
+    const auto parent = submodule->get_name();
+
+    LvmSession::get_instance().rescan();
 
+    LvmAPI lvm_api;
     std::vector<LvmAPI::VolumeGroup> volume_groups;
     lvm_api.discover_volume_groups_structure(volume_groups);
 
-    for(const auto& volume_group : volume_groups) {
-        auto logical_drive = LogicalDrive::make_logical_drive();
-
-        logical_drive->set_bootable(false);
-        logical_drive->set_name(volume_group.get_name());
-        logical_drive->set_mode(LogicalDrive::LvmTypes::VOLUME_GROUP);
-        logical_drive->set_type(lvm_type_name);
-        logical_drive->set_capacity_gb(volume_group.get_capacity_gb());
-        logical_drive->set_device_path("/dev/" + volume_group.get_name());
-        logical_drive->set_protected(volume_group.get_protection_status());
-        logical_drive->set_status({volume_group.get_status(), volume_group.get_health()});
-
-        for (const auto& physical_volume : volume_group.physical_volumes) {
-            auto physical_drive = LogicalDrive::make_logical_drive();
-
-            physical_drive->set_name(physical_volume.get_name());
-            physical_drive->set_capacity_gb(physical_volume.get_capacity_gb());
-            physical_drive->set_type(lvm_type_name);
-            physical_drive->set_protected(physical_volume.get_protection_status());
-            physical_drive->set_device_path(physical_volume.get_name());
-            physical_drive->set_mode(LogicalDrive::LvmTypes::PHYSICAL_VOLUME);
-            physical_drive->set_status({physical_volume.get_status(), physical_volume.get_health()});
-
-            logical_drive->add_logical_drive(physical_drive);
+    ModelLock lock{get_model_mutex()};
+    std::vector<LogicalDrive::LogicalDriveSharedPtr> current{};
+    for (const auto& logical_drive : submodule->get_logical_drives()) {
+        if (0 == logical_drive->get_mode().compare(
+                    LogicalDrive::LvmTypes::VOLUME_GROUP)) {
+            current.push_back(logical_drive);
         }
+    }
 
-        for (const auto& logical_volume : volume_group.logical_volumes) {
-            auto logical_drive_child = LogicalDrive::make_logical_drive();
+    for (const auto& volume_group : volume_groups) {
+        auto it = std::find_if(current.begin(), current.end(),
+            [&volume_group](const LogicalDrive::LogicalDriveSharedPtr& drive) {
+                return drive->get_name() == volume_group.get_name();
+            });
+
+        if (current.end() == it) {
+            auto logical_drive = make_volume_group(volume_group);
+            submodule->add_logical_drive(logical_drive);
+            events.push_back(make_event(logical_drive->get_uuid(), parent,
+                    LOGICAL_DRIVE_TYPE, Transition::DISCOVERY_UP));
+            for (const auto& child : logical_drive->get_logical_drives()) {
+                events.push_back(make_event(child->get_uuid(), parent,
+                        LOGICAL_DRIVE_TYPE, Transition::DISCOVERY_UP));
+            }
+            continue;
+        }
 
-            logical_drive_child->set_name(logical_volume.get_name());
-            logical_drive_child->set_protected(logical_volume.get_protection_status());
-            logical_drive_child->set_snapshot(logical_volume.get_snapshot_status());
-            logical_drive_child->set_mode(LogicalDrive::LvmTypes::LOGICAL_VOLUME);
-            logical_drive_child->set_capacity_gb(logical_volume.get_capacity_gb());
-            logical_drive_child->set_type(lvm_type_name);
-            logical_drive_child->set_device_path("/dev/" + volume_group.get_name()
-                                                + "/" + logical_volume.get_name());
-            logical_drive_child->set_status({logical_volume.get_status(), logical_volume.get_health()});
+        auto logical_drive = *it;
+        current.erase(it);
+        bool changed = set_volume_group_data(*logical_drive, volume_group);
+
+        const auto& vg_name = volume_group.get_name();
+        changed = update_volumes(*logical_drive,
+            LogicalDrive::LvmTypes::PHYSICAL_VOLUME,
+            volume_group.physical_volumes, set_physical_volume_data,
+            parent, events) || changed;
+        changed = update_volumes(*logical_drive,
+            LogicalDrive::LvmTypes::LOGICAL_VOLUME,
+            volume_group.logical_volumes,
+            [&vg_name](LogicalDrive& drive, const LvmAPI::LogicalVolume& lv) {
+                return set_logical_volume_data(drive, lv, vg_name);
+            }, parent, events) || changed;
+
+        // volume group links its children, so it is updated as well
+        if (changed) {
+            events.push_back(make_event(logical_drive->get_uuid(), parent,
+                    LOGICAL_DRIVE_TYPE, Transition::UPDATE));
+        }
+    }
 
-            logical_drive->add_logical_drive(logical_drive_child);
+    for (const auto& removed : current) {
+        for (const auto& child : removed->get_logical_drives()) {
+            events.push_back(make_event(child->get_uuid(), parent,
+                    LOGICAL_DRIVE_TYPE, Transition::EXTRACTION));
         }
+        events.push_back(make_event(removed->get_uuid(), parent,
+                LOGICAL_DRIVE_TYPE, Transition::EXTRACTION));
+        submodule->delete_logical_drive(removed->get_uuid());
+    }
 
-        submodule->add_logical_drive(logical_drive);
+    // resolving works on the in-memory model only and keeps links which
+    // are already resolved, so hotplugged hard drives get linked as well
+    LogicalDriveDependencyResolver drive_resolver(module);
+    drive_resolver.initialize();
+    drive_resolver.resolve();
+
+    IscsiTargetDependencyResolver target_resolver(module);
+    target_resolver.initialize();
+    for (const auto& target : submodule->get_targets()) {
+        if (target_resolver.resolve_iscsi_target(target)) {
+            events.push_back(make_event(target->get_uuid(), parent,
+                    TARGET_TYPE, Transition::UPDATE));
+        }
     }
+    return events;
 }
@@ -0,0 +1,373 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file discovery_snapshot.cpp
+ *
+ * @brief Last discovered storage model persisted between agent restarts.
+ * */
+
+#include "discovery/discovery_snapshot.hpp"
+#include "discovery/model_lock.hpp"
+#include "discovery/dependency_resolver/storage_dependency_resolver.hpp"
+
+#include "agent-framework/module/hard_drive.hpp"
+#include "agent-framework/module/logical_drive.hpp"
+#include "agent-framework/module/target.hpp"
+#include "agent-framework/logger_ext.hpp"
+
+#include "configuration/utils.hpp"
+#include "json/json.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+using namespace agent::storage::discovery;
+
+using agent_framework::generic::Module;
+using agent_framework::generic::Submodule;
+using agent_framework::generic::Status;
+using HardDrive = agent_framework::generic::HardDrive;
+using LogicalDrive = agent_framework::generic::LogicalDrive;
+using Target = agent_framework::generic::Target;
+
+namespace {
+
+/*! Snapshots written by other format versions are ignored */
+constexpr json::Uint SNAPSHOT_VERSION = 1;
+
+/*! State of components restored from snapshot until discovery confirms them */
+constexpr const char STALE_STATE[] = "Starting";
+
+bool file_exists(const std::string& file_name) {
+    struct stat buf;
+    return (0 == stat(file_name.c_str(), &buf));
+}
+
+json::Value status_to_json(const Status& status) {
+    json::Value value{json::Value::Type::OBJECT};
+    value["state"] = status.get_state();
+    value["health"] = status.get_health();
+    return value;
+}
+
+Status stale_status(const json::Value& value) {
+    return Status{STALE_STATE, value["health"].as_string()};
+}
+
+json::Value hard_drive_to_json(HardDrive& hard_drive) {
+    const auto& fru_info = hard_drive.get_fru_info();
+    json::Value value{json::Value::Type::OBJECT};
+    value["uuid"] = hard_drive.get_uuid();
+    value["name"] = hard_drive.get_name();
+    value["devicePath"] = hard_drive.get_device_path();
+    value["interface"] = hard_drive.get_interface();
+    value["type"] = hard_drive.get_type();
+    value["capacityGB"] = json::Uint(hard_drive.get_capacity_gb());
+    value["rpm"] = json::Uint(hard_drive.get_rpm());
+    value["fruInfo"]["serialNumber"] = fru_info.get_serial_number();
+    value["fruInfo"]["manufacturer"] = fru_info.get_manufacturer();
+    value["fruInfo"]["modelNumber"] = fru_info.get_model_number();
+    value["fruInfo"]["partNumber"] = fru_info.get_part_number();
+    value["status"] = status_to_json(hard_drive.get_status());
+    return value;
+}
+
+HardDrive::HardDriveSharedPtr hard_drive_from_json(const json::Value& value) {
+    auto hard_drive = std::make_shared<HardDrive>();
+    hard_drive->read_configuration(value);
+    hard_drive->set_uuid(value["uuid"].as_string());
+    hard_drive->set_name(value["name"].as_string());
+    hard_drive->set_device_path(value["devicePath"].as_string());
+    hard_drive->set_status(stale_status(value["status"]));
+    return hard_drive;
+}
+
+json::Value logical_drive_to_json(LogicalDrive& logical_drive) {
+    json::Value value{json::Value::Type::OBJECT};
+    value["uuid"] = logical_drive.get_uuid();
+    value["name"] = logical_drive.get_name();
+    value["devicePath"] = logical_drive.get_device_path();
+    value["type"] = logical_drive.get_type();
+    value["mode"] = logical_drive.get_mode();
+    value["master"] = logical_drive.get_master();
+    value["capacityGB"] = json::Double(logical_drive.get_capacity_gb());
+    value["bootable"] = logical_drive.is_bootable();
+    value["protected"] = logical_drive.is_protected();
+    value["snapshot"] = logical_drive.is_snapshot();
+    value["status"] = status_to_json(logical_drive.get_status());
+    value["logicalDrives"] = json::Value::Type::ARRAY;
+    for (const auto& child : logical_drive.get_logical_drives()) {
+        value["logicalDrives"].push_back(logical_drive_to_json(*child));
+    }
+    return value;
+}
+
+LogicalDrive::LogicalDriveSharedPtr
+logical_drive_from_json(const json::Value& value) {
+    auto logical_drive = LogicalDrive::make_logical_drive();
+    logical_drive->set_uuid(value["uuid"].as_string());
+    logical_drive->set_name(value["name"].as_string());
+    logical_drive->set_device_path(value["devicePath"].as_string());
+    logical_drive->set_type(value["type"].as_string());
+    logical_drive->set_mode(value["mode"].as_string());
+    logical_drive->set_master(value["master"].as_string());
+    logical_drive->set_capacity_gb(value["capacityGB"].as_double());
+    logical_drive->set_bootable(value["bootable"].as_bool());
+    logical_drive->set_protected(value["protected"].as_bool());
+    logical_drive->set_snapshot(value["snapshot"].as_bool());
+    logical_drive->set_status(stale_status(value["status"]));
+    for (const auto& child : value["logicalDrives"].as_array()) {
+        logical_drive->add_logical_drive(logical_drive_from_json(child));
+    }
+    return logical_drive;
+}
+
+json::Value target_to_json(Target& target) {
+    json::Value value{json::Value::Type::OBJECT};
+    value["uuid"] = target.get_uuid();
+    value["targetId"] = json::Int(target.get_target_id());
+    value["targetIQN"] = target.get_target_iqn();
+    value["targetAddress"] = target.get_target_address();
+    value["targetPort"] = json::Uint(target.get_target_port());
+    value["initiatorIQN"] = target.get_initiator_iqn();
+    value["status"] = status_to_json(target.get_status());
+    value["targetLUN"] = json::Value::Type::ARRAY;
+    for (const auto& lun : target.get_target_lun()) {
+        json::Value lun_value{json::Value::Type::OBJECT};
+        lun_value["lun"] = json::Uint(lun.get_lun_id());
+        lun_value["devicePath"] = lun.get_device_path();
+        value["targetLUN"].push_back(lun_value);
+    }
+    return value;
+}
+
+Target::TargetSharedPtr target_from_json(const json::Value& value) {
+    auto target = Target::make_target();
+    target->set_uuid(value["uuid"].as_string());
+    target->set_target_id(value["targetId"].as_int());
+    target->set_target_iqn(value["targetIQN"].as_string());
+    target->set_target_address(value["targetAddress"].as_string());
+    target->set_target_port(value["targetPort"].as_uint());
+    target->set_initiator_iqn(value["initiatorIQN"].as_string());
+    target->set_status(stale_status(value["status"]));
+    for (const auto& lun_value : value["targetLUN"].as_array()) {
+        Target::Lun lun;
+        lun.set_lun_id(lun_value["lun"].as_uint());
+        lun.set_device_path(lun_value["devicePath"].as_string());
+        target->add_target_lun(std::move(lun));
+    }
+    return target;
+}
+
+json::Value submodule_to_json(Submodule& submodule) {
+    json::Value value{json::Value::Type::OBJECT};
+    value["uuid"] = submodule.get_name();
+    value["hardDrives"] = json::Value::Type::ARRAY;
+    for (const auto& hard_drive : submodule.get_hard_drives()) {
+        value["hardDrives"].push_back(hard_drive_to_json(*hard_drive));
+    }
+    value["logicalDrives"] = json::Value::Type::ARRAY;
+    for (const auto& logical_drive : submodule.get_logical_drives()) {
+        value["logicalDrives"].push_back(logical_drive_to_json(*logical_drive));
+    }
+    value["targets"] = json::Value::Type::ARRAY;
+    for (const auto& target : submodule.get_targets()) {
+        value["targets"].push_back(target_to_json(*target));
+    }
+    return value;
+}
+
+/*! Components of one submodule, applied only when whole snapshot is valid */
+struct RestoredSubmodule {
+    Submodule* submodule{nullptr};
+    std::string uuid{};
+    std::vector<HardDrive::HardDriveSharedPtr> hard_drives{};
+    std::vector<LogicalDrive::LogicalDriveSharedPtr> logical_drives{};
+    std::vector<Target::TargetSharedPtr> targets{};
+};
+
+struct RestoredModule {
+    Module* module{nullptr};
+    std::string uuid{};
+    std::vector<RestoredSubmodule> submodules{};
+};
+
+RestoredSubmodule submodule_from_json(Submodule& submodule,
+                                      const json::Value& value) {
+    if (submodule.get_storage_controllers().empty()) {
+        throw std::runtime_error("Submodule has no storage controller.");
+    }
+
+    RestoredSubmodule restored{};
+    restored.submodule = &submodule;
+    restored.uuid = value["uuid"].as_string();
+    for (const auto& hard_drive : value["hardDrives"].as_array()) {
+        restored.hard_drives.push_back(hard_drive_from_json(hard_drive));
+    }
+    for (const auto& logical_drive : value["logicalDrives"].as_array()) {
+        restored.logical_drives.push_back(logical_drive_from_json(logical_drive));
+    }
+    for (const auto& target : value["targets"].as_array()) {
+        restored.targets.push_back(target_from_json(target));
+    }
+    return restored;
+}
+
+RestoredModule module_from_json(Module& module, const json::Value& value) {
+    auto& submodules = module.get_submodules();
+    const auto& submodules_json = value["submodules"].as_array();
+    if (submodules.size() != submodules_json.size()) {
+        throw std::runtime_error("Submodules do not match configuration.");
+    }
+
+    RestoredModule restored{};
+    restored.module = &module;
+    restored.uuid = value["uuid"].as_string();
+    for (std::size_t i = 0; i < submodules.size(); ++i) {
+        restored.submodules.push_back(
+                submodule_from_json(*submodules[i], submodules_json[i]));
+    }
+    return restored;
+}
+
+void apply(RestoredModule& restored) {
+    restored.module->set_name(restored.uuid);
+    for (auto& restored_submodule : restored.submodules) {
+        auto* submodule = restored_submodule.submodule;
+        auto& storage_controller = submodule->get_storage_controllers().front();
+        submodule->set_name(restored_submodule.uuid);
+        for (auto& hard_drive : restored_submodule.hard_drives) {
+            storage_controller->add_hard_drive(std::move(hard_drive));
+        }
+        for (auto& logical_drive : restored_submodule.logical_drives) {
+            submodule->add_logical_drive(std::move(logical_drive));
+        }
+        for (const auto& target : restored_submodule.targets) {
+            submodule->get_target_manager().add_target(target);
+        }
+    }
+
+    // links between components are not stored, resolve them again
+    StorageDependencyResolver dependency_resolver(*restored.module);
+    dependency_resolver.resolve();
+}
+
+}
+
+DiscoverySnapshot::DiscoverySnapshot(const std::string& path) : m_path{path} {}
+
+bool DiscoverySnapshot::load(Modules& modules) const {
+    if (m_path.empty() || !file_exists(m_path)) {
+        return false;
+    }
+
+    std::vector<RestoredModule> restored_modules{};
+    try {
+        json::Value snapshot;
+        configuration::file_to_json(m_path, snapshot);
+        if (!snapshot["version"].is_uint()
+            || SNAPSHOT_VERSION != snapshot["version"].as_uint()) {
+            log_warning(GET_LOGGER("storage"),
+                    "Unsupported discovery snapshot version: " << m_path);
+            return false;
+        }
+
+        for (auto& module : modules) {
+            for (const auto& module_json : snapshot["modules"].as_array()) {
+                if (module_json["ipv4"].as_string() == module->get_ip_address()) {
+                    restored_modules.push_back(
+                            module_from_json(*module, module_json));
+                    break;
+                }
+            }
+        }
+        if (restored_modules.size() != modules.size()) {
+            log_warning(GET_LOGGER("storage"), "Discovery snapshot "
+                    << m_path << " does not match configured modules.");
+            return false;
+        }
+
+        for (auto& restored : restored_modules) {
+            apply(restored);
+        }
+    }
+    catch (const std::exception& e) {
+        log_warning(GET_LOGGER("storage"), "Cannot load discovery snapshot "
+                << m_path << ": " << e.what());
+        return false;
+    }
+    catch (const uuid_error_t&) {
+        log_warning(GET_LOGGER("storage"), "Cannot load discovery snapshot "
+                << m_path << ": invalid UUID.");
+        return false;
+    }
+
+    log_info(GET_LOGGER("storage"), "Discovery snapshot loaded: " << m_path);
+    return true;
+}
+
+bool DiscoverySnapshot::save(const Modules& modules) const {
+    if (m_path.empty()) {
+        return false;
+    }
+
+    json::Value snapshot{json::Value::Type::OBJECT};
+    snapshot["version"] = SNAPSHOT_VERSION;
+    snapshot["modules"] = json::Value::Type::ARRAY;
+    std::unique_lock<std::mutex> lock{get_model_mutex()};
+    for (const auto& module : modules) {
+        json::Value module_json{json::Value::Type::OBJECT};
+        module_json["ipv4"] = module->get_ip_address();
+        module_json["uuid"] = module->get_name();
+        module_json["submodules"] = json::Value::Type::ARRAY;
+        for (const auto& submodule : module->get_submodules()) {
+            module_json["submodules"].push_back(submodule_to_json(*submodule));
+        }
+        snapshot["modules"].push_back(module_json);
+    }
+    lock.unlock();
+
+    const std::string temporary_path = m_path + ".tmp";
+    try {
+        configuration::json_to_file(temporary_path, snapshot);
+    }
+    catch (const std::ios_base::failure&) {
+        log_warning(GET_LOGGER("storage"),
+                "Cannot write discovery snapshot: " << temporary_path);
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+
+    if (0 != std::rename(temporary_path.c_str(), m_path.c_str())) {
+        log_warning(GET_LOGGER("storage"),
+                "Cannot replace discovery snapshot: " << m_path);
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+
+    log_debug(GET_LOGGER("storage"), "Discovery snapshot saved: " << m_path);
+    return true;
+}
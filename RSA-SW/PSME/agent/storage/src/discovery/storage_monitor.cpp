@@ -0,0 +1,295 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file storage_monitor.cpp
+ *
+ * @brief Incremental discovery driven by udev and LVM change notifications.
+ * */
+
+#include "discovery/storage_monitor.hpp"
+#include "agent-framework/eventing/event_msg.hpp"
+
+#ifdef UDEV_FOUND
+#include <libudev.h>
+#endif
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+using namespace agent::storage::discovery;
+
+namespace {
+
+/*! LVM tools write metadata backup after every change */
+constexpr const char LVM_BACKUP_DIR[] = "/etc/lvm/backup";
+
+/*! Poll timeout used to check if the monitor is still running */
+constexpr int POLL_TIMEOUT_MS = 1000;
+
+/*! Changes are handled when no new event came for this time */
+constexpr int SETTLE_TIME_MS = 500;
+
+#ifdef UDEV_FOUND
+/*! Device mapper devices (LVM logical volumes) are virtual block devices */
+bool is_virtual_device(const char* devpath) {
+    return nullptr != devpath && nullptr != std::strstr(devpath, "/virtual/");
+}
+#endif
+
+}
+
+StorageMonitor::StorageMonitor(const DiscoveryManager& discovery_manager,
+                               const DiscoverySnapshot& snapshot)
+    : m_discovery_manager{discovery_manager}, m_snapshot{snapshot} {}
+
+StorageMonitor::~StorageMonitor() {
+    stop();
+}
+
+void StorageMonitor::start() {
+    if (!m_running) {
+        m_running = true;
+        m_thread = std::thread(&StorageMonitor::m_task, this);
+    }
+}
+
+void StorageMonitor::stop() {
+    if (m_running) {
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+}
+
+bool StorageMonitor::m_open() {
+#ifdef UDEV_FOUND
+    m_udev = udev_new();
+    if (nullptr != m_udev) {
+        m_udev_monitor = udev_monitor_new_from_netlink(m_udev, "udev");
+    }
+    if (nullptr == m_udev_monitor
+        || 0 != udev_monitor_filter_add_match_subsystem_devtype(
+                    m_udev_monitor, "block", "disk")
+        || 0 != udev_monitor_enable_receiving(m_udev_monitor)) {
+        log_warning(GET_LOGGER("storage-agent"),
+                "Cannot monitor udev block events, hotplug is not detected.");
+        if (nullptr != m_udev_monitor) {
+            udev_monitor_unref(m_udev_monitor);
+            m_udev_monitor = nullptr;
+        }
+    }
+#endif
+
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (0 > m_inotify_fd
+        || 0 > inotify_add_watch(m_inotify_fd, LVM_BACKUP_DIR,
+                                 IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE)) {
+        log_warning(GET_LOGGER("storage-agent"), "Cannot watch "
+                << LVM_BACKUP_DIR << ": " << std::strerror(errno));
+        if (0 <= m_inotify_fd) {
+            close(m_inotify_fd);
+            m_inotify_fd = -1;
+        }
+    }
+
+#ifdef UDEV_FOUND
+    return nullptr != m_udev_monitor || 0 <= m_inotify_fd;
+#else
+    return 0 <= m_inotify_fd;
+#endif
+}
+
+void StorageMonitor::m_close() {
+#ifdef UDEV_FOUND
+    if (nullptr != m_udev_monitor) {
+        udev_monitor_unref(m_udev_monitor);
+        m_udev_monitor = nullptr;
+    }
+    if (nullptr != m_udev) {
+        udev_unref(m_udev);
+        m_udev = nullptr;
+    }
+#endif
+    if (0 <= m_inotify_fd) {
+        close(m_inotify_fd);
+        m_inotify_fd = -1;
+    }
+}
+
+void StorageMonitor::m_task() {
+    log_info(GET_LOGGER("storage-agent"), "Starting storage monitor...");
+
+    if (!m_open()) {
+        log_error(GET_LOGGER("storage-agent"),
+                "Storage monitor has nothing to watch, stopping.");
+        m_close();
+        return;
+    }
+
+    // notifications received meanwhile are queued by the kernel
+    if (!m_wait_for_discovery()) {
+        m_close();
+        return;
+    }
+
+    while (m_running) {
+        struct pollfd fds[2]{};
+        nfds_t count = 0;
+#ifdef UDEV_FOUND
+        const nfds_t udev_index = count;
+        if (nullptr != m_udev_monitor) {
+            fds[count].fd = udev_monitor_get_fd(m_udev_monitor);
+            fds[count++].events = POLLIN;
+        }
+#endif
+        const nfds_t inotify_index = count;
+        if (0 <= m_inotify_fd) {
+            fds[count].fd = m_inotify_fd;
+            fds[count++].events = POLLIN;
+        }
+
+        const bool pending = m_lvm_changed || !m_changed_drives.empty();
+        const int ret = poll(fds, count,
+                             pending ? SETTLE_TIME_MS : POLL_TIMEOUT_MS);
+        if (0 > ret) {
+            if (EINTR == errno) {
+                continue;
+            }
+            log_error(GET_LOGGER("storage-agent"), "Storage monitor poll failed: "
+                    << std::strerror(errno));
+            break;
+        }
+
+        if (0 == ret) {
+            if (pending) {
+                m_handle_changes();
+            }
+            continue;
+        }
+
+#ifdef UDEV_FOUND
+        if (nullptr != m_udev_monitor && (fds[udev_index].revents & POLLIN)) {
+            m_read_udev_events();
+        }
+#endif
+        if (0 <= m_inotify_fd && (fds[inotify_index].revents & POLLIN)) {
+            m_read_lvm_events();
+        }
+    }
+
+    m_close();
+    log_info(GET_LOGGER("storage-agent"), "Storage monitor is stopped.");
+}
+
+bool StorageMonitor::m_wait_for_discovery() {
+    while (!m_discovery_manager.wait_for_discovery_complete(
+                std::chrono::milliseconds(POLL_TIMEOUT_MS))) {
+        if (!m_running) {
+            return false;
+        }
+    }
+
+    const auto events = m_discovery_manager.take_discovery_events();
+    log_info(GET_LOGGER("storage-agent"), "Discovery changed "
+            << events.size() << " components.");
+    for (const auto& event : events) {
+        notify_all(event);
+    }
+    m_snapshot.save(ModuleManager::get_modules());
+    return true;
+}
+
+void StorageMonitor::m_read_udev_events() {
+#ifdef UDEV_FOUND
+    struct udev_device* device = udev_monitor_receive_device(m_udev_monitor);
+    if (nullptr == device) {
+        return;
+    }
+
+    const char* action = udev_device_get_action(device);
+    const char* sysname = udev_device_get_sysname(device);
+    log_debug(GET_LOGGER("storage-agent"), "udev event: "
+            << (action ? action : "?") << " " << (sysname ? sysname : "?"));
+
+    if (is_virtual_device(udev_device_get_devpath(device))) {
+        // logical volume was activated or removed
+        m_lvm_changed = true;
+    }
+    else if (nullptr != sysname) {
+        m_changed_drives.insert(sysname);
+    }
+    udev_device_unref(device);
+#endif
+}
+
+void StorageMonitor::m_read_lvm_events() {
+    alignas(struct inotify_event) char buffer[4096];
+    while (0 < read(m_inotify_fd, buffer, sizeof(buffer))) {
+        m_lvm_changed = true;
+    }
+}
+
+void StorageMonitor::m_handle_changes() {
+    DiscoveryManager::EventMsgs events{};
+
+    // updates take the model lock themselves, so commands are served
+    // between single drive updates and the LVM rescan
+    try {
+        for (auto& module : ModuleManager::get_modules()) {
+            for (const auto& name : m_changed_drives) {
+                auto drive_events =
+                    m_discovery_manager.update_hard_drive(*module, name);
+                events.insert(events.end(),
+                              drive_events.begin(), drive_events.end());
+            }
+
+            // physical volumes may live on changed drives
+            auto lvm_events = m_discovery_manager.update_logical_drives(*module);
+            events.insert(events.end(), lvm_events.begin(), lvm_events.end());
+        }
+    }
+    catch (const std::exception& e) {
+        log_error(GET_LOGGER("storage-agent"),
+                "Incremental discovery failed: " << e.what());
+    }
+
+    m_changed_drives.clear();
+    m_lvm_changed = false;
+
+    m_publish(events);
+}
+
+void StorageMonitor::m_publish(const DiscoveryManager::EventMsgs& events) {
+    if (events.empty()) {
+        return;
+    }
+    for (const auto& event : events) {
+        notify_all(event);
+    }
+    m_snapshot.save(ModuleManager::get_modules());
+}
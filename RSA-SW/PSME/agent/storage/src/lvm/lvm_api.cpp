@@ -26,6 +26,7 @@
  * @brief C++ wrapper for Liblvm
  * */
 #include "lvm_api.hpp"
+#include "lvm_session.hpp"
 #include "agent-framework/logger_ext.hpp"
 #include "agent-framework/exceptions/exception.hpp"
 
@@ -42,55 +43,37 @@ bool LvmAPI::remove_logical_volume(const char *vg_name, const char *lv_name) {
         return false;
     }
 
-    vg_t vg_handle = nullptr;
-    lv_t lv_handle = nullptr;
-    lvm_t lvm_handle = nullptr;
-    int ret = 0;
+    auto& session = LvmSession::get_instance();
+    std::lock_guard<std::recursive_mutex> lock{session.get_mutex()};
 
-    lvm_handle = lvm_init(nullptr);
+    lvm_t lvm_handle = session.get_handle();
     if (nullptr == lvm_handle) {
-        log_error(GET_LOGGER("lvm"), "Could not open handle to LVM.");
         return false;
     }
 
-    vg_handle = lvm_vg_open(lvm_handle, vg_name, WRITE_MODE, flags);
+    vg_t vg_handle = session.open_volume_group(vg_name, WRITE_MODE);
     if (nullptr == vg_handle) {
-        log_error(GET_LOGGER("lvm"), "Could not open volume group: "
-                << lvm_errmsg(lvm_handle));
-        lvm_quit(lvm_handle);
         return false;
     }
 
-    lv_handle = lvm_lv_from_name(vg_handle, lv_name);
+    lv_t lv_handle = lvm_lv_from_name(vg_handle, lv_name);
     if (nullptr == lv_handle) {
         log_error(GET_LOGGER("lvm"), "Could not open logical volume: "
                 << lvm_errmsg(lvm_handle));
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         return false;
     }
 
-    ret = lvm_vg_remove_lv(lv_handle);
-    if (0 != ret) {
+    if (0 != lvm_vg_remove_lv(lv_handle)) {
         log_error(GET_LOGGER("lvm"), "Could not remove logical volume: "
                 << lvm_errmsg(lvm_handle));
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
-        return false;
-    }
-
-    ret = lvm_vg_write(vg_handle);
-    if (0 != ret) {
-        log_error(GET_LOGGER("lvm"), "Could not save changes to volume group: "
-                << lvm_errmsg(lvm_handle));
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         return false;
     }
 
-    lvm_vg_close(vg_handle);
-    lvm_quit(lvm_handle);
-    return true;
+    const bool status = session.write_volume_group(vg_handle);
+    session.close_volume_group(vg_handle);
+    return status;
 }
 
 bool LvmAPI::create_snapshot(const char *vg_name, const char *lv_name, const char *snapshot_name, uint64_t size_bytes) {
@@ -105,43 +88,40 @@ bool LvmAPI::create_snapshot(const char *vg_name, const char *lv_name, const cha
             "Snapshot size must be above 0.");
     }
 
-    vg_t vg_handle = nullptr;
-    lvm_t lvm_handle = nullptr;
-    lv_t lv_handle = nullptr, snapshot_handle = nullptr;
-    lvm_handle = lvm_init(nullptr);
+    auto& session = LvmSession::get_instance();
+    std::lock_guard<std::recursive_mutex> lock{session.get_mutex()};
 
+    lvm_t lvm_handle = session.get_handle();
     if (nullptr == lvm_handle) {
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not open handle to LVM");
     }
 
-    vg_handle = lvm_vg_open(lvm_handle, vg_name, WRITE_MODE, flags);
+    vg_t vg_handle = session.open_volume_group(vg_name, WRITE_MODE);
     if (nullptr == vg_handle) {
-        lvm_quit(lvm_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not open volume group");
     }
 
-    lv_handle = lvm_lv_from_name(vg_handle, lv_name);
+    lv_t lv_handle = lvm_lv_from_name(vg_handle, lv_name);
     if (nullptr == lv_handle) {
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not open logical volume");
     }
 
-    snapshot_handle = lvm_lv_snapshot(lv_handle, snapshot_name, size_bytes);
+    // lvm_lv_snapshot commits metadata itself, only the cache is stale now
+    lv_t snapshot_handle = lvm_lv_snapshot(lv_handle, snapshot_name, size_bytes);
+    session.invalidate();
     if (nullptr == snapshot_handle) {
         log_error(GET_LOGGER("lvm"), "Could not create snapshot: "
                 << lvm_errmsg(lvm_handle));
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not create snapshot");
     }
 
-    lvm_vg_close(vg_handle);
-    lvm_quit(lvm_handle);
+    session.close_volume_group(vg_handle);
     return true;
 }
 
@@ -152,48 +132,44 @@ bool LvmAPI::create_clone(const char *vg_name, const char *lv_name, const char *
             "Could not read create parameters");
     }
 
-    vg_t vg_handle = nullptr;
-    lvm_t lvm_handle = nullptr;
-    lv_t lv_handle = nullptr, clone_handle = nullptr;
-    lvm_handle = lvm_init(nullptr);
+    auto& session = LvmSession::get_instance();
+    std::lock_guard<std::recursive_mutex> lock{session.get_mutex()};
 
+    lvm_t lvm_handle = session.get_handle();
     if (nullptr == lvm_handle) {
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not open handle to LVM");
     }
 
-    vg_handle = lvm_vg_open(lvm_handle, vg_name, WRITE_MODE, flags);
+    vg_t vg_handle = session.open_volume_group(vg_name, WRITE_MODE);
     if (nullptr == vg_handle) {
-        lvm_quit(lvm_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not open volume group");
     }
 
-    lv_handle = lvm_lv_from_name(vg_handle, lv_name);
+    lv_t lv_handle = lvm_lv_from_name(vg_handle, lv_name);
     if (nullptr == lv_handle) {
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not open logical volume");
     }
 
     if (size_bytes < lvm_lv_get_size(lv_handle)) {
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not create clone size is smaller than source size.");
     }
 
-    clone_handle = lvm_vg_create_lv_linear(vg_handle, clone_name, size_bytes);
+    // lvm_vg_create_lv_linear commits metadata itself, only the cache is stale now
+    lv_t clone_handle = lvm_vg_create_lv_linear(vg_handle, clone_name, size_bytes);
+    session.invalidate();
     if (nullptr == clone_handle) {
-        lvm_vg_close(vg_handle);
-        lvm_quit(lvm_handle);
+        session.close_volume_group(vg_handle);
         THROW(agent_framework::exceptions::LvmError, "lvm",
             "Could not create clone.");
     }
 
-    lvm_vg_close(vg_handle);
-    lvm_quit(lvm_handle);
+    session.close_volume_group(vg_handle);
 
     return true;
 }
@@ -275,11 +251,16 @@ void LvmAPI::m_discover_logical_volumes(LvmAPI::VolumeGroup& volume_group, vg_t&
 
 void LvmAPI::discover_volume_groups_structure(vector<LvmAPI::VolumeGroup>& volume_groups) {
 
-    lvm_t handle = nullptr;
-    handle = lvm_init(nullptr);
+    auto& session = LvmSession::get_instance();
+    std::lock_guard<std::recursive_mutex> lock{session.get_mutex()};
+
+    if (session.get_cached_volume_groups(volume_groups)) {
+        log_debug(GET_LOGGER("lvm"), "Volume groups read from cache.");
+        return;
+    }
 
+    lvm_t handle = session.get_handle();
     if (nullptr == handle) {
-        log_error(GET_LOGGER("lvm"), "Could not open handle to LVM.");
         return;
     }
 
@@ -291,16 +272,13 @@ void LvmAPI::discover_volume_groups_structure(vector<LvmAPI::VolumeGroup>& volum
     if (nullptr == vgnames) {
         log_error(GET_LOGGER("lvm"), "Could not open volume group list: "
                 << lvm_errmsg(handle));
-        lvm_quit(handle);
         return;
     }
 
+    vector<VolumeGroup> discovered{};
     dm_list_iterate_items(str_list, vgnames) {
-        vg = lvm_vg_open(handle, str_list->str, READ_MODE, flags);
+        vg = session.open_volume_group(str_list->str, READ_MODE);
         if (nullptr == vg) {
-            log_error(GET_LOGGER("lvm"), "Could not open volume group: "
-                    << lvm_errmsg(handle));
-            lvm_quit(handle);
             return;
         }
         VolumeGroup volume_group;
@@ -325,11 +303,12 @@ void LvmAPI::discover_volume_groups_structure(vector<LvmAPI::VolumeGroup>& volum
         m_discover_physical_volumes(volume_group, vg, handle);
         m_discover_logical_volumes(volume_group, vg, handle);
 
-        lvm_vg_close(vg);
-        volume_groups.push_back(volume_group);
+        session.close_volume_group(vg);
+        discovered.push_back(volume_group);
     }
-    lvm_quit(handle);
 
+    session.set_cached_volume_groups(discovered);
+    volume_groups.insert(volume_groups.end(), discovered.cbegin(), discovered.cend());
 }
 
 #endif
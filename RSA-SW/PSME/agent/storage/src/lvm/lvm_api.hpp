@@ -53,6 +53,8 @@ using std::string;
 
 /*!
  * @brief C++ wrapper for liblvm2app
+ *
+ * All LvmAPI objects share one lvm handle and structure cache, see LvmSession.
  */
 class LvmAPI {
 public:
@@ -448,9 +450,6 @@ private:
     static constexpr const char *state_enabled = "Enabled";
     static constexpr const char *state_disabled = "Disabled";
 
-    //default flag for lvm handle
-    static constexpr uint32_t flags = 0;
-
     //lvm attribute properties for LV, VG, PV
     static constexpr const char *lv_attr_property = "lv_attr";
     static constexpr const char *vg_attr_property = "vg_attr";
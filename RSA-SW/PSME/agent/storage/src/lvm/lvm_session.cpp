@@ -0,0 +1,147 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file lvm_session.cpp
+ *
+ * @brief Long-lived liblvm2app handle shared by all LvmAPI objects
+ * */
+
+#include "lvm_session.hpp"
+#include "agent-framework/logger_ext.hpp"
+
+using namespace agent::storage::lvm;
+
+namespace {
+LvmSession* g_lvm_session = nullptr;
+std::mutex g_lvm_session_mutex{};
+}
+
+LvmSession& LvmSession::get_instance() {
+    std::lock_guard<std::mutex> lock{g_lvm_session_mutex};
+    /* created again if used after cleanup() */
+    if (nullptr == g_lvm_session) {
+        g_lvm_session = new LvmSession;
+    }
+    return *g_lvm_session;
+}
+
+void LvmSession::cleanup() {
+    std::lock_guard<std::mutex> lock{g_lvm_session_mutex};
+    delete g_lvm_session;
+    g_lvm_session = nullptr;
+}
+
+bool LvmSession::get_cached_volume_groups(VolumeGroups& volume_groups) const {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    if (!m_cache_valid) {
+        return false;
+    }
+    volume_groups.insert(volume_groups.end(),
+            m_volume_groups.cbegin(), m_volume_groups.cend());
+    return true;
+}
+
+void LvmSession::set_cached_volume_groups(const VolumeGroups& volume_groups) {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    m_volume_groups = volume_groups;
+    m_cache_valid = true;
+}
+
+void LvmSession::invalidate() {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    m_volume_groups.clear();
+    m_cache_valid = false;
+}
+
+void LvmSession::rescan() {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    invalidate();
+    m_rescan_needed = true;
+}
+
+#ifdef LVM2APP_FOUND
+
+LvmSession::~LvmSession() {
+    if (nullptr != m_handle) {
+        lvm_quit(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+lvm_t LvmSession::get_handle() {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    if (nullptr == m_handle) {
+        m_handle = lvm_init(nullptr);
+        if (nullptr == m_handle) {
+            log_error(GET_LOGGER("lvm"), "Could not open handle to LVM.");
+            return nullptr;
+        }
+        m_rescan_needed = false;
+    }
+    else if (m_rescan_needed) {
+        if (0 != lvm_scan(m_handle)) {
+            log_warning(GET_LOGGER("lvm"), "Could not rescan LVM devices: "
+                    << lvm_errmsg(m_handle));
+        }
+        m_rescan_needed = false;
+    }
+    return m_handle;
+}
+
+vg_t LvmSession::open_volume_group(const char* vg_name, const char* mode) {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    lvm_t handle = get_handle();
+    if (nullptr == handle) {
+        return nullptr;
+    }
+
+    vg_t vg_handle = lvm_vg_open(handle, vg_name, mode, 0);
+    if (nullptr == vg_handle) {
+        log_error(GET_LOGGER("lvm"), "Could not open volume group: "
+                << lvm_errmsg(handle));
+        return nullptr;
+    }
+    return vg_handle;
+}
+
+void LvmSession::close_volume_group(vg_t vg_handle) {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    lvm_vg_close(vg_handle);
+}
+
+bool LvmSession::write_volume_group(vg_t vg_handle) {
+    std::lock_guard<std::recursive_mutex> lock{m_mutex};
+    invalidate();
+    if (0 != lvm_vg_write(vg_handle)) {
+        log_error(GET_LOGGER("lvm"), "Could not save changes to volume group: "
+                << lvm_errmsg(m_handle));
+        return false;
+    }
+    return true;
+}
+
+#else
+
+LvmSession::~LvmSession() {}
+
+#endif
@@ -0,0 +1,141 @@
+/*!
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * @file lvm_session.hpp
+ * @brief Long-lived liblvm2app handle shared by all LvmAPI objects
+ * */
+
+#ifndef PSME_STORAGE_LVM_SESSION_HPP
+#define PSME_STORAGE_LVM_SESSION_HPP
+
+#include "lvm_api.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace agent {
+namespace storage {
+namespace lvm {
+
+/*!
+ * @brief Process wide LVM session.
+ *
+ * lvm_init() rescans all block devices and LVM metadata, so the session keeps
+ * one lvm handle open for the whole agent lifetime. It also caches the volume
+ * group structure read by LvmAPI::discover_volume_groups_structure() until
+ * a mutation invalidates it.
+ *
+ * All LvmAPI operations take the session lock, liblvm2app is not thread safe.
+ */
+class LvmSession {
+public:
+    using VolumeGroups = std::vector<LvmAPI::VolumeGroup>;
+
+    /*!
+     * @brief Singleton pattern. Return global LvmSession object
+     * @return LvmSession object
+     */
+    static LvmSession& get_instance();
+
+    /*! Singleton pattern. Close lvm handle and clear global LvmSession */
+    static void cleanup();
+
+    /*!
+     * @brief Get session lock. Must be held while using lvm handles.
+     * @return Session mutex
+     */
+    std::recursive_mutex& get_mutex() {
+        return m_mutex;
+    }
+
+    /*!
+     * @brief Get cached volume groups structure
+     * @param[out] volume_groups Vector to be extended with cached structure
+     * @return true if cache was valid and volume_groups has been filled
+     */
+    bool get_cached_volume_groups(VolumeGroups& volume_groups) const;
+
+    /*!
+     * @brief Store discovered volume groups structure in the cache
+     * @param[in] volume_groups Discovered volume groups
+     */
+    void set_cached_volume_groups(const VolumeGroups& volume_groups);
+
+    /*! @brief Drop cached volume groups structure */
+    void invalidate();
+
+    /*!
+     * @brief Drop cache and force liblvm2app to rescan devices on next
+     * access. Use it when LVM could be changed outside of the agent.
+     */
+    void rescan();
+
+#ifdef LVM2APP_FOUND
+    /*!
+     * @brief Get lvm handle, it is opened on first use
+     * @return lvm handle or nullptr on failure
+     */
+    lvm_t get_handle();
+
+    /*!
+     * @brief Open volume group
+     * @param[in] vg_name Volume group name
+     * @param[in] mode Open mode, "r" or "w"
+     * @return Volume group handle or nullptr on failure
+     */
+    vg_t open_volume_group(const char* vg_name, const char* mode);
+
+    /*!
+     * @brief Close volume group
+     * @param[in] vg_handle Volume group handle
+     */
+    void close_volume_group(vg_t vg_handle);
+
+    /*!
+     * @brief Write volume group changes to disk and drop the cache
+     * @param[in] vg_handle Volume group handle
+     * @return true on success
+     */
+    bool write_volume_group(vg_t vg_handle);
+#endif
+
+    ~LvmSession();
+
+private:
+    LvmSession() = default;
+    LvmSession(const LvmSession&) = delete;
+    LvmSession& operator=(const LvmSession&) = delete;
+    LvmSession(LvmSession&&) = delete;
+    LvmSession& operator=(LvmSession&&) = delete;
+
+    mutable std::recursive_mutex m_mutex{};
+    VolumeGroups m_volume_groups{};
+    bool m_cache_valid{false};
+    bool m_rescan_needed{false};
+
+#ifdef LVM2APP_FOUND
+    lvm_t m_handle{nullptr};
+#endif
+};
+
+}
+}
+}
+#endif	/* PSME_STORAGE_LVM_SESSION_HPP */
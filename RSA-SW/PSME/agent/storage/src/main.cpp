@@ -45,9 +45,14 @@
 #include "default_configuration.hpp"
 
 #include "discovery/discovery_manager.hpp"
+#include "discovery/discovery_snapshot.hpp"
+#include "discovery/storage_monitor.hpp"
+#include "lvm/lvm_session.hpp"
+#include "sysfs/sysfs_api.hpp"
 
 #include <jsonrpccpp/server/connectors/httpserver.h>
 
+#include <chrono>
 #include <csignal>
 #include <cstdio>
 #include <memory>
@@ -136,11 +141,32 @@ int main(int argc, char* argv[]) {
     CommandJsonServer server(http_server);
     server.add(commands);
 
+    /* Discovery snapshot of previous run */
+    std::string snapshot_file{};
+    if (configuration["discovery"]["snapshot-file"].is_string()) {
+        snapshot_file = configuration["discovery"]["snapshot-file"].as_string();
+    }
+    agent::storage::discovery::DiscoverySnapshot snapshot(snapshot_file);
+
+    /* Drive probe threads, started by the first discovery */
+    using agent::storage::sysfs::SysfsAPI;
+    std::size_t probe_threads{SysfsAPI::DEFAULT_PROBE_CONCURRENCY};
+    std::chrono::milliseconds probe_timeout{SysfsAPI::DEFAULT_PROBE_TIMEOUT_MS};
+    if (configuration["discovery"]["probe-threads"].is_uint()) {
+        probe_threads = configuration["discovery"]["probe-threads"].as_uint();
+    }
+    if (configuration["discovery"]["probe-timeout"].is_uint()) {
+        probe_timeout = std::chrono::seconds(
+            configuration["discovery"]["probe-timeout"].as_uint());
+    }
+    SysfsAPI::get_instance()->configure_probes(probe_threads, probe_timeout);
+
     /* Start discovery */
     agent::storage::discovery::DiscoveryManager discovery_manager;
     try {
-        /* Create modules */
+        /* Create modules and restore them from last discovery */
         ModuleManager::create();
+        snapshot.load(ModuleManager::get_modules());
         /* Start state machine */
         state_machine_thread_u_ptr.reset(
                 new StateMachineThread(ModuleManager::get_modules(),
@@ -158,19 +184,29 @@ int main(int argc, char* argv[]) {
         log_error(GET_LOGGER("storage-agent"), e.what());
     }
 
-    /* Wait for discovery to complete */
-    discovery_manager.wait_for_discovery_complete();
-
-    /* Register agent to rest application server */
-    reg_manager.register_agent(reg_data);
+    /* Publish discovery results and apply hotplug and LVM changes
+     * incrementally, restored components are served until then */
+    agent::storage::discovery::StorageMonitor storage_monitor(discovery_manager,
+                                                               snapshot);
+    storage_monitor.subscribe(client.get());
+    storage_monitor.start();
 
     /* Start json-rpc command server */
     server.start();
 
+    /* Register agent to rest application server */
+    reg_manager.register_agent(reg_data);
+
     /* Stop the program and wait for interrupt */
     wait_for_interrupt();
 
     server.stop();
+    storage_monitor.stop();
+    /* Keep changes made by commands, restored model is not saved back */
+    if (discovery_manager.wait_for_discovery_complete(
+                std::chrono::milliseconds(0))) {
+        snapshot.save(ModuleManager::get_modules());
+    }
 
     log_info(GET_LOGGER("storage-agent"), "Stopping PSME Storage...\n");
 
@@ -185,6 +221,7 @@ int main(int argc, char* argv[]) {
 
     agent_framework::action::TaskRunner::cleanup();
     agent_framework::action::TaskStatusManager::cleanup();
+    agent::storage::lvm::LvmSession::cleanup();
 
     return 0;
 }
@@ -27,5 +27,6 @@
 #define AGENT_STORAGE_CONFIGURATION_HPP
 
 #define LVM2APP_FOUND
+#define UDEV_FOUND
 
 #endif /* AGENT_STORAGE_CONFIGURATION_HPP */
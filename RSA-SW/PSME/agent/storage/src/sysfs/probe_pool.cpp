@@ -0,0 +1,143 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file probe_pool.cpp
+ *
+ * @brief Bounded pool of threads probing block devices
+ * */
+#include "probe_pool.hpp"
+#include "agent-framework/logger_ext.hpp"
+#include "agent-framework/threading/threadpool.hpp"
+
+#include <future>
+#include <algorithm>
+
+using namespace agent::storage::sysfs;
+
+/*! Probe of single drive */
+struct ProbePool::Probe {
+    enum class State {
+        QUEUED,
+        RUNNING,
+        DONE,
+        ABANDONED
+    };
+
+    explicit Probe(const std::string& path) : device_path{path} {}
+
+    const std::string device_path;
+    std::atomic<State> state{State::QUEUED};
+    std::chrono::steady_clock::time_point started_at{};
+    std::future<void> done{};
+    HardDrive result{};
+};
+
+/*! State used by the probe threads, kept alive by abandoned probes */
+struct ProbePool::Shared {
+    explicit Shared(ProbeFunction function) : probe{std::move(function)} {}
+
+    const ProbeFunction probe;
+    std::atomic<std::size_t> hung_probes{0};
+};
+
+ProbePool::ProbePool(std::size_t concurrency,
+                     const std::chrono::milliseconds& timeout,
+                     ProbeFunction probe) :
+    m_concurrency{std::max<std::size_t>(concurrency, 1)},
+    m_timeout{timeout},
+    m_shared{std::make_shared<Shared>(std::move(probe))},
+    m_pool{new agent_framework::threading::Threadpool(m_concurrency)} {}
+
+ProbePool::~ProbePool() {
+    const std::size_t hung = m_shared->hung_probes;
+    if (0 != hung) {
+        // joining a thread blocked in a drive ioctl would never return
+        log_warning(GET_LOGGER("storage-agent"), "Leaving " << hung
+              << " probe threads blocked on hung block devices.");
+        static_cast<void>(m_pool.release());
+    }
+}
+
+std::vector<bool> ProbePool::probe(const std::vector<std::string>& device_paths,
+                                   std::vector<HardDrive>& results) {
+    std::vector<ProbeSharedPtr> probes{};
+    probes.reserve(device_paths.size());
+    for (const auto& device_path : device_paths) {
+        auto probe = std::make_shared<Probe>(device_path);
+        probe->done = m_pool->run(&ProbePool::run_probe, m_shared, probe);
+        probes.push_back(std::move(probe));
+    }
+
+    // each drive gets its own slot, filled in device_paths order
+    std::vector<bool> finished(probes.size(), false);
+    results.resize(probes.size());
+    for (std::size_t index = 0; index < probes.size(); ++index) {
+        if (wait_for_probe(*probes[index])) {
+            results[index] = probes[index]->result;
+            finished[index] = true;
+        }
+    }
+    return finished;
+}
+
+void ProbePool::run_probe(const SharedPtr& shared, const ProbeSharedPtr& probe) {
+    using State = Probe::State;
+
+    probe->started_at = std::chrono::steady_clock::now();
+    auto state = State::QUEUED;
+    if (!probe->state.compare_exchange_strong(state, State::RUNNING)) {
+        // discovery gave up before the probe was started
+        return;
+    }
+
+    shared->probe(probe->device_path, probe->result);
+
+    state = State::RUNNING;
+    if (!probe->state.compare_exchange_strong(state, State::DONE)) {
+        log_info(GET_LOGGER("storage-agent"), "Hung block device "
+              << probe->device_path << " responded.");
+        --shared->hung_probes;
+    }
+}
+
+bool ProbePool::wait_for_probe(Probe& probe) {
+    using State = Probe::State;
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+
+    while (std::future_status::ready != probe.done.wait_for(POLL_INTERVAL)) {
+        auto state = probe.state.load();
+        if (State::RUNNING == state) {
+            if (std::chrono::steady_clock::now() - probe.started_at > m_timeout
+                && probe.state.compare_exchange_strong(state, State::ABANDONED)) {
+                ++m_shared->hung_probes;
+                return false;
+            }
+        }
+        else if (State::QUEUED == state && m_shared->hung_probes >= m_concurrency
+                && probe.state.compare_exchange_strong(state, State::ABANDONED)) {
+            // all probe threads are blocked on hung drives
+            return false;
+        }
+    }
+    return State::DONE == probe.state.load();
+}
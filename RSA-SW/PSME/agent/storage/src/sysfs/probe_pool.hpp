@@ -0,0 +1,113 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file probe_pool.hpp
+ * @brief Bounded pool of threads probing block devices
+ * */
+
+#ifndef PSME_STORAGE_PROBE_POOL_HPP
+#define PSME_STORAGE_PROBE_POOL_HPP
+
+#include "sysfs_api.hpp"
+
+#include <functional>
+
+namespace agent_framework {
+namespace threading {
+class Threadpool;
+}
+}
+
+namespace agent {
+namespace storage {
+namespace sysfs {
+
+/*!
+ * @brief Runs drive probes on a bounded pool of threads.
+ *
+ * A probe running longer than the timeout is abandoned, its thread stays
+ * blocked until the drive answers. When all threads are blocked the queued
+ * probes are skipped. The pool is not joined on destruction while a thread
+ * is blocked in a probe, the threads are left to the process exit instead.
+ */
+class ProbePool {
+public:
+    using HardDrive = SysfsAPI::HardDrive;
+
+    /*! Reads attributes of the device into the result drive */
+    using ProbeFunction = std::function<void(const std::string& device_path,
+                                             HardDrive& result)>;
+
+    /*!
+     * @brief Create pool
+     * @param[in] concurrency Number of probe threads, at least 1
+     * @param[in] timeout Time after which a probe is considered hung
+     * @param[in] probe Probe function, run on the pool threads
+     * */
+    ProbePool(std::size_t concurrency,
+              const std::chrono::milliseconds& timeout,
+              ProbeFunction probe);
+
+    /*! Disable copy */
+    ProbePool(const ProbePool&) = delete;
+    ProbePool& operator=(const ProbePool&) = delete;
+
+    ~ProbePool();
+
+    /*!
+     * @brief Probe devices and wait for the results
+     * @param[in] device_paths Devices to be probed
+     * @param[out] results Probe result of each device, in device_paths order
+     * @return For each device true if its probe finished within the timeout
+     * */
+    std::vector<bool> probe(const std::vector<std::string>& device_paths,
+                            std::vector<HardDrive>& results);
+
+    /*!
+     * @brief Get number of probe threads
+     * @return Number of probe threads
+     * */
+    std::size_t get_concurrency() const {
+        return m_concurrency;
+    }
+
+private:
+    struct Probe;
+    struct Shared;
+    using ProbeSharedPtr = std::shared_ptr<Probe>;
+    using SharedPtr = std::shared_ptr<Shared>;
+
+    static void run_probe(const SharedPtr& shared, const ProbeSharedPtr& probe);
+    bool wait_for_probe(Probe& probe);
+
+    std::size_t m_concurrency;
+    std::chrono::milliseconds m_timeout;
+    /* outlives the pool in abandoned probes */
+    SharedPtr m_shared;
+    std::unique_ptr<agent_framework::threading::Threadpool> m_pool;
+};
+
+}
+}
+}
+#endif	/* PSME_STORAGE_PROBE_POOL_HPP */
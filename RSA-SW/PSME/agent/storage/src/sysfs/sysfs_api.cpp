@@ -26,6 +26,7 @@
  * @brief C++ wrapper for Libsysfs
  * */
 #include "sysfs_api.hpp"
+#include "probe_pool.hpp"
 #include "agent-framework/logger_ext.hpp"
 
 #include "libsysfs.h"
@@ -38,8 +39,7 @@
 #include <scsi/sg.h>
 #include <linux/hdreg.h>
 
-#include <mutex>
-#include <thread>
+#include <cstring>
 #include <algorithm>
 
 using namespace agent::storage::sysfs;
@@ -49,6 +49,8 @@ constexpr const char SysfsAPI::BOOT_FS[];
 
 constexpr const char SysfsAPI::HardDrive::TYPE_SSD[];
 constexpr const char SysfsAPI::HardDrive::TYPE_HDD[];
+constexpr std::size_t SysfsAPI::DEFAULT_PROBE_CONCURRENCY;
+constexpr std::chrono::milliseconds::rep SysfsAPI::DEFAULT_PROBE_TIMEOUT_MS;
 
 static SysfsAPI* g_sysfs_api = nullptr;
 
@@ -60,52 +62,159 @@ SysfsAPI* SysfsAPI::get_instance() {
     return g_sysfs_api;
 }
 
+SysfsAPI::SysfsAPI() :
+    m_probe_concurrency{DEFAULT_PROBE_CONCURRENCY},
+    m_probe_timeout{DEFAULT_PROBE_TIMEOUT_MS} {}
+
 SysfsAPI::~SysfsAPI() {}
 
+void SysfsAPI::configure_probes(std::size_t concurrency,
+                                const std::chrono::milliseconds& timeout) {
+    if (m_probe_pool) {
+        log_warning(GET_LOGGER("storage-agent"),
+              "Probe threads already started, configuration ignored.");
+        return;
+    }
+    m_probe_concurrency = std::max<std::size_t>(concurrency, 1);
+    m_probe_timeout = timeout;
+}
+
+void SysfsAPI::clear_cache() {
+    std::lock_guard<std::mutex> lock{m_cache_mutex};
+    m_static_attributes.clear();
+}
+
 void SysfsAPI::get_hard_drives(vector<HardDrive>& hard_drives) {
+    m_get_hard_drives(hard_drives, {});
+}
+
+bool SysfsAPI::get_hard_drive(const string& name, HardDrive& drive) {
+    vector<HardDrive> hard_drives{};
+    m_get_hard_drives(hard_drives, name);
+    if (hard_drives.empty()) {
+        return false;
+    }
+    drive = hard_drives.front();
+    return true;
+}
+
+void SysfsAPI::m_get_hard_drives(vector<HardDrive>& hard_drives,
+                                 const string& name) {
     struct sysfs_class* block = nullptr;
     struct sysfs_device* device = nullptr;
     struct dlist* devices_list = nullptr;
-    std::list<std::thread> threads{};
-    std::mutex push_back_mutex{};
+    vector<struct sysfs_device*> devices{};
+
+    block = sysfs_open_class(SYSFS_BLOCK_NAME);
+    if (nullptr == block) {
+        return;
+    }
+
+    // boot device does not change at runtime, detect it once
+    if (m_boot_device.empty()) {
+        m_detect_boot_device();
+    }
+
+    devices_list = sysfs_get_class_devices(block);
+    dlist_for_each_data(devices_list, device, struct sysfs_device) {
+        if (nullptr != device && (name.empty() || name == device->name)
+                && !m_is_virtual_device(device)
+                && !m_is_boot_device(device)) {
+            devices.push_back(device);
+        }
+    }
 
-    auto discover_device = [&](struct sysfs_device* dev) {
-        HardDrive hard_drive{};
+    if (!m_probe_pool) {
+        m_probe_pool.reset(new ProbePool(m_probe_concurrency, m_probe_timeout,
+            [this](const string& dev_path, HardDrive& result) {
+                m_read_ata_attributes(dev_path, result);
+            }));
+    }
 
-        m_read_block_device_attributes(dev, hard_drive);
+    const auto first = hard_drives.size();
+    hard_drives.resize(first + devices.size());
+    vector<std::size_t> probed{};
+    vector<string> probed_paths{};
 
-        std::lock_guard<std::mutex> guard(push_back_mutex);
+    for (std::size_t index = 0; index < devices.size(); ++index) {
+        auto& hard_drive = hard_drives[first + index];
+        m_read_block_device_attributes(devices[index], hard_drive);
 
-        hard_drives.push_back(hard_drive);
+        if (!m_read_cached_attributes(hard_drive)) {
+            probed.push_back(first + index);
+            probed_paths.push_back(hard_drive.get_device_path());
+        }
+    }
 
+    sysfs_close_class(block);
+
+    vector<HardDrive> results{};
+    const auto finished = m_probe_pool->probe(probed_paths, results);
+    for (std::size_t index = 0; index < probed.size(); ++index) {
+        auto& hard_drive = hard_drives[probed[index]];
+        if (finished[index]) {
+            const auto& result = results[index];
+            hard_drive.set_serial_number(result.get_serial_number());
+            hard_drive.set_manufacturer(result.get_manufacturer());
+            hard_drive.set_type(result.get_type());
+            hard_drive.set_rpm(result.get_rpm());
+            hard_drive.set_interface(result.get_interface());
+            m_cache_attributes(hard_drive);
+        }
+        else {
+            log_warning(GET_LOGGER("storage-agent"), "Block device "
+                  << hard_drive.get_device_path() << " did not respond, "
+                  << "reporting it without ATA attributes.");
+        }
+    }
+
+    for (std::size_t index = first; index < hard_drives.size(); ++index) {
+        const auto& hard_drive = hard_drives[index];
         log_debug(GET_LOGGER("storage-agent"), "Found block device "
               << hard_drive.get_device_path());
         log_debug(GET_LOGGER("storage-agent"), "Model: "
               << hard_drive.get_model());
         log_debug(GET_LOGGER("storage-agent"), "Capacity: "
               << hard_drive.get_capacity_gb());
-    };
+    }
+}
 
-    block = sysfs_open_class(SYSFS_BLOCK_NAME);
-    if (nullptr == block) {
-        return;
+bool SysfsAPI::m_read_cached_attributes(HardDrive& hard_drive) {
+    if (hard_drive.get_wwn().empty()) {
+        return false;
     }
 
-    devices_list = sysfs_get_class_devices(block);
-    dlist_for_each_data(devices_list, device, struct sysfs_device) {
-        if (nullptr != device && !m_is_virtual_device(device)
-                && !m_is_boot_device(device)) {
+    std::lock_guard<std::mutex> lock{m_cache_mutex};
+    const auto it = m_static_attributes.find(hard_drive.get_wwn());
+    if (m_static_attributes.cend() == it) {
+        return false;
+    }
 
-            // discover hard drives simultaneously
-            threads.emplace_back(discover_device, device);
-        }
+    const auto& attributes = it->second;
+    hard_drive.set_model(attributes.model);
+    hard_drive.set_serial_number(attributes.serial_number);
+    hard_drive.set_manufacturer(attributes.manufacturer);
+    hard_drive.set_type(attributes.type);
+    hard_drive.set_interface(attributes.interface);
+    hard_drive.set_rpm(attributes.rpm);
+    return true;
+}
+
+void SysfsAPI::m_cache_attributes(const HardDrive& hard_drive) {
+    if (hard_drive.get_wwn().empty() || hard_drive.get_serial_number().empty()) {
+        return;
     }
 
-    // join all threads
-    std::for_each(std::begin(threads), std::end(threads),
-            std::mem_fun_ref(&std::thread::join));
+    StaticAttributes attributes{};
+    attributes.model = hard_drive.get_model();
+    attributes.serial_number = hard_drive.get_serial_number();
+    attributes.manufacturer = hard_drive.get_manufacturer();
+    attributes.type = hard_drive.get_type();
+    attributes.interface = hard_drive.get_interface();
+    attributes.rpm = hard_drive.get_rpm();
 
-    sysfs_close_class(block);
+    std::lock_guard<std::mutex> lock{m_cache_mutex};
+    m_static_attributes[hard_drive.get_wwn()] = std::move(attributes);
 }
 
 void SysfsAPI::get_partitions(const HardDrive& drive,
@@ -153,10 +262,6 @@ bool SysfsAPI::m_is_virtual_device(const struct sysfs_device* device) {
 }
 
 bool SysfsAPI::m_is_boot_device(const struct sysfs_device* device) {
-    if (m_boot_device.empty()) {
-        m_detect_boot_device();
-    }
-
     if (!m_boot_device.empty()) {
         string dev_path = m_get_device_path(device);
         if (m_boot_device.find(dev_path) == 0) {
@@ -218,11 +323,14 @@ void SysfsAPI::m_read_block_device_attributes(struct sysfs_device* device,
                                               HardDrive& hard_drive) {
     unsigned long long capacity_bytes = 0;
     string model = "";
+    string wwn = "";
 
     m_read_attribute(capacity_bytes, device, "size");
     m_read_attribute(model, device, "device/model");
+    m_read_attribute(wwn, device, "device/wwid");
 
     m_trim(model);
+    m_trim(wwn);
 
     hard_drive.set_name(device->name);
     hard_drive.set_sysfs_path(device->path);
@@ -230,8 +338,7 @@ void SysfsAPI::m_read_block_device_attributes(struct sysfs_device* device,
     hard_drive.set_capacity_gb(
         static_cast<uint32_t>(capacity_bytes / SECTORS_TO_GB));
     hard_drive.set_model(model);
-
-    m_read_ata_attributes(device, hard_drive);
+    hard_drive.set_wwn(wwn);
 }
 
 void SysfsAPI::m_read_attribute(string& value,
@@ -297,7 +404,7 @@ void SysfsAPI::m_read_attribute(int& value,
     }
 }
 
-void SysfsAPI::m_read_ata_attributes(const struct sysfs_device* device,
+void SysfsAPI::m_read_ata_attributes(const string& dev_path,
                                      HardDrive& hard_drive) {
     static constexpr uint32_t SSD_RPM_VALUE = 1;
 
@@ -305,20 +412,21 @@ void SysfsAPI::m_read_ata_attributes(const struct sysfs_device* device,
         uint32_t rpm{};
         string serial_number{};
         string manufacturer{};
+        AtaData data{};
 
         try {
-            m_perform_sg_io(device);
+            m_perform_sg_io(dev_path, data);
         }
         catch (const std::exception& error) {
             log_warning(GET_LOGGER("storage-agent"),
                         "Cannot perform SG_IO ioctl. " <<
                         "Falling back to HDIO_DRIVE_CMD. " << error.what());
-            m_perform_hdio_drive_cmd(device);
+            m_perform_hdio_drive_cmd(dev_path, data);
         }
 
-        m_read_rpm(rpm);
-        m_read_serial_number(serial_number);
-        m_read_manufacturer(manufacturer);
+        m_read_rpm(data, rpm);
+        m_read_serial_number(data, serial_number);
+        m_read_manufacturer(data, manufacturer);
 
         if (SSD_RPM_VALUE == rpm) {
             hard_drive.set_type(HardDrive::TYPE_SSD);
@@ -338,29 +446,23 @@ void SysfsAPI::m_read_ata_attributes(const struct sysfs_device* device,
     }
 }
 
-void SysfsAPI::m_perform_hdio_drive_cmd(const struct sysfs_device* device) {
+void SysfsAPI::m_perform_hdio_drive_cmd(const string& dev_path, AtaData& data) {
 
     static constexpr uint8_t ATA_OP_IDENTIFY = 0xec;
     static constexpr uint8_t ATA_OP_PIDENTIFY = 0xa1;
 
-    string dev_path = m_get_device_path(device);
-
-    if (nullptr == m_hdio_data.get()) {
-        m_hdio_data.reset(new uint16_t[ATA_DATA_SIZE/2]);
-    }
-
     int fd = open(dev_path.c_str(), O_RDONLY | O_NONBLOCK);
     if (0 > fd) {
         throw std::runtime_error("open");
     }
 
-    memset(m_hdio_data.get(), 0, ATA_DATA_SIZE);
+    data.fill(0);
 
-    uint8_t* hdio_data = reinterpret_cast<uint8_t*>(m_hdio_data.get());
+    uint8_t* hdio_data = reinterpret_cast<uint8_t*>(data.data());
     hdio_data[0] = ATA_OP_IDENTIFY;
     hdio_data[3] = 1;
     if (0 != ioctl(fd, HDIO_DRIVE_CMD, hdio_data)) {
-        memset(m_hdio_data.get(), 0, ATA_DATA_SIZE);
+        data.fill(0);
         hdio_data[0] = ATA_OP_PIDENTIFY;
         hdio_data[3] = 1;
         if (0 != ioctl(fd, HDIO_DRIVE_CMD, hdio_data)) {
@@ -372,7 +474,7 @@ void SysfsAPI::m_perform_hdio_drive_cmd(const struct sysfs_device* device) {
     close(fd);
 }
 
-void SysfsAPI::m_perform_sg_io(const struct sysfs_device* device) {
+void SysfsAPI::m_perform_sg_io(const string& dev_path, AtaData& data) {
 
     static constexpr const size_t COMMAND_BUFFER_SIZE = 16;
     static constexpr const size_t SENSE_BUFFER_SIZE = 32;
@@ -385,15 +487,10 @@ void SysfsAPI::m_perform_sg_io(const struct sysfs_device* device) {
     static constexpr const uint8_t SG_CDB2_TDIR_FROM_DEV = 0x08;
     static constexpr const uint8_t ATA_USING_LBA = 0x40;
 
-    string dev_path = m_get_device_path(device);
-
-    if (nullptr == m_hdio_data.get()) {
-        m_hdio_data.reset(new uint16_t[ATA_DATA_SIZE/2]);
-    }
-
     uint8_t command_buffer[COMMAND_BUFFER_SIZE];
     uint8_t sense_buffer[SENSE_BUFFER_SIZE];
-    uint8_t* data_buffer = reinterpret_cast<uint8_t*>(m_hdio_data.get() + 2);
+    // identify data is placed after 4 bytes header, the same as HDIO_DRIVE_CMD
+    uint8_t* data_buffer = reinterpret_cast<uint8_t*>(data.data() + 2);
     sg_io_hdr_t io_hdr;
 
     int fd = open(dev_path.c_str(), O_RDONLY | O_NONBLOCK);
@@ -404,7 +501,7 @@ void SysfsAPI::m_perform_sg_io(const struct sysfs_device* device) {
     memset(&io_hdr, 0, sizeof(io_hdr));
     memset(command_buffer, 0, COMMAND_BUFFER_SIZE);
     memset(sense_buffer, 0, SENSE_BUFFER_SIZE);
-    memset(m_hdio_data.get(), 0, ATA_DATA_SIZE);
+    data.fill(0);
 
     command_buffer[0] = SG_ATA_16;
     command_buffer[1] = SG_ATA_PROTO_PIO_IN;
@@ -418,7 +515,7 @@ void SysfsAPI::m_perform_sg_io(const struct sysfs_device* device) {
     io_hdr.cmd_len = COMMAND_BUFFER_SIZE;
     io_hdr.mx_sb_len = SENSE_BUFFER_SIZE;
     io_hdr.dxfer_direction = SG_DXFER_FROM_DEV;
-    io_hdr.dxfer_len = ATA_DATA_SIZE;
+    io_hdr.dxfer_len = ATA_DATA_SIZE - 4;
     io_hdr.dxferp = data_buffer;
     io_hdr.cmdp = command_buffer;
     io_hdr.sbp = sense_buffer;
@@ -432,38 +529,39 @@ void SysfsAPI::m_perform_sg_io(const struct sysfs_device* device) {
     close(fd);
 }
 
-void SysfsAPI::m_read_ata_string(string& value, size_t offset, size_t length) {
-    if (0 == m_hdio_data[offset]) {
+void SysfsAPI::m_read_ata_string(const AtaData& data, string& value,
+                                 size_t offset, size_t length) {
+    if (0 == data[offset]) {
         return;
     }
     value.resize(length * 2);
     for (size_t pos = 0; pos < length; ++pos) {
-        uint16_t data_word = m_hdio_data[offset + pos];
+        uint16_t data_word = data[offset + pos];
         value[pos * 2] = static_cast<char>((data_word >> 8) & 0xff);
         value[pos * 2 + 1] = static_cast<char>(data_word & 0xff);
     }
     m_trim(value);
 }
 
-void SysfsAPI::m_read_serial_number(string& serial_number) {
+void SysfsAPI::m_read_serial_number(const AtaData& data, string& serial_number) {
     static constexpr const uint32_t SERIAL_OFFSET = 12;
     static constexpr const uint32_t SERIAL_LENGTH = 10;
 
-    m_read_ata_string(serial_number, SERIAL_OFFSET, SERIAL_LENGTH);
+    m_read_ata_string(data, serial_number, SERIAL_OFFSET, SERIAL_LENGTH);
 }
 
-void SysfsAPI::m_read_manufacturer(string& manufacturer) {
+void SysfsAPI::m_read_manufacturer(const AtaData& data, string& manufacturer) {
     static constexpr const uint32_t MANUFACTURER_OFFSET = 198;
     static constexpr const uint32_t MANUFACTURER_LENGTH = 10;
 
-    m_read_ata_string(manufacturer, MANUFACTURER_OFFSET, MANUFACTURER_LENGTH);
+    m_read_ata_string(data, manufacturer, MANUFACTURER_OFFSET, MANUFACTURER_LENGTH);
 }
 
-void SysfsAPI::m_read_rpm(uint32_t& rpm) {
+void SysfsAPI::m_read_rpm(const AtaData& data, uint32_t& rpm) {
     /* Nominal Media Rotation Rate */
     static constexpr uint32_t NMRR = 219;
 
-    rpm = m_hdio_data[NMRR];
+    rpm = data[NMRR];
     log_debug(GET_LOGGER("storage-agent"), "Nominal Media Rotation Rate: " <<
               rpm);
 }
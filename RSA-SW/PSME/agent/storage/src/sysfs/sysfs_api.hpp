@@ -28,6 +28,10 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
 
 struct sysfs_device;
 
@@ -35,6 +39,8 @@ namespace agent {
 namespace storage {
 namespace sysfs {
 
+class ProbePool;
+
 using std::vector;
 using std::string;
 using std::uint32_t;
@@ -53,6 +59,7 @@ public:
         string m_manufacturer{};
         string m_model{};
         string m_serial_number{};
+        string m_wwn{};
         uint32_t m_capacity_gb{};
         uint32_t m_rpm{};
         string m_type{};
@@ -196,6 +203,22 @@ public:
             m_serial_number = serial_number;
         }
 
+        /*!
+         * @brief Get hard drive world wide name
+         * @return Hard drive WWN, empty if not reported by the device
+         * */
+        const string& get_wwn() const {
+            return m_wwn;
+        }
+
+        /*!
+         * @brief Set hard drive world wide name
+         * @param[in] wwn Hard drive WWN
+         * */
+        void set_wwn(const string& wwn) {
+            m_wwn = wwn;
+        }
+
         /*!
          * @brief Get hard drive type
          * @return Hard drive type
@@ -300,10 +323,48 @@ public:
 
     /*!
      * @brief Get hard drives
+     *
+     * ATA identify data is read by a bounded pool of probe threads.
+     * Static attributes (model, serial number, manufacturer, RPM) are cached
+     * by device WWN, so rediscovery only reads dynamic ones from sysfs.
+     * Drives which do not answer within probe timeout are reported without
+     * ATA attributes.
+     *
      * @param[in] drives Vector of hard drives to be filled.
      * */
     void get_hard_drives(vector<HardDrive>& drives);
 
+    /*!
+     * @brief Get single hard drive by its block device name.
+     *
+     * Used on hotplug, other drives are neither read nor probed.
+     *
+     * @param[in] name Block device name, e.g. "sdb"
+     * @param[out] drive Hard drive to be filled
+     * @return true if the device exists and is not virtual nor boot device
+     * */
+    bool get_hard_drive(const string& name, HardDrive& drive);
+
+    /*! Default number of probe threads */
+    static constexpr std::size_t DEFAULT_PROBE_CONCURRENCY = 8;
+    /*! Default probe timeout */
+    static constexpr std::chrono::milliseconds::rep DEFAULT_PROBE_TIMEOUT_MS = 30000;
+
+    /*!
+     * @brief Set maximum number of drives probed simultaneously and time
+     * after which a probed drive is considered hung. Called once at startup,
+     * ignored after the first discovery.
+     * @param[in] concurrency Number of probe threads
+     * @param[in] timeout Probe timeout
+     * */
+    void configure_probes(std::size_t concurrency,
+                          const std::chrono::milliseconds& timeout);
+
+    /*!
+     * @brief Drop cached static attributes of all drives
+     * */
+    void clear_cache();
+
     /*!
      * @brief Gets list of partitions for given hard drive.
      * @param[in] drive Hard Drive.
@@ -317,10 +378,30 @@ public:
     virtual ~SysfsAPI();
 
 private:
-    SysfsAPI() {}
+    SysfsAPI();
+
+    static constexpr uint32_t ATA_DATA_SIZE = 512+4;
+    using AtaData = std::array<uint16_t, ATA_DATA_SIZE/2>;
+
+    /*! Drive attributes which never change while drive is present */
+    struct StaticAttributes {
+        string model{};
+        string serial_number{};
+        string manufacturer{};
+        string type{};
+        string interface{};
+        uint32_t rpm{};
+    };
 
     string m_boot_device{};
 
+    std::size_t m_probe_concurrency;
+    std::chrono::milliseconds m_probe_timeout;
+    std::unique_ptr<ProbePool> m_probe_pool{};
+
+    std::mutex m_cache_mutex{};
+    std::unordered_map<string, StaticAttributes> m_static_attributes{};
+
     bool m_is_virtual_device(const struct sysfs_device* device);
     bool m_is_boot_device(const struct sysfs_device* device);
 
@@ -341,14 +422,19 @@ private:
                           struct sysfs_device* device,
                           const string& attribute_name);
 
-    void m_read_ata_attributes(const struct sysfs_device* device,
+    void m_get_hard_drives(vector<HardDrive>& drives, const string& name);
+    bool m_read_cached_attributes(HardDrive& hard_drive);
+    void m_cache_attributes(const HardDrive& hard_drive);
+
+    void m_read_ata_attributes(const string& dev_path,
                                HardDrive& hard_drive);
-    void m_perform_sg_io(const struct sysfs_device* device);
-    void m_perform_hdio_drive_cmd(const struct sysfs_device* device);
-    void m_read_ata_string(string& value, size_t offset, size_t length);
-    void m_read_rpm(uint32_t& rpm);
-    void m_read_serial_number(string& serial_number);
-    void m_read_manufacturer(string& manufacturer);
+    void m_perform_sg_io(const string& dev_path, AtaData& data);
+    void m_perform_hdio_drive_cmd(const string& dev_path, AtaData& data);
+    void m_read_ata_string(const AtaData& data, string& value,
+                           size_t offset, size_t length);
+    void m_read_rpm(const AtaData& data, uint32_t& rpm);
+    void m_read_serial_number(const AtaData& data, string& serial_number);
+    void m_read_manufacturer(const AtaData& data, string& manufacturer);
 
     string m_get_device_path(const struct sysfs_device* device);
 
@@ -357,9 +443,6 @@ private:
     static constexpr uint32_t SECTORS_TO_GB = 2*1024*1024;
     static constexpr const char ROOT_FS[] = "/";
     static constexpr const char BOOT_FS[] = "/boot";
-
-    static constexpr uint32_t ATA_DATA_SIZE = 512+4;
-    std::unique_ptr<uint16_t[]> m_hdio_data{};
 };
 
 }
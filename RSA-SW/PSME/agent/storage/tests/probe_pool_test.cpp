@@ -0,0 +1,145 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file probe_pool_test.cpp
+ *
+ * @brief Concurrent drive probing tests
+ * */
+
+#include "gtest/gtest.h"
+
+#include "sysfs/probe_pool.hpp"
+
+#include <chrono>
+#include <future>
+#include <random>
+#include <thread>
+
+using namespace agent::storage::sysfs;
+
+namespace {
+
+constexpr std::chrono::milliseconds LONG_TIMEOUT{10000};
+constexpr std::chrono::milliseconds SHORT_TIMEOUT{200};
+
+std::vector<std::string> make_device_paths(std::size_t count) {
+    std::vector<std::string> device_paths{};
+    for (std::size_t index = 0; index < count; ++index) {
+        device_paths.push_back("/dev/sd" + std::to_string(index));
+    }
+    return device_paths;
+}
+
+/*! Fills result from the device path after a random delay */
+void fake_probe(const std::string& device_path, ProbePool::HardDrive& result) {
+    thread_local std::mt19937 generator{std::random_device{}()};
+    std::uniform_int_distribution<int> delay_ms{0, 5};
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms(generator)));
+
+    result.set_device_path(device_path);
+    result.set_serial_number("SN" + device_path);
+    result.set_manufacturer("ATA");
+    result.set_rpm(uint32_t(device_path.size() * 1000));
+}
+
+}
+
+TEST(ProbePoolTest, ConcurrentProbingMatchesSequential) {
+    const auto device_paths = make_device_paths(32);
+
+    std::vector<ProbePool::HardDrive> sequential{};
+    std::vector<bool> sequential_finished{};
+    {
+        ProbePool pool(1, LONG_TIMEOUT, fake_probe);
+        sequential_finished = pool.probe(device_paths, sequential);
+    }
+
+    std::vector<ProbePool::HardDrive> concurrent{};
+    std::vector<bool> concurrent_finished{};
+    {
+        ProbePool pool(8, LONG_TIMEOUT, fake_probe);
+        concurrent_finished = pool.probe(device_paths, concurrent);
+    }
+
+    ASSERT_EQ(device_paths.size(), sequential.size());
+    ASSERT_EQ(device_paths.size(), concurrent.size());
+    ASSERT_EQ(device_paths.size(), concurrent_finished.size());
+    for (std::size_t index = 0; index < device_paths.size(); ++index) {
+        EXPECT_TRUE(sequential_finished[index]);
+        EXPECT_TRUE(concurrent_finished[index]);
+        EXPECT_EQ(device_paths[index], concurrent[index].get_device_path());
+        EXPECT_EQ(sequential[index].get_device_path(),
+                  concurrent[index].get_device_path());
+        EXPECT_EQ(sequential[index].get_serial_number(),
+                  concurrent[index].get_serial_number());
+        EXPECT_EQ(sequential[index].get_manufacturer(),
+                  concurrent[index].get_manufacturer());
+        EXPECT_EQ(sequential[index].get_rpm(), concurrent[index].get_rpm());
+    }
+}
+
+TEST(ProbePoolTest, PoolIsReusedAcrossDiscoveries) {
+    const auto device_paths = make_device_paths(8);
+    ProbePool pool(0, LONG_TIMEOUT, fake_probe);
+    ASSERT_EQ(1u, pool.get_concurrency());
+
+    for (int pass = 0; pass < 3; ++pass) {
+        std::vector<ProbePool::HardDrive> results{};
+        const auto finished = pool.probe(device_paths, results);
+        ASSERT_EQ(device_paths.size(), results.size());
+        for (std::size_t index = 0; index < device_paths.size(); ++index) {
+            EXPECT_TRUE(finished[index]);
+            EXPECT_EQ(device_paths[index], results[index].get_device_path());
+        }
+    }
+}
+
+TEST(ProbePoolTest, HungProbeIsAbandonedAndNotJoined) {
+    // shared with the hung probe thread, which outlives the test
+    auto release = std::make_shared<std::promise<void>>();
+    std::shared_future<void> released{release->get_future()};
+    const std::vector<std::string> device_paths{"/dev/hung", "/dev/sda"};
+
+    std::vector<ProbePool::HardDrive> results{};
+    std::vector<bool> finished{};
+    const auto destroyed = std::async(std::launch::async, [&] {
+        ProbePool pool(1, SHORT_TIMEOUT,
+            [released](const std::string& device_path,
+                       ProbePool::HardDrive& result) {
+                if ("/dev/hung" == device_path) {
+                    released.wait();
+                }
+                result.set_device_path(device_path);
+            });
+        finished = pool.probe(device_paths, results);
+    });
+
+    // the only probe thread is hung, so the queued probe is skipped as well
+    ASSERT_EQ(std::future_status::ready,
+              destroyed.wait_for(std::chrono::seconds(5)));
+    ASSERT_EQ(device_paths.size(), finished.size());
+    EXPECT_FALSE(finished[0]);
+    EXPECT_FALSE(finished[1]);
+
+    release->set_value();
+}
@@ -78,6 +78,25 @@ public:
      * */
     NodesLinkVec build_nodes(Node& root, const string& component_id);
 
+    /*!
+     * @brief Builds or refreshes single storage component.
+     *
+     * Existing node is patched in place and its links to other storage
+     * components are resolved again. New node is built in the proper
+     * collection of its storage service, the rest of the service subtree
+     * is left untouched.
+     *
+     * @param root Tree's root node.
+     * @param service_uuid Uuid of storage service owning the component.
+     * @param component_uuid Uuid of the component.
+     * @param component_type Component type reported by agent
+     * (HardDrive, LogicalDrive or Target).
+     * @return Vector of links between nodes, not empty for new nodes only.
+     * */
+    NodesLinkVec build_component(Node& root, const string& service_uuid,
+                                 const string& component_uuid,
+                                 const string& component_type);
+
 private:
 
     /*!
@@ -138,6 +157,43 @@ private:
                       const std::string& component_uuid,
                       const std::string& collection_name);
 
+    /*!
+     * @brief Reads drive properties from agent and patches drive node.
+     * @param storage_service StorageService reference
+     * @param drive_node Drive node
+     * */
+    void update_drive(StorageService& storage_service, Node& drive_node);
+
+    /*!
+     * @brief Reads logical drive properties from agent and patches its node.
+     * @param storage_service StorageService reference
+     * @param logical_drive_node Logical drive node
+     * */
+    void update_logical_drive(StorageService& storage_service,
+                              Node& logical_drive_node);
+
+    /*!
+     * @brief Reads target properties from agent and patches target node.
+     * @param service StorageService reference
+     * @param target Target node
+     * @param logical_drives Logical drives node
+     * */
+    void update_target(StorageService& service, Node& target,
+                       const Node& logical_drives);
+
+    /*!
+     * @brief Replaces links of given name with current children
+     * reported by agent.
+     * @param parent Node to be relinked
+     * @param collection_name Name of the collection and the link
+     * @param other_side_link_name Link name on children side
+     * @param storage_service The storage service
+     * @param root_node Highest node in the tree hierarchy to search for children
+     * */
+    void relink_children(Node& parent, const std::string& collection_name,
+                         const std::string& other_side_link_name,
+                         StorageService& storage_service, const Node& root_node);
+
     /*!
      * @brief Return all children from logical_drives collection
      * for specified logical_drive parent
@@ -43,7 +43,12 @@ namespace eventing {
         out << "[gami_id=" << r.get_gami_id()
             << " component=" << r.get_id()
             << " state=" << r.get_state()
-            << " transition=" << r.get_transition() << "]";
+            << " transition=" << r.get_transition();
+        if (!r.get_type().empty()) {
+            out << " type=" << r.get_type()
+                << " parent=" << r.get_parent();
+        }
+        out << "]";
         return out;
     }
 }
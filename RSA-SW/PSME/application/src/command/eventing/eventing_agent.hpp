@@ -90,6 +90,8 @@ public:
         std::string m_id{};
         std::string m_state{};
         std::string m_transition{};
+        std::string m_type{};
+        std::string m_parent{};
 
     public:
         /*!
@@ -127,13 +129,33 @@ public:
             return m_transition;
         }
 
+        /*!
+        * @brief Gets component type. Empty for events concerning
+        * whole component subtree.
+        *
+        * @return component type
+        */
+        const std::string& get_type() const {
+            return m_type;
+        }
+
+        /*!
+        * @brief Gets uuid of the component owning this one
+        *
+        * @return parent component id
+        */
+        const std::string& get_parent() const {
+            return m_parent;
+        }
+
         /*! Request default constructor */
         Request() = default;
         /*! Constructor */
         Request(const string& gami_id, const string& id, const string& state,
-                const string& transition)
+                const string& transition, const string& type = "",
+                const string& parent = "")
             : m_gami_id(gami_id), m_id(id), m_state(state),
-                m_transition(transition) { }
+                m_transition(transition), m_type(type), m_parent(parent) { }
         /*! Request default copy constructor */
         Request(const Request&) = default;
         /*! Request default assigment operator */
@@ -60,6 +60,8 @@ void EventingAgent::notification(const Json::Value& params) {
         request.m_id = params["id"].asString();
         request.m_state = params["newState"].asString();
         request.m_transition = params["transition"].asString();
+        request.m_type = params.get("type", "").asString();
+        request.m_parent = params.get("parent", "").asString();
 
         command->execute(request, response);
 
@@ -50,6 +50,11 @@ namespace {
     constexpr const char PHYSICAL_DRIVES_COLLECTION_TYPE[] = "PhysicalDrives";
     constexpr const char TARGETS_COLLECTION_TYPE[] = "iSCSITargets";
     constexpr const char LOGICAL_DRIVES_COLLECTION_TYPE[] = "LogicalDrives";
+
+    /* Component types sent by storage agent in component events */
+    constexpr const char HARD_DRIVE_COMPONENT[] = "HardDrive";
+    constexpr const char LOGICAL_DRIVE_COMPONENT[] = "LogicalDrive";
+    constexpr const char TARGET_COMPONENT[] = "Target";
 }
 
 NodesLinkVec
@@ -192,8 +197,6 @@ StorageNodeBuilder::build_logical_drives(StorageService& storage_service,
     NodesLinkVec nodes_to_link;
     for (const auto& subcomponent : response) {
         const auto& logical_drive_uuid = subcomponent.get_subcomponent();
-        auto logical_drive_info = storage_service.get_logical_drive_info(logical_drive_uuid);
-
         auto logical_drive_node = std::make_shared<LogicalDrive>(
                                 logical_drive_uuid, get_agent()->get_gami_id(),
                                 get_node_id(logical_drive_uuid));
@@ -204,21 +207,29 @@ StorageNodeBuilder::build_logical_drives(StorageService& storage_service,
                     LogicalDrives::TYPE, storage_manager_node,
                     logical_drive_node, Resource::MANAGED_BY);
 
-        json::Value json_content;
-        json_content[Status::STATUS] = to_resource_status(logical_drive_info.get_status()).as_json();
-        json_content["CapacityGB"] = logical_drive_info.get_capacity_gb();
-        json_content["Mode"] = logical_drive_info.get_mode();
-        json_content["Type"] = logical_drive_info.get_type();
-        json_content["Bootable"] = logical_drive_info.get_bootable();
-        json_content["Protected"] = logical_drive_info.get_protected();
-        json_content["Snapshot"] = logical_drive_info.get_snapshot();
-        json_content["Image"] = logical_drive_info.get_image();
-
-        logical_drive_node->get_resource().patch(json_content);
+        update_logical_drive(storage_service, *logical_drive_node);
     }
     return nodes_to_link;
 }
 
+void StorageNodeBuilder::update_logical_drive(StorageService& storage_service,
+                                              Node& logical_drive_node) {
+    auto logical_drive_info =
+        storage_service.get_logical_drive_info(logical_drive_node.get_uuid());
+
+    json::Value json_content;
+    json_content[Status::STATUS] = to_resource_status(logical_drive_info.get_status()).as_json();
+    json_content["CapacityGB"] = logical_drive_info.get_capacity_gb();
+    json_content["Mode"] = logical_drive_info.get_mode();
+    json_content["Type"] = logical_drive_info.get_type();
+    json_content["Bootable"] = logical_drive_info.get_bootable();
+    json_content["Protected"] = logical_drive_info.get_protected();
+    json_content["Snapshot"] = logical_drive_info.get_snapshot();
+    json_content["Image"] = logical_drive_info.get_image();
+
+    logical_drive_node.get_resource().patch(json_content);
+}
+
 void StorageNodeBuilder::build_drives(StorageService& storage_service,
                                       Node& parent,
                                       const std::string& component_uuid,
@@ -228,27 +239,34 @@ void StorageNodeBuilder::build_drives(StorageService& storage_service,
 
     for (const auto& subcomponent : response) {
         const std::string& disk_uuid = subcomponent.get_subcomponent();
-        auto drive_info = storage_service.get_physical_drive_info(disk_uuid);
         auto drive_node = std::make_shared<PhysicalDrive>(disk_uuid,
                 get_agent()->get_gami_id(), get_node_id(disk_uuid));
 
         NodeBuilder::link_nodes(LinkType::COMPOSITION,
                 Resource::MEMBERS, parent, drive_node);
 
-        json::Value json_content;
-        json_content[Status::STATUS] = to_resource_status(drive_info.get_status()).as_json();
-        json_content["Interface"] = drive_info.get_interface();
-        json_content["CapacityGB"] = drive_info.get_capacity_gb();
-        json_content["RPM"] = drive_info.get_rpm();
-        json_content["Model"] = drive_info.get_fru_info().get_model_number();
-        json_content["SerialNumber"] = drive_info.get_fru_info().get_serial_number();
-        json_content["Manufacturer"] = drive_info.get_fru_info().get_manufacturer();
-        json_content["Type"] = drive_info.get_type();
-
-        drive_node->get_resource().patch(json_content);
+        update_drive(storage_service, *drive_node);
     }
 }
 
+void StorageNodeBuilder::update_drive(StorageService& storage_service,
+                                      Node& drive_node) {
+    auto drive_info =
+        storage_service.get_physical_drive_info(drive_node.get_uuid());
+
+    json::Value json_content;
+    json_content[Status::STATUS] = to_resource_status(drive_info.get_status()).as_json();
+    json_content["Interface"] = drive_info.get_interface();
+    json_content["CapacityGB"] = drive_info.get_capacity_gb();
+    json_content["RPM"] = drive_info.get_rpm();
+    json_content["Model"] = drive_info.get_fru_info().get_model_number();
+    json_content["SerialNumber"] = drive_info.get_fru_info().get_serial_number();
+    json_content["Manufacturer"] = drive_info.get_fru_info().get_manufacturer();
+    json_content["Type"] = drive_info.get_type();
+
+    drive_node.get_resource().patch(json_content);
+}
+
 NodeSharedPtr
 StorageNodeBuilder::create_service(const std::string& component_uuid) {
     auto service = std::make_shared<Service>(component_uuid,
@@ -278,8 +296,6 @@ StorageNodeBuilder::build_targets(StorageService& service,
 
     NodesLinkVec nodes_to_link;
     for (const auto& subcomponent : response) {
-        auto target_info =
-                    service.get_target_info(subcomponent.get_subcomponent());
         auto target = std::make_shared<Target>(subcomponent.get_subcomponent(),
                                 get_agent()->get_gami_id(),
                                 get_node_id(subcomponent.get_subcomponent()));
@@ -289,43 +305,155 @@ StorageNodeBuilder::build_targets(StorageService& service,
                     Targets::REMOTE_TARGETS, storage_manager_node,
                     target, Resource::MANAGED_BY);
 
-        json::Value json;
-        json[Status::STATUS] = to_resource_status(
-                                        target_info.get_status()).as_json();
-
-        json[Resource::ENUMERATED] = to_string(EnumStatus::ENUMERATED);
-        json["Type"] = TARGETS_COLLECTION_TYPE;
-
-        json::Value luns(json::Value::Type::ARRAY);
-        for (const auto& lun : target_info.get_target_luns()) {
-            if (auto logical_drive = logical_drives.get_node_by_uuid(
-                                            lun.get_logical_drive_uuid())) {
-                json::Value lun_json;
-                lun_json["LUN"] = static_cast<unsigned>(lun.get_lun());
-                lun_json["Drive"] = logical_drive->get_path();
-                luns.push_back(std::move(lun_json));
-            }
+        update_target(service, *target, logical_drives);
+    }
+    return nodes_to_link;
+}
+
+void StorageNodeBuilder::update_target(StorageService& service,
+                                       Node& target,
+                                       const Node& logical_drives) {
+    auto target_info = service.get_target_info(target.get_uuid());
+
+    json::Value json;
+    json[Status::STATUS] = to_resource_status(
+                                    target_info.get_status()).as_json();
+
+    json[Resource::ENUMERATED] = to_string(EnumStatus::ENUMERATED);
+    json["Type"] = TARGETS_COLLECTION_TYPE;
+
+    json::Value luns(json::Value::Type::ARRAY);
+    for (const auto& lun : target_info.get_target_luns()) {
+        if (auto logical_drive = logical_drives.get_node_by_uuid(
+                                        lun.get_logical_drive_uuid())) {
+            json::Value lun_json;
+            lun_json["LUN"] = static_cast<unsigned>(lun.get_lun());
+            lun_json["Drive"] = logical_drive->get_path();
+            luns.push_back(std::move(lun_json));
         }
+    }
+
+    json::Value addr;
+    addr["TargetIQN"] = target_info.get_target_iqn();
+    addr["TargetLUN"] = luns;
+    addr["TargetPortalIP"] = target_info.get_target_address();
+    addr["TargetPortalPort"]  = target_info.get_target_port();
+    addr[Status::STATUS] = to_resource_status(
+                                    target_info.get_status()).as_json();
+    json::Value enum_iscsi;
+    enum_iscsi["iSCSI"] = addr;
+    json["Addresses"].push_back(enum_iscsi);
+    json::Value initiator;
+    initiator["iSCSI"]["InitiatorIQN"] = target_info.get_initiator_iqn();
+    json["Initiator"].push_back(initiator);
+
+    target.get_resource().patch(json);
+}
+
+NodesLinkVec
+StorageNodeBuilder::build_component(Node& root,
+                                    const string& service_uuid,
+                                    const string& component_uuid,
+                                    const string& component_type) {
+    m_root = &root;
+    auto* service_node = root.get_node_by_uuid(service_uuid);
+    if (nullptr == service_node || nullptr == root.get_next()
+        || nullptr == root.get_next()->get_next()) {
+        throw std::runtime_error("Storage service " + service_uuid
+                                 + " is not in the tree.");
+    }
+    auto* v_node = root.get_next()->get_next();
+    auto* storage_manager_node = v_node->get_node_by_id(Managers::TYPE).get_next();
+    if (nullptr == storage_manager_node) {
+        throw std::runtime_error("Tree is not properly initialized.");
+    }
+
+    auto storage_service = ServiceFactory::create_storage(get_agent()->get_gami_id());
+    const auto& gami_id = get_agent()->get_gami_id();
+    auto& drives_node = service_node->get_node_by_id(Drives::TYPE);
+    auto& logical_drives_node = service_node->get_node_by_id(LogicalDrives::TYPE);
+    auto& targets_node = service_node->get_node_by_id(Targets::TYPE);
 
-        json::Value addr;
-        addr["TargetIQN"] = target_info.get_target_iqn();
-        addr["TargetLUN"] = luns;
-        addr["TargetPortalIP"] = target_info.get_target_address();
-        addr["TargetPortalPort"]  = target_info.get_target_port();
-        addr[Status::STATUS] = to_resource_status(
-                                        target_info.get_status()).as_json();
-        json::Value enum_iscsi;
-        enum_iscsi["iSCSI"] = addr;
-        json["Addresses"].push_back(enum_iscsi);
-        json::Value initiator;
-        initiator["iSCSI"]["InitiatorIQN"] = target_info.get_initiator_iqn();
-        json["Initiator"].push_back(initiator);
-
-        target->get_resource().patch(json);
+    NodesLinkVec nodes_to_link;
+    auto* node = root.get_node_by_uuid(component_uuid);
+
+    if (0 == component_type.compare(HARD_DRIVE_COMPONENT)) {
+        if (nullptr == node) {
+            auto drive_node = std::make_shared<PhysicalDrive>(component_uuid,
+                                                              gami_id);
+            nodes_to_link.emplace_back(LinkType::COMPOSITION,
+                    Resource::MEMBERS, drives_node, drive_node);
+            update_drive(storage_service, *drive_node);
+            drive_node->add_link(Resource::CONTAINED_BY, *service_node);
+        }
+        else {
+            update_drive(storage_service, *node);
+        }
+    }
+    else if (0 == component_type.compare(LOGICAL_DRIVE_COMPONENT)) {
+        if (nullptr == node) {
+            auto logical_drive_node = std::make_shared<LogicalDrive>(
+                                            component_uuid, gami_id);
+            nodes_to_link.emplace_back(LinkType::COMPOSITION,
+                    Resource::MEMBERS, logical_drives_node, logical_drive_node);
+            nodes_to_link.emplace_back(LinkType::ASSOCIATION,
+                    LogicalDrives::TYPE, *storage_manager_node,
+                    logical_drive_node, Resource::MANAGED_BY);
+            update_logical_drive(storage_service, *logical_drive_node);
+            node = logical_drive_node.get();
+        }
+        else {
+            update_logical_drive(storage_service, *node);
+        }
+        relink_children(*node, LOGICAL_DRIVES_COLLECTION_TYPE, "UsedBy",
+                        storage_service, logical_drives_node);
+        relink_children(*node, PHYSICAL_DRIVES_COLLECTION_TYPE, "UsedBy",
+                        storage_service, drives_node);
+    }
+    else if (0 == component_type.compare(TARGET_COMPONENT)) {
+        if (nullptr == node) {
+            auto target = std::make_shared<Target>(component_uuid, gami_id);
+            nodes_to_link.emplace_back(LinkType::COMPOSITION,
+                    Resource::MEMBERS, targets_node, target);
+            nodes_to_link.emplace_back(LinkType::ASSOCIATION,
+                    Targets::REMOTE_TARGETS, *storage_manager_node,
+                    target, Resource::MANAGED_BY);
+            update_target(storage_service, *target, logical_drives_node);
+            node = target.get();
+        }
+        else {
+            update_target(storage_service, *node, logical_drives_node);
+        }
+        relink_children(*node, LOGICAL_DRIVES_COLLECTION_TYPE, "Targets",
+                        storage_service, logical_drives_node);
+    }
+    else {
+        throw std::runtime_error("Unknown storage component type "
+                                 + component_type);
     }
     return nodes_to_link;
 }
 
+void StorageNodeBuilder::relink_children(Node& parent,
+        const std::string& collection_name,
+        const std::string& other_side_link_name,
+        StorageService& storage_service, const Node& root_node) {
+    std::vector<Node*> stale_children;
+    for (const auto& link : parent.get_links()) {
+        if (link.m_name == collection_name) {
+            stale_children.push_back(link.m_node);
+        }
+    }
+    for (auto* child : stale_children) {
+        parent.remove_link(*child);
+    }
+
+    for (auto* child : find_children(parent, collection_name,
+                                     storage_service, root_node)) {
+        parent.add_link(collection_name, *child, other_side_link_name);
+    }
+}
+
 std::string
 StorageNodeBuilder::get_node_id(const std::string& uuid) {
     if (nullptr != m_root) {
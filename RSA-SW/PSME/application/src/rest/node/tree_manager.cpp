@@ -168,6 +168,8 @@ private:
     void handle_add_event(const EventingAgent::Request& event);
     void handle_remove_event(const EventingAgent::Request& event);
     void handle_update_event(const EventingAgent::Request& event);
+    void handle_component_event(const EventingAgent::Request& event,
+                                EventType event_type);
 
     NodeBuilderUPtr create_node_builder(AgentSharedPtr agent);
 
@@ -212,6 +214,13 @@ TreeManager::EventBasedImpl::m_handle_events() {
             try {
                 auto event_type = get_event_type(*event);
 
+                // events concerning single component of agent's subtree
+                if (!event->get_type().empty()
+                    && EventType::UNKNOWN != event_type) {
+                    handle_component_event(*event, event_type);
+                    continue;
+                }
+
                 switch (event_type) {
                     case EventType::ADD:
                         handle_add_event(*event);
@@ -338,6 +347,44 @@ TreeManager::EventBasedImpl::handle_update_event(const EventingAgent::Request& e
     }
 }
 
+void
+TreeManager::EventBasedImpl::handle_component_event(
+        const EventingAgent::Request& event, EventType event_type) {
+    log_debug(GET_LOGGER("rest"), " Component event handler");
+
+    auto agent = AgentManager::get_instance().get_agent(event.get_gami_id());
+    // todo: compute and network agent.
+    if (!agent->has_capability("Storage")) {
+        log_debug(GET_LOGGER("rest"), " Component events are not supported: "
+                << event);
+        return;
+    }
+
+    // exclusive access, existing nodes are patched in place
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (EventType::REMOVE == event_type) {
+        // storage manager is shared by the whole service, so only the
+        // component node is erased, its links are cleared on erase
+        auto* found = m_root->get_node_by_uuid(event.get_id());
+        if (nullptr != found) {
+            m_root->erase(*found);
+        }
+        return;
+    }
+
+    StorageNodeBuilder builder(agent);
+    auto nodes_to_link = builder.build_component(*m_root, event.get_parent(),
+                                        event.get_id(), event.get_type());
+    for (auto& link : nodes_to_link) {
+        NodeBuilder::link_nodes(link.m_link_type,
+                                link.m_first_link_name,
+                                link.m_first,
+                                link.m_second,
+                                link.m_second_link_name);
+    }
+}
+
 TreeManager::TreeManager(const json::Value& config)
     : m_impl(new TreeManager::EventBasedImpl(config)) { }
 
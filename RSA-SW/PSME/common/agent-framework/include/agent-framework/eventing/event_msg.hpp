@@ -108,6 +108,43 @@ public:
         return m_transition;
     }
 
+    /*!
+     * @brief Sets component type, e.g. "HardDrive", "LogicalDrive" or "Target".
+     * Empty type means that the event concerns whole module and its subtree.
+     *
+     * @param type component type
+     */
+    void set_type(const std::string& type) {
+        m_type = type;
+    }
+
+    /*!
+     * @brief Gets component type
+     *
+     * @return component type
+     */
+    const std::string& get_type() const {
+        return m_type;
+    }
+
+    /*!
+     * @brief Sets uuid of the component owning this one
+     *
+     * @param parent parent component id
+     */
+    void set_parent(const std::string& parent) {
+        m_parent = parent;
+    }
+
+    /*!
+     * @brief Gets uuid of the component owning this one
+     *
+     * @return parent component id
+     */
+    const std::string& get_parent() const {
+        return m_parent;
+    }
+
     /*!
      * @brief Convert event message to json format
      *
@@ -119,6 +156,8 @@ private:
     std::string m_id;
     ModuleState::State m_state;
     StateMachineTransition::Transition m_transition;
+    std::string m_type{};
+    std::string m_parent{};
 };
 
 }
@@ -0,0 +1,174 @@
+/*!
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * @file component_registry.hpp
+ *
+ * @brief UUID index of agent components
+ * */
+
+#ifndef AGENT_FRAMEWORK_MODULE_COMPONENT_REGISTRY_HPP
+#define AGENT_FRAMEWORK_MODULE_COMPONENT_REGISTRY_HPP
+
+#include "agent-framework/threading/rw_lock.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace agent_framework {
+namespace generic {
+
+class HardDrive;
+class LogicalDrive;
+class Target;
+class Submodule;
+
+/*!
+ * @brief Global UUID index of submodules, hard drives, logical drives
+ * and targets.
+ *
+ * Containers register components when they are added and unregister
+ * them when they are removed, so lookups do not walk the module tree.
+ * Components are held by weak references. A component UUID must not be
+ * changed while it is registered.
+ *
+ * Lookups take a shared lock and may run concurrently.
+ */
+class ComponentRegistry {
+public:
+    using HardDriveSharedPtr = std::shared_ptr<HardDrive>;
+    using HardDriveWeakPtr = std::weak_ptr<HardDrive>;
+    using LogicalDriveSharedPtr = std::shared_ptr<LogicalDrive>;
+    using LogicalDriveWeakPtr = std::weak_ptr<LogicalDrive>;
+    using TargetSharedPtr = std::shared_ptr<Target>;
+    using TargetWeakPtr = std::weak_ptr<Target>;
+
+    /*!
+     * @brief Get global registry. It is never destroyed, so components
+     * may unregister from destructors at any time.
+     * @return Registry
+     */
+    static ComponentRegistry& get_instance();
+
+    /*!
+     * @brief Register hard drive
+     * @param[in] hard_drive Hard drive
+     */
+    void add_hard_drive(const HardDriveSharedPtr& hard_drive);
+
+    /*!
+     * @brief Unregister hard drive
+     * @param[in] hard_drive Hard drive
+     */
+    void remove_hard_drive(const HardDriveSharedPtr& hard_drive);
+
+    /*!
+     * @brief Register logical drive with all its child logical drives
+     * @param[in] logical_drive Logical drive
+     */
+    void add_logical_drive(const LogicalDriveSharedPtr& logical_drive);
+
+    /*!
+     * @brief Unregister logical drive with all its child logical drives
+     * @param[in] logical_drive Logical drive
+     */
+    void remove_logical_drive(const LogicalDriveSharedPtr& logical_drive);
+
+    /*!
+     * @brief Register target
+     * @param[in] target Target
+     */
+    void add_target(const TargetSharedPtr& target);
+
+    /*!
+     * @brief Unregister target
+     * @param[in] target Target
+     */
+    void remove_target(const TargetSharedPtr& target);
+
+    /*!
+     * @brief Register submodule
+     * @param[in] submodule Submodule
+     */
+    void add_submodule(Submodule* submodule);
+
+    /*!
+     * @brief Unregister submodule
+     * @param[in] submodule Submodule
+     */
+    void remove_submodule(Submodule* submodule);
+
+    /*!
+     * @brief Update submodule index after its UUID is changed
+     * @param[in] old_uuid Previous submodule UUID
+     * @param[in] submodule Submodule with new UUID
+     */
+    void rename_submodule(const std::string& old_uuid, Submodule* submodule);
+
+    /*!
+     * @brief Find hard drive
+     * @param[in] uuid Hard drive UUID
+     * @return Hard drive, expired if not found
+     */
+    HardDriveWeakPtr find_hard_drive(const std::string& uuid) const;
+
+    /*!
+     * @brief Find logical drive
+     * @param[in] uuid Logical drive UUID
+     * @return Logical drive, expired if not found
+     */
+    LogicalDriveWeakPtr find_logical_drive(const std::string& uuid) const;
+
+    /*!
+     * @brief Find target
+     * @param[in] uuid Target UUID
+     * @return Target, expired if not found
+     */
+    TargetWeakPtr find_target(const std::string& uuid) const;
+
+    /*!
+     * @brief Find submodule
+     * @param[in] uuid Submodule UUID
+     * @return Submodule or nullptr if not found
+     */
+    Submodule* find_submodule(const std::string& uuid) const;
+
+    /*! @brief Drop all registered components */
+    void clear();
+
+private:
+    ComponentRegistry() = default;
+    ComponentRegistry(const ComponentRegistry&) = delete;
+    ComponentRegistry& operator=(const ComponentRegistry&) = delete;
+
+    void m_add_logical_drive(const LogicalDriveSharedPtr& logical_drive);
+    void m_remove_logical_drive(const LogicalDriveSharedPtr& logical_drive);
+
+    mutable threading::RWLock m_lock{};
+    std::unordered_map<std::string, HardDriveWeakPtr> m_hard_drives{};
+    std::unordered_map<std::string, LogicalDriveWeakPtr> m_logical_drives{};
+    std::unordered_map<std::string, TargetWeakPtr> m_targets{};
+    std::unordered_map<std::string, Submodule*> m_submodules{};
+};
+
+}
+}
+
+#endif /* AGENT_FRAMEWORK_MODULE_COMPONENT_REGISTRY_HPP */
@@ -28,6 +28,7 @@
 #include "agent-framework/module/oem_data.hpp"
 #include "agent-framework/module/block_device.hpp"
 #include "agent-framework/module/hard_drive.hpp"
+#include "agent-framework/module/component_registry.hpp"
 
 #include <string>
 #include <vector>
@@ -220,6 +221,7 @@ public:
      * */
     void add_logical_drive(LogicalDriveSharedPtr logical_drive) {
         m_logical_drives.push_back(logical_drive);
+        ComponentRegistry::get_instance().add_logical_drive(logical_drive);
     }
 
     /*!
@@ -146,6 +146,15 @@ public:
         return std::string(m_name.string());
     }
 
+    /*!
+     * @brief Sets name of Module, used to keep UUID across restarts.
+     * @param[in] name Name of Module represented by UUID.
+     * @throw uuid_error_t if name is not a valid UUID
+     * */
+    void set_name(const std::string& name) {
+        m_name.import(name.c_str());
+    }
+
     /*!
      * @brief Gets IP address of Module
      * @return IP address of module
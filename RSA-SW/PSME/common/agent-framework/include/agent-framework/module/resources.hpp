@@ -48,6 +48,15 @@ public:
         return m_uuid.string();
     }
 
+    /*!
+     * @brief Set uuid, used to restore components persisted by the agent
+     * @param[in] uuid_str Component uuid in string representation
+     * @throw uuid_error_t if uuid_str is not a valid uuid
+     */
+    void set_uuid(const std::string& uuid_str) {
+        m_uuid.import(uuid_str.c_str());
+    }
+
     /*!
      * Gets status
      * @return Status reference
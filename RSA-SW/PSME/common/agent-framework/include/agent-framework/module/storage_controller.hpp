@@ -26,6 +26,7 @@
 #define AGENT_FRAMEWORK_MODULE_STORAGE_CONTROLLER_HPP
 
 #include "agent-framework/module/hard_drive.hpp"
+#include "agent-framework/module/component_registry.hpp"
 #include "agent-framework/module/fru_info.hpp"
 #include "agent-framework/module/oem_data.hpp"
 #include "agent-framework/module/status.hpp"
@@ -89,6 +90,7 @@ public:
      * */
     void add_hard_drive(const HardDriveSharedPtr& hard_drive) {
         m_hard_drives.push_back(hard_drive);
+        ComponentRegistry::get_instance().add_hard_drive(hard_drive);
     }
 
     /*!
@@ -107,6 +109,13 @@ public:
      * */
     HardDriveWeakPtr find_hard_drive(const string& uuid) const;
 
+    /*!
+     * @brief Delete hard drive with given UUID
+     * @param[in] uuid Hard drive UUID
+     * @return true if deleted successfuly, false otherwise
+     * */
+    bool delete_hard_drive(const string& uuid);
+
     /*!
      * @brief Returns FRUInfo.
      *
@@ -101,6 +101,13 @@ public:
      * */
     const std::string get_name() { return std::string(m_name.string()); }
 
+    /*!
+     * @brief Sets name of submodule, used to keep UUID across restarts.
+     * @param[in] name Name of submodule represented by UUID.
+     * @throw uuid_error_t if name is not a valid UUID
+     * */
+    void set_name(const std::string& name);
+
     /*!
      * @brief Sets type of submodule.
      *
@@ -230,6 +237,7 @@ public:
      * */
     void add_logical_drive(LogicalDriveSharedPtr logical_drive) {
         m_logical_drives.push_back(logical_drive);
+        ComponentRegistry::get_instance().add_logical_drive(logical_drive);
     }
 
     /*!
@@ -239,6 +247,13 @@ public:
      * */
     const std::vector<LogicalDriveSharedPtr> get_logical_drives() const;
 
+    /*!
+     * @brief Delete top level logical drive with given UUID
+     * @param[in] uuid Logical drive UUID
+     * @return true if deleted successfuly, false otherwise
+     * */
+    bool delete_logical_drive(const string& uuid);
+
     /*!
      * @brief Returns vector of targets.
      *
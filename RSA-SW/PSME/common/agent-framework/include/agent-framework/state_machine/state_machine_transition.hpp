@@ -66,6 +66,9 @@ public:
      *
      * @var Transition StateMachineTransition::DISCOVERY_MISSING
      * %StateMachine went to MISSING from UNKNOWN state.
+     *
+     * @var Transition StateMachineTransition::UPDATE
+     * Component is still UP but its properties have changed.
      */
     enum class Transition {
         IDLE,
@@ -75,13 +78,14 @@ public:
         CAME_UP,
         DISCOVERY_UP,
         DISCOVERY_DOWN,
-        DISCOVERY_MISSING
+        DISCOVERY_MISSING,
+        UPDATE
     };
 
     /**
      * @brief Transition names array
      */
-    static std::array<const char*, 8> transition_names;
+    static std::array<const char*, 9> transition_names;
 
 private:
     StateMachineTransition(const StateMachineTransition &MT);
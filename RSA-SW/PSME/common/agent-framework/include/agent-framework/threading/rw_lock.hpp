@@ -0,0 +1,103 @@
+/*!
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * @file rw_lock.hpp
+ *
+ * @brief Readers-writer lock
+ * */
+
+#ifndef AGENT_FRAMEWORK_THREADING_RW_LOCK_HPP
+#define AGENT_FRAMEWORK_THREADING_RW_LOCK_HPP
+
+#include <pthread.h>
+
+namespace agent_framework {
+namespace threading {
+
+/*!
+ * @brief Readers-writer lock, many readers or a single writer.
+ *
+ * Satisfies BasicLockable, so std::lock_guard takes it exclusively.
+ * Use RWLock::ReadGuard for shared access.
+ */
+class RWLock {
+public:
+    /*! @brief Scoped shared lock */
+    class ReadGuard {
+    public:
+        /*!
+         * @brief Take lock for reading
+         * @param lock Lock to be taken
+         */
+        explicit ReadGuard(RWLock& lock) : m_lock(lock) {
+            m_lock.lock_shared();
+        }
+
+        /*! @brief Release lock */
+        ~ReadGuard() {
+            m_lock.unlock_shared();
+        }
+
+    private:
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        RWLock& m_lock;
+    };
+
+    RWLock() {
+        pthread_rwlock_init(&m_rwlock, nullptr);
+    }
+
+    ~RWLock() {
+        pthread_rwlock_destroy(&m_rwlock);
+    }
+
+    /*! @brief Take lock exclusively */
+    void lock() {
+        pthread_rwlock_wrlock(&m_rwlock);
+    }
+
+    /*! @brief Release exclusive lock */
+    void unlock() {
+        pthread_rwlock_unlock(&m_rwlock);
+    }
+
+    /*! @brief Take lock for reading */
+    void lock_shared() {
+        pthread_rwlock_rdlock(&m_rwlock);
+    }
+
+    /*! @brief Release lock taken for reading */
+    void unlock_shared() {
+        pthread_rwlock_unlock(&m_rwlock);
+    }
+
+private:
+    RWLock(const RWLock&) = delete;
+    RWLock& operator=(const RWLock&) = delete;
+
+    pthread_rwlock_t m_rwlock;
+};
+
+}
+}
+
+#endif /* AGENT_FRAMEWORK_THREADING_RW_LOCK_HPP */
@@ -29,6 +29,7 @@
 #include "thread_queue.hpp"
 #include <thread>
 #include <future>
+#include <functional>
 #include <vector>
 
 namespace agent_framework {
@@ -33,5 +33,9 @@ Json::Value EventMsg::to_json() const {
     ret["newState"] = ModuleState::get_state_name(get_state());
     ret["transition"] = StateMachineTransition::get_transition_name(
                                                             get_transition());
+    if (!get_type().empty()) {
+        ret["type"] = get_type();
+        ret["parent"] = get_parent();
+    }
     return ret;
 }
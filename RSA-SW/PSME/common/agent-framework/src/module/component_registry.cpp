@@ -0,0 +1,175 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * @file component_registry.cpp
+ *
+ * @brief UUID index of agent components
+ * */
+
+#include "agent-framework/module/component_registry.hpp"
+#include "agent-framework/module/hard_drive.hpp"
+#include "agent-framework/module/logical_drive.hpp"
+#include "agent-framework/module/target.hpp"
+#include "agent-framework/module/submodule.hpp"
+
+#include <mutex>
+
+using namespace agent_framework::generic;
+
+using ReadGuard = agent_framework::threading::RWLock::ReadGuard;
+using WriteGuard = std::lock_guard<agent_framework::threading::RWLock>;
+
+namespace {
+
+/* Entry is removed only if it still refers to given component */
+template <typename Map, typename Component>
+void remove_entry(Map& map, const std::string& uuid, const Component* component) {
+    auto it = map.find(uuid);
+    if (map.end() != it) {
+        auto indexed = it->second.lock();
+        if (!indexed || indexed.get() == component) {
+            map.erase(it);
+        }
+    }
+}
+
+template <typename Map>
+typename Map::mapped_type find_entry(const Map& map, const std::string& uuid) {
+    auto it = map.find(uuid);
+    if (map.end() != it) {
+        return it->second;
+    }
+    return {};
+}
+
+}
+
+ComponentRegistry& ComponentRegistry::get_instance() {
+    static ComponentRegistry* registry = new ComponentRegistry();
+    return *registry;
+}
+
+void ComponentRegistry::add_hard_drive(const HardDriveSharedPtr& hard_drive) {
+    const auto uuid = hard_drive->get_uuid();
+    WriteGuard lock{m_lock};
+    m_hard_drives[uuid] = hard_drive;
+}
+
+void ComponentRegistry::remove_hard_drive(const HardDriveSharedPtr& hard_drive) {
+    const auto uuid = hard_drive->get_uuid();
+    WriteGuard lock{m_lock};
+    remove_entry(m_hard_drives, uuid, hard_drive.get());
+}
+
+void ComponentRegistry::add_logical_drive(const LogicalDriveSharedPtr& logical_drive) {
+    WriteGuard lock{m_lock};
+    m_add_logical_drive(logical_drive);
+}
+
+void ComponentRegistry::remove_logical_drive(const LogicalDriveSharedPtr& logical_drive) {
+    WriteGuard lock{m_lock};
+    m_remove_logical_drive(logical_drive);
+}
+
+void ComponentRegistry::m_add_logical_drive(const LogicalDriveSharedPtr& logical_drive) {
+    m_logical_drives[logical_drive->get_uuid()] = logical_drive;
+    for (const auto& child : logical_drive->get_logical_drives()) {
+        m_add_logical_drive(child);
+    }
+}
+
+void ComponentRegistry::m_remove_logical_drive(const LogicalDriveSharedPtr& logical_drive) {
+    remove_entry(m_logical_drives, logical_drive->get_uuid(), logical_drive.get());
+    for (const auto& child : logical_drive->get_logical_drives()) {
+        m_remove_logical_drive(child);
+    }
+}
+
+void ComponentRegistry::add_target(const TargetSharedPtr& target) {
+    const auto uuid = target->get_uuid();
+    WriteGuard lock{m_lock};
+    m_targets[uuid] = target;
+}
+
+void ComponentRegistry::remove_target(const TargetSharedPtr& target) {
+    const auto uuid = target->get_uuid();
+    WriteGuard lock{m_lock};
+    remove_entry(m_targets, uuid, target.get());
+}
+
+void ComponentRegistry::add_submodule(Submodule* submodule) {
+    const auto uuid = submodule->get_name();
+    WriteGuard lock{m_lock};
+    m_submodules[uuid] = submodule;
+}
+
+void ComponentRegistry::remove_submodule(Submodule* submodule) {
+    const auto uuid = submodule->get_name();
+    WriteGuard lock{m_lock};
+    auto it = m_submodules.find(uuid);
+    if (m_submodules.end() != it && it->second == submodule) {
+        m_submodules.erase(it);
+    }
+}
+
+void ComponentRegistry::rename_submodule(const std::string& old_uuid,
+                                         Submodule* submodule) {
+    const auto uuid = submodule->get_name();
+    WriteGuard lock{m_lock};
+    auto it = m_submodules.find(old_uuid);
+    if (m_submodules.end() != it && it->second == submodule) {
+        m_submodules.erase(it);
+        m_submodules[uuid] = submodule;
+    }
+}
+
+ComponentRegistry::HardDriveWeakPtr
+ComponentRegistry::find_hard_drive(const std::string& uuid) const {
+    ReadGuard lock{m_lock};
+    return find_entry(m_hard_drives, uuid);
+}
+
+ComponentRegistry::LogicalDriveWeakPtr
+ComponentRegistry::find_logical_drive(const std::string& uuid) const {
+    ReadGuard lock{m_lock};
+    return find_entry(m_logical_drives, uuid);
+}
+
+ComponentRegistry::TargetWeakPtr
+ComponentRegistry::find_target(const std::string& uuid) const {
+    ReadGuard lock{m_lock};
+    return find_entry(m_targets, uuid);
+}
+
+Submodule* ComponentRegistry::find_submodule(const std::string& uuid) const {
+    ReadGuard lock{m_lock};
+    return find_entry(m_submodules, uuid);
+}
+
+void ComponentRegistry::clear() {
+    WriteGuard lock{m_lock};
+    m_hard_drives.clear();
+    m_logical_drives.clear();
+    m_targets.clear();
+    m_submodules.clear();
+}
@@ -53,13 +53,17 @@ LogicalDrive::find_logical_drive(const std::string& uuid) const {
 
 bool LogicalDrive::delete_logical_drive(const std::string& uuid) {
 
-    auto it = std::remove_if(m_logical_drives.begin(), m_logical_drives.end(),
+    // removed elements stay valid, they are unregistered below
+    auto it = std::stable_partition(m_logical_drives.begin(), m_logical_drives.end(),
             [&uuid](LogicalDriveSharedPtr & ld) {
-                return uuid == ld->get_uuid();
+                return uuid != ld->get_uuid();
             });
 
     bool ret = (it != m_logical_drives.end());
 
+    for (auto removed = it; removed != m_logical_drives.end(); ++removed) {
+        ComponentRegistry::get_instance().remove_logical_drive(*removed);
+    }
     m_logical_drives.erase(it, m_logical_drives.end());
 
     return ret;
@@ -94,6 +94,7 @@ void Module::add_submodule(SubmoduleUniquePtr submodule) {
     submodule->set_ip_address(get_ip_address());
     submodule->set_username(get_username());
     submodule->set_password(get_password());
+    ComponentRegistry::get_instance().add_submodule(submodule.get());
     m_submodules.push_back(std::move(submodule));
 }
 
@@ -23,6 +23,7 @@
 */
 
 #include "agent-framework/module/module_manager.hpp"
+#include "agent-framework/module/component_registry.hpp"
 
 #include "agent-framework/logger_ext.hpp"
 #include "configuration/configuration.hpp"
@@ -85,6 +86,9 @@ void ModuleManager::cleanup() {
         return;
     }
     g_modules->clear();
+    // logical volumes and volume groups reference each other and outlive
+    // their modules, drop them from the index as well
+    ComponentRegistry::get_instance().clear();
 }
 
 ModuleManager::module_vec_t& ModuleManager::get_modules() {
@@ -108,62 +112,32 @@ Module* ModuleManager::get_module(const std::string& uuid) {
 }
 
 Submodule* ModuleManager::get_submodule(const std::string& uuid) {
-    auto& modules = ModuleManager::get_modules();
-    for (auto& module : modules) {
-        auto& submodules = module->get_submodules();
-        auto it = std::find_if(submodules.begin(), submodules.end(),
-                                        [&uuid](const SubmoduleUniquePtr& sm) {
-            return (uuid.compare(sm->get_name()) == 0); });
-        if (it != submodules.end()) {
-            return it->get();
-        }
-    }
-    return nullptr;
+    return ComponentRegistry::get_instance().find_submodule(uuid);
 }
 
 HardDriveWeakPtr ModuleManager::find_hard_drive(const std::string& uuid) {
-
-    const auto& modules = ModuleManager::get_modules();
-    for (const auto& module : modules) {
-        const auto& hard_drive = module->find_hard_drive(uuid);
-        if (!hard_drive.expired()) {
-            return hard_drive;
-        }
-    }
-    return {};
+    return ComponentRegistry::get_instance().find_hard_drive(uuid);
 }
 
 LogicalDriveWeakPtr ModuleManager::find_logical_drive(const std::string& uuid) {
-    const auto& modules = ModuleManager::get_modules();
-    for (const auto& module : modules) {
-        const auto& logical_drive = module->find_logical_drive(uuid);
-        if (!logical_drive.expired()) {
-            return logical_drive;
-        }
-    }
-    return {};
+    return ComponentRegistry::get_instance().find_logical_drive(uuid);
 }
 
 Target::TargetWeakPtr ModuleManager::find_target(const std::string& uuid) {
-
-    const auto& modules = ModuleManager::get_modules();
-    for (const auto& module : modules) {
-        const auto& target = module->find_target(uuid);
-        if (!target.expired()) {
-            return target;
-        }
-    }
-    return {};
+    return ComponentRegistry::get_instance().find_target(uuid);
 }
 
 std::vector<HardDriveSharedPtr> ModuleManager::get_hard_drives() {
     std::vector<HardDriveSharedPtr> hard_drives;
     const auto& modules = get_modules();
     for (const auto& module : modules) {
-        auto module_drives = std::move(module->get_hard_drives());
-        hard_drives.reserve(hard_drives.size() + module_drives.size());
-        std::copy(module_drives.cbegin(), module_drives.cend(),
-                  std::back_inserter(hard_drives));
+        for (const auto& submodule : module->get_submodules()) {
+            for (const auto& controller : submodule->get_storage_controllers()) {
+                const auto& drives = controller->get_hard_drives();
+                hard_drives.insert(hard_drives.end(),
+                                   drives.cbegin(), drives.cend());
+            }
+        }
     }
     return hard_drives;
 }
@@ -26,6 +26,8 @@
 #include "agent-framework/module/storage_controller.hpp"
 #include "json/json.hpp"
 
+#include <algorithm>
+
 using namespace agent_framework::generic;
 
 void StorageController::read_configuration(const json::Value& controller_configuration) {
@@ -57,7 +59,11 @@ void StorageController::read_configuration(const json::Value& controller_configu
 }
 
 
-StorageController::~StorageController(){}
+StorageController::~StorageController() {
+    for (const auto& hard_drive : m_hard_drives) {
+        ComponentRegistry::get_instance().remove_hard_drive(hard_drive);
+    }
+}
 
 HardDriveWeakPtr StorageController::find_hard_drive(const std::string& uuid) const {
     const auto& hard_drives = get_hard_drives();
@@ -68,3 +74,21 @@ HardDriveWeakPtr StorageController::find_hard_drive(const std::string& uuid) con
     }
     return {};
 }
+
+bool StorageController::delete_hard_drive(const std::string& uuid) {
+
+    // removed elements stay valid, they are unregistered below
+    auto it = std::stable_partition(m_hard_drives.begin(), m_hard_drives.end(),
+            [&uuid](HardDriveSharedPtr & hd) {
+                return uuid != hd->get_uuid();
+            });
+
+    bool ret = (it != m_hard_drives.end());
+
+    for (auto removed = it; removed != m_hard_drives.end(); ++removed) {
+        ComponentRegistry::get_instance().remove_hard_drive(*removed);
+    }
+    m_hard_drives.erase(it, m_hard_drives.end());
+
+    return ret;
+}
@@ -34,10 +34,26 @@
 
 #include <algorithm>
 #include <exception>
+#include <functional>
 
 using namespace agent_framework::generic;
 
-Submodule::~Submodule(){}
+Submodule::~Submodule() {
+    auto& registry = ComponentRegistry::get_instance();
+    for (const auto& logical_drive : m_logical_drives) {
+        registry.remove_logical_drive(logical_drive);
+    }
+    for (const auto& target : get_targets()) {
+        registry.remove_target(target);
+    }
+    registry.remove_submodule(this);
+}
+
+void Submodule::set_name(const std::string& name) {
+    const auto old_name = get_name();
+    m_name.import(name.c_str());
+    ComponentRegistry::get_instance().rename_submodule(old_name, this);
+}
 
 void Submodule::read_configuration(const json::Value& submod_configuration) {
     try {
@@ -224,6 +240,24 @@ const std::vector<LogicalDriveSharedPtr> Submodule::get_logical_drives() const {
     return result;
 }
 
+bool Submodule::delete_logical_drive(const std::string& uuid) {
+
+    // removed elements stay valid, they are unregistered below
+    auto it = std::stable_partition(m_logical_drives.begin(), m_logical_drives.end(),
+            [&uuid](LogicalDriveSharedPtr & ld) {
+                return uuid != ld->get_uuid();
+            });
+
+    bool ret = (it != m_logical_drives.end());
+
+    for (auto removed = it; removed != m_logical_drives.end(); ++removed) {
+        ComponentRegistry::get_instance().remove_logical_drive(*removed);
+    }
+    m_logical_drives.erase(it, m_logical_drives.end());
+
+    return ret;
+}
+
 HardDriveWeakPtr Submodule::find_hard_drive(const std::string& uuid) const {
 
     const auto& storage_controllers = get_storage_controllers();
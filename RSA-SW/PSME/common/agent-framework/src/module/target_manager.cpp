@@ -24,7 +24,9 @@
 
 #include "agent-framework/module/target_manager.hpp"
 #include "agent-framework/module/target.hpp"
+#include "agent-framework/module/component_registry.hpp"
 #include <algorithm>
+#include <limits>
 
 using namespace agent_framework::generic;
 
@@ -34,11 +36,13 @@ const TargetManager::TargetVec& TargetManager::get_targets() const {
 
 void TargetManager::add_target(const Target::TargetSharedPtr& target) {
     m_targets.emplace_back(target);
+    ComponentRegistry::get_instance().add_target(target);
 }
 
 void TargetManager::remove_target(const Target::TargetSharedPtr& target) {
     auto elem = std::find(m_targets.begin(), m_targets.end(), target);
     if (elem != m_targets.end()) {
+        ComponentRegistry::get_instance().remove_target(target);
         m_targets.erase(elem);
     }
 }
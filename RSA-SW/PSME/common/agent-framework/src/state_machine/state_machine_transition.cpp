@@ -26,7 +26,7 @@
 
 using namespace agent_framework::generic;
 
-std::array<const char*, 8> StateMachineTransition::transition_names = {
+std::array<const char*, 9> StateMachineTransition::transition_names = {
     {
         "IDLE",
         "EXTRACTION",
@@ -35,7 +35,8 @@ std::array<const char*, 8> StateMachineTransition::transition_names = {
         "CAME_UP",
         "DISCOVERY_UP",
         "DISCOVERY_DOWN",
-        "DISCOVERY_MISSING"
+        "DISCOVERY_MISSING",
+        "UPDATE"
     }
 };
 
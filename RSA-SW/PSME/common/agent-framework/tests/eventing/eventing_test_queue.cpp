@@ -69,3 +69,36 @@ TEST_F(EventQueueTest, PositiveQueuePushPop) {
     ASSERT_NE(out_msg.get(), nullptr);
     ASSERT_EQ(out_msg->get_id(), "TestEventId");
 }
+
+TEST_F(EventQueueTest, PositiveModuleEventJson) {
+    EventMsg msg(
+        "TestEventId",
+        ModuleState::State::ENABLED,
+        StateMachineTransition::Transition::DISCOVERY_UP);
+
+    const auto json = msg.to_json();
+
+    ASSERT_EQ(json["id"].asString(), "TestEventId");
+    ASSERT_EQ(json["transition"].asString(), "DISCOVERY_UP");
+    ASSERT_FALSE(json.isMember("type"));
+    ASSERT_FALSE(json.isMember("parent"));
+}
+
+TEST_F(EventQueueTest, PositiveComponentEventJson) {
+    EventMsg msg(
+        "TestDriveId",
+        ModuleState::State::ENABLED,
+        StateMachineTransition::Transition::UPDATE);
+    msg.set_type("HardDrive");
+    msg.set_parent("TestServiceId");
+
+    m_queue->push_back(msg);
+    const auto out_msg = m_queue->try_pop();
+    ASSERT_NE(out_msg.get(), nullptr);
+
+    const auto json = out_msg->to_json();
+
+    ASSERT_EQ(json["transition"].asString(), "UPDATE");
+    ASSERT_EQ(json["type"].asString(), "HardDrive");
+    ASSERT_EQ(json["parent"].asString(), "TestServiceId");
+}
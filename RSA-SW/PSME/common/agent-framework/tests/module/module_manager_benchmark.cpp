@@ -0,0 +1,148 @@
+/*!
+ * @section LICENSE
+ *
+ * @copyright
+ * Copyright (c) 2015 Intel Corporation
+ *
+ * @copyright
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * @copyright
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * @copyright
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Compares UUID lookups through ModuleManager index with walking
+ * the module tree. Only results are verified, timings are printed.
+ * */
+
+#include "../mocks/mock_logger_ext.hpp"
+
+#include "agent-framework/module/module_manager.hpp"
+#include "agent-framework/module/module.hpp"
+#include "agent-framework/module/submodule.hpp"
+
+#include "configuration/configuration.hpp"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using configuration::Configuration;
+
+using namespace agent_framework::generic;
+using namespace agent_framework::testing;
+
+class ModuleManagerBenchmark : public ::testing::Test {
+protected:
+    std::unique_ptr<ModuleManager> m_manager{};
+
+    std::unique_ptr<logger_cpp::Logger> m_logusrmock{};
+
+    std::vector<std::string> m_uuids{};
+
+    static constexpr char MODULES_CONFIGURATION[] = R"({
+    "modules": [
+        {
+            "ipv4": "1.1.2.1",
+            "username": "USERID",
+            "password": "PASSW0RD",
+            "port": 623,
+            "gpio": {"model": "PCA9555", "bus": 3, "address": 32, "bank": 0, "pins": [0, 3], "inverted": false},
+            "submodules": [
+                { "port": 62000 },
+                { "port": 62001 },
+                { "port": 62002 },
+                { "port": 62003 }
+            ]
+        }
+    ]
+    })";
+    static constexpr unsigned VOLUME_GROUPS = 10;
+    static constexpr unsigned LOGICAL_VOLUMES = 500;
+
+    virtual void SetUp() {
+
+        m_logusrmock.reset(new MockLogger);
+
+        Configuration::get_instance()
+            .set_default_configuration(MODULES_CONFIGURATION);
+
+        m_manager.reset(new ModuleManager);
+        m_manager->create();
+
+        /* Volumes are added to the last submodule, the worst case for walk */
+        auto& module = m_manager->get_modules().front();
+        auto& submodule = module->get_submodules().back();
+        for (unsigned vg = 0; vg < VOLUME_GROUPS; ++vg) {
+            auto volume_group = LogicalDrive::make_logical_drive();
+            for (unsigned lv = 0; lv < LOGICAL_VOLUMES; ++lv) {
+                auto logical_volume = LogicalDrive::make_logical_drive();
+                m_uuids.push_back(logical_volume->get_uuid());
+                volume_group->add_logical_drive(logical_volume);
+            }
+            m_uuids.push_back(volume_group->get_uuid());
+            submodule->add_logical_drive(volume_group);
+        }
+    }
+
+    virtual void TearDown() {
+        m_manager->cleanup();
+        m_manager.reset(nullptr);
+
+        Configuration::cleanup();
+
+        m_logusrmock.reset(nullptr);
+    }
+
+    virtual ~ModuleManagerBenchmark();
+};
+
+constexpr char ModuleManagerBenchmark::MODULES_CONFIGURATION[];
+constexpr unsigned ModuleManagerBenchmark::VOLUME_GROUPS;
+constexpr unsigned ModuleManagerBenchmark::LOGICAL_VOLUMES;
+
+ModuleManagerBenchmark::~ModuleManagerBenchmark() {}
+
+namespace {
+
+template <typename Lookup>
+std::chrono::microseconds measure(const std::vector<std::string>& uuids,
+                                  Lookup lookup) {
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& uuid : uuids) {
+        if (lookup(uuid).expired()) {
+            ADD_FAILURE() << "Logical drive not found: " << uuid;
+        }
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+}
+
+}
+
+TEST_F(ModuleManagerBenchmark, FindLogicalDrive) {
+    const auto& module = m_manager->get_modules().front();
+
+    const auto indexed = measure(m_uuids, [](const std::string& uuid) {
+        return ModuleManager::find_logical_drive(uuid);
+    });
+    const auto walked = measure(m_uuids, [&module](const std::string& uuid) {
+        return module->find_logical_drive(uuid);
+    });
+
+    std::cout << m_uuids.size() << " logical drive lookups: index "
+              << indexed.count() << " us, tree walk "
+              << walked.count() << " us" << std::endl;
+}
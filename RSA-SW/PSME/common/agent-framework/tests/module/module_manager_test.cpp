@@ -103,6 +103,7 @@ protected:
     })";
     static constexpr size_t MODULES_COUNT = 3;
     static constexpr char NONEXISTENT_UUID[] = "00000000-0000-0000-0000-000000000000";
+    static constexpr char RENAMED_UUID[] = "5a3c2b7e-7f4c-11e5-8bcf-feff819cdc9f";
 
     virtual void SetUp() {
 
@@ -130,6 +131,7 @@ protected:
 constexpr char ModuleManagerTest::MODULES_CONFIGURATION[];
 constexpr size_t ModuleManagerTest::MODULES_COUNT;
 constexpr char ModuleManagerTest::NONEXISTENT_UUID[];
+constexpr char ModuleManagerTest::RENAMED_UUID[];
 
 ModuleManagerTest::~ModuleManagerTest() {}
 
@@ -164,6 +166,65 @@ TEST_F(ModuleManagerTest, PositiveModuleManager_GetSubmodule) {
     ASSERT_EQ(m_manager->get_submodule(submod_name), submodule.get());
 }
 
+TEST_F(ModuleManagerTest, PositiveModuleManager_GetRenamedSubmodule) {
+    auto& submodule = m_manager->get_modules()[0]->get_submodules()[0];
+    const auto old_name = submodule->get_name();
+
+    submodule->set_name(RENAMED_UUID);
+
+    ASSERT_EQ(m_manager->get_submodule(RENAMED_UUID), submodule.get());
+    ASSERT_EQ(m_manager->get_submodule(old_name), nullptr);
+}
+
+TEST_F(ModuleManagerTest, PositiveModuleManager_FindHardDrive) {
+    auto& submodule = m_manager->get_modules()[0]->get_submodules()[0];
+    submodule->add_storage_controller(StorageController::make_storage_controller());
+    auto& storage_controller = submodule->get_storage_controllers().front();
+
+    auto hard_drive = std::make_shared<HardDrive>();
+    storage_controller->add_hard_drive(hard_drive);
+    const auto uuid = hard_drive->get_uuid();
+
+    ASSERT_EQ(m_manager->find_hard_drive(uuid).lock(), hard_drive);
+    ASSERT_EQ(m_manager->get_hard_drives().size(), 1u);
+
+    storage_controller->delete_hard_drive(uuid);
+
+    ASSERT_TRUE(m_manager->find_hard_drive(uuid).expired());
+}
+
+TEST_F(ModuleManagerTest, PositiveModuleManager_FindLogicalDrive) {
+    auto& submodule = m_manager->get_modules()[2]->get_submodules()[11];
+    auto volume_group = LogicalDrive::make_logical_drive();
+    auto logical_volume = LogicalDrive::make_logical_drive();
+    volume_group->add_logical_drive(logical_volume);
+    submodule->add_logical_drive(volume_group);
+    const auto vg_uuid = volume_group->get_uuid();
+    const auto lv_uuid = logical_volume->get_uuid();
+
+    ASSERT_EQ(m_manager->find_logical_drive(vg_uuid).lock(), volume_group);
+    ASSERT_EQ(m_manager->find_logical_drive(lv_uuid).lock(), logical_volume);
+
+    // volume is still referenced here, but it is not part of the model
+    submodule->delete_logical_drive(vg_uuid);
+
+    ASSERT_TRUE(m_manager->find_logical_drive(vg_uuid).expired());
+    ASSERT_TRUE(m_manager->find_logical_drive(lv_uuid).expired());
+}
+
+TEST_F(ModuleManagerTest, PositiveModuleManager_FindTarget) {
+    auto& submodule = m_manager->get_modules()[0]->get_submodules()[0];
+    auto target = Target::make_target();
+    submodule->get_target_manager().add_target(target);
+    const auto uuid = target->get_uuid();
+
+    ASSERT_EQ(m_manager->find_target(uuid).lock(), target);
+
+    submodule->get_target_manager().remove_target(target);
+
+    ASSERT_TRUE(m_manager->find_target(uuid).expired());
+}
+
 /* Negative */
 
 TEST_F(ModuleManagerTest, NegativeModuleManager_GetModule) {
@@ -174,3 +235,8 @@ TEST_F(ModuleManagerTest, NegativeModuleManager_GetSubmodule) {
     ASSERT_EQ(m_manager->get_submodule(NONEXISTENT_UUID), nullptr);
 }
 
+TEST_F(ModuleManagerTest, NegativeModuleManager_FindComponents) {
+    ASSERT_TRUE(m_manager->find_hard_drive(NONEXISTENT_UUID).expired());
+    ASSERT_TRUE(m_manager->find_logical_drive(NONEXISTENT_UUID).expired());
+    ASSERT_TRUE(m_manager->find_target(NONEXISTENT_UUID).expired());
+}
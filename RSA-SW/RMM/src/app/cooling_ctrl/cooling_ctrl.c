@@ -13,7 +13,193 @@
  */
 
 
+#include <time.h>
+
 #include "cooling_ctrl.h"
+#include "libwrap/wrap.h"
+#include "libwrap/am_api.h"
+
+static struct list_head *node_bucket(struct cooling_ctrl *ctrl, memdb_integer node_id)
+{
+	return &ctrl->nodes[(uint64)node_id % COOLING_HASH_SIZE];
+}
+
+static struct cooling_node *find_node(struct cooling_ctrl *ctrl, memdb_integer node_id)
+{
+	struct cooling_node *node;
+
+	list_for_each_entry(node, node_bucket(ctrl, node_id), list) {
+		if (node->node_id == node_id)
+			return node;
+	}
+
+	return NULL;
+}
+
+/* The CM of a drawer or a fan and the zone between them, NULL if not known yet. */
+static struct cooling_node *find_cm(struct cooling_ctrl *ctrl, struct cooling_node *node,
+									struct cooling_node **zone)
+{
+	struct cooling_node *cm;
+
+	*zone = find_node(ctrl, node->parent);
+	if (*zone == NULL)
+		return NULL;
+
+	cm = find_node(ctrl, (*zone)->parent);
+	if (cm == NULL || cm->type != MC_TYPE_CM)
+		return NULL;
+
+	return cm;
+}
+
+/* Inverse of get_cm_lid() and get_zone_lid() for thermal zones, 0 if not known yet. */
+static int64 get_tzone_idx(struct cooling_node *cm, struct cooling_node *tzone)
+{
+	if (cm->lid == 0)
+		return 0;
+
+	if (MAX_TZONE_NUM == 1)
+		return cm->lid;
+
+	if (tzone->lid == 0)
+		return 0;
+
+	return (cm->lid - 1) * MAX_TZONE_NUM + tzone->lid;
+}
+
+static int is_policy(struct cooling_ctrl *ctrl, char *policy)
+{
+	return strncmp(ctrl->policy, policy, strlen(policy)) == 0;
+}
+
+/* Take an attribute of a node into the model. */
+static void set_node_value(struct cooling_node *node, char *name, char *data)
+{
+	int idx;
+
+	if (node->type == MC_TYPE_DRAWER) {
+		if (strcmp(name, CHASSIS_TEMP_STR) == 0) {
+			node->thermal = atoi(data);
+		} else if (strncmp(name, FAN_PWM_STR, strlen(FAN_PWM_STR)) == 0) {
+			idx = atoi(name + strlen(FAN_PWM_STR));
+			if (idx >= 0 && idx < MAX_PWM_NUM)
+				node->pwm[idx] = atoi(data);
+		}
+	} else if (strcmp(name, WRAP_LOC_ID_STR) == 0) {
+		node->lid = atoi(data);
+	} else if (node->type == MC_TYPE_FAN && strcmp(name, FAN_ENABLE_STATE_STR) == 0) {
+		if (node->disabled != (atoi(data) == FAN_STATE_DISABLED)) {
+			node->disabled = !node->disabled;
+			/* enabling restores the pwm saved by libwrap, not ours */
+			node->output_pwm = -1;
+		}
+	}
+}
+
+/* Values of a node which existed before the subscription. */
+static void load_node_values(struct cooling_node *node)
+{
+	struct attr_info *info;
+	void *attrs;
+	int offset;
+	int size = 0;
+	int truncated = 0;
+
+	attrs = libdb_attrs_get_by_node(DB_RMM, node->node_id, 0, &size, &truncated, LOCK_ID_NULL);
+	if (attrs == NULL)
+		return;
+
+	foreach_attr_info(info, offset, attrs, size)
+		set_node_value(node, attr_name(info), (char *)attr_data(info));
+
+	libdb_free_attrs(attrs);
+}
+
+static struct cooling_node *add_node(struct cooling_ctrl *ctrl, memdb_integer node_id,
+									 memdb_integer parent, memdb_integer type)
+{
+	struct cooling_node *node;
+	int i;
+
+	node = find_node(ctrl, node_id);
+	if (node != NULL) {
+		node->parent = parent;
+		return node;
+	}
+
+	node = malloc(sizeof(*node));
+	if (node == NULL) {
+		rmm_log(ERROR, "node out of memory\n");
+		return NULL;
+	}
+	bzero(node, sizeof(*node));
+	node->node_id = node_id;
+	node->parent = parent;
+	node->type = type;
+	node->thermal = -1;
+	node->output_pwm = -1;
+	for (i = 0; i < MAX_PWM_NUM; i++)
+		node->pwm[i] = -1;
+
+	/* both policies' values are kept, a policy change needs no new subscription */
+	if (type == MC_TYPE_DRAWER)
+		node->handler = libdb_subscribe_attr_coalesced(DB_RMM, ctrl->sub, node_id, COOLING_DRAWER_PREFIX, LOCK_ID_NULL);
+	else if (type != MC_TYPE_DZONE)
+		node->handler = libdb_subscribe_attr_by_prefix(DB_RMM, ctrl->sub, node_id, WRAP_LOC_ID_STR, LOCK_ID_NULL);
+	if (type == MC_TYPE_FAN)
+		node->state_handler = libdb_subscribe_attr_by_prefix(DB_RMM, ctrl->sub, node_id, FAN_ENABLE_STATE_STR, LOCK_ID_NULL);
+
+	list_add_tail(&node->list, node_bucket(ctrl, node_id));
+	ctrl->dirty = 1;
+
+	return node;
+}
+
+static void del_node(struct cooling_ctrl *ctrl, memdb_integer node_id)
+{
+	struct cooling_node *node = find_node(ctrl, node_id);
+
+	if (node == NULL)
+		return;
+
+	if (node->handler)
+		libdb_unsubscribe_event(DB_RMM, node->handler, LOCK_ID_NULL);
+	if (node->state_handler)
+		libdb_unsubscribe_event(DB_RMM, node->state_handler, LOCK_ID_NULL);
+	list_del(&node->list);
+	free(node);
+	ctrl->dirty = 1;
+}
+
+/* Nodes present before cooling_ctrl started. */
+static void load_nodes(struct cooling_ctrl *ctrl, unsigned int type_min, unsigned int type_max)
+{
+	struct node_info *nodes;
+	struct cooling_node *node;
+	int num = 0;
+	int i;
+
+	nodes = libdb_list_node_by_type(DB_RMM, type_min, type_max, &num, NULL, LOCK_ID_NULL);
+	if (nodes == NULL)
+		return;
+
+	for (i = 0; i < num; i++) {
+		node = add_node(ctrl, nodes[i].node_id, nodes[i].parent, nodes[i].type);
+		if (node != NULL && node->type != MC_TYPE_DZONE)
+			load_node_values(node);
+	}
+
+	libdb_free_node(nodes);
+}
+
+static uint64 clock_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
 struct cooling_ctrl* cooling_allocate()
 {
@@ -24,13 +210,16 @@ struct cooling_ctrl* cooling_allocate()
 		return NULL;
 	}
 	bzero(ctrl, sizeof(struct cooling_ctrl));
+	ctrl->now_ms = clock_ms;
 	return ctrl;
 }
 
 void cooling_init(struct cooling_ctrl *ctrl)
 {
-	struct cm_attr * attr;
 	char policy[128] = {0};
+	int temp_min, temp_max, pwm_min, pwm_max;
+	int i;
+
 	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, COOLING_POLICY, policy, 128, LOCK_ID_NULL);
 
 	if(strlen(policy) == 0) {
@@ -39,26 +228,35 @@ void cooling_init(struct cooling_ctrl *ctrl)
 	else {
 		strncpy_safe(ctrl->policy, policy, sizeof(ctrl->policy), sizeof(ctrl->policy) - 1);
 	}
-	
 
-	ctrl->cm_create_handler = libdb_subscribe_node_create_by_type(DB_RMM, MC_TYPE_CM, LOCK_ID_NULL);
-	ctrl->cm_delete_handler = libdb_subscribe_node_delete_by_type(DB_RMM, MC_TYPE_CM, LOCK_ID_NULL);
+	ctrl->temp_min = COOLING_TEMP_MIN_DEFAULT;
+	ctrl->temp_max = COOLING_TEMP_MAX_DEFAULT;
+	ctrl->pwm_min = COOLING_PWM_MIN_DEFAULT;
+	ctrl->pwm_max = COOLING_PWM_MAX_DEFAULT;
+	if (rmm_cfg_get_cooling_curve(&temp_min, &temp_max, &pwm_min, &pwm_max) == 0) {
+		if (temp_min < temp_max && pwm_min <= pwm_max) {
+			ctrl->temp_min = temp_min;
+			ctrl->temp_max = temp_max;
+			ctrl->pwm_min = pwm_min;
+			ctrl->pwm_max = pwm_max;
+		} else {
+			rmm_log(ERROR, "invalid cooling curve in rmm.cfg, using the defaults\n");
+		}
+	}
 
-	ctrl->tmc_create_handler = libdb_subscribe_node_create_by_type(DB_RMM, MC_TYPE_DRAWER, LOCK_ID_NULL);
-	ctrl->tmc_delete_handler = libdb_subscribe_node_delete_by_type(DB_RMM, MC_TYPE_DRAWER, LOCK_ID_NULL);
+	for (i = 0; i < COOLING_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&ctrl->nodes[i]);
 
-	INIT_LIST_HEAD(&ctrl->cm_head);
-	INIT_LIST_HEAD(&ctrl->tmc_head);
-	INIT_LIST_HEAD(&ctrl->attr_head);
+	/* CM, drawer zone, drawer; thermal zone, fan */
+	ctrl->create_handler[0] = libdb_subscribe_type_of_node_create(DB_RMM, ctrl->sub, MC_TYPE_CM, MC_TYPE_DRAWER, LOCK_ID_NULL);
+	ctrl->delete_handler[0] = libdb_subscribe_type_of_node_delete(DB_RMM, ctrl->sub, MC_TYPE_CM, MC_TYPE_DRAWER, LOCK_ID_NULL);
+	ctrl->create_handler[1] = libdb_subscribe_type_of_node_create(DB_RMM, ctrl->sub, MC_TYPE_TZONE, MC_TYPE_FAN, LOCK_ID_NULL);
+	ctrl->delete_handler[1] = libdb_subscribe_type_of_node_delete(DB_RMM, ctrl->sub, MC_TYPE_TZONE, MC_TYPE_FAN, LOCK_ID_NULL);
+	ctrl->policy_handler = libdb_subscribe_attr_by_prefix(DB_RMM, ctrl->sub, MC_TYPE_RMC, COOLING_POLICY, LOCK_ID_NULL);
 
-	attr = malloc(sizeof(*attr));
-	if (attr == NULL) {
-		rmm_log(ERROR, "attr out of memory\n");
-		return;
-	}
-	attr->prefix_handler = libdb_subscribe_attr_by_prefix(DB_RMM, MC_TYPE_RMC, COOLING_POLICY, LOCK_ID_NULL);
-	attr->node_id = MC_TYPE_RMC;
-	list_add_tail(&attr->list, &ctrl->attr_head);
+	load_nodes(ctrl, MC_TYPE_CM, MC_TYPE_DRAWER);
+	load_nodes(ctrl, MC_TYPE_TZONE, MC_TYPE_FAN);
+	ctrl->dirty = 1;
 }
 
 static int policy_changed(struct cooling_ctrl *ctrl, struct event_info *evt)
@@ -76,176 +274,154 @@ static int policy_changed(struct cooling_ctrl *ctrl, struct event_info *evt)
 	return 0;
 }
 
-static void subscribe_attr(struct cooling_ctrl * ctrl, memdb_integer node_id)
+static void attr_change_action(struct event_info *evt, struct cooling_ctrl * ctrl)
 {
-	struct cm_attr  * attr;
-	
-	if (strncmp(ctrl->policy, POLICY_FIXED_PWM_STR, strlen(POLICY_FIXED_PWM_STR)) != 0) {
-		attr = malloc(sizeof(*attr));
-		if (attr == NULL) {
-			rmm_log(ERROR, "attr out of memory\n");
-			return;
-		}
-		if (strncmp(ctrl->policy, POLICY_AGGREGATED_THERMAL_STR, strlen(POLICY_AGGREGATED_THERMAL_STR)) == 0) {
-			attr->prefix_handler = libdb_subscribe_attr_by_prefix(DB_RMM, node_id, CHASSIS_TEMP_STR, LOCK_ID_NULL);
-		}
-		else if (strncmp(ctrl->policy, POLICY_AGGREGATED_PWM_STR, strlen(POLICY_AGGREGATED_PWM_STR)) == 0) {
-			attr->prefix_handler = libdb_subscribe_attr_by_prefix(DB_RMM, node_id, FAN_PWM_STR, LOCK_ID_NULL);
-		}
+	struct cooling_node *node;
 
-		attr->node_id = node_id;
-		list_add_tail(&attr->list, &ctrl->attr_head);
+	if (evt->anodeid == MC_TYPE_RMC) {
+		if (policy_changed(ctrl, evt)) {
+			rmm_log(INFO, "policy changed, new policy is %s\n", ctrl->policy);
+			ctrl->dirty = 1;
+		}
+		return;
 	}
+
+	node = find_node(ctrl, evt->anodeid);
+	if (node == NULL)
+		return;
+
+	set_node_value(node, event_attr_name(evt), (char *)event_attr_data(evt));
+	ctrl->dirty = 1;
 }
 
-static int node_delete_action(struct event_info *evt, struct cooling_ctrl * ctrl)
+void cooling_event_ops(struct event_info *evt, void *cb_data)
 {
-	struct cm_node  * cm;
-	struct cm_attr  * attr;
-	struct tmc_node * tmc;
-	
-	if (evt->ntype == MC_TYPE_CM) {
-		list_for_each_entry(cm, &ctrl->cm_head, list) {
-			if(cm->node_id == evt->nnodeid) {
-				list_del(&cm->list);
-				free(cm);
-				break;
-			}
-		}
-		return 0;
+	struct cooling_ctrl * ctrl = (struct cooling_ctrl *)cb_data;
+
+	if (evt->event == EVENT_NODE_DELETE) {
+		rmm_log(INFO, "Node delete, node_id is %lu\n", evt->nnodeid);
+		del_node(ctrl, evt->nnodeid);
 	} 
-	else if (evt->ntype == MC_TYPE_DRAWER) {
-		list_for_each_entry(tmc, &ctrl->tmc_head, list) {
-			if(tmc->node_id == evt->nnodeid) {
-				list_del(&tmc->list);
-				free(tmc);
-				break;
-			}
-		}
-		list_for_each_entry(attr, &ctrl->attr_head, list) {
-			if(attr->node_id == evt->nnodeid) {
-				libdb_unsubscribe_event(DB_RMM, attr->prefix_handler, LOCK_ID_NULL);
-				list_del(&attr->list);
-				free(attr);
-				break;
-			}
-		}
-		return 0;
+	else if (evt->event == EVENT_NODE_CREATE) {
+		rmm_log(INFO, "Node create, node_id is %lu\n", evt->nnodeid);
+		add_node(ctrl, evt->nnodeid, evt->nparent, evt->ntype);
+	}
+	else if(evt->event == EVENT_NODE_ATTR) {
+		rmm_log(DBG, "Atrribute changed, event node_id is %lu\n", evt->anodeid);
+		attr_change_action(evt, ctrl);
+	}
+	else {
+		rmm_log(ERROR, "Unknown event!\n");
 	}
-	
-	return 0;
 }
 
-static int node_create_action(struct event_info *evt, struct cooling_ctrl * ctrl)
+static int thermal_to_pwm(struct cooling_ctrl *ctrl, int thermal)
 {
-	struct cm_node  * cm;
-	struct tmc_node * tmc;
-	
-	if (evt->ntype == MC_TYPE_CM) {
-		list_for_each_entry(cm, &ctrl->cm_head, list) {
-			if (cm->node_id == evt->nnodeid) {
-				rmm_log(ERROR, "subcribed already\n");
-				return -1;
-			}
-		}
-
-		cm = malloc(sizeof(*cm));
-		if (cm == NULL) {
-			rmm_log(ERROR, "cm out of memory\n");
-			return -1;
-		}
-		cm->node_id = evt->nnodeid;
-		list_add_tail(&cm->list, &ctrl->cm_head);
-		
-		return 0;
-	}
-	else if (evt->ntype == MC_TYPE_DRAWER) {
-		list_for_each_entry(tmc, &ctrl->tmc_head, list) {
-			if (tmc->node_id == evt->nnodeid) {
-				rmm_log(ERROR, "added already\n");
-				return -1;
-			}
-		}
-		
-		tmc = malloc(sizeof(*tmc));
-		if (tmc == NULL) {
-			rmm_log(ERROR, "tmc out of memory\n");
-			return -1;
-		}
-		tmc->node_id = evt->nnodeid;
-		list_add_tail(&tmc->list, &ctrl->tmc_head);
+	if (thermal <= ctrl->temp_min)
+		return ctrl->pwm_min;
+	if (thermal >= ctrl->temp_max)
+		return ctrl->pwm_max;
 
-		subscribe_attr(ctrl, evt->nnodeid);
-		rmm_log(INFO, "current policy is %s\n", ctrl->policy);
-
-		return 0;
-	}
-	return 0;
+	return ctrl->pwm_min + (thermal - ctrl->temp_min) *
+		(ctrl->pwm_max - ctrl->pwm_min) / (ctrl->temp_max - ctrl->temp_min);
 }
 
-static int attr_change_action(struct event_info *evt, struct cooling_ctrl * ctrl)
+/* Target pwm of each fan position of a CM, from the drawers below it. */
+static void aggregate_drawers(struct cooling_ctrl *ctrl)
 {
-	struct tmc_node  * tmc;
-	struct cm_attr  * attr, *attr_policy,*attr_safe;
-	int aggregated_thermal, aggregated_pwm;
-	
-	list_for_each_entry(attr, &ctrl->attr_head, list) {
-		if (attr->node_id == MC_TYPE_RMC && policy_changed(ctrl, evt)) {
-			rmm_log(INFO, "policy changed, new policy is %s\n", ctrl->policy);
-			/* unsubscribe old attribute belong to CM and TMC */
-			list_for_each_entry_safe(attr_policy, attr_safe, &ctrl->attr_head, list) {
-				if (attr_policy->node_id != MC_TYPE_RMC) {
-					libdb_unsubscribe_event(DB_RMM, attr_policy->prefix_handler, LOCK_ID_NULL);
-					list_del(&attr_policy->list);
-					free(attr_policy);
-				}
-			}
-			/* subscribe attribute for new poicy */
-			list_for_each_entry(tmc, &ctrl->tmc_head, list) {
-				subscribe_attr(ctrl, tmc->node_id);
-			}
-			return 0;
+	struct cooling_node *node;
+	struct cooling_node *zone;
+	struct cooling_node *cm;
+	int thermal = is_policy(ctrl, POLICY_AGGREGATED_THERMAL_STR);
+	int i, j;
+
+	for (i = 0; i < COOLING_HASH_SIZE; i++) {
+		list_for_each_entry(node, &ctrl->nodes[i], list) {
+			if (node->type != MC_TYPE_CM)
+				continue;
+			for (j = 0; j < MAX_PWM_NUM; j++)
+				node->pwm[j] = -1;
 		}
-		else if (attr->node_id == evt->anodeid) {
-			if (strncmp(ctrl->policy, POLICY_AGGREGATED_THERMAL_STR, strlen(POLICY_AGGREGATED_THERMAL_STR)) == 0) {
-				libdb_attr_get_int(DB_RMM, evt->anodeid, CHASSIS_TEMP_STR, &aggregated_thermal, LOCK_ID_NULL);
+	}
 
-				if(attr->aggregated_thermal != aggregated_thermal && aggregated_thermal != -1) {
-					rmm_log(INFO, "aggregated_thermal changed from %d to %d on node %lu\n", attr->aggregated_thermal, aggregated_thermal, attr->node_id);
-					attr->aggregated_thermal = aggregated_thermal;
-				}
-			}
-			else if (strncmp(ctrl->policy, POLICY_AGGREGATED_PWM_STR, strlen(POLICY_AGGREGATED_PWM_STR)) == 0) {
-				libdb_attr_get_int(DB_RMM, evt->anodeid, "aggregated_pwm0", &aggregated_pwm, LOCK_ID_NULL);
-				
-				if(attr->aggregated_pwm[0] != aggregated_pwm && aggregated_pwm != -1) {
-					rmm_log(INFO, "aggregated_pwm changed from %d to %d on node %lu\n", attr->aggregated_pwm, aggregated_pwm, attr->node_id);
-					attr->aggregated_pwm[0] = aggregated_pwm;
+	for (i = 0; i < COOLING_HASH_SIZE; i++) {
+		list_for_each_entry(node, &ctrl->nodes[i], list) {
+			if (node->type != MC_TYPE_DRAWER)
+				continue;
+			cm = find_cm(ctrl, node, &zone);
+			if (cm == NULL)
+				continue;
+
+			for (j = 0; j < MAX_PWM_NUM; j++) {
+				if (thermal) {
+					if (node->thermal >= 0 && thermal_to_pwm(ctrl, node->thermal) > cm->pwm[j])
+						cm->pwm[j] = thermal_to_pwm(ctrl, node->thermal);
+				} else if (node->pwm[j] > cm->pwm[j]) {
+					cm->pwm[j] = node->pwm[j];
 				}
 			}
-			return 0;
 		}
 	}
-	return 0;
 }
 
-void cooling_event_ops(struct event_info *evt, void *cb_data)
+int cooling_tick(struct cooling_ctrl *ctrl)
 {
-	struct cooling_ctrl * ctrl = (struct cooling_ctrl *)cb_data;
+	struct cooling_node *node;
+	struct cooling_node *tzone;
+	struct cooling_node *cm;
+	int64 tzone_idx;
+	uint64 start;
+	int sent = 0;
+	int left = 0;
+	int pwm;
+	int i;
 
-	if (evt->event == EVENT_NODE_DELETE) {
-		rmm_log(INFO, "Node delete, node_id is %lu\n", evt->nnodeid);
-		node_delete_action(evt,ctrl);
-	} 
-	else if (evt->event == EVENT_NODE_CREATE) {
-		rmm_log(INFO, "Node create, node_id is %lu\n", evt->nnodeid);
-		node_create_action(evt,ctrl);
-	}
-	else if(evt->event == EVENT_NODE_ATTR) {
-		rmm_log(INFO, "Atrribute changed, event node_id is %lu\n", evt->anodeid);
-		attr_change_action(evt, ctrl);
+	if (!ctrl->dirty)
+		return 0;
+	ctrl->dirty = 0;
+
+	if (is_policy(ctrl, POLICY_FIXED_PWM_STR))
+		return 0;
+
+	aggregate_drawers(ctrl);
+
+	start = ctrl->now_ms();
+	for (i = 0; i < COOLING_HASH_SIZE; i++) {
+		list_for_each_entry(node, &ctrl->nodes[i], list) {
+			if (node->type != MC_TYPE_FAN || node->lid < 1 || node->lid > MAX_PWM_NUM ||
+				node->disabled)
+				continue;
+			cm = find_cm(ctrl, node, &tzone);
+			if (cm == NULL)
+				continue;
+			tzone_idx = get_tzone_idx(cm, tzone);
+			if (tzone_idx == 0)
+				continue;
+
+			pwm = cm->pwm[node->lid - 1];
+			if (pwm < 0 || pwm == node->output_pwm)
+				continue;
+
+			if (left || ctrl->now_ms() - start >= COOLING_TICK_BUDGET_MS) {
+				left++;
+				continue;
+			}
+
+			if (am_set_fan_pwm(tzone_idx, node->lid, pwm) != 0) {
+				rmm_log(ERROR, "set pwm of fan %d in tzone %lld fail\n", node->lid, tzone_idx);
+				ctrl->dirty = 1;		/* retried next tick */
+				continue;
+			}
+			node->output_pwm = pwm;
+			sent++;
+		}
 	}
-	else {
-		rmm_log(ERROR, "Unknown event!\n");
+
+	if (left) {
+		rmm_log(ERROR, "cooling tick over %d ms after %d fan commands, %d left for the next tick\n",
+				COOLING_TICK_BUDGET_MS, sent, left);
+		ctrl->dirty = 1;
 	}
+
+	return sent;
 }
@@ -60,36 +60,54 @@
 #define DEFAULT_FAN_PRESENT        0x01
 #define DEFAULT_SHELF_PRESENT      0x03
 
-struct cm_node {
-	struct list_head list;
-	memdb_integer node_id;
-	int output_pwm;
-};
+#define COOLING_TICK_MS			200		/* policies run at this rate */
+#define COOLING_TICK_BUDGET_MS	100		/* fan commands of a tick stop after this */
+#define COOLING_HASH_SIZE		64
 
-struct tmc_node {
-	struct list_head list;
-	memdb_integer node_id;
-};
+#define COOLING_DRAWER_PREFIX	"aggregated_"	/* CHASSIS_TEMP_STR and FAN_PWM_STR */
 
-struct cm_attr {
-	struct list_head  list;
-	memdb_integer     node_id;
-	memdb_integer prefix_handler;
-	int    aggregated_thermal;
-	int    aggregated_pwm[MAX_PWM_NUM];
+/*
+ * aggregated_thermal policy: linear from pwm_min at temp_min to pwm_max at
+ * temp_max. Taken from the cooling_ctrl section of rmm.cfg; these defaults
+ * are placeholders used when it is missing, not values from a platform spec.
+ */
+#define COOLING_TEMP_MIN_DEFAULT	25
+#define COOLING_TEMP_MAX_DEFAULT	45
+#define COOLING_PWM_MIN_DEFAULT		30
+#define COOLING_PWM_MAX_DEFAULT		100
+
+/* A CM, thermal zone, drawer zone, drawer or fan, kept up to date from memdb events. */
+struct cooling_node {
+	struct list_head list;			/* hash bucket */
+	memdb_integer node_id;
+	memdb_integer parent;
+	memdb_integer type;
+	memdb_integer handler;			/* attr subscription, not for drawer zones */
+	memdb_integer state_handler;	/* fans: enable_state subscription */
+
+	int lid;						/* CMs, thermal zones and fans: loc_id, 0 if unknown */
+	int thermal;					/* drawers: aggregated_thermal, -1 if unknown */
+	int pwm[MAX_PWM_NUM];			/* drawers: aggregated_pwm<n>, CMs: target of each fan */
+	int output_pwm;					/* fans: last pwm sent, -1 if none */
+	int disabled;					/* fans: turned off by fan_change_state, not driven */
 };
 
 struct cooling_ctrl {
 	char policy[32];
-	struct list_head cm_head;
-	struct list_head tmc_head;
-	struct list_head attr_head;
-	
-	memdb_integer cm_create_handler;
-	memdb_integer cm_delete_handler;
-	
-	memdb_integer tmc_create_handler;
-	memdb_integer tmc_delete_handler;
+	struct list_head nodes[COOLING_HASH_SIZE];
+	int dirty;						/* model changed or a command failed since the last tick */
+
+	int temp_min;
+	int temp_max;
+	int pwm_min;
+	int pwm_max;
+
+	uint64 (*now_ms)(void);			/* monotonic clock of the tick budget */
+
+	int sub;						/* memdb subscriber */
+	memdb_integer policy_handler;
+	memdb_integer create_handler[2];
+	memdb_integer delete_handler[2];
 };
 
 enum cooling_policy {
@@ -100,6 +118,21 @@ enum cooling_policy {
 
 struct cooling_ctrl* cooling_allocate();
 void cooling_init(struct cooling_ctrl *ctrl);
+
+/**
+ * @brief update the model from a memdb event, nothing is read from memdb.
+ */
 void cooling_event_ops(struct event_info *evt, void *cb_data);
 
+/**
+ * @brief run the current policy over the model, to be called every COOLING_TICK_MS.
+ *
+ * Each enabled fan whose target pwm changed gets one am_set_fan_pwm(), a
+ * failed one is retried on the next tick. The commands wait for the asset
+ * module, those left after COOLING_TICK_BUDGET_MS go on the next tick.
+ *
+ * @return number of fan commands sent.
+ */
+int cooling_tick(struct cooling_ctrl *ctrl);
+
 #endif /* ifndef __COOLING_CONTRL_H__ */
@@ -15,12 +15,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "libjsonrpcapi/libjsonrpcapi.h"
 #include "libjipmi/common.h"
 #include "cooling_ctrl.h"
 #include "librmmcfg/rmm_cfg.h"
 #include "libinit/libinit.h"
+#include "libwrap/wrap.h"
+
+#define COOLING_CONNECT_MS		5000	/* retry interval while the asset module is down */
 
 int main()
 {
@@ -29,6 +33,11 @@ int main()
 	fd_set rfds;
 	struct cooling_ctrl *ctrl;
 	int port;
+	struct timeval tv;
+	uint64 now;
+	uint64 next_tick;
+	uint64 next_connect;
+	int connected = 0;
 
 	if (daemon(1, 1) < 0)
 		exit(-1);
@@ -41,7 +50,8 @@ int main()
 	if (ctrl == NULL)
 		exit(-1);
 
-	if (libdb_init_subscription(NOTIFY_BY_SELECT, cooling_event_ops, ctrl) < 0) {
+	ctrl->sub = libdb_init_subscription(NOTIFY_BY_SELECT, cooling_event_ops, ctrl);
+	if (ctrl->sub < 0) {
 		rmm_log(ERROR, "Failed to init select subscirbe mode!\n");
 		return -1;
 	}
@@ -50,17 +60,37 @@ int main()
 
 	rmm_log(INFO, "cooling ctrl default init success!\n");
 
+	/* events only update the model, policies run on a fixed tick */
+	next_tick = ctrl->now_ms();
+	next_connect = next_tick;
 	for (;;) {
+		now = ctrl->now_ms();
+		if (!connected && now >= next_connect) {
+			/* fan commands go to the asset module */
+			connected = (libwrap_connect_asset_module() == RESULT_OK);
+			if (!connected)
+				next_connect = now + COOLING_CONNECT_MS;
+		}
+		if (now >= next_tick) {
+			if (connected)
+				cooling_tick(ctrl);
+			next_tick += COOLING_TICK_MS;
+			if (next_tick <= now)
+				next_tick = now + COOLING_TICK_MS;
+		}
+
 		max_fd = -1;
 		FD_ZERO(&rfds);
 
-		libjsonrpcapi_callback_selectfds(&rfds, &max_fd);
+		libjsonrpcapi_callback_selectfds(ctrl->sub, &rfds, &max_fd);
 
-		rc = select(max_fd + 1, &rfds, NULL, NULL, NULL);
+		tv.tv_sec = (next_tick - now) / 1000;
+		tv.tv_usec = ((next_tick - now) % 1000) * 1000;
+		rc = select(max_fd + 1, &rfds, NULL, NULL, &tv);
 		if (rc <= 0)
 			continue;
 
-		libjsonrpcapi_callback_processfds(&rfds);
+		libjsonrpcapi_callback_processfds(ctrl->sub, &rfds);
 	}
 
 }
@@ -0,0 +1,477 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Replays a memdb event trace through the controller, memdb, the asset
+ * module and rmmlogd are replaced by the stubs below. Events reach the
+ * controller only if it subscribed to them, as with memdbd. Every
+ * am_set_fan_pwm() is logged and the log is compared with a golden file
+ * recorded from a reviewed run. Prints the memdb calls made and the time
+ * spent per event and per tick.
+ *
+ * Trace lines, times in ms, other lines are skipped:
+ *   <ms> create <node_id> <parent> <type>
+ *   <ms> delete <node_id>
+ *   <ms> attr <node_id> <name> <value>
+ *   <ms> latency <ms>		each am_set_fan_pwm() takes this long from now on
+ *
+ * Golden lines, one per fan command:
+ *   <tick ms> <tzone_idx> <fan_idx> <pwm>
+ *
+ * test_cooling_replay replay/rack.trace replay/rack.golden
+ * test_cooling_replay <trace> prints the log, to record a new golden file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libwrap/wrap.h"
+#include "libutils/test.h"
+#include "cooling_ctrl.h"
+
+#define MAX_NODES		256
+#define MAX_ATTRS		16
+#define MAX_SUBS		512
+#define MAX_LINE		256
+#define MAX_CMD_LOG		(1024 * 1024)
+
+struct stub_attr {
+	char name[WRAP_DB_MAX_KEY_LEN];
+	char data[WRAP_DB_MAX_VALUE_LEN];
+};
+
+struct stub_node {
+	int used;
+	memdb_integer node_id;
+	memdb_integer parent;
+	memdb_integer type;
+	int attr_num;
+	struct stub_attr attrs[MAX_ATTRS];
+};
+
+struct stub_sub {
+	int used;
+	int attr;					/* attr subscription, else node events */
+	memdb_integer node_id;
+	char prefix[WRAP_DB_MAX_KEY_LEN];
+	unsigned int type_min;
+	unsigned int type_max;
+};
+
+static struct stub_node store[MAX_NODES];
+static struct stub_sub subs[MAX_SUBS];
+static char store_policy[32] = POLICY_AGGREGATED_THERMAL_STR;
+
+static int memdb_reads;
+static int memdb_subscribes;
+static int attr_events;
+static int delivered;
+static int attr_delivered;
+
+static char cmd_log[MAX_CMD_LOG];
+static int cmd_log_len;
+static long long tick_ms;
+static long long clock_ms;		/* the controller's clock, advanced by the asset module stub */
+static long long latency_ms;
+
+static struct stub_node *stub_find(memdb_integer node_id)
+{
+	int i;
+
+	for (i = 0; i < MAX_NODES; i++) {
+		if (store[i].used && store[i].node_id == node_id)
+			return &store[i];
+	}
+
+	return NULL;
+}
+
+static char *stub_get(struct stub_node *node, char *name)
+{
+	int i;
+
+	for (i = 0; i < node->attr_num; i++) {
+		if (strcmp(node->attrs[i].name, name) == 0)
+			return node->attrs[i].data;
+	}
+
+	return NULL;
+}
+
+static void stub_set(struct stub_node *node, char *name, char *data)
+{
+	char *value = stub_get(node, name);
+
+	if (value == NULL) {
+		if (node->attr_num == MAX_ATTRS)
+			return;
+		strncpy_safe(node->attrs[node->attr_num].name, name, WRAP_DB_MAX_KEY_LEN, WRAP_DB_MAX_KEY_LEN - 1);
+		value = node->attrs[node->attr_num++].data;
+	}
+	strncpy_safe(value, data, WRAP_DB_MAX_VALUE_LEN, WRAP_DB_MAX_VALUE_LEN - 1);
+}
+
+static memdb_integer stub_subscribe(int attr, memdb_integer node_id, char *prefix,
+									unsigned int type_min, unsigned int type_max)
+{
+	int i;
+
+	memdb_subscribes++;
+	for (i = 0; i < MAX_SUBS; i++) {
+		if (subs[i].used)
+			continue;
+		subs[i].used = 1;
+		subs[i].attr = attr;
+		subs[i].node_id = node_id;
+		strncpy_safe(subs[i].prefix, prefix ? prefix : "", WRAP_DB_MAX_KEY_LEN, WRAP_DB_MAX_KEY_LEN - 1);
+		subs[i].type_min = type_min;
+		subs[i].type_max = type_max;
+		return i + 1;
+	}
+
+	return 0;
+}
+
+static int subscribed_node(memdb_integer type)
+{
+	int i;
+
+	for (i = 0; i < MAX_SUBS; i++) {
+		if (subs[i].used && !subs[i].attr && type >= subs[i].type_min && type <= subs[i].type_max)
+			return 1;
+	}
+
+	return 0;
+}
+
+static int subscribed_attr(memdb_integer node_id, char *name)
+{
+	int i;
+
+	for (i = 0; i < MAX_SUBS; i++) {
+		if (subs[i].used && subs[i].attr && subs[i].node_id == node_id &&
+			strncmp(name, subs[i].prefix, strlen(subs[i].prefix)) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* logging stubs, there is no rmmlogd to send records to */
+
+static int32 log_level = ERROR;
+volatile int32 *rmm_log_level = &log_level;
+
+int rmm_log_request(int level, const char *func, const char *fmt, ...)
+{
+	return 0;
+}
+
+/* memdb stubs, the calls cooling_ctrl.c makes */
+
+memdb_integer libdb_attr_get_string(unsigned char db_name, memdb_integer node, char *name, char *output, int64 len, lock_id_t lock_id)
+{
+	memdb_reads++;
+	if (node == MC_TYPE_RMC && strcmp(name, COOLING_POLICY) == 0)
+		strncpy_safe(output, store_policy, len, len - 1);
+	return 0;
+}
+
+struct node_info *libdb_list_node_by_type(unsigned char db_name, unsigned int type_min, unsigned int type_max,
+										  int *nodenum, filter_callback filter, lock_id_t lock_id)
+{
+	memdb_reads++;
+	*nodenum = 0;
+	return NULL;
+}
+
+void libdb_free_node(struct node_info *node)
+{
+	free(node);
+}
+
+void *libdb_attrs_get_by_node(unsigned char db_name, memdb_integer node, int subtree,
+							  int *size, int *truncated, lock_id_t lock_id)
+{
+	memdb_reads++;
+	return NULL;
+}
+
+void libdb_free_attrs(void *attrs)
+{
+	free(attrs);
+}
+
+memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name, int sub, unsigned int node_type_min,
+												  unsigned int node_type_max, lock_id_t lock_id)
+{
+	return stub_subscribe(0, 0, NULL, node_type_min, node_type_max);
+}
+
+memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name, int sub, unsigned int node_type_min,
+												  unsigned int node_type_max, lock_id_t lock_id)
+{
+	return stub_subscribe(0, 0, NULL, node_type_min, node_type_max);
+}
+
+memdb_integer libdb_subscribe_attr_by_prefix(unsigned char db_name, int sub, memdb_integer node_id, char *prefix, lock_id_t lock_id)
+{
+	return stub_subscribe(1, node_id, prefix, 0, 0);
+}
+
+memdb_integer libdb_subscribe_attr_coalesced(unsigned char db_name, int sub, memdb_integer node_id, char *prefix, lock_id_t lock_id)
+{
+	return stub_subscribe(1, node_id, prefix, 0, 0);
+}
+
+memdb_integer libdb_unsubscribe_event(unsigned char db_name, memdb_integer handle, lock_id_t lock_id)
+{
+	if (handle > 0 && handle <= MAX_SUBS)
+		subs[handle - 1].used = 0;
+	return 0;
+}
+
+/* asset module stub, logs the fan commands */
+
+int am_set_fan_pwm(int64 tzone_idx, int64 fan_idx, int64 pwm)
+{
+	if (cmd_log_len < MAX_CMD_LOG)
+		cmd_log_len += snprintf(cmd_log + cmd_log_len, MAX_CMD_LOG - cmd_log_len,
+								"%lld %lld %lld %lld\n", tick_ms, tzone_idx, fan_idx, pwm);
+	clock_ms += latency_ms;
+	return 0;
+}
+
+static uint64 replay_now_ms(void)
+{
+	return clock_ms;
+}
+
+/* no rmm.cfg, the defaults of the thermal curve are used */
+
+int rmm_cfg_get_cooling_curve(int *temp_min, int *temp_max, int *pwm_min, int *pwm_max)
+{
+	return -1;
+}
+
+/* trace replay */
+
+static double event_max_us;
+static double event_total_us;
+static double tick_max_us;
+static double tick_total_us;
+static int ticks;
+static int cmds;
+
+static void deliver(struct cooling_ctrl *ctrl, struct event_info *evt)
+{
+	double t = now_us();
+
+	cooling_event_ops(evt, ctrl);
+	t = now_us() - t;
+	event_total_us += t;
+	if (t > event_max_us)
+		event_max_us = t;
+	delivered++;
+}
+
+static void replay_line(struct cooling_ctrl *ctrl, char *line)
+{
+	char action[16];
+	char name[WRAP_DB_MAX_KEY_LEN];
+	char data[WRAP_DB_MAX_VALUE_LEN];
+	long long ms, node_id, parent, type;
+	union {
+		struct event_info evt;
+		char buf[sizeof(struct event_info) + WRAP_DB_MAX_KEY_LEN + WRAP_DB_MAX_VALUE_LEN];
+	} u;
+	struct event_info *evt = &u.evt;
+	struct stub_node *node;
+	int i;
+
+	if (sscanf(line, "%lld %15s", &ms, action) != 2)
+		return;
+
+	if (strcmp(action, "latency") == 0) {
+		sscanf(line, "%lld %15s %lld", &ms, action, &latency_ms);
+	} else if (strcmp(action, "create") == 0 &&
+		sscanf(line, "%lld %15s %lld %lld %lld", &ms, action, &node_id, &parent, &type) == 5) {
+		for (i = 0; i < MAX_NODES && store[i].used; i++)
+			;
+		if (i == MAX_NODES)
+			return;
+		bzero(&store[i], sizeof(store[i]));
+		store[i].used = 1;
+		store[i].node_id = node_id;
+		store[i].parent = parent;
+		store[i].type = type;
+
+		if (subscribed_node(type)) {
+			evt->event = EVENT_NODE_CREATE;
+			evt->nnodeid = node_id;
+			evt->nparent = parent;
+			evt->ntype = type;
+			deliver(ctrl, evt);
+		}
+	} else if (strcmp(action, "delete") == 0 &&
+			   sscanf(line, "%lld %15s %lld", &ms, action, &node_id) == 3) {
+		node = stub_find(node_id);
+		if (node == NULL)
+			return;
+		node->used = 0;
+
+		if (subscribed_node(node->type)) {
+			evt->event = EVENT_NODE_DELETE;
+			evt->nnodeid = node_id;
+			evt->nparent = node->parent;
+			evt->ntype = node->type;
+			deliver(ctrl, evt);
+		}
+	} else if (strcmp(action, "attr") == 0 &&
+			   sscanf(line, "%lld %15s %lld %31s %127s", &ms, action, &node_id, name, data) == 5) {
+		if (node_id == MC_TYPE_RMC && strcmp(name, COOLING_POLICY) == 0)
+			strncpy_safe(store_policy, data, sizeof(store_policy), sizeof(store_policy) - 1);
+		else if ((node = stub_find(node_id)) != NULL)
+			stub_set(node, name, data);
+		attr_events++;
+
+		if (subscribed_attr(node_id, name)) {
+			evt->event = EVENT_NODE_ATTR;
+			evt->anodeid = node_id;
+			evt->info.attr.cookie = 0;
+			evt->aaction = EVENT_ATTR_ACTION_MOD;
+			evt->info.attr.namelen = strlen(name) + 1;
+			evt->adatalen = strlen(data) + 1;
+			memcpy(event_attr_name(evt), name, strlen(name) + 1);
+			memcpy(event_attr_data(evt), data, strlen(data) + 1);
+			deliver(ctrl, evt);
+			attr_delivered++;
+		}
+	}
+}
+
+static void tick(struct cooling_ctrl *ctrl, long long ms)
+{
+	double t = now_us();
+
+	tick_ms = ms;
+	clock_ms = ms;
+	cmds += cooling_tick(ctrl);
+	t = now_us() - t;
+	tick_total_us += t;
+	if (t > tick_max_us)
+		tick_max_us = t;
+	ticks++;
+}
+
+/* The command log against the golden file, the first differences are printed. */
+static int compare_golden(char *path)
+{
+	char line[MAX_LINE];
+	char *log = cmd_log;
+	char *end;
+	int len;
+	int diffs = 0;
+	int n = 0;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		printf("no golden file %s\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		n++;
+		end = strchr(log, '\n');
+		len = end ? end - log + 1 : strlen(log);
+		if (len != strlen(line) || strncmp(log, line, len) != 0) {
+			if (diffs++ < 10)
+				printf("line %d: got %.*s%sexpected %s", n, len, log, end ? "" : "nothing\n", line);
+		}
+		log += len;
+	}
+	fclose(fp);
+
+	if (*log != '\0') {
+		end = strchr(log, '\n');
+		printf("line %d: got %.*s, the golden file ended\n", n + 1, (int)(end - log), log);
+		diffs++;
+	}
+
+	return diffs ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct cooling_ctrl *ctrl;
+	char line[MAX_LINE];
+	long long ms;
+	long long next_tick = COOLING_TICK_MS;
+	FILE *fp;
+
+	if (argc < 2) {
+		printf("usage: %s <trace> [golden]\n", argv[0]);
+		return -1;
+	}
+
+	fp = fopen(argv[1], "r");
+	if (fp == NULL) {
+		printf("FAIL: no trace %s\n", argv[1]);
+		return -1;
+	}
+
+	ctrl = cooling_allocate();
+	if (ctrl == NULL)
+		return -1;
+	ctrl->now_ms = replay_now_ms;
+	cooling_init(ctrl);
+	memdb_reads = 0;
+	memdb_subscribes = 0;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (sscanf(line, "%lld", &ms) != 1)
+			continue;
+		while (ms >= next_tick) {
+			tick(ctrl, next_tick);
+			next_tick += COOLING_TICK_MS;
+		}
+		replay_line(ctrl, line);
+	}
+	tick(ctrl, next_tick);
+	fclose(fp);
+
+	if (argc < 3) {
+		fputs(cmd_log, stdout);
+		return 0;
+	}
+
+	printf("%d attr events in trace, %d events delivered, %d ticks of %d ms\n",
+		   attr_events, delivered, ticks, COOLING_TICK_MS);
+	printf("memdb calls after init: %d reads, %d subscriptions, %d fan commands\n",
+		   memdb_reads, memdb_subscribes, cmds);
+	printf("one read per attr event, as before the model, would be %d reads\n", attr_delivered);
+	printf("event: %.2f us avg, %.2f us max; tick: %.2f us avg, %.2f us max\n",
+		   delivered ? event_total_us / delivered : 0, event_max_us,
+		   ticks ? tick_total_us / ticks : 0, tick_max_us);
+
+	check(memdb_reads == 0, "no memdb read while running");
+	check(cmd_log_len < MAX_CMD_LOG, "command log fits");
+	check(compare_golden(argv[2]) == 0, "fan commands match the golden file");
+
+	return test_result();
+}
@@ -458,23 +458,122 @@ static memdb_tbl_t psu_attr_memdb[] = {
 	{PSU_U_HEIGHT_STR,		PERSISTENT_N, RESET_N,	    NULL,				"3"},
 };
 
-static int init_attr(memdb_tbl_t *tb1, int size, memdb_integer node_id, int snap, ...)
+void attr_update_init(struct attr_update *update)
+{
+	update->num = 0;
+}
+
+static struct attr_set_info *attr_update_find(struct attr_update *update,
+											  memdb_integer node_id, char *name)
+{
+	int i;
+
+	for (i = 0; i < update->num; i++) {
+		if (update->attrs[i].node == node_id && strcmp(update->attrs[i].name, name) == 0)
+			return &update->attrs[i];
+	}
+
+	return NULL;
+}
+
+int attr_update_set_string(struct attr_update *update, memdb_integer node_id,
+						   char *name, char *value, unsigned char snapshot_flag)
+{
+	struct attr_set_info *attr;
+
+	attr = attr_update_find(update, node_id, name);
+	if (attr == NULL) {
+		if (update->num == ATTR_UPDATE_MAX && attr_update_commit(update) != 0)
+			return -1;
+		attr = &update->attrs[update->num];
+		attr->node = node_id;
+		attr->cookie = 0;
+		attr->name = name;
+		attr->data = update->values[update->num];
+		update->num++;
+	}
+
+	attr->snapshot_flag = snapshot_flag;
+	strncpy_safe(attr->data, value, WRAP_DB_MAX_VALUE_LEN, WRAP_DB_MAX_VALUE_LEN - 1);
+
+	return 0;
+}
+
+int attr_update_set_int(struct attr_update *update, memdb_integer node_id,
+						char *name, int value, unsigned char snapshot_flag)
+{
+	char buff[16] = {0};
+
+	snprintf(buff, sizeof(buff), "%d", value);
+	return attr_update_set_string(update, node_id, name, buff, snapshot_flag);
+}
+
+int attr_update_commit(struct attr_update *update)
+{
+	int num = update->num;
+
+	if (num == 0)
+		return 0;
+
+	update->num = 0;
+	if (libdb_attrs_set(DB_RMM, update->attrs, num, LOCK_ID_NULL) != 0) {
+		rmm_log(ERROR, "db set %d attrs of node %llu fail\n", num, update->attrs[0].node);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The value of an attribute in a buffer of libdb_attrs_get_by_node, "" if missing. */
+static char *find_attr_value(void *attrs, int size, char *name)
+{
+	struct attr_info *info;
+	int offset;
+
+	foreach_attr_info(info, offset, attrs, size) {
+		if (strcmp(attr_name(info), name) == 0)
+			return (char *)attr_data(info);
+	}
+
+	return "";
+}
+
+static int init_attr(struct attr_update *update, memdb_tbl_t *tb1, int size,
+					 memdb_integer node_id, int snap, ...)
 {
 	int i = 0;
-	int rc = 0;
 	result_t ret = RESULT_OK;
 	char value[WRAP_DB_MAX_VALUE_LEN] = {0};
 	va_list args;
 	int length = 0;
 	int64 error_code = 0;
+	void *attrs = NULL;
+	int attrs_size = 0;
+	int truncated = 0;
+
+	/* read the attributes of the node at once, one by one if they do not fit */
+	attrs = libdb_attrs_get_by_node(DB_RMM, node_id, 0, &attrs_size, &truncated, LOCK_ID_NULL);
+	if (attrs != NULL && truncated) {
+		libdb_free_attrs(attrs);
+		attrs = NULL;
+	}
 
 	for (i = 0; i < size; i++) {
 		ret = RESULT_OK;
 		memset(value, 0, WRAP_DB_MAX_VALUE_LEN);
 
-		error_code = libdb_attr_get_string(DB_RMM, node_id, tb1[i].key, value, WRAP_DB_MAX_VALUE_LEN, LOCK_ID_NULL);
-		if (error_code != 0) {
-			rmm_log(DBG, "%s:%d: error code:%d\n", __func__, __LINE__, error_code);
+		/* set by the caller in this update */
+		if (attr_update_find(update, node_id, tb1[i].key) != NULL)
+			continue;
+
+		if (attrs != NULL) {
+			strncpy_safe(value, find_attr_value(attrs, attrs_size, tb1[i].key),
+						 WRAP_DB_MAX_VALUE_LEN, WRAP_DB_MAX_VALUE_LEN - 1);
+		} else {
+			error_code = libdb_attr_get_string(DB_RMM, node_id, tb1[i].key, value, WRAP_DB_MAX_VALUE_LEN, LOCK_ID_NULL);
+			if (error_code != 0) {
+				rmm_log(DBG, "%s:%d: error code:%d\n", __func__, __LINE__, error_code);
+			}
 		}
 
 		if (strlen(value) == 0) {
@@ -494,16 +593,17 @@ static int init_attr(memdb_tbl_t *tb1, int size, memdb_integer node_id, int snap
 				}
 
 				if (ret == RESULT_OK)
-					if (libdb_attr_set_string(DB_RMM, node_id,
-										tb1[i].key, 0x0, value,
-										(tb1[i].snapshot_flag>>1), LOCK_ID_NULL) == -1) {
+					if (attr_update_set_string(update, node_id, tb1[i].key, value,
+											   (tb1[i].snapshot_flag>>1)) == -1) {
 						rmm_log(ERROR, "db set attr %s fail\n", tb1[i].key);
+						libdb_free_attrs(attrs);
 						return -1;
 					}
 			}
 		}
 	}
 
+	libdb_free_attrs(attrs);
 	return 0;
 }
 
@@ -532,47 +632,50 @@ void add_color_tag(void)
 void init_rack_attr(void)
 {
 	char ip_addr[WRAP_DB_MAX_VALUE_LEN] = {0};
+	struct attr_update update;
 
 	if (libutils_get_ip((char *)ip_addr) < 0) {
 		memset(ip_addr, 0, WRAP_DB_MAX_VALUE_LEN);
 		strncpy_safe(ip_addr, "x", sizeof(ip_addr), 1);
 	}
-	init_attr(rack_attr_memdb, sizeof(rack_attr_memdb)/sizeof(memdb_tbl_t), MC_TYPE_RMC, PERSISTENT_ALL, ip_addr);
+	attr_update_init(&update);
+	init_attr(&update, rack_attr_memdb, sizeof(rack_attr_memdb)/sizeof(memdb_tbl_t), MC_TYPE_RMC, PERSISTENT_ALL, ip_addr);
+	attr_update_commit(&update);
 }
 
-void init_pzone_attr(const memdb_integer *node_id, int pzone_lid, int cm_lid, int snap)
+void init_pzone_attr(struct attr_update *update, const memdb_integer *node_id, int pzone_lid, int cm_lid, int snap)
 {
-	init_attr(pzone_attr_memdb, sizeof(pzone_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, pzone_lid, cm_lid);
+	init_attr(update, pzone_attr_memdb, sizeof(pzone_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, pzone_lid, cm_lid);
 }
 
-void init_tzone_attr(const memdb_integer *node_id, int tzone_lid, int cm_lid, int snap)
+void init_tzone_attr(struct attr_update *update, const memdb_integer *node_id, int tzone_lid, int cm_lid, int snap)
 {
-	init_attr(tzone_attr_memdb, sizeof(tzone_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, tzone_lid, cm_lid);
+	init_attr(update, tzone_attr_memdb, sizeof(tzone_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, tzone_lid, cm_lid);
 }
 
-void init_dzone_attr(const memdb_integer *node_id, int dzone_lid, int cm_lid, int snap)
+void init_dzone_attr(struct attr_update *update, const memdb_integer *node_id, int dzone_lid, int cm_lid, int snap)
 {
-	init_attr(dzone_attr_memdb, sizeof(dzone_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, dzone_lid, cm_lid);
+	init_attr(update, dzone_attr_memdb, sizeof(dzone_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, dzone_lid, cm_lid);
 }
 
-void init_fan_attr(const memdb_integer *node_id, int fan_lid, int tzone_lid, int cm_lid, int snap)
+void init_fan_attr(struct attr_update *update, const memdb_integer *node_id, int fan_lid, int tzone_lid, int cm_lid, int snap)
 {
-	init_attr(fan_attr_memdb, sizeof(fan_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, *node_id, fan_lid, tzone_lid, cm_lid);
+	init_attr(update, fan_attr_memdb, sizeof(fan_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, *node_id, fan_lid, tzone_lid, cm_lid);
 }
 
-void init_psu_attr(const memdb_integer *node_id, int psu_lid, int pzone_lid, int cm_lid, int snap)
+void init_psu_attr(struct attr_update *update, const memdb_integer *node_id, int psu_lid, int pzone_lid, int cm_lid, int snap)
 {
-	init_attr(psu_attr_memdb, sizeof(psu_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, node_id, psu_lid, pzone_lid, cm_lid);
+	init_attr(update, psu_attr_memdb, sizeof(psu_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, node_id, psu_lid, pzone_lid, cm_lid);
 }
 
-void init_mbp_attr(const memdb_integer *node_id, int cm_lid, int snap)
+void init_mbp_attr(struct attr_update *update, const memdb_integer *node_id, int cm_lid, int snap)
 {
-	init_attr(mbp_attr_memdb, sizeof(mbp_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, cm_lid);
+	init_attr(update, mbp_attr_memdb, sizeof(mbp_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, cm_lid);
 }
 
-void init_drawer_attr(const memdb_integer *node_id, int drawer_lid, int dz_lid, int cm_lid, int snap)
+void init_drawer_attr(struct attr_update *update, const memdb_integer *node_id, int drawer_lid, int dz_lid, int cm_lid, int snap)
 {
-	init_attr(drawer_attr_memdb, sizeof(drawer_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, node_id, drawer_lid, dz_lid, cm_lid);
+	init_attr(update, drawer_attr_memdb, sizeof(drawer_attr_memdb)/sizeof(memdb_tbl_t), *node_id, snap, node_id, drawer_lid, dz_lid, cm_lid);
 }
 
 static int reset_attr(memdb_tbl_t *tb1, int size, memdb_integer node_id, ...)
@@ -17,9 +17,51 @@
 #define __ASSETD_ATTRIBUTE_H__
 
 #include <stdio.h>
+#include "libwrap/wrap.h"
+
 typedef void (*reset_zone_fn)(const memdb_integer *node_id, int cm_lid, int zone_lid);
 typedef void (*reset_item_fn)(const memdb_integer *node_id, int cm_lid, int item_lid, int zone_lid);
 
+#define ATTR_UPDATE_MAX		64
+
+/* attribute writes of one asset update, sent to memdb in one request */
+struct attr_update {
+	int num;
+	struct attr_set_info attrs[ATTR_UPDATE_MAX];
+	char values[ATTR_UPDATE_MAX][WRAP_DB_MAX_VALUE_LEN];
+};
+
+/**
+ * @brief start an empty update.
+ */
+extern void attr_update_init(struct attr_update *update);
+
+/**
+ * @brief add an attribute write to the update, a write of the same attribute
+ * already in it is replaced. The update is committed first when full.
+ *
+ * @param  name			attribute name, not copied.
+ * @param  value		copied, truncated to WRAP_DB_MAX_VALUE_LEN.
+ *
+ * @return 0			success.
+ * 		   -1			fail
+ */
+extern int attr_update_set_string(struct attr_update *update, memdb_integer node_id,
+								  char *name, char *value, unsigned char snapshot_flag);
+extern int attr_update_set_int(struct attr_update *update, memdb_integer node_id,
+							   char *name, int value, unsigned char snapshot_flag);
+
+/**
+ * @brief write the attributes of the update to memdb in one request and empty it.
+ *
+ * Subscribers get the changes of a node in one event. memdb applies one
+ * request whole, but an update that filled up was partly committed by
+ * attr_update_set_string() already.
+ *
+ * @return 0			success.
+ * 		   -1			fail
+ */
+extern int attr_update_commit(struct attr_update *update);
 
 /**
  * @brief initalize rack attribute.
@@ -30,76 +72,83 @@ extern void init_rack_attr(void);
 /**
  * @brief initalize drawer zone attribute when drawer zone added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the drawer zone.
  * @param  dzone_idx	drawer zone index.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_dzone_attr(const memdb_integer *node_id, int dzone_idx, int cm_idx, int snap);
+extern void init_dzone_attr(struct attr_update *update, const memdb_integer *node_id, int dzone_idx, int cm_idx, int snap);
 
 /**
  * @brief initalize drawer attribute when drawer added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the drawer.
  * @param  drawer_idx	drawer index.
  * @param  dzone_idx	dower zone index of this drawer.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_drawer_attr(const memdb_integer *node_id, int drawer_idx, int dzone_idx, int cm_idx, int snap);
+extern void init_drawer_attr(struct attr_update *update, const memdb_integer *node_id, int drawer_idx, int dzone_idx, int cm_idx, int snap);
 
 /**
  * @brief initalize mbp attribute when mbp added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the mbp.
  * @param  mbp_idx		mbp index.
  * @param  cm_idx		cm index of this mbp.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_mbp_attr(const memdb_integer *node_id, int cm_idx, int snap);
+extern void init_mbp_attr(struct attr_update *update, const memdb_integer *node_id, int cm_idx, int snap);
 
 /**
  * @brief initalize power zone attribute when power zone added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the power zone.
  * @param  pzone_idx	power zone index.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_pzone_attr(const memdb_integer *node_id, int pzone_idx, int cm_idx, int snap);
+extern void init_pzone_attr(struct attr_update *update, const memdb_integer *node_id, int pzone_idx, int cm_idx, int snap);
 
 /**
  * @brief initalize psu attribute when psu added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the psu.
  * @param  psu_idx		psu index.
  * @param  pzone_idx	power zone index of this psu.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_psu_attr(const memdb_integer *node_id, int psu_idx, int pzone_idx, int cm_idx, int snap);
+extern void init_psu_attr(struct attr_update *update, const memdb_integer *node_id, int psu_idx, int pzone_idx, int cm_idx, int snap);
 
 /**
  * @brief initalize thermal zone attribute when thermal zone added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the thermal zone.
  * @param  tzone_idx	thermal zone index.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_tzone_attr(const memdb_integer *node_id, int tzone_idx, int cm_idx, int snap);
+extern void init_tzone_attr(struct attr_update *update, const memdb_integer *node_id, int tzone_idx, int cm_idx, int snap);
 
 /**
  * @brief initalize fan attribute when fan added.
  *
+ * @param  update		missing attributes are added to it.
  * @param  node_id		node_id of the fan.
  * @param  fan_idx		fan index.
  * @param  tzone_idx	thermal zone index of this fan.
  * @param  snap			snapshot or not.
  *
  */
-extern void init_fan_attr(const memdb_integer *node_id, int fan_idx, int tzone_idx, int cm_idx, int snap);
+extern void init_fan_attr(struct attr_update *update, const memdb_integer *node_id, int fan_idx, int tzone_idx, int cm_idx, int snap);
 
 
 
@@ -125,12 +125,15 @@ static void remove_node(memdb_integer node_id, memdb_integer parent, memdb_integ
 		break;
 	}
 
-	rc = libdb_attr_get_string(DB_RMM, node_id, WRAP_UUID_STR, uuid, sizeof(uuid), LOCK_ID_NULL);
-	if (rc == -1 || strlen(uuid) == 0) {
-		rmm_log(ERROR, "memdb get uuid fail\n");
-		return;
+	if (nmap_get_uuid_by_node_id(uuid, sizeof(uuid), node_id) == 0) {
+		nmap_remove_by_node_id(node_id);
+	} else {
+		rc = libdb_attr_get_string(DB_RMM, node_id, WRAP_UUID_STR, uuid, sizeof(uuid), LOCK_ID_NULL);
+		if (rc == -1 || strlen(uuid) == 0) {
+			rmm_log(ERROR, "memdb get uuid fail\n");
+			return;
+		}
 	}
-	nmap_remove_by_node_id(node_id);
 
 	if (msg_sn != 0) {
 		rc = libdb_attr_get_string(DB_RMM, node_id, WRAP_LOC_ID_STR, lid_str, sizeof(lid_str), LOCK_ID_NULL);
@@ -165,7 +168,8 @@ static void ad_remove_node(char *uuid)
 	libdb_destroy_node(DB_RMM, node_id, LOCK_ID_NULL);
 }
 
-void set_chassis_fw_ver(uint8 ver_low, uint8 ver_hi, memdb_integer node_id)
+static int set_chassis_fw_ver(struct attr_update *update, uint8 ver_low, uint8 ver_hi,
+							  memdb_integer node_id)
 {
 	char tmp[8] = {0};
 	char ver_l[8] = {0};
@@ -176,18 +180,16 @@ void set_chassis_fw_ver(uint8 ver_low, uint8 ver_hi, memdb_integer node_id)
 	snprintf(tmp, sizeof(tmp), "%02X", ver_low);
 	ret = sscanf(tmp, "%[0-9a-fA-F]", ver_l);
 	if (ret != 1)
-		return;
+		return 0;
 
 	snprintf(tmp, sizeof(tmp), "%02X", ver_hi);
 	ret = sscanf(tmp, "%[0-9a-fA-F]", ver_h);
 	if (ret != 1)
-		return;
+		return 0;
 
 	snprintf(buff, sizeof(buff), "%s.%s", ver_h, ver_l);
 
-	if (libdb_attr_set_string(DB_RMM, node_id, MBP_FW_VER_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL) == -1) {
-		rmm_log(ERROR, "memdb set mbp fw ver fail\n");
-	}
+	return attr_update_set_string(update, node_id, MBP_FW_VER_STR, buff, SNAPSHOT_NEED_NOT);
 }
 
 result_t get_mbp_hw_addr(unsigned int pos, unsigned char *hw_addr)
@@ -239,61 +241,74 @@ int on_cm_change(char* uuid, json_t *req, json_t *resp)
 	int64 ver_low;
 	int rc = 0;
 	memdb_integer node_id = 0;
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&node_id, uuid);
 
 	if (jrpc_get_named_param_value(req, JRPC_CM_LID, JSON_INTEGER, &cm_lid) == JSONRPC_SUCCESS) {
 		if (cm_lid != 0) {
 			unsigned char hw_addr[8] = {0};
 			snprintf(buff, sizeof(buff), "%d", (int)cm_lid);
-			rc = libdb_attr_set_string(DB_RMM, node_id, MBP_LOC_ID_STR, 0x0, buff, SNAPSHOT_NEED, LOCK_ID_NULL);
+			rc = attr_update_set_string(&update, node_id, MBP_LOC_ID_STR, buff, SNAPSHOT_NEED);
 			if (rc == -1) {
 				rmm_log(ERROR, "memdb set mbp loc id fail\n");
-				return -1;
+				goto err;
 			}
 			get_mbp_hw_addr(cm_lid, hw_addr);
-			rc = libdb_attr_set_string(DB_RMM, node_id, MBP_HW_ADDR_STR,
-				0x0, (char *)hw_addr, SNAPSHOT_NEED, LOCK_ID_NULL);
+			rc = attr_update_set_string(&update, node_id, MBP_HW_ADDR_STR, (char *)hw_addr, SNAPSHOT_NEED);
 			if (rc == -1) {
 				rmm_log(ERROR, "memdb set hw addr fail\n");
-				return -1;
+				goto err;
 			}
-			rc = libdb_attr_set_string(DB_RMM, node_id, MBP_MBPID_STR, 0x0, buff, SNAPSHOT_NEED, LOCK_ID_NULL);
+			rc = attr_update_set_string(&update, node_id, MBP_MBPID_STR, buff, SNAPSHOT_NEED);
 			if (rc == -1) {
 				rmm_log(ERROR, "memdb set mbp id fail\n");
-				return -1;
+				goto err;
 			}
-			init_mbp_attr(&node_id, cm_lid, PERSISTENT_ALL);
+			init_mbp_attr(&update, &node_id, cm_lid, PERSISTENT_ALL);
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_CM_ULOC, JSON_INTEGER, &cm_uloc) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%lld", cm_uloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, MBP_U_LOC_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, MBP_U_LOC_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc != 0) {
 			rmm_log(ERROR, "memdb set cm ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_IPADDRESS, JSON_INTEGER, &ip_address) == JSONRPC_SUCCESS) {
 		if (ip_address != 0) {
 			/* save ip address */
-			rc = libdb_attr_set_int(DB_RMM, node_id, MBP_IP_ADDR_STR, 0x0, ip_address, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+			rc = attr_update_set_int(&update, node_id, MBP_IP_ADDR_STR, ip_address, SNAPSHOT_NEED_NOT);
 			if (rc == -1) {
 				rmm_log(ERROR, "memdb set mbp ip addr fail\n");
-				return -1;
+				goto err;
 			}
 		}
 	}
 
 	if((jrpc_get_named_param_value(req, JRPC_VER_HIGH, JSON_INTEGER, &ver_high) == JSONRPC_SUCCESS) &&
 			(jrpc_get_named_param_value(req, JRPC_VER_LOW, JSON_INTEGER, &ver_low) == JSONRPC_SUCCESS)) {
-		set_chassis_fw_ver((uint8)ver_low, (uint8)ver_high, node_id);
+		rc = set_chassis_fw_ver(&update, (uint8)ver_low, (uint8)ver_high, node_id);
+		if (rc == -1) {
+			rmm_log(ERROR, "memdb set mbp fw ver fail\n");
+			goto err;
+		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 int on_pzone_add(char *uuid, char *parent_uuid, json_t *req, json_t *resp)
@@ -343,43 +358,53 @@ int on_pzone_change(char *uuid, json_t *req, json_t *resp)
 	int64 rc = 0;
 	int64 pz_uloc = 0;
 	char buff[16] = {};
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&pz_nid, uuid);
 	if (pz_nid == INVALID_NODE_ID) {
 		rmm_log(ERROR, "get pzone node id fail, uuid is %d\n", uuid);
-		return -1;
+		goto err;
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PZ_LID, JSON_INTEGER, &pz_lid)!= JSONRPC_SUCCESS) {
 		rmm_log(ERROR, "get pzone loc id fail, uuid is %d\n", uuid);
-		return -1;
+		goto err;
 	}
 
 	pnode = libdb_get_node_by_node_id(DB_RMM, pz_nid, LOCK_ID_NULL);
 	if (pnode == NULL) {
 		rmm_log(ERROR, "get pzone node id fail\n");
-		return -1;
+		goto err;
 	}
 
 	rc = libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
 	if (rc != 0) {
 		rmm_log(ERROR, "get cm loc id fail\n");
-		return rc;
+		goto err;
 	}
 
-	init_pzone_attr(&pz_nid, pz_lid, cm_lid, PERSISTENT_ALL);
+	init_pzone_attr(&update, &pz_nid, pz_lid, cm_lid, PERSISTENT_ALL);
 
 	if (jrpc_get_named_param_value(req, JRPC_PZ_ULOC, JSON_INTEGER, &pz_uloc) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%lld", pz_uloc);
-		rc = libdb_attr_set_string(DB_RMM, pz_nid, PZONE_U_LOC_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, pz_nid, PZONE_U_LOC_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc != 0) {
 			rmm_log(ERROR, "memdb set tzone ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 int on_tzone_add(char *uuid, char *parent_uuid, json_t *req, json_t *resp)
@@ -427,43 +452,53 @@ int on_tzone_change(char *uuid, json_t *req, json_t *resp)
 	int64 rc = 0;
 	char buff[16] = {};
 	int cm_lid = 0;
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&tz_nid, uuid);
 	if (tz_nid == INVALID_NODE_ID) {
 		rmm_log(ERROR, "get tzone node id fail, uuid is %d\n", uuid);
-		return -1;
+		goto err;
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_TZ_LID, JSON_INTEGER, &tz_lid) != JSONRPC_SUCCESS) {
 		rmm_log(ERROR, "get tzone node loc id fail, uuid is %d\n", uuid);
-			return -1;
+			goto err;
 	}
 
 	pnode = libdb_get_node_by_node_id(DB_RMM, tz_nid, LOCK_ID_NULL);
 	if (pnode == NULL) {
 		rmm_log(ERROR, "get tzone node id fail\n");
-		return -1;
+		goto err;
 	}
 
 	rc = libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
 	if (rc != 0) {
 		rmm_log(ERROR, "get cm loc id fail\n");
-		return -1;
+		goto err;
 	}
 
-	init_tzone_attr(&tz_nid, tz_lid, cm_lid, PERSISTENT_ALL);
+	init_tzone_attr(&update, &tz_nid, tz_lid, cm_lid, PERSISTENT_ALL);
 
 	if (jrpc_get_named_param_value(req, JRPC_TZ_ULOC, JSON_INTEGER, &tz_uloc) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%lld", tz_uloc);
-		rc = libdb_attr_set_string(DB_RMM, tz_nid, TZONE_U_LOC_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, tz_nid, TZONE_U_LOC_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set tzone ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 int on_dzone_add(char *uuid, char *parent_uuid, json_t *req, json_t *resp)
@@ -512,21 +547,23 @@ int on_dzone_change(char *uuid, json_t *req, json_t *resp)
 	int cm_lid = 0;
 	int rc = 0;
 	char buff[128] = {0};
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&node_id, uuid);
 	if (jrpc_get_named_param_value(req, JRPC_PRESENT_INFO, JSON_INTEGER, &present) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_char(DB_RMM, node_id, DRAWER_PRESENT_STR, 0x0, (char)present, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_int(&update, node_id, DRAWER_PRESENT_STR, (char)present, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set drawer present fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_DRAWER_ALERT, JSON_INTEGER, &alert) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_char(DB_RMM, node_id, ALERT_STR, 0x0, (char)present, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_int(&update, node_id, ALERT_STR, (char)present, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set drawer alert fail\n");
-			return -1;
+			goto err;
 		}
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%lld", (alert & 0xFF));
@@ -537,24 +574,32 @@ int on_dzone_change(char *uuid, json_t *req, json_t *resp)
 		pnode = libdb_get_node_by_node_id(DB_RMM, node_id, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get dzone node id fail\n");
-			return -1;
+			goto err;
 		}
 
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
-		init_tzone_attr(&node_id, dz_lid, cm_lid, PERSISTENT_ALL);
+		init_tzone_attr(&update, &node_id, dz_lid, cm_lid, PERSISTENT_ALL);
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_DZ_ULOC, JSON_INTEGER, &dz_uloc) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%lld", dz_uloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, DZONE_U_LOC_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, DZONE_U_LOC_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set drawer ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 int on_psu_add(char *uuid, char *parent_uuid, json_t *req, json_t *resp)
@@ -606,58 +651,60 @@ int on_psu_change(char *uuid, json_t *req, json_t *resp)
 	int pz_lid = 0;
 	int cm_lid = 0;
 	int rc = 0;
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&node_id, uuid);
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_SERIAL, JSON_STRING, &str_ptr) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_SER_NUM_STR, 0x0, str_ptr, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_SER_NUM_STR, str_ptr, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu serial num fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_MANUFACTURE, JSON_STRING, &str_ptr) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_MANUFACT_STR, 0x0, str_ptr, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_MANUFACT_STR, str_ptr, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu manufacture fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_MODEL, JSON_STRING, &str_ptr) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_MODEL_STR, 0x0, str_ptr, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_MODEL_STR, str_ptr, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu model fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_FW_VER, JSON_STRING, &str_ptr) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_FW_VER_STR, 0x0, str_ptr, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_FW_VER_STR, str_ptr, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu fw ver fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_POWER_IN, JSON_INTEGER, &pin) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%d", (int)pin);
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_TT_PWR_IN_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_TT_PWR_IN_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set ps tt pwr in fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_CURRENT_OUT, JSON_INTEGER, &co) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%d", (int)co);
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_TT_CURRENT_OUT_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_TT_CURRENT_OUT_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu current out fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
@@ -665,41 +712,49 @@ int on_psu_change(char *uuid, json_t *req, json_t *resp)
 		pnode = libdb_get_node_by_node_id(DB_RMM, node_id, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get psu node fail, node id is %llu, uuid is %s\n", node_id, uuid);
-			return -1;
+			goto err;
 		}
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &pz_lid, LOCK_ID_NULL);
 
 		pnode = libdb_get_node_by_node_id(DB_RMM, pnode->parent, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get pzone node id fail\n");
-			return -1;
+			goto err;
 		}
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
 		rmm_log(INFO, "initial psu attr, psu loc is %lld at cm %d\n", psu_lid, cm_lid);
-		init_psu_attr(&node_id, psu_lid, pz_lid, cm_lid, PERSISTENT_ALL);
+		init_psu_attr(&update, &node_id, psu_lid, pz_lid, cm_lid, PERSISTENT_ALL);
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_XLOC, JSON_INTEGER, &psu_xloc) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%d", (int)psu_xloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_X_LOC_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_X_LOC_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu xlocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_PSU_ULOC, JSON_INTEGER, &psu_uloc) == JSONRPC_SUCCESS) {
 		memset(buff, 0, sizeof(buff));
 		snprintf(buff, sizeof(buff), "%d", (int)psu_uloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, PSU_U_LOC_STR, 0x0, buff, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, PSU_U_LOC_STR, buff, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set psu ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 int on_drawer_add(char *uuid, char *present_uuid, json_t *req, json_t *resp)
@@ -750,22 +805,24 @@ int on_drawer_change(char *uuid, json_t *req, json_t *resp)
 	int rc = 0;
 	int64 drawer_uloc = 0;
 	int64 drawer_xloc = 0;
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&node_id, uuid);
 	if (jrpc_get_named_param_value(req, JRPC_INFO, JSON_INTEGER, &temp) == JSONRPC_SUCCESS) {
 		snprintf(temp_str, sizeof(temp_str), "%d", (int)temp);
-		rc = libdb_attr_set_string(DB_RMM, node_id, CHASSIS_TEMP_STR, 0x0, temp_str, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, CHASSIS_TEMP_STR, temp_str, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set chassis temp fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_IPADDRESS, JSON_STRING, &ip) == JSONRPC_SUCCESS) {
-		rc = libdb_attr_set_string(DB_RMM, node_id, DRAWER_TMC_IP_STR, 0x0, ip, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, DRAWER_TMC_IP_STR, ip, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set tmc ip fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
@@ -773,31 +830,39 @@ int on_drawer_change(char *uuid, json_t *req, json_t *resp)
 		pnode = libdb_get_node_by_node_id(DB_RMM, node_id, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get drawer node id fail, node id is %llu, uuid is %s\n", node_id, uuid);
-			return -1;
+			goto err;
 		}
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &dz_lid, LOCK_ID_NULL);
 
 		pnode = libdb_get_node_by_node_id(DB_RMM, pnode->parent, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get dzone node id fail\n");
-			return -1;
+			goto err;
 		}
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
 		rmm_log(INFO, "initial drawer attr, drawer loc is %lld at cm %d\n", drawer_lid, cm_lid);
-		init_drawer_attr(&node_id, drawer_lid, dz_lid, cm_lid, PERSISTENT_ALL);
+		init_drawer_attr(&update, &node_id, drawer_lid, dz_lid, cm_lid, PERSISTENT_ALL);
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_DRAWER_ULOC, JSON_INTEGER, &drawer_uloc) == JSONRPC_SUCCESS) {
 		memset(temp_str, 0, sizeof(temp_str));
 		snprintf(temp_str, sizeof(temp_str), "%lld", drawer_uloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, DRAWER_U_LOC_STR, 0x0, temp_str, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, DRAWER_U_LOC_STR, temp_str, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set drawer ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 int on_fan_add(char *uuid, char *present_uuid, json_t *req, json_t *resp)
@@ -848,14 +913,16 @@ int on_fan_change(char *uuid, json_t *req, json_t *resp)
 	int tz_lid = 0;
 	int cm_lid = 0;
 	int rc = 0;
+	struct attr_update update;
 
+	attr_update_init(&update);
 	nmap_get_node_id_by_uuid(&node_id, uuid);
 	if (jrpc_get_named_param_value(req, JRPC_INFO, JSON_INTEGER, &speed) == JSONRPC_SUCCESS) {
 		snprintf(string, sizeof(string), "%d", (int)speed);
-		rc = libdb_attr_set_string(DB_RMM, node_id, FAN_TACH_READ_STR, 0x0, string, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, FAN_TACH_READ_STR, string, SNAPSHOT_NEED_NOT);
 		if (rc == -1) {
 			rmm_log(ERROR, "memdb set fan tach fail\n");
-			return -1;
+			goto err;
 		}
 		json_object_add(resp, JRPC_NODE_ID, json_integer(node_id));
 	}
@@ -864,41 +931,49 @@ int on_fan_change(char *uuid, json_t *req, json_t *resp)
 		pnode = libdb_get_node_by_node_id(DB_RMM, node_id, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get fan node id fail, node id is %llu, uuid is %s\n", node_id, uuid);
-			return -1;
+			goto err;
 		}
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &tz_lid, LOCK_ID_NULL);
 
 		pnode = libdb_get_node_by_node_id(DB_RMM, pnode->parent, LOCK_ID_NULL);
 		if (pnode == NULL) {
 			rmm_log(ERROR, "get tzone node id fail\n");
-			return -1;
+			goto err;
 		}
 		libdb_attr_get_int(DB_RMM, pnode->parent, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
 		rmm_log(INFO, "initial fan attr, fan loc is %lld at cm %d\n", fan_lid, cm_lid);
-		init_fan_attr(&node_id, fan_lid, tz_lid, cm_lid, PERSISTENT_ALL);
+		init_fan_attr(&update, &node_id, fan_lid, tz_lid, cm_lid, PERSISTENT_ALL);
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_FAN_ULOC, JSON_INTEGER, &fan_uloc) == JSONRPC_SUCCESS) {
 		memset(string, 0, sizeof(string));
 		snprintf(string, sizeof(string), "%lld", fan_uloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, FAN_U_LOC_STR, 0x0, string, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, FAN_U_LOC_STR, string, SNAPSHOT_NEED_NOT);
 		if (rc != 0) {
 			rmm_log(ERROR, "memdb set fan ulocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
 	if (jrpc_get_named_param_value(req, JRPC_FAN_XLOC, JSON_INTEGER, &fan_xloc) == JSONRPC_SUCCESS) {
 		memset(string, 0, sizeof(string));
 		snprintf(string, sizeof(string), "%lld", fan_xloc);
-		rc = libdb_attr_set_string(DB_RMM, node_id, FAN_X_LOC_STR, 0x0, string, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+		rc = attr_update_set_string(&update, node_id, FAN_X_LOC_STR, string, SNAPSHOT_NEED_NOT);
 		if (rc != 0) {
 			rmm_log(ERROR, "memdb set fan xlocation fail\n");
-			return -1;
+			goto err;
 		}
 	}
 
+	if (attr_update_commit(&update) != 0)
+		return -1;
+
 	return 0;
+
+err:
+	/* the writes queued before the failure are still made */
+	attr_update_commit(&update);
+	return -1;
 }
 
 cmd_func_map_t cmd_func_maps[] = {
@@ -43,30 +43,6 @@
 #include "attribute.h"
 #include "libjsonrpcapi/parser.h"
 
-static void *ipmi_cb_thread(void *unused)
-{
-	int		rc;
-	int		max_fd;
-	fd_set	rfds;
-
-	prctl(PR_SET_NAME, "ipmi_cb_thread");
-	while (1) {
-		max_fd = -1;
-		FD_ZERO(&rfds);
-		libjipmi_callback_selectfds(&rfds, &max_fd);
-		rc = select(max_fd + 1, &rfds, NULL, NULL, NULL);
-		if (rc <= 0) {
-			rmm_log(INFO, "select timeout\n");
-			continue;
-		}
-
-		libjipmi_callback_processfds(&rfds);
-	}
-	printf("ipmi_cb_thread task exit, errno:%d %s\n", errno, strerror(errno));
-	return NULL;
-}
-
-
 static void create_listen_socket(int *fd)
 {
 	int port; 
@@ -196,7 +172,6 @@ int main(int argc, char **argv)
 {
 	int fd;
 	int port;
-	pthread_t	tid_ipmi_cb;
 	pthread_t	tid_asset_module_set_attr;
 	gami_reg_t reg_info = {{0}};
 
@@ -217,11 +192,6 @@ int main(int argc, char **argv)
 
 	libdb_is_ready(DB_RMM, LOCK_ID_NULL, -1);
 
-	if (pthread_create(&tid_ipmi_cb, NULL, ipmi_cb_thread, NULL) != 0) {
-		rmm_log(ERROR, "Failed to create ipmi callback thread!\n");
-		return -1;
-	}
-
 	if (pthread_create(&tid_asset_module_set_attr, NULL, asset_module_set_gami_attr_thread, NULL) != 0) {
 		rmm_log(ERROR, "Failed to create asset module notify thread!\n");
 		return -1;
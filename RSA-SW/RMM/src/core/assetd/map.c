@@ -13,25 +13,112 @@
  */
 
 
+
 #include <stdlib.h>
 #include "map.h"
 #include "libutils/list.h"
 #include "libutils/string.h"
 #include "libwrap/wrap.h"
 
+/*
+ * Each mapping is hashed both by uuid and by node id, so lookups do not
+ * depend on the number of assets in the rack. A uuid maps to one node and
+ * a node to one uuid, adding a mapping again replaces the old one.
+ */
+#define NMAP_HASH_SIZE		1024
+
 typedef struct un_map_item {
-	struct list_head list;
+	struct list_head uuid_hash;
+	struct list_head node_hash;
 	char uuid[UUID_MAX_LEN];
 	memdb_integer node_id;
 } un_map_item_t;
 
+static struct list_head uuid_table[NMAP_HASH_SIZE];
+static struct list_head node_table[NMAP_HASH_SIZE];
+static int nmap_inited;
+
+static void nmap_init(void)
+{
+	int i;
+
+	for (i = 0; i < NMAP_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&uuid_table[i]);
+		INIT_LIST_HEAD(&node_table[i]);
+	}
+	nmap_inited = 1;
+}
+
+static inline struct list_head *uuid_bucket(const char *uuid)
+{
+	unsigned int h = 2166136261u;	/* FNV-1a */
+
+	while (*uuid) {
+		h ^= (unsigned char)*uuid++;
+		h *= 16777619u;
+	}
+
+	return &uuid_table[h & (NMAP_HASH_SIZE - 1)];
+}
+
+/* node ids are sequential, so low bits are used */
+static inline struct list_head *node_bucket(memdb_integer node_id)
+{
+	return &node_table[node_id & (NMAP_HASH_SIZE - 1)];
+}
+
+static un_map_item_t *find_by_uuid(const char *uuid)
+{
+	un_map_item_t *item;
+
+	if (!nmap_inited)
+		return NULL;
+
+	list_for_each_entry(item, uuid_bucket(uuid), uuid_hash) {
+		if (strcmp(uuid, item->uuid) == 0)
+			return item;
+	}
+	return NULL;
+}
+
+static un_map_item_t *find_by_node_id(memdb_integer node_id)
+{
+	un_map_item_t *item;
+
+	if (!nmap_inited)
+		return NULL;
+
+	list_for_each_entry(item, node_bucket(node_id), node_hash) {
+		if (item->node_id == node_id)
+			return item;
+	}
+	return NULL;
+}
 
-struct list_head node_list = LIST_HEAD_INIT(node_list);
+static void remove_item(un_map_item_t *item)
+{
+	list_del(&item->uuid_hash);
+	list_del(&item->node_hash);
+	free(item);
+}
 
 void nmap_add(char* uuid, memdb_integer node_id)
 {
 	un_map_item_t *item = NULL;
 
+	if (!nmap_inited)
+		nmap_init();
+
+	item = find_by_uuid(uuid);
+	if (item != NULL && item->node_id == node_id)
+		return;
+	if (item != NULL)
+		remove_item(item);
+
+	item = find_by_node_id(node_id);
+	if (item != NULL)
+		remove_item(item);
+
 	item = (un_map_item_t *)malloc(sizeof(un_map_item_t));
 	if (item == NULL)
 		return;
@@ -41,32 +128,39 @@ void nmap_add(char* uuid, memdb_integer node_id)
 	strncpy_safe(item->uuid, uuid, UUID_MAX_LEN, UUID_MAX_LEN - 1);
 	item->node_id = node_id;
 
-	list_add_tail(&item->list, &node_list);
+	list_add_tail(&item->uuid_hash, uuid_bucket(item->uuid));
+	list_add_tail(&item->node_hash, node_bucket(node_id));
 }
 
 void nmap_remove_by_node_id(memdb_integer node_id)
 {
 	un_map_item_t *item;
 
-	list_for_each_entry(item, &node_list, list) {
-		if(item->node_id == node_id) {
-			list_del(&item->list);
-			free(item);
-			break;
-		}
-	}
-	
+	item = find_by_node_id(node_id);
+	if (item != NULL)
+		remove_item(item);
 }
 
 int nmap_get_node_id_by_uuid(memdb_integer *node_id, char *uuid)
 {
 	un_map_item_t *item;
 
-	list_for_each_entry(item, &node_list, list) {
-		if (strcmp((char *)uuid, item->uuid) == 0) {
-			*node_id = item->node_id;
-			return 0;
-		}
-	}
-	return -1;
+	item = find_by_uuid(uuid);
+	if (item == NULL)
+		return -1;
+
+	*node_id = item->node_id;
+	return 0;
+}
+
+int nmap_get_uuid_by_node_id(char *uuid, int len, memdb_integer node_id)
+{
+	un_map_item_t *item;
+
+	item = find_by_node_id(node_id);
+	if (item == NULL)
+		return -1;
+
+	strncpy_safe(uuid, item->uuid, len, len - 1);
+	return 0;
 }
@@ -23,5 +23,6 @@
 void nmap_add(char* uuid, memdb_integer node_id);
 void nmap_remove_by_node_id(memdb_integer node_id);
 int nmap_get_node_id_by_uuid(memdb_integer *node_id, char *uuid);
+int nmap_get_uuid_by_node_id(char *uuid, int len, memdb_integer node_id);
 
 #endif
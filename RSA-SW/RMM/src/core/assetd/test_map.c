@@ -0,0 +1,169 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/*
+ * Replays a burst of change notifications for a full rack against the
+ * uuid to node map: every asset is added as on the add events, then
+ * change events resolve the uuid of the asset and of its parent. The
+ * same burst runs with many racks mapped to show that the cost of a
+ * lookup does not grow with the population.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libutils/rack.h"
+#include "librmmcfg/platform.h"
+#include "libutils/test.h"
+#include "map.h"
+
+#define NODE_ID_BASE	10000000
+#define BURST_EVENTS	200000
+#define MANY_RACKS		16
+
+/* CM, zones, PSUs, fans and drawers of one rack */
+#define ASSETS_PER_CM	(1 + MAX_PZONE_NUM + MAX_TZONE_NUM + MAX_DZONE_NUM + \
+						 MAX_PSU_NUM + MAX_PWM_NUM + MAX_DRAWER_NUM)
+#define RACK_ASSETS		(MAX_CM_NUM * ASSETS_PER_CM)
+
+struct asset {
+	char uuid[UUID_MAX_LEN];
+	memdb_integer node_id;
+	int parent;
+};
+
+static struct asset *assets;
+static int asset_num;
+
+static int add_asset(int rack, int parent, int type, int idx)
+{
+	struct asset *a = &assets[asset_num];
+
+	snprintf(a->uuid, sizeof(a->uuid), "%08x-%04x-%04x-%04x-%012x",
+			 rack, type, idx, asset_num & 0xffff, asset_num * 2654435761u);
+	a->node_id = NODE_ID_BASE + asset_num;
+	a->parent = parent;
+
+	nmap_add(a->uuid, a->node_id);
+
+	return asset_num++;
+}
+
+static void add_rack(int rack)
+{
+	int cm, zone, i;
+
+	for (cm = 0; cm < MAX_CM_NUM; cm++) {
+		int cm_idx = add_asset(rack, -1, MC_TYPE_CM, cm);
+
+		zone = add_asset(rack, cm_idx, MC_TYPE_PZONE, cm);
+		for (i = 0; i < MAX_PSU_NUM; i++)
+			add_asset(rack, zone, MC_TYPE_PSU, i);
+
+		zone = add_asset(rack, cm_idx, MC_TYPE_TZONE, cm);
+		for (i = 0; i < MAX_PWM_NUM; i++)
+			add_asset(rack, zone, MC_TYPE_FAN, i);
+
+		zone = add_asset(rack, cm_idx, MC_TYPE_DZONE, cm);
+		for (i = 0; i < MAX_DRAWER_NUM; i++)
+			add_asset(rack, zone, MC_TYPE_DRAWER, i);
+	}
+}
+
+/* Resolve uuids as the on_*_change handlers do, return us per event. */
+static double replay_burst(int first, int count, int *wrong)
+{
+	memdb_integer node_id;
+	struct asset *a;
+	double start;
+	int i;
+
+	*wrong = 0;
+	start = now_us();
+	for (i = 0; i < BURST_EVENTS; i++) {
+		a = &assets[first + (i * 7) % count];
+
+		if (nmap_get_node_id_by_uuid(&node_id, a->uuid) != 0 || node_id != a->node_id)
+			(*wrong)++;
+		if (a->parent >= 0 &&
+			(nmap_get_node_id_by_uuid(&node_id, assets[a->parent].uuid) != 0 ||
+			 node_id != assets[a->parent].node_id))
+			(*wrong)++;
+	}
+
+	return (now_us() - start) / BURST_EVENTS;
+}
+
+int main(int argc, char **argv)
+{
+	char uuid[UUID_MAX_LEN];
+	memdb_integer node_id;
+	double one_rack, many_racks;
+	int wrong;
+	int i;
+
+	assets = calloc(MANY_RACKS * RACK_ASSETS, sizeof(struct asset));
+	if (assets == NULL)
+		return -1;
+
+	add_rack(0);
+	check(asset_num == RACK_ASSETS, "full rack added");
+
+	one_rack = replay_burst(0, RACK_ASSETS, &wrong);
+	check(wrong == 0, "change burst resolves every uuid of a full rack");
+
+	for (i = 1; i < MANY_RACKS; i++)
+		add_rack(i);
+	many_racks = replay_burst(0, asset_num, &wrong);
+	check(wrong == 0, "change burst resolves every uuid of many racks");
+
+	printf("%d events, %d assets: %.3f us/event\n", BURST_EVENTS, RACK_ASSETS, one_rack);
+	printf("%d events, %d assets: %.3f us/event\n", BURST_EVENTS, asset_num, many_racks);
+
+	wrong = 0;
+	for (i = 0; i < asset_num; i++) {
+		if (nmap_get_uuid_by_node_id(uuid, sizeof(uuid), assets[i].node_id) != 0 ||
+			strcmp(uuid, assets[i].uuid) != 0)
+			wrong++;
+	}
+	check(wrong == 0, "node id resolves to its uuid");
+
+	/* add events are sent again when a CM reconnects */
+	nmap_add(assets[0].uuid, assets[0].node_id);
+	nmap_remove_by_node_id(assets[0].node_id);
+	check(nmap_get_node_id_by_uuid(&node_id, assets[0].uuid) == -1, "re-added asset leaves no stale mapping");
+
+	/* a uuid moved to a new node, and a node given a new uuid */
+	nmap_add(assets[1].uuid, NODE_ID_BASE - 1);
+	check(nmap_get_node_id_by_uuid(&node_id, assets[1].uuid) == 0 && node_id == NODE_ID_BASE - 1,
+		  "uuid maps to its new node");
+	check(nmap_get_uuid_by_node_id(uuid, sizeof(uuid), assets[1].node_id) == -1,
+		  "old node of a moved uuid is unmapped");
+
+	nmap_add("new-uuid", assets[2].node_id);
+	check(nmap_get_node_id_by_uuid(&node_id, assets[2].uuid) == -1, "old uuid of a renamed node is unmapped");
+	check(nmap_get_uuid_by_node_id(uuid, sizeof(uuid), assets[2].node_id) == 0 &&
+		  strcmp(uuid, "new-uuid") == 0, "node maps to its new uuid");
+
+	for (i = 3; i < asset_num; i++)
+		nmap_remove_by_node_id(assets[i].node_id);
+	check(nmap_get_node_id_by_uuid(&node_id, assets[asset_num - 1].uuid) == -1, "removed assets are unmapped");
+
+	free(assets);
+
+	return test_result();
+}
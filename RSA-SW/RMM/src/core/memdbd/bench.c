@@ -0,0 +1,103 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libmemdb/memdb.h"
+#include "libutils/rack.h"
+#include "libutils/test.h"
+
+/*
+ * Compare reading attributes from memdbd shared memory with reading them
+ * through memdbd requests. memdbd has to be running.
+ *
+ * usage: memdbbench [attributes] [reads]
+ */
+
+static int run(memdb_integer node, int attr_num, int reads, int shm_read, double *ns)
+{
+	struct timespec start;
+	char name[32], expect[32], data[32];
+	int i, errors = 0;
+
+	libdb_set_shm_read(shm_read);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < reads; i++) {
+		snprintf(name, sizeof(name), "bench_attr_%d", i % attr_num);
+		memset(data, 0, sizeof(data));
+		libdb_attr_get_string(DB_RMM, node, name, data, sizeof(data), LOCK_ID_NULL);
+
+		snprintf(expect, sizeof(expect), "value_%d", i % attr_num);
+		if (strcmp(data, expect) != 0)
+			errors++;
+	}
+	*ns = elapsed_ns(&start) / reads;
+
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int attr_num = argc > 1 ? atoi(argv[1]) : 100;
+	int reads = argc > 2 ? atoi(argv[2]) : 10000;
+	char name[32], data[32];
+	memdb_integer node;
+	double shm_ns, rpc_ns;
+	int i, shm_err, rpc_err;
+
+	if (attr_num <= 0 || reads <= 0) {
+		printf("usage: %s [attributes] [reads]\n", argv[0]);
+		return -1;
+	}
+
+	libdb_init();
+
+	node = libdb_create_node(DB_RMM, 0, MC_TYPE_RMC, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+	if (node <= 0) {
+		printf("fail to create node, is memdbd running?\n");
+		return -1;
+	}
+
+	for (i = 0; i < attr_num; i++) {
+		snprintf(name, sizeof(name), "bench_attr_%d", i);
+		snprintf(data, sizeof(data), "value_%d", i);
+		libdb_attr_set_string(DB_RMM, node, name, 0, data, SNAPSHOT_NEED_NOT, LOCK_ID_NULL);
+	}
+
+	rpc_err = run(node, attr_num, reads, 0, &rpc_ns);
+	shm_err = run(node, attr_num, reads, 1, &shm_ns);
+	libdb_set_shm_read(1);
+
+	printf("%d attributes, %d reads\n", attr_num, reads);
+	printf("  memdbd request: %10.0f ns/read, %d errors\n", rpc_ns, rpc_err);
+	printf("  shared memory:  %10.0f ns/read, %d errors\n", shm_ns, shm_err);
+
+	/* removed attributes must not be read from shared memory any more */
+	libdb_attr_remove(DB_RMM, node, "bench_attr_0", LOCK_ID_NULL);
+	memset(data, 0, sizeof(data));
+	libdb_attr_get_string(DB_RMM, node, "bench_attr_0", data, sizeof(data), LOCK_ID_NULL);
+	if (data[0] != '\0') {
+		printf("removed attribute is still readable: %s\n", data);
+		shm_err++;
+	}
+
+	libdb_destroy_node(DB_RMM, node, LOCK_ID_NULL);
+
+	return (shm_err || rpc_err) ? -1 : 0;
+}
@@ -0,0 +1,370 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "memdb.h"
+#include "memdb_log.h"
+#include "snap.h"
+#include "libmemdb/node.h"
+#include "libmemdb/event.h"
+#include "libutils/rmm.h"
+#include "librmmlog/rmmlog.h"
+
+/*
+ * Check that memdbd recovers the memdb from its image and log after a
+ * crash at any point.
+ *
+ * A writer process changes the memdb, compacts it once in the middle and
+ * records the expected memdb state after every change. The log is then
+ * cut after every record and in the middle of the next one, and a fresh
+ * process loads the files and compares what it gets.
+ *
+ * usage: memdbcrashtest [changes]
+ */
+
+#define MAX_NODES	256
+#define ATTR_NAMES	8
+
+struct state {
+	uint64 digest;
+	uint32 nodes;
+	uint32 attrs;
+};
+
+struct checkpoint {
+	off_t wal_len;
+	struct state state;
+};
+
+static char dir[64];
+
+static void path_of(char *path, const char *file)
+{
+	memdb_snap_path(path, 128, file);
+}
+
+static uint32 hash_of(const void *a, size_t alen, const void *b, size_t blen)
+{
+	return memdb_crc32(memdb_crc32(0, a, alen), b, blen);
+}
+
+/* independent of the order of nodes and attributes */
+static struct state get_state(void)
+{
+	struct state st = {0};
+	struct node *node;
+	struct node_attr *attr;
+	memdb_integer key[3];
+
+	list_for_each_entry(node, &node_list, list) {
+		if (node->node_id == 0 || node->parent == NULL)
+			continue;
+
+		key[0] = node->node_id;
+		key[1] = node->parent->node_id;
+		key[2] = node->type;
+		st.digest += hash_of(key, sizeof(key), NULL, 0);
+		st.nodes++;
+	}
+
+	list_for_each_entry(attr, &attr_list, list) {
+		key[0] = attr->node->node_id;
+		key[1] = attr->cookie;
+		key[2] = attr->type;
+		st.digest += (uint64)hash_of(key, sizeof(key), attr->name, attr->namelen) *
+					 hash_of(attr->data, attr->datalen, NULL, 0);
+		st.attrs++;
+	}
+
+	return st;
+}
+
+static off_t file_len(const char *file)
+{
+	char path[128];
+	struct stat sb;
+
+	path_of(path, file);
+	if (stat(path, &sb) != 0)
+		return 0;
+
+	return sb.st_size;
+}
+
+static int copy_file(const char *from, const char *to, off_t len)
+{
+	char src[128], dst[128];
+	char buf[4096];
+	int in, out;
+	ssize_t n;
+
+	path_of(src, from);
+	path_of(dst, to);
+	unlink(dst);
+
+	in = open(src, O_RDONLY);
+	if (in < 0)
+		return -1;
+
+	out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	while (len > 0 && (n = read(in, buf, len < sizeof(buf) ? len : sizeof(buf))) > 0) {
+		if (write(out, buf, n) != n)
+			break;
+		len -= n;
+	}
+
+	close(in);
+	close(out);
+	return len > 0 ? -1 : 0;
+}
+
+static void change_memdb(unsigned int *seed, memdb_integer *ids, int *id_num)
+{
+	unsigned char name[32];
+	unsigned char data[64];
+	struct node *node;
+	int i, r, len;
+
+	node = find_node_by_node_id(DB_RMM, *id_num ? ids[rand_r(seed) % *id_num] : 0);
+	len = snprintf((char *)name, sizeof(name), "attr%d", rand_r(seed) % ATTR_NAMES) + 1;
+
+	r = rand_r(seed) % 100;
+	if (r < 25 || *id_num == 0) {
+		if (*id_num < MAX_NODES) {
+			node = insert_node(DB_RMM, node, rand_r(seed) % 64, SNAPSHOT_NEED);
+			ids[(*id_num)++] = node->node_id;
+		}
+	} else if (r < 70) {
+		/* binary data, also with '\n' which broke the text log */
+		r = rand_r(seed) % sizeof(data) + 1;
+		for (i = 0; i < r; i++)
+			data[i] = rand_r(seed);
+		set_node_attr(DB_RMM, node, rand_r(seed), name, len, data, r,
+					  SNAPSHOT_NEED, rand_r(seed) % 5);
+	} else if (r < 90) {
+		remove_node_attr(DB_RMM, node, name, len);
+	} else if (node->node_id != 0) {
+		destroy_node(DB_RMM, node);
+	}
+
+	publish_subscription();
+
+	/* destroyed subtrees */
+	for (i = 0; i < *id_num; i++) {
+		if (find_node_by_node_id(DB_RMM, ids[i]) == NULL)
+			ids[i--] = ids[--(*id_num)];
+	}
+}
+
+/*
+ * Changes the memdb, returns the checkpoints of the log written after
+ * the compaction, and the state at the compaction in 'compacted'.
+ */
+static int run_writer(int changes, struct checkpoint *cp, struct state *compacted)
+{
+	memdb_integer ids[MAX_NODES];
+	unsigned int seed = 1;
+	int id_num = 0;
+	int i;
+
+	int_node_module();
+	int_event_module();
+	memdb_snap_load(DB_RMM);
+
+	for (i = 0; i < changes / 2; i++)
+		change_memdb(&seed, ids, &id_num);
+
+	*compacted = get_state();
+	copy_file(MEMDB_LOG_RMM_FILE, "wal.0", file_len(MEMDB_LOG_RMM_FILE));
+	if (memdb_snap_compact(DB_RMM) != 0 || file_len(MEMDB_LOG_RMM_FILE) != 0)
+		return -1;
+	copy_file(FILE_IMAGE, "image.1", file_len(FILE_IMAGE));
+
+	cp[0].wal_len = 0;
+	cp[0].state = *compacted;
+	for (i = 1; i <= changes - changes / 2; i++) {
+		change_memdb(&seed, ids, &id_num);
+		cp[i].wal_len = file_len(MEMDB_LOG_RMM_FILE);
+		cp[i].state = get_state();
+	}
+	copy_file(MEMDB_LOG_RMM_FILE, "wal.1", file_len(MEMDB_LOG_RMM_FILE));
+
+	return i;
+}
+
+/* load the memdb in a new process as memdbd does at start */
+static int load(struct state *expect, off_t wal_len)
+{
+	struct state st;
+	pid_t pid;
+	int status;
+
+	pid = fork();
+	if (pid == 0) {
+		int_node_module();
+		int_event_module();
+		memdb_snap_load(DB_RMM);
+		st = get_state();
+		if (memcmp(&st, expect, sizeof(st)) != 0)
+			exit(1);
+		if (wal_len >= 0 && file_len(MEMDB_LOG_RMM_FILE) != wal_len)
+			exit(2);
+		exit(0);
+	}
+
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void clean(void)
+{
+	const char *files[] = {FILE_IMAGE, FILE_IMAGE ".tmp", FILE_IMAGE ".bad",
+						   MEMDB_LOG_RMM_FILE, "image.1", "wal.0", "wal.1"};
+	char path[128];
+	int i;
+
+	for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+		path_of(path, files[i]);
+		unlink(path);
+	}
+	rmdir(dir);
+}
+
+int main(int argc, char **argv)
+{
+	struct checkpoint *cp;
+	struct state compacted;
+	struct state empty = {0};
+	char path[128];
+	int changes = 1000;
+	int cp_num;
+	int failed = 0;
+	int rc;
+	int i;
+	pid_t pid;
+	int fd;
+
+	if (argc > 1)
+		changes = atoi(argv[1]);
+
+	if (rmm_log_init() < 0)
+		exit(-1);
+
+	snprintf(dir, sizeof(dir), "/tmp/memdbcrash.XXXXXX");
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return -1;
+	}
+	strncat(dir, "/", sizeof(dir) - strlen(dir) - 1);
+	memdb_snap_set_dir(dir);
+
+	cp = calloc(changes + 1, sizeof(*cp));
+
+	/* the writer must not leave its memdb to the loaders */
+	pid = fork();
+	if (pid == 0) {
+		cp_num = run_writer(changes, cp, &compacted);
+		path_of(path, "checkpoints");
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		write(fd, &compacted, sizeof(compacted));
+		write(fd, cp, cp_num * sizeof(*cp));
+		close(fd);
+		exit(cp_num < 0);
+	}
+	waitpid(pid, &rc, 0);
+
+	path_of(path, "checkpoints");
+	fd = open(path, O_RDONLY);
+	if (rc != 0 || fd < 0 || read(fd, &compacted, sizeof(compacted)) != sizeof(compacted)) {
+		printf("writer failed\n");
+		clean();
+		return -1;
+	}
+	cp_num = read(fd, cp, (changes + 1) * sizeof(*cp)) / sizeof(*cp);
+	close(fd);
+	unlink(path);
+
+	/* crash after the image and before the log was emptied */
+	copy_file("image.1", FILE_IMAGE, file_len("image.1"));
+	copy_file("wal.0", MEMDB_LOG_RMM_FILE, file_len("wal.0"));
+	if (load(&compacted, -1) != 0) {
+		printf("image with the log before it: FAILED\n");
+		failed++;
+	}
+
+	/* no image, the whole log before compaction */
+	path_of(path, FILE_IMAGE);
+	unlink(path);
+	copy_file("wal.0", MEMDB_LOG_RMM_FILE, file_len("wal.0"));
+	if (load(&compacted, file_len("wal.0")) != 0) {
+		printf("log without image: FAILED\n");
+		failed++;
+	}
+
+	/* crash after every log record, and in the middle of the next one */
+	for (i = 0; i < cp_num; i++) {
+		copy_file("image.1", FILE_IMAGE, file_len("image.1"));
+
+		copy_file("wal.1", MEMDB_LOG_RMM_FILE, cp[i].wal_len);
+		rc = load(&cp[i].state, cp[i].wal_len);
+
+		if (rc == 0 && i + 1 < cp_num && cp[i + 1].wal_len > cp[i].wal_len + 1) {
+			copy_file("wal.1", MEMDB_LOG_RMM_FILE,
+					  (cp[i].wal_len + cp[i + 1].wal_len) / 2);
+			rc = load(&cp[i].state, cp[i].wal_len);
+		}
+
+		if (rc != 0) {
+			printf("crash after change %d: FAILED (%d)\n", i, rc);
+			failed++;
+		}
+	}
+
+	/* crash while the image was written */
+	copy_file("image.1", FILE_IMAGE ".tmp", file_len("image.1") / 2);
+	copy_file("image.1", FILE_IMAGE, file_len("image.1"));
+	copy_file("wal.1", MEMDB_LOG_RMM_FILE, file_len("wal.1"));
+	if (load(&cp[cp_num - 1].state, -1) != 0) {
+		printf("partial image left: FAILED\n");
+		failed++;
+	}
+
+	/* a damaged image is not loaded */
+	path_of(path, FILE_IMAGE);
+	fd = open(path, O_WRONLY);
+	pwrite(fd, "X", 1, file_len(FILE_IMAGE) / 2);
+	close(fd);
+	copy_file("wal.0", MEMDB_LOG_RMM_FILE, 0);
+	load(&empty, -1);
+	path_of(path, FILE_IMAGE ".bad");
+	if (access(path, F_OK) != 0) {
+		printf("damaged image: FAILED\n");
+		failed++;
+	}
+
+	printf("%d crash points, %d failed\n", cp_num + 4, failed);
+
+	clean();
+	free(cp);
+	return failed ? -1 : 0;
+}
@@ -23,27 +23,206 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <signal.h>
+#include <time.h>
 
 #include "libmemdb/event.h"
 #include "libutils/rmm.h"
 #include "libutils/sock.h"
 #include "libjsonrpc/jsonrpc.h"
 
+#define EVENT_HASH_SIZE			256		/* buckets of attr subscriptions by node id */
+#define EVENT_MAX_TARGETS		64		/* subscribers served per batch of one event */
+#define EVENT_MAX_SIGNALS		64		/* pids with a deferred SIGEVT */
+#define EVENT_COALESCE_MAX		256		/* coalesced attr events waiting */
+#define EVENT_COALESCE_MS		20
+#define EVENT_SIGNAL_DELAY_MS	10
+#define EVENT_MAX_ATTRS			64		/* attr events of one node sent together */
+
 struct list_head sublist = LIST_HEAD_INIT(sublist);
 struct list_head pod_sublist = LIST_HEAD_INIT(pod_sublist);
 
+/*
+ * Subscriptions of a DB by what they match, so an event only walks the
+ * subscriptions which may want it.
+ */
+struct event_index {
+	struct list_head node[EVENT_NODE_ATTR];			/* create/delete, by event */
+	struct list_head attr_all;						/* attrs of every node */
+	struct list_head attr_node[EVENT_HASH_SIZE];	/* attrs of one node */
+};
+
+/* one subscriber of the events being sent, a port may have several subscriptions */
+struct event_target {
+	memdb_integer port;
+	memdb_integer pid;
+	int coalesce;
+	uint64 evts;		/* bit per event of the batch it gets */
+};
+
+/* one event, or the attr events of one node */
+struct event_batch {
+	struct event_info *evts[EVENT_MAX_ATTRS];
+	int evt_num;
+	uint64 bit;			/* of the event being matched */
+	int num;
+	struct event_target targets[EVENT_MAX_TARGETS];
+};
+
+struct coalesced_event {
+	memdb_integer port;
+	memdb_integer pid;
+	memdb_integer node_id;
+	char *name;
+	char *str;
+	int len;
+};
+
+static struct event_index rmm_index;
+static struct event_index pod_index;
+
+static struct coalesced_event coalesced[EVENT_COALESCE_MAX];
+static int coalesced_num;
+static uint64 coalesced_since;
+
+/* attr events held between event_attrs_begin and event_attrs_end */
+static struct event_info *held[EVENT_MAX_ATTRS];
+static memdb_integer held_db[EVENT_MAX_ATTRS];
+static int held_num;
+static int holding;
+
+static memdb_integer signal_pids[EVENT_MAX_SIGNALS];
+static int signal_num;
+static uint64 signal_since;
+
 static int notify_fd = -1;
 
-static void event_notify(struct subscription *s, struct event_info *evt, int evtlen)
+static uint64 now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static struct event_index *get_index(memdb_integer db_name)
+{
+	return DB_POD == db_name ? &pod_index : &rmm_index;
+}
+
+static struct list_head *get_bucket(struct event_index *idx, struct subscription *s)
+{
+	if (s->event != EVENT_NODE_ATTR)
+		return &idx->node[s->event];
+
+	if (s->data.attr.node_id == 0 && s->data.attr.prefix_len == 0)
+		return &idx->attr_all;
+
+	return &idx->attr_node[(uint64)s->data.attr.node_id % EVENT_HASH_SIZE];
+}
+
+static void send_event(memdb_integer port, char *str, int len)
 {
 	struct sockaddr_in addr;
-	char *notify_str = NULL;
 
 	memset(&addr, 0, sizeof(addr));
 	addr.sin_family = AF_INET;
-	addr.sin_port = s->cb_port;
+	addr.sin_port = port;
 	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
 
+	sendto(notify_fd, str, len, 0, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+static void flush_signals(void)
+{
+	int i;
+
+	for (i = 0; i < signal_num; i++)
+		kill(signal_pids[i], SIGEVT);
+	signal_num = 0;
+}
+
+/* one SIGEVT makes the subscriber read all the events queued on its socket */
+static void add_signal(memdb_integer pid)
+{
+	int i;
+
+	if (pid == 0)
+		return;
+
+	for (i = 0; i < signal_num; i++) {
+		if (signal_pids[i] == pid)
+			return;
+	}
+
+	if (signal_num == EVENT_MAX_SIGNALS)
+		flush_signals();
+	if (signal_num == 0)
+		signal_since = now_ms();
+	signal_pids[signal_num++] = pid;
+}
+
+static void flush_coalesced(void)
+{
+	int i;
+
+	for (i = 0; i < coalesced_num; i++) {
+		send_event(coalesced[i].port, coalesced[i].str, coalesced[i].len);
+		add_signal(coalesced[i].pid);
+		free(coalesced[i].str);
+	}
+	coalesced_num = 0;
+}
+
+/* Queue an attr event, a queued one of the same attribute is replaced. */
+static void add_coalesced(struct event_target *t, struct event_info *evt, char *str, int len)
+{
+	struct coalesced_event *c = NULL;
+	char *name = (char *)&evt->info.attr.elems[0];
+	int namelen = evt->info.attr.namelen;
+	char *copy;
+	int i;
+
+	for (i = 0; i < coalesced_num; i++) {
+		if (coalesced[i].port == t->port &&
+			coalesced[i].node_id == evt->info.attr.nodeid &&
+			strncmp(coalesced[i].name, name, namelen) == 0 &&
+			coalesced[i].name[namelen] == '\0') {
+			c = &coalesced[i];
+			break;
+		}
+	}
+
+	/* the string then the name, in one block */
+	copy = malloc(len + namelen + 1);
+	if (copy == NULL) {
+		send_event(t->port, str, len);
+		add_signal(t->pid);
+		return;
+	}
+	memcpy(copy, str, len);
+	memcpy(copy + len, name, namelen);
+	copy[len + namelen] = '\0';
+
+	if (c != NULL) {
+		free(c->str);
+	} else {
+		if (coalesced_num == EVENT_COALESCE_MAX)
+			flush_coalesced();
+		if (coalesced_num == 0)
+			coalesced_since = now_ms();
+		c = &coalesced[coalesced_num++];
+		c->port = t->port;
+		c->node_id = evt->info.attr.nodeid;
+	}
+	c->pid = t->pid;
+	c->str = copy;
+	c->name = copy + len;
+	c->len = len;
+}
+
+static char *create_notify_string(struct event_info *evt)
+{
 	switch (evt->event) {
 	case EVENT_NODE_CREATE:
 	case EVENT_NODE_DELETE:
@@ -53,9 +232,8 @@ static void event_notify(struct subscription *s, struct event_info *evt, int evt
 				{"parent", &evt->nparent, JSON_INTEGER},
 				{"type", mc_type_str[evt->ntype], JSON_STRING}
 			};
-			notify_str = jrpc_create_notify_string(event_string[evt->event], 3, params);
+			return jrpc_create_notify_string(event_string[evt->event], 3, params);
 		}
-		break;
 	case EVENT_NODE_ATTR:
 		{
 			jrpc_param_t params[5] = {
@@ -63,86 +241,263 @@ static void event_notify(struct subscription *s, struct event_info *evt, int evt
 				{"cookie", &evt->info.attr.cookie, JSON_INTEGER},
 				{"action", &evt->info.attr.action, JSON_INTEGER},
 				{"name", &evt->info.attr.elems[0], JSON_STRING},
-				{"data", &evt->info.attr.elems[evt->info.attr.datalen], JSON_STRING}
+				{"data", &evt->info.attr.elems[evt->info.attr.namelen], JSON_STRING}
 			};
-			notify_str = jrpc_create_notify_string(event_string[evt->event], 5, params);
+			return jrpc_create_notify_string(event_string[evt->event], 5, params);
 		}
-		break;
 	default:
-		break;
+		return NULL;
 	}
+}
+
+/* One notification with the attr events of one node. */
+static char *create_attrs_string(struct event_batch *b, uint64 evts)
+{
+	struct event_info *evt;
+	json_t *attrs;
+	json_t *attr;
+	char *str;
+	int i;
 
-	if (notify_str)
-		sendto(notify_fd, notify_str, strlen(notify_str)+1, 0, (struct sockaddr *)&addr, sizeof(addr));
+	attrs = json_array();
+	if (attrs == NULL)
+		return NULL;
 
-	if (s->cb_pid != 0)
-		kill(s->cb_pid, SIGEVT);
+	for (i = 0; i < b->evt_num; i++) {
+		if (!(evts & (1ULL << i)))
+			continue;
+		evt = b->evts[i];
+		attr = json_object();
+		if (attr == NULL ||
+			JSON_SUCCESS != json_object_add(attr, "cookie", json_integer(evt->info.attr.cookie)) ||
+			JSON_SUCCESS != json_object_add(attr, "action", json_integer(evt->info.attr.action)) ||
+			JSON_SUCCESS != json_object_add(attr, "name", json_string(event_attr_name(evt))) ||
+			JSON_SUCCESS != json_object_add(attr, "data", json_string((char *)event_attr_data(evt))) ||
+			JSON_SUCCESS != json_array_add(attrs, attr)) {
+			if (attr)
+				json_free(attr);
+			json_free(attrs);
+			return NULL;
+		}
+	}
+
+	{
+		jrpc_param_t params[2] = {
+			{"node_id", &b->evts[0]->info.attr.nodeid, JSON_INTEGER},
+			{"attrs", attrs, JSON_ARRAY}
+		};
+		str = jrpc_create_notify_string(EVENT_NODE_ATTRS_STR, 2, params);
+	}
+
+	/* NULL as well when longer than JSONRPC_MAX_STRING_LEN */
+	return str;
 }
 
-void node_create_notify(memdb_integer db_name, struct node *n)
+/*
+ * Serialize each event once and send it to every subscriber of the batch.
+ * A subscriber which gets several attr events of the batch gets them in one
+ * notification, unless it coalesces them.
+ */
+static void event_notify(struct event_batch *b)
+{
+	struct event_target *t;
+	char *strs[EVENT_MAX_ATTRS] = {NULL};
+	int lens[EVENT_MAX_ATTRS];
+	char *agg_str = NULL;
+	uint64 agg_evts = 0;
+	int i, j;
+
+	for (i = 0; i < b->num; i++) {
+		t = &b->targets[i];
+
+		if (!t->coalesce && (t->evts & (t->evts - 1)) != 0) {
+			if (t->evts != agg_evts) {
+				if (agg_str)
+					jrpc_free_string(agg_str);
+				agg_str = create_attrs_string(b, t->evts);
+				agg_evts = t->evts;
+			}
+			if (agg_str) {
+				send_event(t->port, agg_str, strlen(agg_str) + 1);
+				add_signal(t->pid);
+				continue;
+			}
+		}
+
+		for (j = 0; j < b->evt_num; j++) {
+			if (!(t->evts & (1ULL << j)))
+				continue;
+
+			if (strs[j] == NULL) {
+				strs[j] = create_notify_string(b->evts[j]);
+				if (strs[j] == NULL)
+					continue;
+				lens[j] = strlen(strs[j]) + 1;
+			}
+
+			if (t->coalesce && b->evts[j]->event == EVENT_NODE_ATTR) {
+				add_coalesced(t, b->evts[j], strs[j], lens[j]);
+			} else {
+				send_event(t->port, strs[j], lens[j]);
+				add_signal(t->pid);
+			}
+		}
+	}
+
+	for (j = 0; j < b->evt_num; j++) {
+		if (strs[j])
+			jrpc_free_string(strs[j]);
+	}
+	if (agg_str)
+		jrpc_free_string(agg_str);
+
+	b->num = 0;
+}
+
+/* A subscriber gets an event once, even if several of its subscriptions match. */
+static void event_match(struct event_batch *b, struct subscription *s)
+{
+	struct event_target *t;
+	int i;
+
+	for (i = 0; i < b->num; i++) {
+		t = &b->targets[i];
+		if (t->port == s->cb_port) {
+			if (!(s->flags & SUB_FLAG_COALESCE))
+				t->coalesce = 0;
+			if (t->pid == 0)
+				t->pid = s->cb_pid;
+			t->evts |= b->bit;
+			return;
+		}
+	}
+
+	if (b->num == EVENT_MAX_TARGETS)
+		event_notify(b);
+
+	t = &b->targets[b->num++];
+	t->port = s->cb_port;
+	t->pid = s->cb_pid;
+	t->coalesce = (s->flags & SUB_FLAG_COALESCE) != 0;
+	t->evts = b->bit;
+}
+
+static void node_notify(memdb_integer db_name, struct node *n, memdb_integer event)
 {
 	struct subscription *s;
-	struct event_info event;
-	struct list_head *which_sub = &sublist;
+	struct event_info evt;
+	struct event_batch batch;
 
-	if (DB_POD == db_name)
-		which_sub = &pod_sublist;
+	evt.event = event;
+	evt.nnodeid = n->node_id;
+	evt.nparent = n->parent != NULL ? n->parent->node_id : 0UL;
+	evt.ntype = n->type;
 
-	event.event = EVENT_NODE_CREATE;
-	event.nnodeid = n->node_id;
-	event.nparent = n->parent != NULL ? n->parent->node_id : 0UL;
-	event.ntype = n->type;
+	batch.evts[0] = &evt;
+	batch.evt_num = 1;
+	batch.bit = 1;
+	batch.num = 0;
 
-	list_for_each_entry(s, which_sub, list) {
-		if (s->event == EVENT_NODE_CREATE &&
-		    n->type >= s->data.node.type_min &&
+	list_for_each_entry(s, &get_index(db_name)->node[event], index) {
+		if (n->type >= s->data.node.type_min &&
 		    n->type <= s->data.node.type_max)
-			event_notify(s, &event, sizeof(event));
+			event_match(&batch, s);
 	}
+
+	event_notify(&batch);
+}
+
+void node_create_notify(memdb_integer db_name, struct node *n)
+{
+	node_notify(db_name, n, EVENT_NODE_CREATE);
 }
 
 void node_delete_notify(memdb_integer db_name, struct node *n)
 {
+	node_notify(db_name, n, EVENT_NODE_DELETE);
+}
+
+/* Send attr events of one node, several of them only when held. */
+static void attr_notify(memdb_integer db_name, struct event_info **evts, int num)
+{
+	memdb_integer node_id = evts[0]->info.attr.nodeid;
+	struct event_index *idx = get_index(db_name);
+	struct list_head *bucket = &idx->attr_node[(uint64)node_id % EVENT_HASH_SIZE];
 	struct subscription *s;
-	struct event_info event;
-	struct list_head *which_sub = &sublist;
+	struct event_batch batch;
+	char *name;
+	int i;
 
-	if (DB_POD == db_name)
-		which_sub = &pod_sublist;
+	batch.evt_num = num;
+	batch.num = 0;
 
-	event.event = EVENT_NODE_DELETE;
-	event.nnodeid = n->node_id;
-	event.nparent = n->parent != NULL ? n->parent->node_id : 0UL;
-	event.ntype = n->type;
+	for (i = 0; i < num; i++) {
+		batch.evts[i] = evts[i];
+		batch.bit = 1ULL << i;
 
-	list_for_each_entry(s, which_sub, list) {
-		if (s->event == EVENT_NODE_DELETE &&
-		    n->type >= s->data.node.type_min &&
-		    n->type <= s->data.node.type_max)
-			event_notify(s, &event, sizeof(event));
+		list_for_each_entry(s, &idx->attr_all, index)
+			event_match(&batch, s);
+
+		name = event_attr_name(evts[i]);
+		list_for_each_entry(s, bucket, index) {
+			if (s->data.attr.node_id != node_id)
+				continue;
+			if (s->data.attr.prefix_len != 0 &&
+				strncmp(name, s->data.attr.name_prefix, s->data.attr.prefix_len) != 0)
+				continue;
+			event_match(&batch, s);
+		}
 	}
+
+	event_notify(&batch);
+}
+
+/* Send the held events, grouped by node. */
+static void flush_held(void)
+{
+	struct event_info *group[EVENT_MAX_ATTRS];
+	memdb_integer node_id;
+	int num;
+	int i, j;
+
+	for (i = 0; i < held_num; i++) {
+		if (held[i] == NULL)
+			continue;
+
+		node_id = held[i]->info.attr.nodeid;
+		num = 0;
+		for (j = i; j < held_num; j++) {
+			if (held[j] != NULL && held_db[j] == held_db[i] &&
+				held[j]->info.attr.nodeid == node_id) {
+				group[num++] = held[j];
+				if (j != i)
+					held[j] = NULL;
+			}
+		}
+
+		attr_notify(held_db[i], group, num);
+
+		for (j = 0; j < num; j++)
+			free(group[j]);
+		held[i] = NULL;
+	}
+
+	held_num = 0;
 }
 
 void node_attr_notify(memdb_integer db_name, struct node_attr *a,
 					  memdb_integer action)
 {
 	int size;
-	char *name;
 	memdb_integer node_id = 0;
-	struct subscription *s;
 	struct event_info *event;
-	struct list_head *which_sub = &sublist;
-
-	if (DB_POD == db_name)
-		which_sub = &pod_sublist;
+	struct event_index *idx = get_index(db_name);
+	struct list_head *bucket;
 
 	node_id = a->node->node_id;
-	list_for_each_entry(s, which_sub, list) {
-		if (s->event == EVENT_NODE_ATTR &&
-		    s->data.attr.node_id == node_id) {
-			break;
-		}
-	}
+	bucket = &idx->attr_node[(uint64)node_id % EVENT_HASH_SIZE];
+	if (list_empty(&idx->attr_all) && list_empty(bucket))
+		return;
 
 	size = sizeof(*event) + a->namelen + a->datalen;
 	if ((event = malloc(size)) == NULL)
@@ -157,28 +512,89 @@ void node_attr_notify(memdb_integer db_name, struct node_attr *a,
 	memcpy(&event->info.attr.elems[0], a->name, a->namelen);
 	memcpy(&event->info.attr.elems[a->namelen], a->data, a->datalen);
 
-	name = a->name;
-	list_for_each_entry(s, which_sub, list) {
-		if (s->event == EVENT_NODE_ATTR) {
-			if (s->data.attr.prefix_len != 0) {
-				if (strncmp(name, s->data.attr.name_prefix, s->data.attr.prefix_len) == 0 &&
-					s->data.attr.node_id == node_id) {
-					event_notify(s, event, size);
-				}
-			} else if (s->data.attr.node_id != 0) {
-				if (s->data.attr.node_id == node_id)
-					event_notify(s, event, size);
-			} else {
-				event_notify(s, event, size);
-			}
-		}
+	if (holding) {
+		if (held_num == EVENT_MAX_ATTRS)
+			flush_held();
+		held[held_num] = event;
+		held_db[held_num] = db_name;
+		held_num++;
+		return;
 	}
 
+	attr_notify(db_name, &event, 1);
 	free(event);
 }
 
+void event_attrs_begin(void)
+{
+	holding = 1;
+}
+
+void event_attrs_end(void)
+{
+	flush_held();
+	holding = 0;
+}
+
+void event_add_subscription(memdb_integer db_name, struct subscription *s)
+{
+	if (DB_RMM == db_name)
+		list_add_tail(&s->list, &sublist);
+	else if (DB_POD == db_name)
+		list_add_tail(&s->list, &pod_sublist);
+	else
+		return;
+
+	list_add_tail(&s->index, get_bucket(get_index(db_name), s));
+}
+
+void event_del_subscription(memdb_integer db_name, struct subscription *s)
+{
+	list_del(&s->list);
+	list_del(&s->index);
+}
+
+void event_flush(int idle)
+{
+	uint64 now = now_ms();
+
+	if (coalesced_num != 0 && now - coalesced_since >= EVENT_COALESCE_MS)
+		flush_coalesced();
+
+	if (signal_num != 0 && (idle || now - signal_since >= EVENT_SIGNAL_DELAY_MS))
+		flush_signals();
+}
+
+int event_flush_wait(void)
+{
+	uint64 now;
+
+	if (coalesced_num == 0)
+		return -1;
+
+	now = now_ms();
+	if (now - coalesced_since >= EVENT_COALESCE_MS)
+		return 0;
+
+	return EVENT_COALESCE_MS - (now - coalesced_since);
+}
+
+static void init_index(struct event_index *idx)
+{
+	int i;
+
+	for (i = 0; i < EVENT_NODE_ATTR; i++)
+		INIT_LIST_HEAD(&idx->node[i]);
+	INIT_LIST_HEAD(&idx->attr_all);
+	for (i = 0; i < EVENT_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&idx->attr_node[i]);
+}
+
 void int_event_module(void)
 {
+	init_index(&rmm_index);
+	init_index(&pod_index);
+
 	notify_fd = udp_create();
 
 	if (notify_fd == -1)
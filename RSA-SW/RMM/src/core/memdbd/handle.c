@@ -14,6 +14,7 @@
 
 
 #include <netinet/in.h>
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -26,6 +27,7 @@
 #include "libmemdb/memdb_jrpc.h"
 #include "libutils/rack.h"
 #include "memdb.h"
+#include "memdb_shm.h"
 
 struct list_head pending_cmd_list = LIST_HEAD_INIT(pending_cmd_list);
 
@@ -218,13 +220,11 @@ static int handle_list_node(struct request_pkg *req, json_t *resp)
 	struct node *n;
 	struct node_info info;
 	struct list_node_param param;
-	struct list_head *which_node = &node_list;
+	struct list_head *which_node;
+	memdb_integer type;
 	jrpc_data_string type_max_str = NULL;
 	jrpc_data_string type_min_str = NULL;
 
-	if (DB_POD == req->db_name)
-		which_node = &pod_node_list;
-
 	if (jrpc_get_named_param_value(req->jrpc_pkg.json, "p_type_max", JSON_STRING, &type_max_str) ||
 		jrpc_get_named_param_value(req->jrpc_pkg.json, "p_type_min", JSON_STRING, &type_min_str) ||
 		-1 == type_str2int(&param.type_max, type_max_str) ||
@@ -235,25 +235,32 @@ static int handle_list_node(struct request_pkg *req, json_t *resp)
 
 	json_t *array = json_array();
 
-	list_for_each_entry(n, which_node, list) {
-		if (n->type < param.type_min ||
-		    n->type > param.type_max)
+	/* nodes are listed by type, in order of creation within a type */
+	for (type = param.type_min; type <= param.type_max; type++) {
+		which_node = node_type_list_head(req->db_name, type);
+		if (which_node == NULL)
 			continue;
 
-		info.parent = n->parent != NULL ? n->parent->node_id : 0UL;
-		info.node_id	= n->node_id;
-		info.type	 = n->type;
+		list_for_each_entry(n, which_node, type_list) {
+			if (n->type < param.type_min ||
+			    n->type > param.type_max)
+				continue;
 
-		json_t *node = json_object();
+			info.parent = n->parent != NULL ? n->parent->node_id : 0UL;
+			info.node_id	= n->node_id;
+			info.type	 = n->type;
 
-		if (NULL != array && NULL != node &&
-			JSON_SUCCESS == json_object_add(node, "parent", json_integer(info.parent)) &&
-			JSON_SUCCESS == json_object_add(node, "node_id", json_integer(info.node_id)) &&
-			JSON_SUCCESS == json_object_add(node, "type", json_string(mc_type_str[info.type])) &&
-			JSON_SUCCESS == json_array_add(array, node))
-			continue;
-		else
-			return MEMDB_INTERNAL_ERR;
+			json_t *node = json_object();
+
+			if (NULL != array && NULL != node &&
+				JSON_SUCCESS == json_object_add(node, "parent", json_integer(info.parent)) &&
+				JSON_SUCCESS == json_object_add(node, "node_id", json_integer(info.node_id)) &&
+				JSON_SUCCESS == json_object_add(node, "type", json_string(mc_type_str[info.type])) &&
+				JSON_SUCCESS == json_array_add(array, node))
+				continue;
+			else
+				return MEMDB_INTERNAL_ERR;
+		}
 	}
 
 	if (JSON_SUCCESS != json_object_add(resp, "r_nodes", array))
@@ -267,31 +274,25 @@ static int handle_node_get_by_node_id(struct request_pkg *req, json_t *resp)
 {
 	struct node *n;
 	struct node_info info;
-	struct list_head *which_node = &node_list;
 
-	if (DB_POD == req->db_name)
-		which_node = &pod_node_list;
+	n = find_node_by_node_id(req->db_name, req->node_id);
+	if (n == NULL)
+		return MEMDB_INTERNAL_ERR;
 
-	list_for_each_entry(n, which_node, list) {
-		if (n->node_id == req->node_id) {
-			info.parent = n->parent != NULL ? n->parent->node_id : 0UL;
-			info.node_id   = n->node_id;
-			info.type   = n->type;
+	info.parent = n->parent != NULL ? n->parent->node_id : 0UL;
+	info.node_id   = n->node_id;
+	info.type   = n->type;
 
-			json_t *node = json_object();
+	json_t *node = json_object();
 
-			if (NULL == node ||
-				JSON_SUCCESS != json_object_add(node, "parent", json_integer(info.parent)) ||
-				JSON_SUCCESS != json_object_add(node, "node_id", json_integer(info.node_id)) ||
-				JSON_SUCCESS != json_object_add(node, "type", json_string(mc_type_str[info.type])) ||
-				JSON_SUCCESS != json_object_add(resp, "r_node", node)) {
-				return MEMDB_INTERNAL_ERR;
-			} else {
-				return MEMDB_HANDLE_SUCCESS;
-			}
-		}
-	}
-	return MEMDB_INTERNAL_ERR;
+	if (NULL == node ||
+		JSON_SUCCESS != json_object_add(node, "parent", json_integer(info.parent)) ||
+		JSON_SUCCESS != json_object_add(node, "node_id", json_integer(info.node_id)) ||
+		JSON_SUCCESS != json_object_add(node, "type", json_string(mc_type_str[info.type])) ||
+		JSON_SUCCESS != json_object_add(resp, "r_node", node))
+		return MEMDB_INTERNAL_ERR;
+
+	return MEMDB_HANDLE_SUCCESS;
 }
 
 static int handle_attr_set(struct request_pkg *req, json_t *resp)
@@ -452,6 +453,204 @@ static int handle_list_attrs_by_cookie(struct request_pkg *req, json_t *resp)
 	return MEMDB_HANDLE_SUCCESS;
 }
 
+struct attrs_get_ctx {
+	json_t *array;
+	json_t *names;
+	int size;
+	int truncated;
+};
+
+static int add_attr_element(struct attrs_get_ctx *ctx, struct node *n,
+							memdb_integer cookie, char *name, char *data)
+{
+	json_t *element = NULL;
+
+	ctx->size += strlen(name) + strlen(data) + 64;
+	if (ctx->size > CMDMAXDATALEN) {
+		ctx->truncated = 1;
+		return 0;
+	}
+
+	element = json_object();
+	if (NULL == element ||
+		JSON_SUCCESS != json_object_add(element, "node", json_integer(n->node_id)) ||
+		JSON_SUCCESS != json_object_add(element, "cookie", json_integer(cookie)) ||
+		JSON_SUCCESS != json_object_add(element, "name", json_string(name)) ||
+		JSON_SUCCESS != json_object_add(element, "data", json_string(data)) ||
+		JSON_SUCCESS != json_array_add(ctx->array, element))
+		return -1;
+
+	return 0;
+}
+
+static int add_node_attrs(struct attrs_get_ctx *ctx, struct node *n, int subtree)
+{
+	int i;
+	char *name, *data;
+	memdb_integer cookie;
+	struct node_attr *pa;
+	struct node *child;
+
+	if (NULL == ctx->names) {
+		list_for_each_entry(pa, &n->attrs, group) {
+			if (ctx->truncated)
+				return 0;
+			if (add_attr_element(ctx, n, pa->cookie, pa->name, (char *)pa->data))
+				return -1;
+		}
+	} else {
+		for (i = 0; i < json_array_size(ctx->names); i++) {
+			if (ctx->truncated)
+				return 0;
+			name = json_string_value(json_array_get(ctx->names, i));
+			if (NULL == name)
+				return -1;
+			/* missing attributes are left out of the result */
+			if (get_node_attr(n, (unsigned char *)name, strlen(name)+1, &cookie, &data))
+				continue;
+			if (add_attr_element(ctx, n, cookie, name, data))
+				return -1;
+		}
+	}
+
+	if (subtree) {
+		list_for_each_entry(child, &n->children, sibling) {
+			if (add_node_attrs(ctx, child, subtree))
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int handle_attrs_get(struct request_pkg *req, json_t *resp)
+{
+	int i;
+	struct node *n;
+	struct attrs_get_ctx ctx = {};
+	json_t *nodes = NULL;
+	jrpc_data_integer p_subtree = 0;
+
+	/* all parameters are optional */
+	if (jrpc_get_named_param_value(req->jrpc_pkg.json, "p_nodes", JSON_ARRAY, &nodes))
+		nodes = NULL;
+	if (jrpc_get_named_param_value(req->jrpc_pkg.json, "p_names", JSON_ARRAY, &ctx.names))
+		ctx.names = NULL;
+	if (jrpc_get_named_param_value(req->jrpc_pkg.json, "p_subtree", JSON_INTEGER, &p_subtree))
+		p_subtree = 0;
+
+	ctx.array = json_array();
+	if (NULL == ctx.array)
+		return MEMDB_INTERNAL_ERR;
+
+	if (NULL == nodes) {
+		n = find_node_by_node_id(req->db_name, req->node_id);
+		if (!n) {
+			json_free(ctx.array);
+			return MEMDB_OEM_NODE_NOTFOUND;
+		}
+		if (add_node_attrs(&ctx, n, p_subtree))
+			goto err;
+	} else {
+		for (i = 0; i < json_array_size(nodes); i++) {
+			n = find_node_by_node_id(req->db_name,
+									 json_integer_value(json_array_get(nodes, i)));
+			/* nodes may go away between listing and reading */
+			if (!n)
+				continue;
+			if (add_node_attrs(&ctx, n, p_subtree))
+				goto err;
+		}
+	}
+
+	if (JSON_SUCCESS != json_object_add(resp, "r_attrs", ctx.array) ||
+		JSON_SUCCESS != json_object_add(resp, "r_truncated", json_integer(ctx.truncated)) ||
+		JSON_SUCCESS != json_object_add(resp, "node_id", json_integer(req->node_id)))
+		return MEMDB_INTERNAL_ERR;
+
+	return MEMDB_HANDLE_SUCCESS;
+
+err:
+	json_free(ctx.array);
+	return MEMDB_INTERNAL_ERR;
+}
+
+static int handle_attrs_set(struct request_pkg *req, json_t *resp)
+{
+	int i, num;
+	int rc = MEMDB_HANDLE_SUCCESS;
+	struct node *n;
+	struct attr_reserve *res = NULL;
+	json_t *attrs = NULL;
+	json_t *element = NULL;
+	char *name, *data;
+
+	if (jrpc_get_named_param_value(req->jrpc_pkg.json, "p_attrs", JSON_ARRAY, &attrs))
+		return MEMDB_INVALID_PARAMS;
+
+	num = json_array_size(attrs);
+	if (num > 0) {
+		res = calloc(num, sizeof(*res));
+		if (res == NULL)
+			return MEMDB_OEM_MALLOC_ERR;
+	}
+
+	/*
+	 * Validate the whole batch and reserve the memory each set may need,
+	 * so applying it cannot fail half way: it is applied entirely or not at all.
+	 */
+	for (i = 0; i < num; i++) {
+		element = json_array_get(attrs, i);
+		name = element ? json_string_value(json_object_get(element, "name")) : NULL;
+		data = element ? json_string_value(json_object_get(element, "data")) : NULL;
+		if (NULL == name || NULL == data ||
+			strlen(name) >= USHRT_MAX || strlen(data) >= USHRT_MAX) {
+			rc = MEMDB_INVALID_PARAMS;
+			goto out;
+		}
+		if (!find_node_by_node_id(req->db_name,
+								  json_integer_value(json_object_get(element, "node")))) {
+			rc = MEMDB_OEM_NODE_NOTFOUND;
+			goto out;
+		}
+		if (reserve_node_attr(&res[i], strlen(name) + 1, strlen(data) + 1)) {
+			rc = MEMDB_OEM_MALLOC_ERR;
+			goto out;
+		}
+	}
+
+	/* subscribers get the changes of a node in one event */
+	event_attrs_begin();
+	for (i = 0; i < num; i++) {
+		element = json_array_get(attrs, i);
+		n = find_node_by_node_id(req->db_name,
+								 json_integer_value(json_object_get(element, "node")));
+		name = json_string_value(json_object_get(element, "name"));
+		data = json_string_value(json_object_get(element, "data"));
+
+		set_node_attr_reserved(req->db_name, n,
+							   json_integer_value(json_object_get(element, "cookie")),
+							   (unsigned char *)name, strlen(name)+1,
+							   (unsigned char *)data, strlen(data)+1,
+							   json_integer_value(json_object_get(element, "snapshot_flag")),
+							   TYPE_STRING, &res[i]);
+		/* set_node_attr only keeps the last change */
+		publish_attr_change();
+	}
+	event_attrs_end();
+
+	if (JSON_SUCCESS != json_object_add(resp, "r_count", json_integer(num)) ||
+		JSON_SUCCESS != json_object_add(resp, "node_id", json_integer(req->node_id)))
+		rc = MEMDB_INTERNAL_ERR;
+
+out:
+	/* memory of attributes which already existed is not taken */
+	for (i = 0; i < num; i++)
+		release_node_attr(&res[i]);
+	free(res);
+	return rc;
+}
+
 static int handle_add_subscription(struct request_pkg *req, json_t *resp)
 {
 	struct subscription *sub = NULL;
@@ -461,6 +660,7 @@ static int handle_add_subscription(struct request_pkg *req, json_t *resp)
 	jrpc_data_integer p_event = 0;
 	jrpc_data_integer p_cb_port = 0;
 	jrpc_data_integer p_cb_pid = 0;
+	jrpc_data_integer p_coalesce = 0;
 
 	if (jrpc_get_named_param_value(req->jrpc_pkg.json, "p_event", JSON_INTEGER, &p_event) ||
 		jrpc_get_named_param_value(req->jrpc_pkg.json, "p_cb_port", JSON_INTEGER, &p_cb_port) ||
@@ -518,14 +718,15 @@ static int handle_add_subscription(struct request_pkg *req, json_t *resp)
 		return MEMDB_INVALID_REQ;
 	}
 
+	/* optional, older clients do not send it */
+	jrpc_get_named_param_value(req->jrpc_pkg.json, "p_coalesce", JSON_INTEGER, &p_coalesce);
+
 	sub->event   = param.event;
 	sub->cb_port = htons(param.cb_port);
 	sub->cb_pid  = param.cb_pid;
+	sub->flags   = p_coalesce ? SUB_FLAG_COALESCE : 0;
 
-	if (DB_RMM == req->db_name)
-		list_add_tail(&sub->list, &sublist);
-	else if (DB_POD == req->db_name)
-		list_add_tail(&sub->list, &pod_sublist);
+	event_add_subscription(req->db_name, sub);
 
 	/*
 	if (JSON_SUCCESS != json_object_add(resp, "r_sub", json_integer((int64)sub)))
@@ -549,7 +750,7 @@ static int handle_remove_subscription(struct request_pkg *req, json_t *resp)
 
 	list_for_each_entry(s, which_sub, list) {
 		if (s == target) {
-			list_del(&s->list);
+			event_del_subscription(req->db_name, s);
 			free(s);
 			break;
 		}
@@ -584,6 +785,7 @@ static int handle_db_lock(struct request_pkg *req, json_t *resp)
 
 	id = alloc_lock_id();
 	cur_lock_id = id;
+	memdb_shm_set_locked(true);
 
 	if (JSON_SUCCESS != json_object_add(resp, "r_lock_id", json_integer(id)))
 		return MEMDB_INTERNAL_ERR;
@@ -599,6 +801,7 @@ static int handle_db_unlock(struct request_pkg *req, json_t *resp)
 		return MEMDB_OEM_HANDLE_ERR;
 
 	cur_lock_id = LOCK_ID_STARTER;
+	memdb_shm_set_locked(false);
 
 	/* unset timer */
 	value.it_value.tv_sec = 0;
@@ -633,6 +836,9 @@ static command_handle_fn handles[CMD_MAX] = {
 
 	[CMD_LOCK] = handle_db_lock,
 	[CMD_UNLOCK] = handle_db_unlock,
+
+	[CMD_ATTRS_GET] = handle_attrs_get,
+	[CMD_ATTRS_SET] = handle_attrs_set,
 };
 
 void pend_command(int fd, struct request_pkg *req, struct sockaddr *addr, socklen_t addrlen)
@@ -722,6 +928,7 @@ void dispose_command(int fd, struct request_pkg *req, struct sockaddr *addr, soc
 void db_timeout(void)
 {
 	cur_lock_id = LOCK_ID_STARTER;
+	memdb_shm_set_locked(false);
 }
 
 void process_pending_cmds(void)
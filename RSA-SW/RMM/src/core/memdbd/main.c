@@ -29,6 +29,7 @@
 #include "snap.h"
 #include "memdb.h"
 #include "memdb_log.h"
+#include "memdb_shm.h"
 #include "libmemdb/command.h"
 #include "libmemdb/event.h"
 #include "libmemdb/node.h"
@@ -104,9 +105,12 @@ int main(int argc, char **argv)
 {
 	int rc;
 	int fd;
+	int wait_ms;
+	int queued;
 	
 	char *rsp_str;
 	fd_set fds;
+	struct timeval tv;
 	socklen_t addrlen;
 	struct sockaddr_in addr;
 	struct request_pkg req;
@@ -119,6 +123,9 @@ int main(int argc, char **argv)
 	libdb_init();
 	int_node_module();
 	int_event_module();
+
+	/* not fatal, clients read attributes from memdbd then */
+	memdb_shm_init();
 	
 	create_listen_socket(&fd);
 
@@ -129,25 +136,27 @@ int main(int argc, char **argv)
 	signal(SIGTERM, handle_signal);
 	signal(SIGALRM , handle_timeout);
 
-	/* Load the existed memdb first. */
-	memdb_node_load(FILE_SNAP, DB_RMM);
-
-	/* Load the latest memdb from the logfile */
-	memdb_log_load(DB_RMM, MEMDB_LOG_RMM_FILE);
-
-	/* clear pending status from existed memdb logfile/snapshot */
-	publish_subscription();
+	/* Load the memdb image and the changes logged after it. */
+	memdb_snap_load(DB_RMM);
 	rsp_str = malloc(JSONRPC_MAX_STRING_LEN);
 	for (;;) {
 		mask = block_timer_signal();
 		process_pending_cmds();
 		unblock_timer_signal(mask);
 
+		/* subscribers are signaled once the queued requests are done */
+		queued = 0;
+		ioctl(fd, FIONREAD, &queued);
+		event_flush(queued == 0);
+
 		FD_ZERO(&fds);
 		FD_SET(fd, &fds);
 
-		rc = select(fd + 1, &fds, NULL, NULL, NULL);
-		if (rc < 0)
+		wait_ms = event_flush_wait();
+		tv.tv_sec = wait_ms / 1000;
+		tv.tv_usec = (wait_ms % 1000) * 1000;
+		rc = select(fd + 1, &fds, NULL, NULL, wait_ms >= 0 ? &tv : NULL);
+		if (rc <= 0)
 			continue;
 		memset(cmd_string, 0, JSONRPC_MAX_STRING_LEN);
 		rc = recvfrom(fd, cmd_string, sizeof(cmd_string), 0, (struct sockaddr *)&addr, &addrlen);
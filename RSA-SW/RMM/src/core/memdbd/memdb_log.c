@@ -13,15 +13,18 @@
  */
 
 
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <time.h>
-#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "memdb.h"
 #include "memdb_log.h"
+#include "snap.h"
 #include "libmemdb/node.h"
 #include "libutils/string.h"
 
@@ -33,11 +36,67 @@
 #define MEMDB_LOG_NAME_PREFIX_LEN	7
 #define MEMDB_LOG_DATA_PREFIX_LEN	7
 
+/*
+ * Log record, followed by the attribute name and data. 'crc' covers the
+ * record from 'seq' to the end of the data.
+ */
+struct memdb_log_rec {
+	uint32 len;					/* whole record */
+	uint32 crc;
+	uint64 seq;
+	uint32 action;
+	uint32 namelen;
+	uint32 datalen;
+	uint32 reserved;
+	memdb_integer node_id;
+	memdb_integer parent;		/* MEMDB_LOG_CREATE_NODE */
+	memdb_integer type;			/* node or attribute type */
+	memdb_integer cookie;
+	unsigned char elems[0];
+};
+
+#define MEMDB_LOG_CRC_OFFSET	offset_of(struct memdb_log_rec, seq)
+
 static int var_memdb_log_ok = 1;
 
 static int memdb_log_rmm_number;
 static int memdb_log_pod_number;
 
+static int log_fd[DB_MAX] = {-1, -1};
+static uint64 log_seq[DB_MAX];
+
+/* set while the memdb is loaded, changes are not logged again */
+static bool log_replaying;
+
+static const char *log_file[DB_MAX] = {
+	MEMDB_LOG_RMM_FILE,
+	MEMDB_LOG_POD_FILE
+};
+
+static uint32 crc_table[256];
+
+uint32 memdb_crc32(uint32 crc, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	uint32 c;
+	int i, j;
+
+	if (crc_table[1] == 0) {
+		for (i = 0; i < 256; i++) {
+			c = i;
+			for (j = 0; j < 8; j++)
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			crc_table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
 int memdb_log_get_status(void)
 {
 	return var_memdb_log_ok;
@@ -63,128 +122,255 @@ void memdb_log_set_pod_number(int var)
 	memdb_log_pod_number = var;
 }
 
-static int get_local_time(char *output)
+uint64 memdb_log_get_seq(memdb_integer db_name)
 {
-	struct tm *tm;
-	time_t timep;
-	char timestamp[128] = {0};
-
-	if (NULL == output)
-		return -1;
+	return log_seq[db_name];
+}
 
-	time(&timep);
-	tm = localtime(&timep);
+void memdb_log_set_replaying(bool replaying)
+{
+	log_replaying = replaying;
+}
 
-	snprintf(timestamp, sizeof(timestamp), "%d-%02d-%02dT%02d:%02d:%02d",
-				(tm->tm_year + 1900), (tm->tm_mon + 1), tm->tm_mday,
-				tm->tm_hour, tm->tm_min, tm->tm_sec);
+static int open_log(memdb_integer db_name)
+{
+	char path[128];
 
-	memcpy(output, timestamp, 128);
+	if (log_fd[db_name] < 0) {
+		memdb_snap_path(path, sizeof(path), log_file[db_name]);
+		log_fd[db_name] = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+	}
 
-	return 0;
+	return log_fd[db_name];
 }
 
 /**
- * @brief: when add/modify/remove node/attribute, write the operation to
- *         log file first.
+ * @brief: when add/modify/remove node/attribute, append the operation to
+ *         the log file. The record is written with a single write(), it is
+ *         not synced, a crash may only lose or tear the last records.
  */
-int memdb_log(memdb_integer db_name, const char *file,
-			  void *param, int action)
+int memdb_log(memdb_integer db_name, void *param, int action)
 {
+	unsigned char buf[MEMDB_LOG_MAX_LINE_SIZE];
+	struct memdb_log_rec *rec = (struct memdb_log_rec *)buf;
+	struct node *node = NULL;
+	struct node_attr *attr = NULL;
+	int len = sizeof(*rec);
+	int fd;
+	int rc = -1;
+
 	if (NULL == param)
 		return -1;
 
-	var_memdb_log_ok = 0;
-
-	int fd = -1;
-	char buf[MEMDB_LOG_MAX_LINE_SIZE] = {0};
-	int rc = -1;
-	int cnt = 0;
-	char cur_time[128] = {0};
-	struct node *node = NULL;
-	struct node_attr *attr = NULL;
+	if (log_replaying)
+		return 0;
 
-	if (DB_RMM == db_name) {
-		++memdb_log_rmm_number;
-	} else if (DB_POD == db_name) {
-		++memdb_log_pod_number;
-	} else {
+	if (DB_RMM != db_name && DB_POD != db_name) {
 		MEMDB_ERR("Unknown memdb name\n");
-		var_memdb_log_ok = 1;
 		return -1;
 	}
 
-	fd = open(file, O_RDWR | O_CREAT | O_APPEND, S_IRWXU);
-	if (fd < 0) {
-		var_memdb_log_ok = 1;
-		return -1;
-	}
+	var_memdb_log_ok = 0;
 
-	get_local_time(cur_time);
+	memset(rec, 0, sizeof(*rec));
+	rec->action = action;
 
 	switch (action) {
 	case MEMDB_LOG_CREATE_NODE:
 		node = (struct node *)param;
-		cnt = snprintf(buf, sizeof(buf), "%s %d %lld %lld %lld\n",
-					  cur_time, action, node->node_id, node->parent->node_id, node->type);
+		rec->node_id = node->node_id;
+		rec->parent = node->parent->node_id;
+		rec->type = node->type;
 		break;
 	case MEMDB_LOG_DESTROY_NODE:
 		node = (struct node *)param;
-		cnt = snprintf(buf, sizeof(buf), "%s %d %lld\n", cur_time, action, node->node_id);
+		rec->node_id = node->node_id;
 		break;
 	case MEMDB_LOG_SET_ATTR:
+	case MEMDB_LOG_REMOVE_ATTR:
 		attr = (struct node_attr *)param;
-		cnt = snprintf(buf, sizeof(buf), "%s %d %lld %lld %lld %lld %lld [name:]",
-					  cur_time, action, attr->node->node_id, attr->cookie,
-					  attr->type, attr->namelen, attr->datalen);
-		memcpy(buf + cnt, attr->name, attr->namelen);
-		cnt += attr->namelen;
-		strncpy_safe(buf + cnt, "[data:]", sizeof(buf) - cnt, 7);
-		cnt += 7;
-		memcpy(buf + cnt, attr->data, attr->datalen);
-		cnt += attr->datalen;
-
-		strncpy_safe(buf + cnt, "\n", sizeof(buf) - cnt, 1);
-		cnt += 1;
+		rec->node_id = attr->node->node_id;
+		rec->cookie = attr->cookie;
+		rec->type = attr->type;
+		rec->namelen = attr->namelen;
+		if (action == MEMDB_LOG_SET_ATTR)
+			rec->datalen = attr->datalen;
+		len += rec->namelen + rec->datalen;
+		if (len > sizeof(buf)) {
+			rec = malloc(len);
+			if (rec == NULL)
+				goto out;
+			memcpy(rec, buf, sizeof(*rec));
+		}
+		memcpy(rec->elems, attr->name, rec->namelen);
+		memcpy(rec->elems + rec->namelen, attr->data, rec->datalen);
+		break;
+	default:
+		MEMDB_ERR("memdb log Unknown action\n");
+		goto out;
+	}
+
+	rec->len = len;
+	rec->seq = ++log_seq[db_name];
+	rec->crc = memdb_crc32(0, (unsigned char *)rec + MEMDB_LOG_CRC_OFFSET,
+						   len - MEMDB_LOG_CRC_OFFSET);
+
+	fd = open_log(db_name);
+	if (fd < 0 || write(fd, rec, len) != len) {
+		MEMDB_ERR("write memdb log failed\n");
+		goto out;
+	}
+
+	if (DB_RMM == db_name)
+		++memdb_log_rmm_number;
+	else
+		++memdb_log_pod_number;
+	rc = 0;
+
+out:
+	if ((unsigned char *)rec != buf)
+		free(rec);
+	var_memdb_log_ok = 1;
+	return rc;
+}
+
+static void replay_record(memdb_integer db_name, struct memdb_log_rec *rec)
+{
+	struct node *node = NULL;
+	struct node *parent = NULL;
+	unsigned char *name = rec->elems;
+	unsigned char *data = rec->elems + rec->namelen;
 
+	switch (rec->action) {
+	case MEMDB_LOG_CREATE_NODE:
+		parent = find_node_by_node_id(db_name, rec->parent);
+		if (parent != NULL)
+			insert_node_with_node_id(db_name, parent, rec->node_id,
+									 rec->type, SNAPSHOT_NEED);
+		break;
+	case MEMDB_LOG_DESTROY_NODE:
+		node = find_node_by_node_id(db_name, rec->node_id);
+		if (node != NULL)
+			destroy_node(db_name, node);
+		break;
+	case MEMDB_LOG_SET_ATTR:
+		node = find_node_by_node_id(db_name, rec->node_id);
+		if (node != NULL)
+			set_node_attr(db_name, node, rec->cookie,
+						  name, rec->namelen, data, rec->datalen,
+						  SNAPSHOT_NEED, rec->type);
 		break;
 	case MEMDB_LOG_REMOVE_ATTR:
-		attr = (struct node_attr *)param;
-		cnt = snprintf(buf, sizeof(buf), "%s %d %lld %lld [name:]", cur_time, action, attr->node->node_id,
-					  attr->namelen);
-		memcpy(buf + cnt, attr->name, attr->namelen);
-		cnt += attr->namelen;
-
-		strncpy_safe(buf + cnt, "\n", sizeof(buf) - cnt, 1);
-		cnt += 1;
+		node = find_node_by_node_id(db_name, rec->node_id);
+		if (node != NULL)
+			remove_node_attr(db_name, node, name, rec->namelen);
 		break;
 	default:
-		MEMDB_ERR("memdb log Unknown action\n");
+		MEMDB_ERR("Unknown action\n");
 		break;
 	}
 
-	if (cnt <= 0)
-		goto err;
+	/* destroy and remove take effect here */
+	publish_subscription();
+}
 
-	rc = write(fd, buf, cnt);
-	if (rc <= 0)
+/**
+ * @brief: replay the records made after the image with sequence number
+ *         'image_seq'. The log is cut after the last valid record.
+ */
+int memdb_log_load(memdb_integer db_name, uint64 image_seq)
+{
+	struct memdb_log_rec *rec;
+	struct stat sb;
+	char path[128];
+	unsigned char *map = NULL;
+	size_t off = 0;
+	int fd;
+	int number = 0;
+
+	log_seq[db_name] = image_seq;
+
+	memdb_snap_path(path, sizeof(path), log_file[db_name]);
+	fd = open(path, O_RDWR);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &sb) < 0)
 		goto err;
 
+	if (sb.st_size > 0) {
+		/* writable, set_node_attr() terminates the name in place */
+		map = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+			goto err;
+	}
+
+	while (off + sizeof(*rec) <= (size_t)sb.st_size) {
+		rec = (struct memdb_log_rec *)(map + off);
+		if (rec->len < sizeof(*rec) || rec->len > (size_t)sb.st_size - off ||
+			rec->len != sizeof(*rec) + rec->namelen + rec->datalen ||
+			rec->crc != memdb_crc32(0, (unsigned char *)rec + MEMDB_LOG_CRC_OFFSET,
+									rec->len - MEMDB_LOG_CRC_OFFSET))
+			break;
+
+		if (rec->seq > image_seq) {
+			replay_record(db_name, rec);
+			log_seq[db_name] = rec->seq;
+			number++;
+		}
+		off += rec->len;
+	}
+
+	if (map != NULL)
+		munmap(map, sb.st_size);
+
+	if (off < (size_t)sb.st_size) {
+		MEMDB_ERR("memdb log %s: drop %ld bytes of torn record\n",
+				  path, (long)(sb.st_size - off));
+		if (ftruncate(fd, off) < 0)
+			MEMDB_ERR("truncate memdb log failed\n");
+	}
 	close(fd);
-	var_memdb_log_ok = 1;
+
+	if (DB_RMM == db_name)
+		memdb_log_rmm_number = number;
+	else
+		memdb_log_pod_number = number;
+
 	return 0;
 
 err:
 	close(fd);
-	var_memdb_log_ok = 1;
-
 	return -1;
 }
 
 /**
- * @brief: write the node and attributes read from the log file to the memdb.
+ * @brief: empty the log once its records are in the image.
  */
-int memdb_log_load(memdb_integer db_name, const char *file)
+void memdb_log_reset(memdb_integer db_name)
+{
+	char path[128];
+
+	if (log_fd[db_name] >= 0) {
+		close(log_fd[db_name]);
+		log_fd[db_name] = -1;
+	}
+
+	memdb_snap_path(path, sizeof(path), log_file[db_name]);
+	if (truncate(path, 0) < 0)
+		unlink(path);
+
+	if (DB_RMM == db_name)
+		memdb_log_rmm_number = 0;
+	else
+		memdb_log_pod_number = 0;
+}
+
+/**
+ * @brief: write the node and attributes read from the text log file of
+ *         previous releases to the memdb.
+ */
+int memdb_log_load_legacy(memdb_integer db_name, const char *file)
 {
 	FILE *fp = NULL;
 	int rc = -1;
@@ -202,8 +388,10 @@ int memdb_log_load(memdb_integer db_name, const char *file)
 	unsigned char data[256] = {0};
 	unsigned int data_len = 0;
 	char *search = NULL;
+	char path[128];
 
-	fp = fopen(file, "r");
+	memdb_snap_path(path, sizeof(path), file);
+	fp = fopen(path, "r");
 	if (NULL == fp)
 		return -1;
 
@@ -283,6 +471,9 @@ int memdb_log_load(memdb_integer db_name, const char *file)
 			MEMDB_ERR("Unknown action\n");
 			break;
 		}
+
+		/* destroy and remove take effect here */
+		publish_subscription();
 	}
 
 	fclose(fp);
@@ -23,18 +23,33 @@
 #define MEMDB_LOG_SET_ATTR		3
 #define MEMDB_LOG_REMOVE_ATTR	4
 
-#define MEMDB_LOG_RMM_FILE			"/var/memdb/memdb_rmm_update.log"
-#define MEMDB_LOG_POD_FILE			"/var/memdb/memdb_pod_update.log"
+/*
+ * Update log, appended with every change of a snapshot-flagged node or
+ * attribute and compacted into the snapshot image (snap.h). Records are
+ * binary and checksummed, a torn record at the end of the log is dropped
+ * when the log is loaded.
+ */
+#define MEMDB_LOG_RMM_FILE			"memdb_rmm.wal"
+#define MEMDB_LOG_POD_FILE			"memdb_pod.wal"
+
+/* text update logs of previous releases, only loaded when upgrading */
+#define MEMDB_LOG_RMM_LEGACY_FILE	"memdb_rmm_update.log"
+#define MEMDB_LOG_POD_LEGACY_FILE	"memdb_pod_update.log"
 
-#define MEMDB_LOG_MAX_NUMBER		20
+/* records after which the log is compacted into the image */
+#define MEMDB_LOG_MAX_NUMBER		4096
 
 extern int memdb_log_get_status(void);
 extern int memdb_log_get_rmm_number(void);
 extern int memdb_log_get_pod_number(void);
 extern void memdb_log_set_rmm_number(int var);
 extern void memdb_log_set_pod_number(int var);
-extern int memdb_log(memdb_integer db_name, const char *file,
-					 void *param, int action);
-extern int memdb_log_load(memdb_integer db_name, const char *file);
+extern uint64 memdb_log_get_seq(memdb_integer db_name);
+extern void memdb_log_set_replaying(bool replaying);
+extern int memdb_log(memdb_integer db_name, void *param, int action);
+extern int memdb_log_load(memdb_integer db_name, uint64 image_seq);
+extern int memdb_log_load_legacy(memdb_integer db_name, const char *file);
+extern void memdb_log_reset(memdb_integer db_name);
+extern uint32 memdb_crc32(uint32 crc, const void *buf, size_t len);
 
 #endif
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "memdb.h"
+#include "memdb_shm.h"
+#include "libmemdb/shm.h"
+
+/*
+ * Writer side of the shared attribute table described in libmemdb/shm.h.
+ * It is only called from memdbd main loop, so there is a single writer.
+ */
+
+static struct memdb_shm_hdr *shm;
+
+static inline void slot_write_begin(struct memdb_shm_slot *slot)
+{
+	slot->seq++;
+	__sync_synchronize();
+}
+
+static inline void slot_write_end(struct memdb_shm_slot *slot)
+{
+	__sync_synchronize();
+	slot->seq++;
+}
+
+static inline int slot_match(struct memdb_shm_slot *slot, memdb_integer db_name,
+							 memdb_integer node_id, const char *name)
+{
+	return slot->state == MEMDB_SHM_SLOT_USED &&
+		   slot->node_id == node_id && slot->db_name == db_name &&
+		   strcmp(slot->name, name) == 0;
+}
+
+/*
+ * Find the slot of the attribute, or a free slot for it if 'free_slot' is
+ * not NULL. Only the first MEMDB_SHM_MAX_PROBE slots from the hash are
+ * searched, readers do not look further either.
+ */
+static struct memdb_shm_slot *find_slot(memdb_integer db_name, memdb_integer node_id,
+										const char *name, struct memdb_shm_slot **free_slot)
+{
+	struct memdb_shm_slot *slot;
+	uint32 idx = memdb_shm_hash(db_name, node_id, name);
+	int i;
+
+	if (free_slot)
+		*free_slot = NULL;
+
+	for (i = 0; i < MEMDB_SHM_MAX_PROBE; i++, idx++) {
+		slot = &shm->slots[idx & (MEMDB_SHM_SLOT_NUM - 1)];
+
+		if (slot->state != MEMDB_SHM_SLOT_USED) {
+			if (free_slot && *free_slot == NULL)
+				*free_slot = slot;
+			if (slot->state == MEMDB_SHM_SLOT_EMPTY)
+				break;
+			continue;
+		}
+
+		if (slot_match(slot, db_name, node_id, name))
+			return slot;
+	}
+
+	return NULL;
+}
+
+int memdb_shm_init(void)
+{
+	struct memdb_shm_hdr *old;
+	int fd;
+
+	/* tell clients still mapping the segment of previous memdbd to drop it */
+	fd = shm_open(MEMDB_SHM_NAME, O_RDWR, 0);
+	if (fd >= 0) {
+		old = mmap(NULL, sizeof(*old), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (old != MAP_FAILED) {
+			old->valid = 0;
+			munmap(old, sizeof(*old));
+		}
+		close(fd);
+		shm_unlink(MEMDB_SHM_NAME);
+	}
+
+	fd = shm_open(MEMDB_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) {
+		MEMDB_ERR("Fail to create shared memory %s\n", MEMDB_SHM_NAME);
+		return -1;
+	}
+
+	if (ftruncate(fd, MEMDB_SHM_SIZE) < 0) {
+		MEMDB_ERR("Fail to resize shared memory %s\n", MEMDB_SHM_NAME);
+		goto err;
+	}
+
+	shm = mmap(NULL, MEMDB_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED) {
+		shm = NULL;
+		MEMDB_ERR("Fail to map shared memory %s\n", MEMDB_SHM_NAME);
+		goto err;
+	}
+	close(fd);
+
+	shm->magic = MEMDB_SHM_MAGIC;
+	shm->version = MEMDB_SHM_VERSION;
+	shm->slot_num = MEMDB_SHM_SLOT_NUM;
+	shm->locked = 0;
+	__sync_synchronize();
+	shm->valid = 1;
+
+	return 0;
+
+err:
+	close(fd);
+	shm_unlink(MEMDB_SHM_NAME);
+	return -1;
+}
+
+void memdb_shm_set_attr(memdb_integer db_name, struct node_attr *pa)
+{
+	struct memdb_shm_slot *slot, *free_slot;
+	memdb_integer node_id = pa->node->node_id;
+
+	if (shm == NULL)
+		return;
+
+	if (pa->namelen > MEMDB_SHM_NAME_LEN || pa->datalen > MEMDB_SHM_DATA_LEN ||
+		pa->data[pa->datalen - 1] != '\0') {
+		/* the value can not be published, readers have to ask memdbd */
+		memdb_shm_del_attr(db_name, pa->node, pa->name);
+		return;
+	}
+
+	slot = find_slot(db_name, node_id, pa->name, &free_slot);
+	if (slot == NULL) {
+		slot = free_slot;
+		if (slot == NULL)
+			return;		/* probe sequence is full, not published */
+
+		slot_write_begin(slot);
+		slot->state = MEMDB_SHM_SLOT_USED;
+		slot->db_name = db_name;
+		slot->node_id = node_id;
+		memcpy(slot->name, pa->name, pa->namelen);
+	} else {
+		slot_write_begin(slot);
+	}
+
+	slot->cookie = pa->cookie;
+	slot->datalen = pa->datalen;
+	memcpy(slot->data, pa->data, pa->datalen);
+	slot_write_end(slot);
+}
+
+void memdb_shm_del_attr(memdb_integer db_name, struct node *node, const char *name)
+{
+	struct memdb_shm_slot *slot;
+
+	if (shm == NULL)
+		return;
+
+	slot = find_slot(db_name, node->node_id, name, NULL);
+	if (slot == NULL)
+		return;
+
+	slot_write_begin(slot);
+	slot->state = MEMDB_SHM_SLOT_DELETED;
+	slot_write_end(slot);
+}
+
+void memdb_shm_del_node(memdb_integer db_name, struct node *root)
+{
+	struct node *n;
+	struct node_attr *pa;
+
+	if (shm == NULL)
+		return;
+
+	list_for_each_entry(pa, &root->attrs, group)
+		memdb_shm_del_attr(db_name, root, pa->name);
+
+	list_for_each_entry(n, &root->children, sibling)
+		memdb_shm_del_node(db_name, n);
+}
+
+void memdb_shm_set_locked(bool locked)
+{
+	if (shm == NULL)
+		return;
+
+	shm->locked = locked;
+	__sync_synchronize();
+}
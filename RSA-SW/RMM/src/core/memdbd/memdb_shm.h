@@ -0,0 +1,29 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __MEMDB_SHM_H_
+#define __MEMDB_SHM_H_
+
+#include "libutils/types.h"
+#include "libmemdb/node.h"
+
+extern int memdb_shm_init(void);
+extern void memdb_shm_set_attr(memdb_integer db_name, struct node_attr *pa);
+extern void memdb_shm_del_attr(memdb_integer db_name, struct node *node,
+							   const char *name);
+extern void memdb_shm_del_node(memdb_integer db_name, struct node *root);
+extern void memdb_shm_set_locked(bool locked);
+
+#endif
@@ -21,6 +21,7 @@
 #include "memdb.h"
 #include "snap.h"
 #include "memdb_log.h"
+#include "memdb_shm.h"
 #include "libutils/types.h"
 #include "libmemdb/event.h"
 #include "libmemdb/node.h"
@@ -43,6 +44,67 @@ struct list_head pod_attr_list = LIST_HEAD_INIT(pod_attr_list);
 
 static unsigned long g_node_number = 10000000;
 
+/*
+ * Indexes, so that requests do not walk the global lists:
+ *  - nodes hashed by node id, node ids are sequential so low bits are used;
+ *  - nodes listed by type, out of range types share the last list;
+ *  - attributes hashed by node and name, for both databases.
+ */
+#define NODE_HASH_SIZE		4096
+#define ATTR_HASH_SIZE		65536
+
+static struct list_head node_hash[DB_MAX][NODE_HASH_SIZE];
+static struct list_head node_type_list[DB_MAX][MC_TYPE_END + 1];
+static struct list_head attr_hash[ATTR_HASH_SIZE];
+
+static inline struct list_head *node_hash_bucket(memdb_integer db_name, memdb_integer node_id)
+{
+	return &node_hash[db_name][node_id & (NODE_HASH_SIZE - 1)];
+}
+
+static inline unsigned int attr_name_hash(const char *name)
+{
+	unsigned int h = 2166136261u;	/* FNV-1a */
+
+	while (*name) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static inline struct list_head *attr_hash_bucket(struct node *node, unsigned int name_hash)
+{
+	return &attr_hash[(name_hash ^ (unsigned int)node->node_id) & (ATTR_HASH_SIZE - 1)];
+}
+
+static void index_node(memdb_integer db_name, struct node *n)
+{
+	memdb_integer type = n->type;
+
+	if (type < MC_TYPE_RMC || type > MC_TYPE_END)
+		type = MC_TYPE_END;
+
+	list_add_tail(&n->hash, node_hash_bucket(db_name, n->node_id));
+	list_add_tail(&n->type_list, &node_type_list[db_name][type]);
+}
+
+static void unindex_node(struct node *n)
+{
+	list_del(&n->hash);
+	list_del(&n->type_list);
+}
+
+struct list_head *node_type_list_head(memdb_integer db_name, memdb_integer type)
+{
+	if (db_name < DB_RMM || db_name >= DB_MAX ||
+		type < MC_TYPE_RMC || type > MC_TYPE_END)
+		return NULL;
+
+	return &node_type_list[db_name][type];
+}
+
 struct node rmm_root = {
 	.node_id	= 0,
 	.type		= 0,
@@ -260,11 +322,13 @@ static void delete_node(memdb_integer db_name, struct node *root)
 
 		list_del(&pa->group);
 		list_del(&pa->list);
+		list_del(&pa->hash);
 		free(pa);
 	}
 
 	list_del(&root->list);
 	list_del(&root->sibling);
+	unindex_node(root);
 
 	node_delete_notify(db_name, root);
 
@@ -311,11 +375,13 @@ struct node *insert_node(memdb_integer db_name, struct node *parent, memdb_integ
 	if (DB_RMM == db_name) {
 		list_add_tail(&n->list, &node_list);
 		list_add_tail(&n->sibling, &parent->children);
+		index_node(db_name, n);
 
 		new_node = n;
 	} else if (DB_POD == db_name) {
 		list_add_tail(&n->list, &pod_node_list);
 		list_add_tail(&n->sibling, &parent->children);
+		index_node(db_name, n);
 
 		new_pod_node = n;
 	} else {
@@ -368,11 +434,13 @@ struct node *insert_node_with_node_id(memdb_integer db_name, struct node *parent
 	if (DB_RMM == db_name) {
 		list_add_tail(&n->list, &node_list);
 		list_add_tail(&n->sibling, &parent->children);
+		index_node(db_name, n);
 
 		new_node = n;
 	} else if (DB_POD == db_name) {
 		list_add_tail(&n->list, &pod_node_list);
 		list_add_tail(&n->sibling, &parent->children);
+		index_node(db_name, n);
 
 		new_pod_node = n;
 	} else {
@@ -386,6 +454,9 @@ struct node *insert_node_with_node_id(memdb_integer db_name, struct node *parent
 
 void destroy_node(memdb_integer db_name, struct node *root)
 {
+	/* the subtree is freed later, but must not be visible from now on */
+	memdb_shm_del_node(db_name, root);
+
 	if (DB_RMM == db_name)
 		freeing_node = root;
 	else if (DB_POD == db_name)
@@ -514,18 +585,13 @@ void dump_all_nodes(memdb_integer db_name)
 struct node *find_node_by_node_id(memdb_integer db_name, memdb_integer node_id)
 {
 	struct node *n;
-	struct list_head *node_list_search = NULL;
 
-	if (DB_RMM == db_name) {
-		node_list_search = &node_list;
-	} else if (DB_POD == db_name) {
-		node_list_search = &pod_node_list;
-	} else {
+	if (DB_RMM != db_name && DB_POD != db_name) {
 		MEMDB_ERR("No matched DB to find thd node\n");
 		return NULL;
 	}
 
-	list_for_each_entry(n, node_list_search, list) {
+	list_for_each_entry(n, node_hash_bucket(db_name, node_id), hash) {
 		if (n->node_id == node_id)
 			return n;
 	}
@@ -538,28 +604,74 @@ static inline struct node_attr *find_attr_item(struct node *node, char *name,
 		unsigned short namelen)
 {
 	struct node_attr *pa;
+	unsigned int name_hash = attr_name_hash(name);
 
-	list_for_each_entry(pa, &node->attrs, group) {
-		if (pa->namelen == namelen &&
-		    strcmp(pa->name, name) == 0)
+	list_for_each_entry(pa, attr_hash_bucket(node, name_hash), hash) {
+		if (pa->node == node && pa->name_hash == name_hash &&
+		    pa->namelen == namelen && strcmp(pa->name, name) == 0)
 			return pa;
 	}
 
 	return NULL;
 }
 
-static inline unsigned char *alloc_attr_data(struct node_attr *pa, int datalen)
+static inline unsigned char *alloc_attr_data(struct node_attr *pa, int datalen,
+											  struct attr_reserve *res)
 {
-	if (datalen > ATTR_DATA_BUFFSIZE)
-		return malloc(datalen);
-	else
+	unsigned char *data;
+
+	if (datalen <= ATTR_DATA_BUFFSIZE)
 		return pa->buf;
+	if (res == NULL)
+		return malloc(datalen);
+
+	data = res->data;
+	res->data = NULL;
+	return data;
+}
+
+int reserve_node_attr(struct attr_reserve *res, unsigned short namelen,
+					  unsigned short datalen)
+{
+	res->data = NULL;
+	res->pa = malloc(sizeof(*res->pa) + namelen);
+	if (res->pa == NULL)
+		return -1;
+
+	if (datalen > ATTR_DATA_BUFFSIZE) {
+		res->data = malloc(datalen);
+		if (res->data == NULL) {
+			free(res->pa);
+			res->pa = NULL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void release_node_attr(struct attr_reserve *res)
+{
+	free(res->pa);
+	free(res->data);
+	res->pa = NULL;
+	res->data = NULL;
 }
 
 int set_node_attr(memdb_integer db_name, struct node *node, memdb_integer cookie,
 				  unsigned char *name, unsigned short namelen,
 				  unsigned char *data, unsigned short datalen,
 				  memdb_integer snapshot_flag, memdb_integer type)
+{
+	return set_node_attr_reserved(db_name, node, cookie, name, namelen,
+								  data, datalen, snapshot_flag, type, NULL);
+}
+
+int set_node_attr_reserved(memdb_integer db_name, struct node *node, memdb_integer cookie,
+						   unsigned char *name, unsigned short namelen,
+						   unsigned char *data, unsigned short datalen,
+						   memdb_integer snapshot_flag, memdb_integer type,
+						   struct attr_reserve *res)
 {
 	struct node_attr *pa;
 
@@ -582,11 +694,15 @@ int set_node_attr(memdb_integer db_name, struct node *node, memdb_integer cookie
 
 	pa = find_attr_item(node, (char *)name, namelen);
 	if (pa == NULL) {
-		pa = malloc(sizeof(*pa) + namelen);
+		if (res != NULL) {
+			pa = res->pa;
+			res->pa = NULL;
+		} else
+			pa = malloc(sizeof(*pa) + namelen);
 		if (pa == NULL)
 			return -1;
 
-		pa->data = alloc_attr_data(pa, datalen);
+		pa->data = alloc_attr_data(pa, datalen, res);
 		if (pa->data == NULL) {
 			free(pa);
 			return -1;
@@ -600,14 +716,17 @@ int set_node_attr(memdb_integer db_name, struct node *node, memdb_integer cookie
 		pa->snapshot_flag = snapshot_flag;
 		pa->type = type;
 		memcpy(pa->name, name, namelen);
+		pa->name_hash = attr_name_hash(pa->name);
 		list_add_tail(&pa->group, &node->attrs);
 
 		if (DB_RMM == db_name) {
 			list_add_tail(&pa->list, &attr_list);
+			list_add_tail(&pa->hash, attr_hash_bucket(node, pa->name_hash));
 
 			curr_attr_action = EVENT_ATTR_ACTION_ADD;
 		} else if (DB_POD == db_name) {
 			list_add_tail(&pa->list, &pod_attr_list);
+			list_add_tail(&pa->hash, attr_hash_bucket(node, pa->name_hash));
 
 			curr_pod_attr_action = EVENT_ATTR_ACTION_ADD;
 		} else {
@@ -619,7 +738,7 @@ int set_node_attr(memdb_integer db_name, struct node *node, memdb_integer cookie
 	if (datalen != pa->datalen) {
 		unsigned char *cp;
 
-		cp = alloc_attr_data(pa, datalen);
+		cp = alloc_attr_data(pa, datalen, res);
 		if (cp == NULL)
 			return -1;
 
@@ -632,6 +751,7 @@ int set_node_attr(memdb_integer db_name, struct node *node, memdb_integer cookie
 
 	pa->cookie = cookie;
 	memcpy(pa->data, data, datalen);
+	memdb_shm_set_attr(db_name, pa);
 
 	if (DB_RMM == db_name)
 		curr_attr = pa;
@@ -644,6 +764,123 @@ int set_node_attr(memdb_integer db_name, struct node *node, memdb_integer cookie
 	return 0;
 }
 
+/**
+ * @brief: Add a node of the memdb image, see memdb_image_load(). The memdb
+ *         is empty and every image node needs snapshot, so there is no
+ *         lookup for an existing node, no event and no snapshot mask walk.
+ */
+struct node *load_image_node(memdb_integer db_name, struct node *parent,
+							 memdb_integer node_id, memdb_integer type,
+							 const struct timespec *now)
+{
+	struct node *n;
+
+	n = (struct node *)malloc(sizeof(struct node));
+	if (n == NULL) {
+		rmm_log(ERROR, "malloc failed\n");
+		return NULL;
+	}
+
+	n->create_time = *now;
+	n->modify_time = *now;
+	n->node_id = node_id;
+	g_node_number = (g_node_number > node_id ? g_node_number : (node_id + 1));
+	n->type = type;
+	n->parent = parent;
+	n->snapshot_flag = SNAPSHOT_NEED;
+
+	INIT_LIST_HEAD(&n->attrs);
+	INIT_LIST_HEAD(&n->children);
+
+	list_add_tail(&n->list, DB_RMM == db_name ? &node_list : &pod_node_list);
+	list_add_tail(&n->sibling, &parent->children);
+	index_node(db_name, n);
+
+	return n;
+}
+
+/**
+ * @brief: Add an attribute of the memdb image, the node has none of that
+ *         name yet. 'name' and 'data' are copied, the image is read-only.
+ */
+int load_image_attr(memdb_integer db_name, struct node *node, memdb_integer cookie,
+					const unsigned char *name, unsigned short namelen,
+					const unsigned char *data, unsigned short datalen,
+					memdb_integer type)
+{
+	struct node_attr *pa;
+
+	if (namelen == 0 || datalen == 0)
+		return -1;
+
+	pa = malloc(sizeof(*pa) + namelen);
+	if (pa == NULL)
+		return -1;
+
+	pa->data = alloc_attr_data(pa, datalen, NULL);
+	if (pa->data == NULL) {
+		free(pa);
+		return -1;
+	}
+
+	pa->node = node;
+	pa->cookie = cookie;
+	pa->namelen = namelen;
+	pa->datalen = datalen;
+	pa->snapshot_flag = SNAPSHOT_NEED;
+	pa->type = type;
+	memcpy(pa->name, name, namelen);
+	pa->name[namelen - 1] = '\0';
+	pa->name_hash = attr_name_hash(pa->name);
+	memcpy(pa->data, data, datalen);
+
+	list_add_tail(&pa->group, &node->attrs);
+	list_add_tail(&pa->list, DB_RMM == db_name ? &attr_list : &pod_attr_list);
+	list_add_tail(&pa->hash, attr_hash_bucket(node, pa->name_hash));
+	memdb_shm_set_attr(db_name, pa);
+
+	return 0;
+}
+
+static void free_image_node(struct node *node, int is_root)
+{
+	struct node *p, *n;
+	struct node_attr *pa, *na;
+
+	list_for_each_entry_safe(p, n, &node->children, sibling)
+		free_image_node(p, 0);
+
+	list_for_each_entry_safe(pa, na, &node->attrs, group) {
+		if (pa->datalen > ATTR_DATA_BUFFSIZE)
+			free(pa->data);
+		list_del(&pa->group);
+		list_del(&pa->list);
+		list_del(&pa->hash);
+		free(pa);
+	}
+
+	if (is_root)
+		return;
+
+	list_del(&node->list);
+	list_del(&node->sibling);
+	unindex_node(node);
+	free(node);
+}
+
+/**
+ * @brief: Drop what memdb_image_load() linked in before it failed, so
+ *         the memdb is empty again for the legacy files. Nothing was
+ *         published yet, so there is no event.
+ */
+void unload_image(memdb_integer db_name)
+{
+	struct node *root = DB_RMM == db_name ? &rmm_root : &pod_root;
+
+	memdb_shm_del_node(db_name, root);
+	free_image_node(root, 1);
+}
+
 int get_node_attr(struct node *node, unsigned char *name,
 				unsigned short namelen, memdb_integer *cookie,
 				char **data_ptr)
@@ -671,6 +908,7 @@ static void del_node_attr(struct node_attr *pa)
 
 	list_del(&pa->group);
 	list_del(&pa->list);
+	list_del(&pa->hash);
 	free(pa);
 }
 
@@ -679,35 +917,71 @@ int remove_node_attr(memdb_integer db_name, struct node *node, unsigned char *na
 {
 	struct node_attr *pa;
 
-	list_for_each_entry(pa, &node->attrs, group) {
-		if (pa->namelen != namelen || strcmp(pa->name, (char *)name) != 0)
-			continue;
+	pa = find_attr_item(node, (char *)name, namelen);
+	if (pa == NULL)
+		return 0;
 
-		clock_gettime(CLOCK_MONOTONIC, &(node->create_time));
+	clock_gettime(CLOCK_MONOTONIC, &(node->create_time));
+	memdb_shm_del_attr(db_name, node, pa->name);
 
-		if (DB_RMM == db_name) {
-			curr_attr = pa;
-			curr_attr_action = EVENT_ATTR_ACTION_DEL;
-		} else if (DB_POD == db_name) {
-			curr_pod_attr = pa;
-			curr_pod_attr_action = EVENT_ATTR_ACTION_DEL;
-		} else
-			return 0;
+	if (DB_RMM == db_name) {
+		curr_attr = pa;
+		curr_attr_action = EVENT_ATTR_ACTION_DEL;
+	} else if (DB_POD == db_name) {
+		curr_pod_attr = pa;
+		curr_pod_attr_action = EVENT_ATTR_ACTION_DEL;
+	} else
+		return 0;
 
-		return 1;
+	return 1;
+}
+
+/* Notify and log the attribute set or removed by the last call, see set_node_attr. */
+void publish_attr_change(void)
+{
+	bool snap_need = false;
+
+	if (curr_attr != NULL) {
+		node_attr_notify(DB_RMM, curr_attr, curr_attr_action);
+
+		if (curr_attr_action == EVENT_ATTR_ACTION_DEL) {
+			if (SNAPSHOT_NEED == curr_attr->snapshot_flag) {
+				memdb_log(DB_RMM, curr_attr, MEMDB_LOG_REMOVE_ATTR);
+			}
+			del_node_attr(curr_attr);
+		} else if (SNAPSHOT_NEED == curr_attr->snapshot_flag) {
+			memdb_log(DB_RMM, curr_attr, MEMDB_LOG_SET_ATTR);
+		}
+
+		curr_attr = NULL;
+		curr_attr_action = 0;
 	}
 
-	return 0;
+	if (curr_pod_attr != NULL) {
+		if (SNAPSHOT_NEED == curr_pod_attr->snapshot_flag)
+			snap_need = true;
+
+		node_attr_notify(DB_POD, curr_pod_attr, curr_pod_attr_action);
+
+		if (curr_pod_attr_action == EVENT_ATTR_ACTION_DEL) {
+			if (snap_need) {
+				memdb_log(DB_POD, curr_pod_attr, MEMDB_LOG_REMOVE_ATTR);
+			}
+			del_node_attr(curr_pod_attr);
+		} else if (snap_need) {
+			memdb_log(DB_POD, curr_pod_attr, MEMDB_LOG_SET_ATTR);
+		}
+
+		curr_pod_attr = NULL;
+		curr_pod_attr_action = 0;
+	}
 }
 
 void publish_subscription(void)
 {
-	bool snap_need = false;
-
 	if (new_node != NULL) {
 		if (SNAPSHOT_NEED == new_node->snapshot_flag) {
-			memdb_log(DB_RMM, MEMDB_LOG_RMM_FILE, new_node,
-					  MEMDB_LOG_CREATE_NODE);
+			memdb_log(DB_RMM, new_node, MEMDB_LOG_CREATE_NODE);
 		}
 
 		node_create_notify(DB_RMM, new_node);
@@ -717,8 +991,7 @@ void publish_subscription(void)
 
 	if (new_pod_node != NULL) {
 		if (SNAPSHOT_NEED == new_pod_node->snapshot_flag) {
-			memdb_log(DB_POD, MEMDB_LOG_POD_FILE, new_pod_node,
-					  MEMDB_LOG_CREATE_NODE);
+			memdb_log(DB_POD, new_pod_node, MEMDB_LOG_CREATE_NODE);
 		}
 
 		node_create_notify(DB_POD, new_pod_node);
@@ -728,8 +1001,7 @@ void publish_subscription(void)
 
 	if (freeing_node != NULL) {
 		if (SNAPSHOT_NEED == freeing_node->snapshot_flag) {
-			memdb_log(DB_RMM, MEMDB_LOG_RMM_FILE, freeing_node,
-					  MEMDB_LOG_DESTROY_NODE);
+			memdb_log(DB_RMM, freeing_node, MEMDB_LOG_DESTROY_NODE);
 		}
 
 		delete_node(DB_RMM, freeing_node);
@@ -738,72 +1010,41 @@ void publish_subscription(void)
 
 	if (freeing_pod_node != NULL) {
 		if (SNAPSHOT_NEED == freeing_pod_node->snapshot_flag) {
-			memdb_log(DB_POD, MEMDB_LOG_POD_FILE, freeing_pod_node,
-					  MEMDB_LOG_DESTROY_NODE);
+			memdb_log(DB_POD, freeing_pod_node, MEMDB_LOG_DESTROY_NODE);
 		}
 
 		delete_node(DB_POD, freeing_pod_node);
 		freeing_pod_node = NULL;
 	}
 
-	if (curr_attr != NULL) {
-		node_attr_notify(DB_RMM, curr_attr, curr_attr_action);
-
-		if (curr_attr_action == EVENT_ATTR_ACTION_DEL) {
-			if (SNAPSHOT_NEED == curr_attr->snapshot_flag) {
-				memdb_log(DB_RMM, MEMDB_LOG_RMM_FILE, curr_attr,
-						  MEMDB_LOG_REMOVE_ATTR);
-			}
-			del_node_attr(curr_attr);
-		} else if (SNAPSHOT_NEED == curr_attr->snapshot_flag) {
-			memdb_log(DB_RMM, MEMDB_LOG_RMM_FILE, curr_attr,
-					  MEMDB_LOG_SET_ATTR);
-		}
-
-		curr_attr = NULL;
-		curr_attr_action = 0;
-	}
-
-	if (curr_pod_attr != NULL) {
-		if (SNAPSHOT_NEED == curr_pod_attr->snapshot_flag)
-			snap_need = true;
+	publish_attr_change();
 
-		node_attr_notify(DB_POD, curr_pod_attr, curr_pod_attr_action);
+	if (MEMDB_LOG_MAX_NUMBER <= memdb_log_get_rmm_number())
+		memdb_snap_compact(DB_RMM);
 
-		if (curr_pod_attr_action == EVENT_ATTR_ACTION_DEL) {
-			del_node_attr(curr_pod_attr);
-			if (snap_need) {
-				memdb_log(DB_POD, MEMDB_LOG_POD_FILE,
-						  curr_pod_attr, MEMDB_LOG_REMOVE_ATTR);
-			}
-		} else if (snap_need) {
-			memdb_log(DB_POD, MEMDB_LOG_POD_FILE,
-					  curr_pod_attr, MEMDB_LOG_SET_ATTR);
-		}
-
-		curr_pod_attr = NULL;
-		curr_pod_attr_action = 0;
-	}
-
-	if (MEMDB_LOG_MAX_NUMBER <= memdb_log_get_rmm_number()) {
-		memdb_node_snap(FILE_SNAP, DB_RMM);
-		unlink(MEMDB_LOG_RMM_FILE);
-		memdb_log_set_rmm_number(0);
-	}
-
-	if (MEMDB_LOG_MAX_NUMBER <= memdb_log_get_pod_number()) {
-		memdb_node_snap(FILE_POD_SNAP, DB_POD);
-		unlink(MEMDB_LOG_POD_FILE);
-		memdb_log_set_pod_number(0);
-	}
+	if (MEMDB_LOG_MAX_NUMBER <= memdb_log_get_pod_number())
+		memdb_snap_compact(DB_POD);
 }
 
 void int_node_module(void)
 {
+	int i, j;
+
 	clock_gettime(CLOCK_MONOTONIC, &(rmm_root.create_time));
 	clock_gettime(CLOCK_MONOTONIC, &(pod_root.create_time));
 
+	for (i = 0; i < DB_MAX; i++) {
+		for (j = 0; j < NODE_HASH_SIZE; j++)
+			INIT_LIST_HEAD(&node_hash[i][j]);
+		for (j = 0; j <= MC_TYPE_END; j++)
+			INIT_LIST_HEAD(&node_type_list[i][j]);
+	}
+	for (j = 0; j < ATTR_HASH_SIZE; j++)
+		INIT_LIST_HEAD(&attr_hash[j]);
+
 	list_add_tail(&rmm_root.list, &node_list);
 	list_add_tail(&pod_root.list, &pod_node_list);
+	index_node(DB_RMM, &rmm_root);
+	index_node(DB_POD, &pod_root);
 }
 
@@ -20,9 +20,9 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/socket.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <errno.h>
-#include <netinet/in.h>
 
 #include "libmemdb/node.h"
 #include "libmemdb/command.h"
@@ -33,155 +33,382 @@
 
 bool snapshot_in_progress = false;
 
-#define MAX_WRITE_SIZE	256
-#define MAX_READ_SIZE	MAX_WRITE_SIZE
 #define MAX_ATTR_SIZE	1024
 
-#define NODE_ATTR_HEAD_LEN	(sizeof(struct list_head) + \
-							 sizeof(struct list_head) + \
-							 sizeof(struct node *))
-
 #define PARAM_ATTR_LEN	(sizeof(struct node_info) + \
 						 sizeof(unsigned char))
 
+/*
+ * The memdb image is written to a temporary file which is renamed over
+ * the previous image when complete, so there is always one whole image.
+ * Changes made after the image are in the log file, see memdb_log.c.
+ *
+ * Layout: header, then for every node a node record followed by its
+ * attribute records. Parents come before their children.
+ */
+#define MEMDB_IMAGE_MAGIC		0x4d444249	/* "MDBI" */
+#define MEMDB_IMAGE_VERSION		1
+
+struct memdb_image_hdr {
+	uint32 magic;
+	uint32 version;
+	uint32 db_name;
+	uint32 crc;					/* of everything after the header */
+	uint64 seq;					/* last log record in the image */
+	uint64 size;				/* bytes after the header */
+	uint32 node_num;
+	uint32 attr_num;
+};
+
+struct memdb_image_node {
+	memdb_integer node_id;
+	memdb_integer parent;
+	memdb_integer type;
+	uint32 attr_num;
+	uint32 reserved;
+};
+
+struct memdb_image_attr {
+	memdb_integer cookie;
+	memdb_integer type;
+	uint32 namelen;
+	uint32 datalen;
+	unsigned char elems[0];		/* name, data, padded to 8 bytes */
+};
+
+#define IMAGE_ATTR_LEN(namelen, datalen)	\
+	((sizeof(struct memdb_image_attr) + (namelen) + (datalen) + 7) & ~7)
+
+static char snap_dir[96] = DIR_FOR_SNAP;
+
+static const char *image_file[DB_MAX] = {
+	FILE_IMAGE,
+	FILE_POD_IMAGE
+};
+
+static const char *legacy_snap_file[DB_MAX] = {
+	FILE_SNAP,
+	FILE_POD_SNAP
+};
+
+static const char *legacy_log_file[DB_MAX] = {
+	MEMDB_LOG_RMM_LEGACY_FILE,
+	MEMDB_LOG_POD_LEGACY_FILE
+};
+
+void memdb_snap_set_dir(const char *dir)
+{
+	snprintf(snap_dir, sizeof(snap_dir), "%s", dir);
+}
+
+void memdb_snap_path(char *path, int len, const char *file)
+{
+	snprintf(path, len, "%s%s", snap_dir, file);
+}
+
+static void make_snap_dir(void)
+{
+	struct stat sb;
+
+	if (stat(snap_dir, &sb) == -1) {
+		if (errno == ENOENT)
+			mkdir(snap_dir, 0777);
+	}
+}
+
+static int write_image_data(FILE *fp, const void *data, size_t len, uint32 *crc)
+{
+	if (fwrite(data, 1, len, fp) != len)
+		return -1;
+
+	*crc = memdb_crc32(*crc, data, len);
+	return 0;
+}
+
 /**
- *@brief:  Store the memdb for snapshoting.
+ * @brief: Write the memdb image, including the changes up to log record 'seq'.
  */
-int memdb_node_snap(char *filename, unsigned char db_name)
+int memdb_image_write(unsigned char db_name, uint64 seq)
 {
+	static const unsigned char pad[8] = {0};
+	struct memdb_image_hdr hdr = {0};
+	struct memdb_image_node inode;
+	struct memdb_image_attr iattr;
+	struct list_head *which_node = &node_list;
 	struct node *node = NULL;
 	struct node_attr *attr = NULL;
-	int cnt = -1;
-	unsigned char buf[PARAM_ATTR_LEN] = {0};
+	char path[128] = {0};
+	char tmp_path[128 + 5] = {0};
+	FILE *fp = NULL;
 	int fd = -1;
-	unsigned char attr_cnt = 0;
-	unsigned char *attr_data = NULL;
-	int buf_rest_size = 0;
-	int buf_assigned_size = 0;
-	struct node_info nodeinfo = {0};
-	struct list_head *which_node = &node_list;
-	int offset = 0;
-	char full_filename[128] = {0};
-	struct stat sb;
+	int len;
 
-	snapshot_in_progress = true;
 	if (DB_POD == db_name)
 		which_node = &pod_node_list;
 
-	if (stat(DIR_FOR_SNAP, &sb) == -1) {
-		if (errno == ENOENT)
-			mkdir(DIR_FOR_SNAP, 0777);
-	}
-
-	snprintf(full_filename, sizeof(full_filename), "%s%s", DIR_FOR_SNAP, filename);
+	make_snap_dir();
+	memdb_snap_path(path, sizeof(path), image_file[db_name]);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
 
-	fd = open(full_filename, O_RDWR | O_CREAT, S_IRWXU);
-	if (fd == -1) {
-		perror("open");
-		MEMDB_ERR("open file failed\n");
+	fp = fopen(tmp_path, "w");
+	if (NULL == fp) {
+		MEMDB_ERR("open memdb image failed\n");
 		return -1;
 	}
 
+	snapshot_in_progress = true;
+
+	/* the header is rewritten when the image is complete */
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		goto err;
+
 	list_for_each_entry(node, which_node, list) {
 		if ((node->parent == NULL) && (node->node_id != 0))
 			continue;
 
-		if (node->node_id != 0)
-			nodeinfo.parent = (node->parent)->node_id;
-		else
-			nodeinfo.parent = 0;
-
-		nodeinfo.node_id = node->node_id;
-		nodeinfo.snapshot_flag = node->snapshot_flag;
-		nodeinfo.type = node->type;
-
 		if (SNAPSHOT_NEED_NOT == node->snapshot_flag)
 			continue;
 
-		memset(buf, 0, PARAM_ATTR_LEN);
-		memcpy(buf, &nodeinfo, sizeof(struct node_info));
+		memset(&inode, 0, sizeof(inode));
+		inode.node_id = node->node_id;
+		inode.parent = node->node_id != 0 ? node->parent->node_id : 0;
+		inode.type = node->type;
+		list_for_each_entry(attr, &node->attrs, group) {
+			if (attr->snapshot_flag != SNAPSHOT_NEED_NOT)
+				inode.attr_num++;
+		}
 
-		attr_cnt = 0;
-		offset = 0;
-		buf_rest_size = 0;
-		buf_assigned_size = 0;
+		if (write_image_data(fp, &inode, sizeof(inode), &hdr.crc) != 0)
+			goto err;
+		hdr.size += sizeof(inode);
+		hdr.node_num++;
 
 		list_for_each_entry(attr, &node->attrs, group) {
 			if (attr->snapshot_flag == SNAPSHOT_NEED_NOT)
 				continue;
 
-			if (attr->node == node) {
-				attr_cnt++;
+			iattr.cookie = attr->cookie;
+			iattr.type = attr->type;
+			iattr.namelen = attr->namelen;
+			iattr.datalen = attr->datalen;
+			len = IMAGE_ATTR_LEN(attr->namelen, attr->datalen);
+
+			if (write_image_data(fp, &iattr, sizeof(iattr), &hdr.crc) != 0 ||
+				write_image_data(fp, attr->name, attr->namelen, &hdr.crc) != 0 ||
+				write_image_data(fp, attr->data, attr->datalen, &hdr.crc) != 0 ||
+				write_image_data(fp, pad, len - sizeof(iattr) - attr->namelen - attr->datalen,
+								 &hdr.crc) != 0)
+				goto err;
+			hdr.size += len;
+			hdr.attr_num++;
+		}
+	}
 
-				if (buf_rest_size < (sizeof(struct node_attr_param)
-								 + attr->namelen + attr->datalen)) {
-					attr_data = (unsigned char *)realloc(attr_data, buf_assigned_size + MAX_ATTR_SIZE);
-					if (NULL == attr_data) {
-						MEMDB_ERR("malloc failed\n");
-						goto err;
-					}
-					buf_rest_size += MAX_ATTR_SIZE;
-					buf_assigned_size += MAX_ATTR_SIZE;
-				}
+	hdr.magic = MEMDB_IMAGE_MAGIC;
+	hdr.version = MEMDB_IMAGE_VERSION;
+	hdr.db_name = db_name;
+	hdr.seq = seq;
 
-				memcpy(attr_data + offset, (char *)attr + NODE_ATTR_HEAD_LEN,
-					   sizeof(struct node_attr_param));
-				offset += sizeof(struct node_attr_param);
+	rewind(fp);
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fflush(fp) != 0 ||
+		fsync(fileno(fp)) != 0)
+		goto err;
 
-				memcpy(attr_data + offset, attr->name, attr->namelen);
-				offset += attr->namelen;
+	fclose(fp);
+	fp = NULL;
 
-				memcpy(attr_data + offset, attr->data, attr->datalen);
-				offset += attr->datalen;
+	if (rename(tmp_path, path) != 0)
+		goto err;
 
-				buf_rest_size -= (sizeof(struct node_attr_param)
-								  + attr->namelen + attr->datalen);
-			}
-		}
+	/* make the rename durable */
+	fd = open(snap_dir, O_RDONLY);
+	if (fd >= 0) {
+		fsync(fd);
+		close(fd);
+	}
 
-		memcpy(buf + sizeof(struct node_info), (unsigned char *)&attr_cnt,
-			   sizeof(unsigned char));
+	snapshot_in_progress = false;
+	return 0;
 
-		cnt = write(fd, buf, PARAM_ATTR_LEN);
-		if (cnt != PARAM_ATTR_LEN) {
-			MEMDB_ERR("write node info failed\n");
-			goto err;
+err:
+	MEMDB_ERR("write memdb image failed\n");
+	if (NULL != fp)
+		fclose(fp);
+	unlink(tmp_path);
+	snapshot_in_progress = false;
+	return -1;
+}
+
+/**
+ * @brief: Load the memdb image, 'seq' is set to the last log record in it.
+ *         The memdb must be empty. Nodes and attributes are linked in
+ *         directly from the mapped image, see load_image_node().
+ */
+int memdb_image_load(unsigned char db_name, uint64 *seq)
+{
+	struct memdb_image_hdr *hdr = NULL;
+	struct memdb_image_node *inode = NULL;
+	struct memdb_image_attr *iattr = NULL;
+	struct node *parent = NULL;
+	struct node *n = NULL;
+	unsigned char *map = NULL;
+	unsigned char *end = NULL;
+	unsigned char *p = NULL;
+	char path[128] = {0};
+	char bad_path[128 + 5] = {0};
+	struct timespec now;
+	struct stat sb;
+	uint32 i;
+	int fd = -1;
+	int rc = -1;
+
+	memdb_snap_path(path, sizeof(path), image_file[db_name]);
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return -1;
+
+	if (fstat(fd, &sb) != 0 || sb.st_size < sizeof(*hdr))
+		goto bad;
+
+	map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		map = NULL;
+		goto bad;
+	}
+
+	hdr = (struct memdb_image_hdr *)map;
+	if (hdr->magic != MEMDB_IMAGE_MAGIC || hdr->version != MEMDB_IMAGE_VERSION ||
+		hdr->db_name != db_name || hdr->size != sb.st_size - sizeof(*hdr) ||
+		hdr->crc != memdb_crc32(0, map + sizeof(*hdr), hdr->size))
+		goto bad;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	p = map + sizeof(*hdr);
+	end = map + sb.st_size;
+	while (p + sizeof(*inode) <= end) {
+		inode = (struct memdb_image_node *)p;
+		p += sizeof(*inode);
+
+		/* siblings usually follow each other, skip the lookup for them */
+		if (NULL == parent || parent->node_id != inode->parent)
+			parent = find_node_by_node_id(db_name, inode->parent);
+		if (NULL == parent) {
+			MEMDB_ERR("memdb image: no parent for node %lld\n", inode->node_id);
+			goto out;
 		}
 
-		if (attr_cnt > 0) {
-			cnt = write(fd, attr_data, offset);
-			if (cnt != offset) {
-				MEMDB_ERR("write node attr failed\n");
-				goto err;
-			}
+		/* the root is its own parent and already exists */
+		if (inode->node_id == inode->parent) {
+			n = parent;
+			n->snapshot_flag = SNAPSHOT_NEED;
+		} else {
+			n = load_image_node(db_name, parent, inode->node_id, inode->type, &now);
+			if (NULL == n)
+				goto out;
 		}
 
-		if (NULL != attr_data) {
-			free(attr_data);
-			attr_data = NULL;
+		for (i = 0; i < inode->attr_num; i++) {
+			iattr = (struct memdb_image_attr *)p;
+			if (p + sizeof(*iattr) > end ||
+				p + IMAGE_ATTR_LEN(iattr->namelen, iattr->datalen) > end)
+				goto out;
+
+			if (load_image_attr(db_name, n, iattr->cookie,
+								iattr->elems, iattr->namelen,
+								iattr->elems + iattr->namelen, iattr->datalen,
+								iattr->type) != 0)
+				goto out;
+			p += IMAGE_ATTR_LEN(iattr->namelen, iattr->datalen);
 		}
 	}
 
+	*seq = hdr->seq;
+	rc = 0;
+
+out:
+	if (rc != 0) {
+		/* the caller falls back to the legacy files on an empty memdb */
+		MEMDB_ERR("memdb image %s can not be loaded\n", path);
+		unload_image(db_name);
+	}
+	munmap(map, sb.st_size);
+	close(fd);
+	return rc;
+
+bad:
+	/* keep it for inspection, it is replaced by the next image */
+	MEMDB_ERR("memdb image %s is corrupted\n", path);
+	snprintf(bad_path, sizeof(bad_path), "%s.bad", path);
+	rename(path, bad_path);
+	if (NULL != map)
+		munmap(map, sb.st_size);
 	close(fd);
+	return -1;
+}
 
-	snapshot_in_progress = false;
+/**
+ * @brief: Load the memdb from the image and the log written after it.
+ *         Files of previous releases are converted to an image.
+ */
+int memdb_snap_load(unsigned char db_name)
+{
+	char path[128] = {0};
+	uint64 seq = 0;
+	bool legacy = false;
+
+	make_snap_dir();
+	memdb_log_set_replaying(true);
+
+	if (memdb_image_load(db_name, &seq) != 0) {
+		seq = 0;
+		if (NULL != memdb_node_load(legacy_snap_file[db_name], db_name))
+			legacy = true;
+		if (0 == memdb_log_load_legacy(db_name, legacy_log_file[db_name]))
+			legacy = true;
+	}
 
-	return cnt;
+	memdb_log_load(db_name, seq);
 
-err:
-	if (NULL != attr_data) {
-		free(attr_data);
-		attr_data = NULL;
+	/* clear pending status before changes are logged again */
+	publish_subscription();
+	memdb_log_set_replaying(false);
+
+	if (legacy && 0 == memdb_snap_compact(db_name)) {
+		memdb_snap_path(path, sizeof(path), legacy_snap_file[db_name]);
+		unlink(path);
+		memdb_snap_path(path, sizeof(path), legacy_log_file[db_name]);
+		unlink(path);
 	}
 
-	close(fd);
-	return -1;
+	return 0;
+}
+
+/**
+ * @brief: Write a new image and empty the log.
+ */
+int memdb_snap_compact(unsigned char db_name)
+{
+	int rc;
+
+	rc = memdb_image_write(db_name, memdb_log_get_seq(db_name));
+	if (0 == rc) {
+		memdb_log_reset(db_name);
+	} else if (DB_RMM == db_name) {
+		/* retry after the next batch of records */
+		memdb_log_set_rmm_number(0);
+	} else {
+		memdb_log_set_pod_number(0);
+	}
+
+	return rc;
 }
 
 /**
- * @brief: Load the snapshot file to the memdb.
+ * @brief: Load the snapshot file of previous releases to the memdb.
  */
-struct node *memdb_node_load(char *filename, unsigned char db_name)
+struct node *memdb_node_load(const char *filename, unsigned char db_name)
 {
 	int cnt = -1;
 	int fd = -1;
@@ -195,11 +422,8 @@ struct node *memdb_node_load(char *filename, unsigned char db_name)
 	int i = 0;
 	struct node *parent = NULL;
 	char full_filename[128] = {0};
-	char new_filename[128] = {0};
 
-	if (chdir(DIR_FOR_SNAP) == 0) {
-		snprintf(full_filename, sizeof(full_filename), "%s%s", DIR_FOR_SNAP, filename);
-	}
+	memdb_snap_path(full_filename, sizeof(full_filename), filename);
 
 	fd = open(full_filename, O_RDONLY);
 	if (fd == -1) {
@@ -249,7 +473,7 @@ struct node *memdb_node_load(char *filename, unsigned char db_name)
 
 				cnt = read(fd, data, attr->datalen + attr->namelen);
 				if (cnt == (attr->datalen + attr->namelen)) {
-					if (set_node_attr(DB_RMM, n, attr->cookie,
+					if (set_node_attr(db_name, n, attr->cookie,
 									  data, attr->namelen,
 									  data + attr->namelen, attr->datalen,
 									  SNAPSHOT_NEED, attr->type) != 0) {
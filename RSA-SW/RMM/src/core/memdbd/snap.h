@@ -16,12 +16,32 @@
 #ifndef _SNAP_H_
 #define _SNAP_H_
 
+#include "libutils/types.h"
+
 #define DIR_FOR_SNAP	"/var/memdb/"
+
+/*
+ * Snapshot image, all snapshot-flagged nodes and attributes as fixed
+ * size binary records behind a checksummed header. It is written to a
+ * temporary file and renamed, so a crash leaves the previous image.
+ * Changes made after the image are in the update log (memdb_log.h).
+ */
+#define FILE_IMAGE		"memdb_rmm.image"
+#define FILE_POD_IMAGE	"memdb_pod.image"
+
+/* snapshots of previous releases, only loaded when upgrading */
 #define FILE_SNAP		"memdb_upgrade.snapshot"
 #define FILE_POD_SNAP	"memdb_pod_upgrade.snapshot"
 
-int memdb_node_snap(char *filename, unsigned char db_name);
+void memdb_snap_set_dir(const char *dir);
+void memdb_snap_path(char *path, int len, const char *file);
+
+int memdb_snap_load(unsigned char db_name);
+int memdb_snap_compact(unsigned char db_name);
+
+int memdb_image_write(unsigned char db_name, uint64 seq);
+int memdb_image_load(unsigned char db_name, uint64 *seq);
 
-struct node *memdb_node_load(char *filename, unsigned char db_name);
+struct node *memdb_node_load(const char *filename, unsigned char db_name);
 
 #endif
@@ -257,23 +257,26 @@ int main(int argc, char **argv)
 	memdb_integer sub_attr_handle_sp1;
 	memdb_integer sub_attr_handle_sp2;
 	struct node_info *subnode;
+	int sub;
 
 	libdb_init();
 
 #ifdef EVENT_NOTIFY_BY_SELECT
-	if (libdb_init_subscription(NOTIFY_BY_SELECT, event_callback_fn, NULL) < 0) {
+	sub = libdb_init_subscription(NOTIFY_BY_SELECT, event_callback_fn, NULL);
+	if (sub < 0) {
 		printf("failed to init select subscirbe mode!\n");
 		return -1;
 	}
 #else
-	if (libdb_init_subscription(NOTIFY_BY_SIGNAL, event_callback_fn, NULL) < 0) {
+	sub = libdb_init_subscription(NOTIFY_BY_SIGNAL, event_callback_fn, NULL);
+	if (sub < 0) {
 		printf("failed to init signal subscirbe mode!\n");
 		return -1;
 	}
 #endif
 
-	sub_create_handle = libdb_subscribe_node_create(DB_RMM, LOCK_ID_NULL);
-	sub_delete_handle = libdb_subscribe_node_delete(DB_RMM, LOCK_ID_NULL);
+	sub_create_handle = libdb_subscribe_node_create(DB_RMM, sub, LOCK_ID_NULL);
+	sub_delete_handle = libdb_subscribe_node_delete(DB_RMM, sub, LOCK_ID_NULL);
 	/*sub_attr_handle_pre = libdb_subscribe_node_attr_all();*/
 	mbp1 = libdb_create_node(DB_RMM, MC_NODE_ROOT, MC_TYPE_CM,
 							 SNAPSHOT_NEED, LOCK_ID_NULL);
@@ -284,7 +287,7 @@ int main(int argc, char **argv)
 	libdb_attr_set_int(DB_RMM, bmc, "ipv4_addr", 0x0,
 					   (int)0x44444444, 0, LOCK_ID_NULL);
 
-	sub_attr_handle_sp1 = libdb_subscribe_attr_by_node(DB_RMM, mbp1, LOCK_ID_NULL);
+	sub_attr_handle_sp1 = libdb_subscribe_attr_by_node(DB_RMM, sub, mbp1, LOCK_ID_NULL);
 
 	mbp2 = libdb_create_node(DB_RMM, MC_NODE_ROOT, MC_TYPE_CM,
 							 SNAPSHOT_NEED, LOCK_ID_NULL);
@@ -313,7 +316,7 @@ int main(int argc, char **argv)
 
 	mbp3 = libdb_create_node(DB_RMM, MC_NODE_ROOT, MC_TYPE_CM,
 							 SNAPSHOT_NEED, LOCK_ID_NULL);
-	sub_attr_handle_sp2 = libdb_subscribe_attr_special(DB_RMM, mbp3, "air", LOCK_ID_NULL);
+	sub_attr_handle_sp2 = libdb_subscribe_attr_special(DB_RMM, sub, mbp3, "air", LOCK_ID_NULL);
 	tmc = libdb_create_node(DB_RMM, mbp3, MC_TYPE_DRAWER,
 							SNAPSHOT_NEED, LOCK_ID_NULL);
 	libdb_attr_set_char(DB_RMM, tmc, "outlet_temp", 0x1, 0x23, 0, LOCK_ID_NULL);
@@ -387,7 +390,7 @@ int main(int argc, char **argv)
 
 	libdb_attr_remove(DB_RMM, psu, pwname, LOCK_ID_NULL);
 	libdb_attr_set_string(DB_RMM, psu, "powertest-213", 0x02, "on", 0, LOCK_ID_NULL);
-	sub_attr_handle_pre = libdb_subscribe_attr_by_prefix(DB_RMM, psu, "hoststate-", LOCK_ID_NULL);
+	sub_attr_handle_pre = libdb_subscribe_attr_by_prefix(DB_RMM, sub, psu, "hoststate-", LOCK_ID_NULL);
 
 	#if 0
 	if (libipmi_init(IPMI_MEMDB_TEST_PORT) < 0)
@@ -424,10 +427,10 @@ int main(int argc, char **argv)
 #ifdef EVENT_NOTIFY_BY_SELECT
 		max_fd = -1;
 		FD_ZERO(&readset);
-		libdb_event_selectfds(&readset, &max_fd);
+		libdb_event_selectfds(sub, &readset, &max_fd);
 
 		if (select(max_fd + 1, &readset, NULL, 0, NULL) > 0)
-			libdb_event_processfds(&readset);
+			libdb_event_processfds(sub, &readset);
 #endif
 
 #endif
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <signal.h>
 #include "libutils/dump.h"
 
 #include "libutils/sock.h"
@@ -25,6 +26,7 @@
 #include "librmmcfg/rmm_cfg.h"
 #include "rf_memdb.h"
 #include "rf_log.h"
+#include "rf_deliver.h"
 #include "libutils/curl_ref.h"
 #include "libutils/string.h"
 #include "libinit/libinit.h"
@@ -99,9 +101,8 @@ static int32 rf_msg_handler(struct rf_log_req_info *req_info)
 		rf_memdb_get_listeners(msg_id_str, location_idx, listener);
 		tmp = listener;
 		while (tmp) {
-			if (strstr(tmp->dest, "http") != NULL){
-				curl_post_msg(tmp->dest, msg);
-			}
+			if (strstr(tmp->dest, "http") != NULL)
+				rf_deliver_post(tmp->dest, msg);
 			tmp2 = tmp->pnext;
 			free(tmp);
 			tmp = tmp2;
@@ -149,49 +150,65 @@ static void parser_logs(int8 *resp_data, int32 read_lines_count)
 	}
 }
 
-static void rf_get_log_handler(int32 fd, struct sockaddr_in addr_from, int32 msg_req_count)
+/*
+ * Log requests come on a loopback TCP connection on the redfishd port, the
+ * reply is the descriptor followed by count records in a single write.
+ */
+static void rf_get_log_handler(int32 fd, int32 msg_req_count)
 {
-	struct rf_log_desc	resp_disc;
+	struct rf_log_desc *resp_disc;
+	int8 *resp = NULL;
 	int8 *resp_data = NULL;
-	int32 val = 0;
 	int32 read_lines_count = 0;
-	int32 msg_count = 0;
-	int32 index = 0;
-	int32 msg_length = 0;
-	int32 addrlen = sizeof(addr_from);
 
+	/* the count comes from the socket, never trust it for the allocation */
+	if (msg_req_count < 0)
+		msg_req_count = 0;
+	else if (msg_req_count > MAX_RF_EVT_MSG_LOG_COUNT)
+		msg_req_count = MAX_RF_EVT_MSG_LOG_COUNT;
+
+	resp = (int8 *)malloc(sizeof(struct rf_log_desc) + msg_req_count * RF_MSG_MAX_LEN);
+	if (resp == NULL)
+		return;
+
+	resp_disc = (struct rf_log_desc *)resp;
+	resp_data = resp + sizeof(struct rf_log_desc);
 	if (msg_req_count > 0) {
-		resp_data = (char *)malloc(abs(msg_req_count) * RF_MSG_MAX_LEN);
 		read_lines_count = rf_log_get(msg_req_count, resp_data);
 		parser_logs(resp_data, read_lines_count);
-		resp_disc.count = read_lines_count;
-		resp_disc.length = read_lines_count * RF_MSG_MAX_LEN;
-	} else {
-		resp_disc.count = 0;
-		resp_disc.length = 0;
 	}
+	resp_disc->count = read_lines_count;
+	resp_disc->length = read_lines_count * RF_MSG_MAX_LEN;
 
-	val = fcntl(fd, F_GETFL, 0);
-	if (fcntl(fd, F_SETFL, val & ~O_NONBLOCK) < 0)
-		return;
+	socket_send(fd, resp, sizeof(struct rf_log_desc) + resp_disc->length);
+	free(resp);
+}
 
-	sendto(fd, (unsigned char *)(&resp_disc), sizeof(struct rf_log_desc), 0, (struct sockaddr *)&addr_from, addrlen);
-	usleep(100);
-	while (index * BUF_SIZE < resp_disc.length) {
-		if ((index  + 1) * BUF_SIZE > resp_disc.length)
-			msg_length = resp_disc.length - index * BUF_SIZE;
-		else
-			msg_length = BUF_SIZE;
-		sendto(fd, (unsigned char *)resp_data + index * BUF_SIZE, msg_length, 0, (struct sockaddr *)&addr_from, addrlen);
-		usleep(100);
-		index++;
-	}
+static void rf_log_conn_handler(int32 listen_fd)
+{
+	int32 fd;
+	struct timeval tv = {1, 0};
+	struct rf_log_req_info req_info;
 
-	if (fcntl(fd, F_SETFL, val & O_NONBLOCK) < 0)
+	fd = accept(listen_fd, NULL, NULL);
+	if (fd < 0)
 		return;
-	if (resp_data)
-		free(resp_data);
-	resp_data = NULL;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	if (socket_recv(fd, &req_info, sizeof(struct rf_log_req_info)) == sizeof(struct rf_log_req_info) &&
+		req_info.type == RF_GET_LOG_BY_LIMIT)
+		rf_get_log_handler(fd, req_info.data.fmt2.count);
+
+	close(fd);
+}
+
+static volatile sig_atomic_t dump_stats;
+
+static void sigusr1_handler(int32 signum)
+{
+	dump_stats = 1;
 }
 
 static void sigterm_handler(int32 signum)
@@ -204,6 +221,7 @@ int main(int32 argc, int8 **argv)
 {
 	int32 rc;
 	int32 fd;
+	int32 log_fd;
 	fd_set fds;
 	int32 port;
 	socklen_t addrlen;
@@ -226,6 +244,10 @@ int main(int32 argc, int8 **argv)
 	if (fd < 0)
 		return -1;
 
+	log_fd = create_tcp_listen(INADDR_LOOPBACK, port, 16);
+	if (log_fd < 0)
+		return -1;
+
 	printf("redfish daemon is Running ...\n");
 
 	/*redfish log init.*/
@@ -235,17 +257,34 @@ int main(int32 argc, int8 **argv)
 	msg_reg_init(NULL);
 	rf_memdb_event_node_init();
 	curl_init();
+	if (rf_deliver_init() != 0) {
+		rmm_log(ERROR, "%s", "Fail to start event delivery.\n");
+		exit(-1);
+	}
+	signal(SIGUSR1, sigusr1_handler);
 
 	set_socket_addr(&addr_from, port);
 	addrlen = sizeof(addr_from);
 	for (;;) {
+		if (dump_stats) {
+			dump_stats = 0;
+			rf_deliver_dump_stats();
+		}
+
 		FD_ZERO(&fds);
 		FD_SET(fd, &fds);
+		FD_SET(log_fd, &fds);
 
-		rc = select(fd + 1, &fds, NULL, NULL, NULL);
+		rc = select((fd > log_fd ? fd : log_fd) + 1, &fds, NULL, NULL, NULL);
 		if (rc < 0)
 			continue;
 
+		if (FD_ISSET(log_fd, &fds))
+			rf_log_conn_handler(log_fd);
+
+		if (!FD_ISSET(fd, &fds))
+			continue;
+
 		rc = recvfrom(fd, &req_info, sizeof(struct rf_log_req_info), 0, (struct sockaddr *)&addr_from, &addrlen);
 		if (rc <= 0)
 			continue;
@@ -253,15 +292,13 @@ int main(int32 argc, int8 **argv)
 		case RF_MSG_REQ:
 			rf_msg_handler(&req_info);
 			break;
-		case RF_GET_LOG_BY_LIMIT:
-			rf_get_log_handler(fd, addr_from, req_info.data.fmt2.count);
-			break;
 		default:
 			printf("Error message type: %d", req_info.type);
 			break;
 		}
 	}
 
+	close(log_fd);
 	close(fd);
 	curl_uninit();
 	return 0;
@@ -0,0 +1,346 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <curl/curl.h>
+
+#include "libutils/string.h"
+#include "rf_deliver.h"
+
+struct deliver_msg {
+	struct deliver_msg *next;
+	int32 retry;
+	int8 data[0];
+};
+
+struct deliver_dest {
+	int32 used;
+	int8 url[RF_DELIVER_URL_LEN];
+
+	struct deliver_msg *head;	/* head is the one in flight */
+	struct deliver_msg *tail;
+	int32 queue_len;
+
+	CURL *curl;					/* kept to reuse its connection */
+	int32 busy;
+	int32 fail_count;			/* consecutive failures, for backoff */
+	uint64 next_try;			/* ms, no request before */
+	uint64 last_used;
+
+	uint32 sent;
+	uint32 failed;
+	uint32 dropped;
+};
+
+static struct deliver_dest dests[RF_DELIVER_MAX_DEST];
+static uint32 dropped_no_dest;
+static int32 active;
+
+/* protects dests, never held while curl does I/O */
+static pthread_mutex_t deliver_lock = PTHREAD_MUTEX_INITIALIZER;
+static CURLM *multi;
+static int wake_fd[2] = {-1, -1};
+
+static uint64 now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t discard_reply(void *ptr, size_t size, size_t nmemb, void *data)
+{
+	return size * nmemb;
+}
+
+/* Find the queue of url, take an idle one over if the table is full. */
+static struct deliver_dest *get_dest(const int8 *url)
+{
+	struct deliver_dest *free_dest = NULL;
+	struct deliver_dest *idle = NULL;
+	int32 i;
+
+	for (i = 0; i < RF_DELIVER_MAX_DEST; i++) {
+		if (!dests[i].used) {
+			if (free_dest == NULL)
+				free_dest = &dests[i];
+			continue;
+		}
+		if (strcmp(dests[i].url, url) == 0)
+			return &dests[i];
+		if (!dests[i].busy && dests[i].queue_len == 0 &&
+			(idle == NULL || dests[i].last_used < idle->last_used))
+			idle = &dests[i];
+	}
+
+	if (free_dest == NULL && idle) {
+		if (idle->curl)
+			curl_easy_cleanup(idle->curl);
+		free_dest = idle;
+	}
+
+	if (free_dest) {
+		memset(free_dest, 0, sizeof(struct deliver_dest));
+		free_dest->used = 1;
+		strncpy_safe(free_dest->url, url, RF_DELIVER_URL_LEN, RF_DELIVER_URL_LEN - 1);
+	}
+
+	return free_dest;
+}
+
+static void start_request(struct deliver_dest *dest, uint64 now)
+{
+	if (dest->curl == NULL) {
+		dest->curl = curl_easy_init();
+		if (dest->curl == NULL)
+			return;
+		curl_easy_setopt(dest->curl, CURLOPT_URL, dest->url);
+		curl_easy_setopt(dest->curl, CURLOPT_PRIVATE, dest);
+		curl_easy_setopt(dest->curl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(dest->curl, CURLOPT_CONNECTTIMEOUT_MS, (long)RF_DELIVER_CONNECT_TIMEOUT_MS);
+		curl_easy_setopt(dest->curl, CURLOPT_TIMEOUT_MS, (long)RF_DELIVER_TIMEOUT_MS);
+		curl_easy_setopt(dest->curl, CURLOPT_WRITEFUNCTION, discard_reply);
+	}
+
+	curl_easy_setopt(dest->curl, CURLOPT_POSTFIELDS, dest->head->data);
+	if (curl_multi_add_handle(multi, dest->curl) != CURLM_OK)
+		return;
+
+	dest->busy = 1;
+	dest->last_used = now;
+	active++;
+}
+
+/* Start the next request of idle destinations, return ms until one is due. */
+static long start_requests(uint64 now)
+{
+	long timeout = 1000;
+	int32 i;
+
+	for (i = 0; i < RF_DELIVER_MAX_DEST; i++) {
+		struct deliver_dest *dest = &dests[i];
+
+		if (!dest->used || dest->busy || dest->head == NULL)
+			continue;
+
+		if (dest->next_try > now) {
+			if ((long)(dest->next_try - now) < timeout)
+				timeout = dest->next_try - now;
+			continue;
+		}
+
+		if (active < RF_DELIVER_MAX_ACTIVE)
+			start_request(dest, now);
+	}
+
+	return timeout;
+}
+
+static void finish_request(CURL *curl, CURLcode result, uint64 now)
+{
+	struct deliver_dest *dest = NULL;
+	struct deliver_msg *msg;
+	long code = 0;
+	int32 backoff;
+
+	curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&dest);
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+	curl_multi_remove_handle(multi, curl);
+	if (dest == NULL)
+		return;
+
+	dest->busy = 0;
+	dest->last_used = now;
+	active--;
+
+	msg = dest->head;
+	if (result == CURLE_OK && code >= 200 && code < 300) {
+		dest->sent++;
+		dest->fail_count = 0;
+		dest->next_try = 0;
+	} else {
+		dest->failed++;
+		dest->fail_count++;
+		backoff = RF_DELIVER_BACKOFF_MS << (dest->fail_count < 7 ? dest->fail_count - 1 : 6);
+		if (backoff > RF_DELIVER_BACKOFF_MAX_MS)
+			backoff = RF_DELIVER_BACKOFF_MAX_MS;
+		dest->next_try = now + backoff;
+
+		if (msg->retry++ < RF_DELIVER_MAX_RETRY)
+			return;
+		dest->dropped++;
+	}
+
+	dest->head = msg->next;
+	if (dest->head == NULL)
+		dest->tail = NULL;
+	dest->queue_len--;
+	free(msg);
+}
+
+static void *deliver_thread(void *arg)
+{
+	struct curl_waitfd wake;
+	CURLMsg *info;
+	int8 buf[64];
+	int32 running;
+	int32 left;
+	int numfds;
+	long timeout;
+
+	for (;;) {
+		pthread_mutex_lock(&deliver_lock);
+		timeout = start_requests(now_ms());
+		pthread_mutex_unlock(&deliver_lock);
+
+		wake.fd = wake_fd[0];
+		wake.events = CURL_WAIT_POLLIN;
+		wake.revents = 0;
+		curl_multi_wait(multi, &wake, 1, timeout, &numfds);
+		if (wake.revents)
+			while (read(wake_fd[0], buf, sizeof(buf)) > 0)
+				;
+
+		curl_multi_perform(multi, &running);
+
+		pthread_mutex_lock(&deliver_lock);
+		while ((info = curl_multi_info_read(multi, &left)) != NULL) {
+			if (info->msg == CURLMSG_DONE)
+				finish_request(info->easy_handle, info->data.result, now_ms());
+		}
+		pthread_mutex_unlock(&deliver_lock);
+	}
+
+	return NULL;
+}
+
+int rf_deliver_post(const int8 *dest_url, const int8 *data)
+{
+	struct deliver_dest *dest;
+	struct deliver_msg *msg;
+	int32 len = strlen(data);
+
+	pthread_mutex_lock(&deliver_lock);
+	dest = get_dest(dest_url);
+	if (dest == NULL) {
+		dropped_no_dest++;
+		goto drop;
+	}
+
+	if (dest->queue_len >= RF_DELIVER_QUEUE_LEN) {
+		dest->dropped++;
+		goto drop;
+	}
+
+	msg = (struct deliver_msg *)malloc(sizeof(struct deliver_msg) + len + 1);
+	if (msg == NULL) {
+		dest->dropped++;
+		goto drop;
+	}
+	msg->next = NULL;
+	msg->retry = 0;
+	memcpy(msg->data, data, len + 1);
+
+	if (dest->tail)
+		dest->tail->next = msg;
+	else
+		dest->head = msg;
+	dest->tail = msg;
+	dest->queue_len++;
+	pthread_mutex_unlock(&deliver_lock);
+
+	if (write(wake_fd[1], "", 1) < 0) {
+		/* pipe full, the thread is woken up anyway */
+	}
+	return 0;
+
+drop:
+	pthread_mutex_unlock(&deliver_lock);
+	return -1;
+}
+
+int32 rf_deliver_get_stats(struct rf_deliver_stats *stats)
+{
+	int32 i;
+	int32 count = 0;
+
+	pthread_mutex_lock(&deliver_lock);
+	for (i = 0; i < RF_DELIVER_MAX_DEST; i++) {
+		if (!dests[i].used)
+			continue;
+		strncpy_safe(stats[count].url, dests[i].url, RF_DELIVER_URL_LEN, RF_DELIVER_URL_LEN - 1);
+		stats[count].queued = dests[i].queue_len;
+		stats[count].sent = dests[i].sent;
+		stats[count].failed = dests[i].failed;
+		stats[count].dropped = dests[i].dropped;
+		count++;
+	}
+	pthread_mutex_unlock(&deliver_lock);
+
+	return count;
+}
+
+void rf_deliver_dump_stats(void)
+{
+	struct rf_deliver_stats stats[RF_DELIVER_MAX_DEST];
+	int32 count;
+	int32 i;
+
+	count = rf_deliver_get_stats(stats);
+	printf("%-48s %8s %10s %10s %10s\n", "destination", "queued", "sent", "failed", "dropped");
+	for (i = 0; i < count; i++)
+		printf("%-48s %8u %10u %10u %10u\n", stats[i].url, stats[i].queued,
+			stats[i].sent, stats[i].failed, stats[i].dropped);
+	printf("dropped, no free destination: %u\n", dropped_no_dest);
+}
+
+int rf_deliver_init(void)
+{
+	pthread_t tid;
+	int32 i;
+
+	if (pipe(wake_fd) < 0)
+		return -1;
+
+	for (i = 0; i < 2; i++) {
+		fcntl(wake_fd[i], F_SETFL, fcntl(wake_fd[i], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(wake_fd[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	multi = curl_multi_init();
+	if (multi == NULL)
+		goto err;
+
+	if (pthread_create(&tid, NULL, deliver_thread, NULL) != 0)
+		goto err;
+	pthread_detach(tid);
+
+	return 0;
+
+err:
+	if (multi)
+		curl_multi_cleanup(multi);
+	multi = NULL;
+	close(wake_fd[0]);
+	close(wake_fd[1]);
+	return -1;
+}
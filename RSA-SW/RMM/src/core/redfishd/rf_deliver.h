@@ -0,0 +1,81 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __RF_DELIVER_H__
+#define __RF_DELIVER_H__
+
+#include "libutils/types.h"
+
+#define RF_DELIVER_URL_LEN			256
+#define RF_DELIVER_MAX_DEST			32		/* destinations with own queue */
+#define RF_DELIVER_MAX_ACTIVE		8		/* requests in flight */
+#define RF_DELIVER_QUEUE_LEN		64		/* events queued per destination */
+#define RF_DELIVER_MAX_RETRY		3
+#define RF_DELIVER_BACKOFF_MS		500
+#define RF_DELIVER_BACKOFF_MAX_MS	30000
+#define RF_DELIVER_CONNECT_TIMEOUT_MS	2000
+#define RF_DELIVER_TIMEOUT_MS		5000
+
+struct rf_deliver_stats {
+	int8	url[RF_DELIVER_URL_LEN];
+	uint32	queued;
+	uint32	sent;
+	uint32	failed;		/* attempts which failed, including retries */
+	uint32	dropped;	/* events given up or not queued */
+};
+
+/**
+ * @brief start the event delivery thread.
+ *
+ * Events are posted by a libcurl multi handle in a thread of its own. Each
+ * destination has a queue and at most one request in flight, so events
+ * reach a listener in order and a slow listener only delays itself.
+ * Connections are kept and reused. A failed post is retried with
+ * exponential backoff, an event is dropped after RF_DELIVER_MAX_RETRY
+ * retries or when the queue of its destination is full.
+ *
+ * curl_init() must be called before.
+ *
+ * @return 0			success.
+ * 		   -1			fail
+ */
+int rf_deliver_init(void);
+
+/**
+ * @brief queue an event for a destination, never blocks on HTTP.
+ *
+ * @param  dest			destination url.
+ * @param  msg			event message, copied.
+ *
+ * @return 0			queued.
+ * 		   -1			dropped
+ */
+int rf_deliver_post(const int8 *dest, const int8 *msg);
+
+/**
+ * @brief get counters of the known destinations.
+ *
+ * @param  stats		array of RF_DELIVER_MAX_DEST entries.
+ *
+ * @return number of entries filled.
+ */
+int32 rf_deliver_get_stats(struct rf_deliver_stats *stats);
+
+/**
+ * @brief print counters of the known destinations.
+ */
+void rf_deliver_dump_stats(void);
+
+#endif
@@ -20,7 +20,7 @@
 #define RF_EVT_LOG_MAX_LINES	10000
 #define RF_EVT_LOG_LEVEL		6
 
-int32 rf_evt_log_handler = 0;
+static long rf_evt_log_handler = 0;
 
 void rf_log_init(void)
 {
@@ -0,0 +1,218 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Event delivery against local HTTP sinks: a fast one, a slow one and a
+ * port nobody listens on. Checks that posting never blocks, that the fast
+ * sink is not delayed by the others, that events arrive in order over one
+ * connection, and that events for the dead sink are dropped and counted.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <curl/curl.h>
+
+#include "libutils/string.h"
+#include "libutils/test.h"
+#include "rf_deliver.h"
+
+#define FAST_PORT		18181
+#define SLOW_PORT		18182
+#define DOWN_PORT		18183
+
+#define FAST_EVENTS		50
+#define SLOW_EVENTS		3
+#define SLOW_DELAY_MS	1000
+
+struct sink {
+	int32 port;
+	int32 delay_ms;
+	volatile int32 events;
+	volatile int32 conns;
+	volatile int32 in_order;
+	volatile uint64 last_ms;
+};
+
+static struct sink fast_sink = {FAST_PORT, 0, 0, 0, 1, 0};
+static struct sink slow_sink = {SLOW_PORT, SLOW_DELAY_MS, 0, 0, 1, 0};
+
+/* Read one request, return its body length or -1 */
+static int32 read_request(int32 fd, int8 *body, int32 size)
+{
+	int8 buf[4096];
+	int8 *end;
+	int8 *p;
+	int32 len = 0;
+	int32 rc;
+	int32 hdr_len;
+	int32 body_len = 0;
+
+	for (;;) {
+		rc = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+		if (rc <= 0)
+			return -1;
+		len += rc;
+		buf[len] = '\0';
+
+		end = strstr(buf, "\r\n\r\n");
+		if (end == NULL)
+			continue;
+		hdr_len = end - buf + 4;
+		p = strcasestr(buf, "Content-Length:");
+		if (p && p < end)
+			body_len = atoi(p + strlen("Content-Length:"));
+		if (len >= hdr_len + body_len)
+			break;
+	}
+
+	if (body_len >= size)
+		body_len = size - 1;
+	memcpy(body, buf + hdr_len, body_len);
+	body[body_len] = '\0';
+
+	return body_len;
+}
+
+static void *sink_thread(void *arg)
+{
+	struct sink *sink = (struct sink *)arg;
+	struct sockaddr_in addr;
+	int8 body[1024];
+	int8 expect[32];
+	const int8 *reply = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+	int32 lfd;
+	int32 fd;
+	int32 val = 1;
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(sink->port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 4) < 0) {
+		perror("sink");
+		exit(-1);
+	}
+
+	for (;;) {
+		fd = accept(lfd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		sink->conns++;
+
+		while (read_request(fd, body, sizeof(body)) >= 0) {
+			if (sink->delay_ms)
+				usleep(sink->delay_ms * 1000);
+			snprintf(expect, sizeof(expect), "event %d", sink->events);
+			if (strcmp(body, expect) != 0)
+				sink->in_order = 0;
+			sink->events++;
+			sink->last_ms = now_ms();
+			if (send(fd, reply, strlen(reply), 0) < 0)
+				break;
+		}
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static void get_stats(const int8 *url, struct rf_deliver_stats *out)
+{
+	struct rf_deliver_stats stats[RF_DELIVER_MAX_DEST];
+	int32 count;
+	int32 i;
+
+	memset(out, 0, sizeof(*out));
+	count = rf_deliver_get_stats(stats);
+	for (i = 0; i < count; i++) {
+		if (strcmp(stats[i].url, url) == 0)
+			*out = stats[i];
+	}
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid;
+	int8 fast_url[64];
+	int8 slow_url[64];
+	int8 down_url[64];
+	int8 msg[32];
+	struct rf_deliver_stats stats;
+	uint64 start;
+	uint64 t;
+	uint64 max_post = 0;
+	int32 i;
+
+	snprintf(fast_url, sizeof(fast_url), "http://127.0.0.1:%d/fast", FAST_PORT);
+	snprintf(slow_url, sizeof(slow_url), "http://127.0.0.1:%d/slow", SLOW_PORT);
+	snprintf(down_url, sizeof(down_url), "http://127.0.0.1:%d/down", DOWN_PORT);
+
+	pthread_create(&tid, NULL, sink_thread, &fast_sink);
+	pthread_create(&tid, NULL, sink_thread, &slow_sink);
+	usleep(100 * 1000);
+
+	curl_global_init(CURL_GLOBAL_ALL);
+	if (rf_deliver_init() != 0) {
+		printf("FAIL: rf_deliver_init\n");
+		return -1;
+	}
+
+	start = now_ms();
+	for (i = 0; i < RF_DELIVER_QUEUE_LEN + 10; i++) {
+		snprintf(msg, sizeof(msg), "event %d", i);
+		t = now_ms();
+		if (i < SLOW_EVENTS)
+			rf_deliver_post(slow_url, msg);
+		rf_deliver_post(down_url, msg);
+		if (i < FAST_EVENTS)
+			rf_deliver_post(fast_url, msg);
+		if (now_ms() - t > max_post)
+			max_post = now_ms() - t;
+	}
+	check(max_post < 10, "posting does not block on HTTP");
+
+	while (fast_sink.events < FAST_EVENTS && now_ms() - start < 5000)
+		usleep(10 * 1000);
+	check(fast_sink.events == FAST_EVENTS, "fast sink got all events");
+	check(fast_sink.last_ms - start < SLOW_DELAY_MS, "fast sink not delayed by slow and dead sinks");
+	check(fast_sink.in_order, "fast sink got events in order");
+	check(fast_sink.conns == 1, "fast sink connection reused");
+
+	get_stats(down_url, &stats);
+	check(stats.dropped == 10, "events over the queue length dropped");
+
+	while (slow_sink.events < SLOW_EVENTS && now_ms() - start < 10000)
+		usleep(10 * 1000);
+	check(slow_sink.events == SLOW_EVENTS && slow_sink.in_order, "slow sink got all events in order");
+
+	/* attempts at 0, 500, 1500 and 3500 ms, the next one after 7500 ms */
+	while (now_ms() - start < 5000)
+		usleep(10 * 1000);
+	get_stats(down_url, &stats);
+	check(stats.failed == RF_DELIVER_MAX_RETRY + 1, "dead sink retried with backoff");
+	check(stats.dropped == 11, "event dropped after last retry");
+
+	rf_deliver_dump_stats();
+
+	return test_result();
+}
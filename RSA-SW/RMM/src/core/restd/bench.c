@@ -0,0 +1,113 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libutils/test.h"
+#include "rest.h"
+
+/*
+ * Measure REST URI routing over all registered URIs, with the variable
+ * segments filled in, as rest_process() routes a request path.
+ *
+ * usage: restdbench [rounds]
+ */
+
+#define MAX_PATH_LEN	256
+
+/* "/v1/rack/drawers/{drawer_uuid}" -> "/v1/rack/drawers/<value>" */
+static int32 fill_uri(const int8 *uri, int8 *path, int32 *vars)
+{
+	int32 len = 0;
+	const int8 *cp = uri;
+	const int8 *value = NULL;
+
+	*vars = 0;
+	while (*cp != '\0' && len < MAX_PATH_LEN - 40) {
+		if (*cp != '{') {
+			path[len++] = *cp++;
+			continue;
+		}
+
+		if (strncmp(cp, "{drawer_uuid}", 13) == 0)
+			value = "6d9a23c2-8e1a-11e5-8994-feff819cdc9f";
+		else
+			value = "2";
+
+		len += snprintf(path + len, MAX_PATH_LEN - len, "%s", value);
+		cp = strchr(cp, '}') + 1;
+		(*vars)++;
+	}
+	path[len] = '\0';
+
+	return len;
+}
+
+int32 main(int32 argc, int8 **argv)
+{
+	struct rest_uri_param param;
+	const int8 **uris = NULL;
+	int8 (*paths)[MAX_PATH_LEN];
+	int8 path[MAX_PATH_LEN];
+	int32 *lens, *vars;
+	struct timespec start;
+	int32 rounds = 100000;
+	int32 num, i, r;
+	int32 failed = 0;
+	double ns;
+
+	if (argc > 1)
+		rounds = atoi(argv[1]);
+
+	rest_register_handlers();
+	num = rest_registered_uris(&uris);
+
+	paths = malloc(num * MAX_PATH_LEN);
+	lens = malloc(num * sizeof(int32));
+	vars = malloc(num * sizeof(int32));
+	if (paths == NULL || lens == NULL || vars == NULL)
+		return -1;
+
+	for (i = 0; i < num; i++) {
+		lens[i] = fill_uri(uris[i], paths[i], &vars[i]);
+
+		memcpy(path, paths[i], lens[i] + 1);
+		if (rest_route(&param, path) == NULL || param.num_path_keys != vars[i]) {
+			printf("%s: not routed\n", paths[i]);
+			failed++;
+		}
+	}
+
+	/* the path is split in place, it is copied as a request would be read */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < num; i++) {
+			memcpy(path, paths[i], lens[i] + 1);
+			rest_route(&param, path);
+		}
+	}
+	ns = elapsed_ns(&start) / ((double)rounds * num);
+
+	printf("%d URIs, %d failed, %.1f ns per lookup\n", num, failed, ns);
+
+	free(paths);
+	free(lens);
+	free(vars);
+	return failed ? -1 : 0;
+}
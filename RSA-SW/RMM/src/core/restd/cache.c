@@ -0,0 +1,356 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include "cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/prctl.h>
+
+#include "http.h"
+#include "libmemdb/memdb.h"
+#include "libutils/list.h"
+
+/*
+ * Cache of serialized GET replies of handlers which only read memdb.
+ *
+ * While a reply is built, the memdb nodes read by the worker are recorded
+ * with libdb_set_read_hook(). A thread subscribed to memdb events counts
+ * attribute changes per node (hashed into node_gen) and counts node
+ * creations and deletions in cache_gen. A cached reply is served while
+ * none of the counters it was built with changed, so invalidation costs
+ * the event thread one increment and never takes the cache lock.
+ *
+ * A client which changes a resource through restd expects to read it back
+ * at once, so any other request flushes the cache instead of waiting for
+ * the memdb event.
+ */
+
+#define BUCKET_NUM		256		/* power of 2 */
+#define NODE_GEN_NUM	4096	/* power of 2 */
+
+#define NODE_GEN_IDX(node_id)	((uint32)((node_id) ^ ((node_id) >> 12)) & (NODE_GEN_NUM - 1))
+
+struct cache_dep {
+	uint32 idx;
+	uint32 gen;
+};
+
+struct cache_deps {
+	uint32 cache_gen;
+	uint32 attr_gen;
+	int32 num;			/* -1 if the reply depends on any node */
+	struct cache_dep dep[REST_CACHE_MAX_DEPS];
+};
+
+struct cache_entry {
+	struct list_head lru;
+	struct cache_entry *next;	/* in bucket */
+	uint32 hash;
+	int8 *key;
+	int8 *body;
+	int32 len;
+	int32 status;
+	int8 etag[REST_CACHE_ETAG_LEN];
+	time_t built;
+	struct cache_deps deps;
+};
+
+static int32 cache_running;
+
+/* written by the event thread only, except cache_gen */
+static volatile uint32 node_gen[NODE_GEN_NUM];
+static volatile uint32 attr_gen;
+static volatile uint32 cache_gen;
+
+/* all below are protected by cache_lock */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cache_entry *buckets[BUCKET_NUM];
+static struct list_head lru_list = LIST_HEAD_INIT(lru_list);
+static int32 entry_num;
+
+/* reply being built by this thread */
+static __thread struct cache_deps building;
+
+
+static uint32 key_hash(const int8 *key)
+{
+	uint32 h = 2166136261u;		/* FNV-1a */
+
+	while (*key) {
+		h ^= (uint8)*key++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static void make_etag(int8 *etag, const int8 *body, int32 len)
+{
+	uint64 h = 14695981039346656037ull;	/* FNV-1a */
+	int32 i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (uint8)body[i];
+		h *= 1099511628211ull;
+	}
+
+	snprintf(etag, REST_CACHE_ETAG_LEN, "\"%016llx\"", (unsigned long long)h);
+}
+
+static void record_read(memdb_integer node_id, void *data)
+{
+	struct cache_deps *deps = data;
+	uint32 idx;
+	int32 i;
+
+	if (deps->num < 0)
+		return;
+
+	if (node_id == LIBDB_ANY_NODE) {
+		deps->num = -1;
+		return;
+	}
+
+	idx = NODE_GEN_IDX(node_id);
+	for (i = 0; i < deps->num; i++) {
+		if (deps->dep[i].idx == idx)
+			return;
+	}
+
+	if (deps->num == REST_CACHE_MAX_DEPS) {
+		deps->num = -1;
+		return;
+	}
+
+	deps->dep[deps->num].idx = idx;
+	deps->dep[deps->num].gen = node_gen[idx];
+	deps->num++;
+}
+
+static int32 deps_valid(const struct cache_deps *deps)
+{
+	int32 i;
+
+	if (deps->cache_gen != cache_gen)
+		return 0;
+
+	if (deps->num < 0)
+		return deps->attr_gen == attr_gen;
+
+	for (i = 0; i < deps->num; i++) {
+		if (node_gen[deps->dep[i].idx] != deps->dep[i].gen)
+			return 0;
+	}
+
+	return 1;
+}
+
+static struct cache_entry **find_entry(const int8 *key, uint32 hash)
+{
+	struct cache_entry **pe;
+
+	for (pe = &buckets[hash & (BUCKET_NUM - 1)]; *pe != NULL; pe = &(*pe)->next) {
+		if ((*pe)->hash == hash && strcmp((*pe)->key, key) == 0)
+			break;
+	}
+
+	return pe;
+}
+
+static void free_entry(struct cache_entry **pe)
+{
+	struct cache_entry *e = *pe;
+
+	*pe = e->next;
+	list_del(&e->lru);
+	entry_num--;
+
+	free(e->key);
+	free(e->body);
+	free(e);
+}
+
+static void cache_event(struct event_info *evt, void *cb_data)
+{
+	if (evt->event == EVENT_NODE_ATTR) {
+		node_gen[NODE_GEN_IDX(evt->anodeid)]++;
+		attr_gen++;
+	} else {
+		__sync_fetch_and_add(&cache_gen, 1);
+	}
+}
+
+static void *cache_event_thread(void *unused)
+{
+	fd_set rfds;
+	int32 maxfd;
+	int32 sub;
+
+	prctl(PR_SET_NAME, "rest_cache");
+
+	sub = libdb_init_subscription(NOTIFY_BY_SELECT, cache_event, NULL);
+	if (sub < 0) {
+		HTTPD_ERR("Failed to subscribe memdb events, reply cache disabled!\n");
+		return NULL;
+	}
+
+	libdb_subscribe_node_create(DB_RMM, sub, LOCK_ID_NULL);
+	libdb_subscribe_node_delete(DB_RMM, sub, LOCK_ID_NULL);
+	libdb_subscribe_attr_all(DB_RMM, sub, LOCK_ID_NULL);
+	cache_running = 1;
+
+	for (;;) {
+		FD_ZERO(&rfds);
+		maxfd = -1;
+		libdb_event_selectfds(sub, &rfds, &maxfd);
+
+		if (select(maxfd + 1, &rfds, NULL, NULL, NULL) < 0)
+			continue;
+
+		libdb_event_processfds(sub, &rfds);
+	}
+
+	return NULL;
+}
+
+void rest_cache_init(void)
+{
+	pthread_t tid;
+
+	if (pthread_create(&tid, NULL, cache_event_thread, NULL) != 0)
+		HTTPD_ERR("Failed to create cache event thread, reply cache disabled!\n");
+}
+
+/*
+ * Copy the reply cached for @key and still valid to @body.
+ * Return 0 on hit, -1 otherwise.
+ */
+int32 rest_cache_get(const int8 *key, int8 *body, int32 size, int32 *len,
+					 int32 *status, int8 *etag)
+{
+	struct cache_entry **pe;
+	struct cache_entry *e;
+	uint32 hash;
+	int32 rc = -1;
+
+	if (!cache_running)
+		return -1;
+
+	hash = key_hash(key);
+
+	pthread_mutex_lock(&cache_lock);
+	pe = find_entry(key, hash);
+	e = *pe;
+	if (e != NULL) {
+		if (!deps_valid(&e->deps) || time(NULL) - e->built > REST_CACHE_MAX_AGE) {
+			free_entry(pe);
+		} else if (e->len <= size) {
+			memcpy(body, e->body, e->len);
+			*len = e->len;
+			*status = e->status;
+			memcpy(etag, e->etag, REST_CACHE_ETAG_LEN);
+			list_del(&e->lru);
+			list_add(&e->lru, &lru_list);
+			rc = 0;
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	return rc;
+}
+
+/*
+ * A reply is built between rest_cache_begin() and rest_cache_end() by the
+ * same thread, then it may be stored by rest_cache_put().
+ */
+void rest_cache_begin(void)
+{
+	building.cache_gen = cache_gen;
+	building.attr_gen = attr_gen;
+	building.num = 0;
+
+	libdb_set_read_hook(record_read, &building);
+}
+
+void rest_cache_end(void)
+{
+	libdb_set_read_hook(NULL, NULL);
+}
+
+/*
+ * Store the reply built by this thread for @key, @etag is set even if the
+ * reply is not stored.
+ */
+void rest_cache_put(const int8 *key, int32 status, const int8 *body, int32 len,
+					int8 *etag)
+{
+	struct cache_entry **pe;
+	struct cache_entry *e;
+	uint32 hash;
+
+	make_etag(etag, body, len);
+
+	if (!cache_running)
+		return;
+
+	e = malloc(sizeof(*e));
+	if (e == NULL)
+		return;
+
+	e->key = strdup(key);
+	e->body = malloc(len);
+	if (e->key == NULL || e->body == NULL) {
+		free(e->key);
+		free(e->body);
+		free(e);
+		return;
+	}
+
+	hash = key_hash(key);
+	e->hash = hash;
+	memcpy(e->body, body, len);
+	e->len = len;
+	e->status = status;
+	memcpy(e->etag, etag, REST_CACHE_ETAG_LEN);
+	e->built = time(NULL);
+	e->deps = building;
+
+	pthread_mutex_lock(&cache_lock);
+	pe = find_entry(key, hash);
+	if (*pe != NULL) {
+		free_entry(pe);
+	} else if (entry_num == REST_CACHE_ENTRY_NUM) {
+		struct cache_entry *old = list_entry(lru_list.prev, struct cache_entry, lru);
+
+		free_entry(find_entry(old->key, old->hash));
+	}
+
+	e->next = buckets[hash & (BUCKET_NUM - 1)];
+	buckets[hash & (BUCKET_NUM - 1)] = e;
+	list_add(&e->lru, &lru_list);
+	entry_num++;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void rest_cache_flush(void)
+{
+	__sync_fetch_and_add(&cache_gen, 1);
+}
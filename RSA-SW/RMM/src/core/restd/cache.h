@@ -0,0 +1,38 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#ifndef __RESTD_CACHE_H__
+#define __RESTD_CACHE_H__
+
+#include "libutils/types.h"
+
+#define REST_CACHE_ENTRY_NUM	128
+#define REST_CACHE_MAX_DEPS		64		/* memdb nodes a reply may depend on */
+#define REST_CACHE_MAX_AGE		30		/* seconds, bounds staleness if an event is lost */
+#define REST_CACHE_KEY_LEN		512
+#define REST_CACHE_ETAG_LEN		20		/* quoted 64 bits hex */
+
+extern void rest_cache_init(void);
+
+extern int32 rest_cache_get(const int8 *key, int8 *body, int32 size, int32 *len,
+							int32 *status, int8 *etag);
+extern void rest_cache_begin(void);
+extern void rest_cache_put(const int8 *key, int32 status, const int8 *body, int32 len,
+						   int8 *etag);
+extern void rest_cache_end(void);
+extern void rest_cache_flush(void);
+
+#endif
@@ -561,12 +561,14 @@ static struct rest_handler drawer_coll_handler = {
 	.get    = drawer_coll_get,
 	.put    = drawer_coll_put,
 	.post   = drawer_coll_post,
+	.cache  = 1,
 };
 
 static struct rest_handler drawer_handler = {
 	.get    = drawer_get,
 	.put    = drawer_put,
 	.post   = drawer_post,
+	.cache  = 1,
 };
 
 static struct rest_handler drawer_coll_evt_handler = {
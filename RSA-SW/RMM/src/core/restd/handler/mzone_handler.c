@@ -711,12 +711,14 @@ static struct rest_handler mbp_coll_handler = {
 	.get    = mbp_coll_get,
 	.put    = mbp_coll_put,
 	.post   = mbp_coll_post,
+	.cache  = 1,
 };
 
 static struct rest_handler mbp_handler = {
 	.get    = mbp_get,
 	.put    = mbp_put,
 	.post   = mbp_post,
+	.cache  = 1,
 };
 
 static struct rest_handler mbp_coll_evt_handler = {
@@ -15,6 +15,7 @@
 
 #include "handler.h"
 #include <pthread.h>
+#include <spawn.h>
 #include "librmmcfg/rmm_cfg.h"
 #include "libredfish/msg_reg.h"
 #include "libutils/time.h"
@@ -121,28 +122,43 @@ static int32 process_reset_rack(uint8 option)
 	return 0;
 }
 
+extern char **environ;
+
+static void *reset_service_thread(void *arg)
+{
+	/* let the reply go out first */
+	sleep(2);
+	process_reset_rack(SERVICE_RESET_PREPARE);
+	return NULL;
+}
+
+/*
+ * restd is multithreaded, so there is no fork() here: a child could block
+ * on a lock another thread held at fork time, rmm_log's for one.
+ */
 static result_t reset_rack(int32 reset_mode, struct rest_uri_param *param)
 {
+	char *reboot_argv[] = {"sh", "-c", "sleep 2; reboot", NULL};
+	pthread_t tid;
 	pid_t pid;
 
 	HTTPD_DEBUG("reset mode:%s\n", (0 == reset_mode) ? RMM_JSON_RESET_MODE_SERVICE:RMM_JSON_RESET_MODE_RMM);
 
-	pid = fork();
-	if (0 == pid) {
-		close(param->fd);
-		sleep(2);
-		if (0 == reset_mode)
-			process_reset_rack(SERVICE_RESET_PREPARE);
-		else if (1 == reset_mode) {
-			HTTPD_INFO("RMM Reset\n");
-			if (system("reboot &") < 0)
-				exit(0);
+	if (0 == reset_mode) {
+		if (pthread_create(&tid, NULL, reset_service_thread, NULL) != 0) {
+			HTTPD_ERR("reset thread create failed\n");
+			return RESULT_OTHER_ERR;
+		}
+		pthread_detach(tid);
+	} else if (1 == reset_mode) {
+		HTTPD_INFO("RMM Reset\n");
+		if (posix_spawnp(&pid, "sh", NULL, NULL, reboot_argv, environ) != 0) {
+			HTTPD_ERR("reboot failed\n");
+			return RESULT_OTHER_ERR;
 		}
-		exit(0);
-	} else {
-		sleep(1);
-		return RESULT_OK;
 	}
+
+	return RESULT_OK;
 }
 
 static void *process_upgrade_thread(void *arg)
@@ -1050,6 +1066,7 @@ static struct rest_handler rack_handler = {
 	.get	= rack_get,
 	.put	= rack_put,
 	.post	= rack_post,
+	.cache	= 1,
 };
 
 static struct rest_handler rack_evt_handler = {
@@ -1018,18 +1018,21 @@ static struct rest_handler tzone_coll_handler = {
 	.get    = tzone_coll_get,
 	.put    = tzone_coll_put,
 	.post   = tzone_coll_post,
+	.cache  = 1,
 };
 
 static struct rest_handler tzone_handler = {
 	.get    = tzone_get,
 	.put    = tzone_put,
 	.post   = tzone_post,
+	.cache  = 1,
 };
 
 static struct rest_handler fan_coll_handler = {
 	.get    = fan_coll_get,
 	.put    = fan_coll_put,
 	.post   = fan_coll_post,
+	.cache  = 1,
 };
 
 static struct rest_handler fan_handler = {
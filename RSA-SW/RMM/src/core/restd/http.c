@@ -15,6 +15,8 @@
 
 #define _GNU_SOURCE
 #include <string.h>
+#include <poll.h>
+#include <netinet/tcp.h>
 #include "rest.h"
 #include "http.h"
 #include "websocket.h"
@@ -22,11 +24,12 @@
 
 
 static int32 add_headers(int8 *buf, int32 status, const int8 *title, const int8 *extra_header,
-			const int8 *mime_type);
+			const int8 *mime_type, int32 keep_alive);
 static int8 *file_mime_type(const int8 *name);
 static void decode_url(struct http_request *req, int8 *url);
 static int32 http_method(const int8 *method);
 static int8 *parse_reqline(int32 fd, int8 *str);
+static int32 get_http_head_sz(struct http_request *req);
 static int8 *get_request_line(struct http_request *req);
 static uint32 get_json_pointer(struct http_request *req);
 static int32 re_alloc_buff(struct http_request *req);
@@ -69,13 +72,22 @@ int32 http_write(int32 fd, const int8 *data, int32 len)
 {
 	int32 rc;
 	int32 offset = 0;
+	struct pollfd pfd;
 
 	while (offset < len) {
 		rc = write(fd, data + offset, len - offset);
 		if (rc < 0) {
 			if (errno == EINTR)
 				continue;
-			return -1;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return -1;
+
+			/* nonblocking connection, wait as long as a blocking one would */
+			pfd.fd = fd;
+			pfd.events = POLLOUT;
+			if (poll(&pfd, 1, HTTPD_TIMO * 1000) <= 0)
+				return -1;
+			continue;
 		}
 		offset += rc;
 	}
@@ -90,7 +102,8 @@ void send_error(int32 fd, int32 status, const int8 *title, const int8 *extra_hea
 	int32 str_len = 0;
 	int8 buf[BUFFSIZ];
 
-	len += add_headers(buf, status, title, extra_header, "text/html");
+	/* no Content-Length, the connection is closed after it */
+	len += add_headers(buf, status, title, extra_header, "text/html", 0);
 	str_len = len;
 	len += snprintf(&buf[len], (BUFFSIZ - str_len), 
 				"<HTML>"
@@ -107,38 +120,23 @@ void send_error(int32 fd, int32 status, const int8 *title, const int8 *extra_hea
 }
 
 
-void *http_process(void *args)
+int32 http_request_init(struct http_request *req, int32 fd, usockaddr *from)
 {
-	int32		fd;
-	struct	http_request *req;
-	int8 *cp = NULL;
-	int8 *line = NULL;
-	int8 *method = NULL;
-	int8 *url = NULL;
-	int8 *protocol = NULL;
 	struct timeval timo;
+	int32 rc_r, rc_s;
 	int32 optval = 1;
-	int32 rc, rc_r, rc_s;
-	int32 r = 0;
 
-	if (NULL == args)
-		return NULL;
-
-	req = (struct http_request *)args;
-	fd = req->fd;
+	memset(req, 0, sizeof(struct http_request));
+	req->fd = fd;
+	req->from = *from;
 
 	req->buff = malloc(BUFFSIZ);
 	req->buff_size = BUFFSIZ;
 	if (NULL == req->buff) {
-		HTTPD_ERR("get_request_line malloc %d fail\n", BUFFSIZ);
-		free(args);
-		return NULL;
+		HTTPD_ERR("http_request_init malloc %d fail\n", BUFFSIZ);
+		return -1;
 	}
-	memset(req->buff, 0, BUFFSIZ);
-
-	rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
-	if (rc < 0)
-		HTTPD_ERR("setsockopt error rc=%d errno=%d %s\n", rc, errno, strerror(errno));
+	req->buff[0] = '\0';
 
 	timo.tv_sec  = HTTPD_TIMO;
 	timo.tv_usec = 0;
@@ -146,32 +144,48 @@ void *http_process(void *args)
 	rc_r = setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timo, sizeof(timo));
 	rc_s = setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timo, sizeof(timo));
 	if (rc_r < 0 || rc_s < 0)
-		HTTPD_ERR("setsockopt error fd=%d rc=%d rc_r=%d rc_s=%d errno=%d %s\n", fd, rc, rc_r, rc_s, errno, strerror(errno));
+		HTTPD_ERR("setsockopt error fd=%d rc_r=%d rc_s=%d errno=%d %s\n", fd, rc_r, rc_s, errno, strerror(errno));
+
+	/* header and body are written separately, do not wait for the ACK */
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval)) < 0)
+		HTTPD_ERR("setsockopt TCP_NODELAY error fd=%d errno=%d %s\n", fd, errno, strerror(errno));
+
+	return 0;
+}
+
+void http_request_free(struct http_request *req)
+{
+	if (NULL != req->buff) {
+		free(req->buff);
+		req->buff = NULL;
+	}
+}
+
+/* Parse the request line and headers, the whole header is in the buffer. */
+static int32 parse_request_head(struct http_request *req)
+{
+	int32 fd = req->fd;
+	int8 *cp = NULL;
+	int8 *line = NULL;
+	int8 *method = NULL;
+	int8 *url = NULL;
+	int8 *protocol = NULL;
 
 	/* GET / HTTP/1.1 */
 	method = get_request_line(req);
 	if (method == NULL)
-		goto close_task;
+		return -1;
 
 	url = parse_reqline(fd, method);
 	if (url == NULL)
-		goto close_task;
+		return -1;
 
 	protocol = parse_reqline(fd, url);
 	if (protocol == NULL)
-		goto close_task;
+		return -1;
 
 	req->method = http_method(method);
-
-	if (req->method == M_OPTIONS) {
-		send_error(fd, 204, "No Content", NULL, "Method OPTIONS.");
-		goto close_task;
-	}
-
-	if (req->method == M_UNKNOWN) {
-		send_error(fd, 400, "Bad Request", NULL, "Method Not Support.");
-		goto close_task;
-	}
+	req->keep_alive = (strcasecmp(protocol, HTTPD_PROTOCOL) == 0);
 
 	decode_url(req, url);
 
@@ -194,6 +208,11 @@ void *http_process(void *args)
 			/* Firefox: [Connection: keep-alive, Upgrade] */
 			if (strcasestr(cp, "Upgrade") != NULL)
 				req->is_connection_upgrade = 1;
+
+			if (strcasestr(cp, "close") != NULL)
+				req->keep_alive = 0;
+			else if (strcasestr(cp, "keep-alive") != NULL)
+				req->keep_alive = 1;
 		} else if (strncasecmp(line, "Sec-WebSocket-Key:", 18) == 0) {
 			cp = &line[18];
 			cp += strspn(cp, " \t");
@@ -210,12 +229,6 @@ void *http_process(void *args)
 			cp = &line[15];
 			cp += strspn(cp, " \t");
 			req->content_length = atol(cp);
-
-			if ((BUFFSIZ < req->content_length + MAX_HEADER_LEN) &&
-				(req->buff_size != req->content_length + MAX_HEADER_LEN) + 1) {
-				re_alloc_buff(req);
-				memset(req->buff + BUFFSIZ, 0, req->buff_size - BUFFSIZ);
-			}
 		} else if (strncasecmp(line, "Content-Type:", 13) == 0) {
 			cp = &line[13];
 			cp += strspn(cp, " \t");
@@ -224,72 +237,158 @@ void *http_process(void *args)
 			cp = &line[5];
 			cp += strspn(cp, " \t");
 			req->host = cp;
+		} else if (strncasecmp(line, "If-None-Match:", 14) == 0) {
+			cp = &line[14];
+			cp += strspn(cp, " \t");
+			req->if_none_match = cp;
 		}
 	}
 
-	HTTPD_INFO("Left %d bytes HTTP data with Content-Length: %ld req->sz[%d] req->pos[%d]\n",
-			req->sz - req->pos, req->content_length, req->sz, req->pos);
-
-	if (line == NULL || req->path[0] != '/')
+	if (line == NULL || req->path[0] != '/') {
 		send_error(fd, 400, "Bad Request", NULL, "Bad Request!");
+		return -1;
+	}
 
-	if ((0 != req->content_length) && (req->sz != req->hd_sz + req->content_length)) {
-		while ((r = http_read(req->fd, req->buff + req->sz, req->buff_size - req->sz)) > 0) {
-			req->sz += r;
-			if (req->sz == req->hd_sz + req->content_length)
-				break;
-		}
+	if (req->content_length < 0 || req->content_length > HTTPD_MAX_CONTENT) {
+		send_error(fd, 413, "Request Entity Too Large", NULL, "Request Entity Too Large.");
+		return -1;
 	}
 
-	if (req->is_websocket)
-		ws_process(req);
-	else {
-		uint32 i = 0;
-		int8 *file = NULL;
-		int8 *path = req->path;
-		int8 *pTmp = path;
-		int8 prefix[MAX_URL] = {0};
-		int8 new_link[MAX_URL + 8] = {0};
-
-		rmm_cfg_get_rest_prefix(prefix, MAX_URL);
-		snprintf(new_link, (MAX_URL + 8), "%s%s", prefix, "/rack");
-
-		/*TODO: move to correct place */
-		get_json_pointer(req);
-
-		/* remove redundant '/' */
-		for (; *(path+i) != '\0'; i++) {
-			if ((*(path+i) == '/') && (*(path+i+1) == '/'))
-				continue;
-			*pTmp++ = *(path+i);
+	/* one more byte to terminate the body */
+	if (req->hd_sz + req->content_length + 1 > req->buff_size) {
+		if (re_alloc_buff(req) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Read what is available of a request from the connection. The connection
+ * is nonblocking, HTTP_REQ_PARTIAL is returned when it has to wait for more.
+ * Bytes read beyond the request are kept for the next one.
+ */
+int32 http_read_request(struct http_request *req)
+{
+	int32 r = 0;
+
+	for (;;) {
+		if (req->hd_sz == 0 && get_http_head_sz(req) != 0) {
+			if (parse_request_head(req) != 0)
+				return HTTP_REQ_ERROR;
+		}
+
+		if (req->hd_sz != 0 && req->sz >= req->hd_sz + req->content_length) {
+			req->next = req->hd_sz + req->content_length;
+			return HTTP_REQ_COMPLETE;
 		}
-		*pTmp = '\0';
-		if ((path[1] == '\0')
-			|| (strncasecmp(path, new_link, strlen(new_link)) == 0))
-			file = NULL;
-		else
-			file = path;
-
-		if (file != NULL)
-			send_file(req->fd, file);
-		else
-			rest_process(req);
+
+		if (req->sz >= req->buff_size - 1) {
+			send_error(req->fd, 400, "Bad Request", NULL, "Request header too long.");
+			return HTTP_REQ_ERROR;
+		}
+
+		r = http_read(req->fd, req->buff + req->sz, req->buff_size - 1 - req->sz);
+		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return HTTP_REQ_PARTIAL;
+		if (r <= 0)
+			return HTTP_REQ_ERROR;
+
+		req->sz += r;
+		req->buff[req->sz] = '\0';
 	}
+}
 
-close_task:
-	close(fd);
-	if (NULL != req->buff) {
-		free(req->buff);
-		req->buff = NULL;
+/* Drop the processed request, keeping the pipelined bytes after it. */
+void http_next_request(struct http_request *req)
+{
+	int32 fd = req->fd;
+	usockaddr from = req->from;
+	int8 *buff = req->buff;
+	int32 buff_size = req->buff_size;
+	int32 left = req->sz - req->next;
+
+	memmove(buff, buff + req->next, left);
+	buff[left] = '\0';
+
+	memset(req, 0, sizeof(struct http_request));
+	req->fd = fd;
+	req->from = from;
+	req->buff = buff;
+	req->buff_size = buff_size;
+	req->sz = left;
+}
+
+/* Process a complete request, return what to do with the connection. */
+int32 http_process(struct http_request *req)
+{
+	uint32 i = 0;
+	int32 fd = req->fd;
+	int32 rc = HTTP_CONN_KEEP_ALIVE;
+	int8 next_ch;
+	int8 *file = NULL;
+	int8 *path = req->path;
+	int8 *pTmp = path;
+	int8 prefix[MAX_URL] = {0};
+	int8 new_link[MAX_URL + 8] = {0};
+
+	HTTPD_INFO("Left %d bytes HTTP data with Content-Length: %ld req->sz[%d] req->pos[%d]\n",
+			req->next - req->pos, req->content_length, req->sz, req->pos);
+
+	if (req->method == M_OPTIONS) {
+		send_error(fd, 204, "No Content", NULL, "Method OPTIONS.");
+		return HTTP_CONN_CLOSE;
 	}
-	free(args);
-	HTTPD_INFO("\nrest_req_thread[%lld] exit, fd[%d], errno:%d %s\n", (uint64)(req->tid_rest_req), fd, errno, strerror(errno));
-	return NULL;
+
+	if (req->method == M_UNKNOWN) {
+		send_error(fd, 400, "Bad Request", NULL, "Method Not Support.");
+		return HTTP_CONN_CLOSE;
+	}
+
+	if (req->is_websocket)
+		return HTTP_CONN_WEBSOCKET;
+
+	/* the body is parsed as a string, hide the next request */
+	next_ch = req->buff[req->next];
+	req->buff[req->next] = '\0';
+
+	rmm_cfg_get_rest_prefix(prefix, MAX_URL);
+	snprintf(new_link, (MAX_URL + 8), "%s%s", prefix, "/rack");
+
+	/*TODO: move to correct place */
+	get_json_pointer(req);
+
+	/* remove redundant '/' */
+	for (; *(path+i) != '\0'; i++) {
+		if ((*(path+i) == '/') && (*(path+i+1) == '/'))
+			continue;
+		*pTmp++ = *(path+i);
+	}
+	*pTmp = '\0';
+	if ((path[1] == '\0')
+		|| (strncasecmp(path, new_link, strlen(new_link)) == 0))
+		file = NULL;
+	else
+		file = path;
+
+	if (file != NULL) {
+		if (send_file(req, file) != 0)
+			rc = HTTP_CONN_CLOSE;
+	} else
+		rest_process(req);
+
+	req->buff[req->next] = next_ch;
+
+	if (!req->keep_alive)
+		rc = HTTP_CONN_CLOSE;
+
+	return rc;
 }
 
 /* @name starts from "/", such as "/index.html" */
-void send_file(int32 sockfd, const int8 *name)
+int32 send_file(struct http_request *req, const int8 *name)
 {
+	int32 sockfd = req->fd;
 	int32 fd;
 	int32 r, len;
 	int64 filesize;
@@ -300,15 +399,14 @@ void send_file(int32 sockfd, const int8 *name)
 
 	if (stat(path, &st) < 0 || (fd = open(path, O_RDONLY)) < 0) {
 		send_error(sockfd, 404, "Not Found", NULL, "File not Found.");
-		close(sockfd);
 		HTTPD_ERR("Not found file %s\n", path);
-		return;
+		return -1;
 	}
 
 	filesize = st.st_size;
 	snprintf(contentlen, sizeof(contentlen), "Content-Length: %lld", filesize);
 
-	len = add_headers(buf, 200, "OK", contentlen, file_mime_type(name));
+	len = add_headers(buf, 200, "OK", contentlen, file_mime_type(name), req->keep_alive);
 	http_write(sockfd, buf, len);
 
 	while (filesize > 0) {
@@ -323,6 +421,9 @@ void send_file(int32 sockfd, const int8 *name)
 	}
 
 	close(fd);
+
+	/* the client cannot tell where the response ends otherwise */
+	return filesize == 0 ? 0 : -1;
 }
 
 
@@ -363,7 +464,7 @@ static int8 *file_mime_type(const int8 *name)
 
 
 static int32 add_headers(int8 *buf, int32 status, const int8 *title, const int8 *extra_header,
-			const int8 *mime_type)
+			const int8 *mime_type, int32 keep_alive)
 {
 	int32 len = 0;
 	time_t now;
@@ -389,7 +490,7 @@ static int32 add_headers(int8 *buf, int32 status, const int8 *title, const int8
 	len += snprintf(&buf[len], (BUFFSIZ - len), "Access-Control-Allow-Methods: GET,PUT,POST,DELETE\r\n");
 	len += snprintf(&buf[len], (BUFFSIZ - len), "Allow:OPTIONS,POST,PUT\r\n");
 	len += snprintf(&buf[len], (BUFFSIZ - len), "Proxy-Connection: Keep-Alive\r\n");
-	len += snprintf(&buf[len], (BUFFSIZ - len), "Connection: close\r\n");
+	len += snprintf(&buf[len], (BUFFSIZ - len), "Connection: %s\r\n", keep_alive ? "keep-alive" : "close");
 	len += snprintf(&buf[len], (BUFFSIZ - len), "\r\n");
 
 	return len;
@@ -458,39 +559,31 @@ static int8 *parse_reqline(int32 fd, int8 *str)
 
 static int32 get_http_head_sz(struct http_request *req)
 {
-	int32 i = 0;
-	int8 *buf = NULL;
+	int8 *end = NULL;
 
 	if (NULL == req)
 		return 0;
 
-	buf = req->buff;
+	end = memmem(req->buff, req->sz, "\r\n\r\n", 4);
+	if (end != NULL)
+		req->hd_sz = end - req->buff + 4;
 
-	for (i = 0; i < req->sz; i++) {
-		if ((i+3 < req->sz) &&
-			(0 == memcmp(&buf[i], "\r\n\r\n", 4))) {
-			req->hd_sz = i+3+1;
-			break;
-		}
-	}
 	return req->hd_sz;
 }
 
+/* Lines are only taken from the header, which is read completely first. */
 static int8 *get_request_line(struct http_request *req)
 {
 	if (NULL == req)
 		return NULL;
 
-	int32 r = 0;
 	int32 i = req->pos;
 	int8 *buf = NULL;
 	int8 ch, *line = NULL;
 
 	buf = req->buff;
 
-
-again:
-	for (; req->pos < req->sz; req->pos++) {
+	for (; req->pos < req->hd_sz; req->pos++) {
 		ch = buf[req->pos];
 
 		if (ch == '\r') {
@@ -502,13 +595,6 @@ again:
 		}
 	}
 
-	if ((line == NULL)
-		&& (r = http_read(req->fd, buf + req->sz, req->buff_size - req->sz)) > 0) {
-		req->sz += r;
-		get_http_head_sz(req);
-		goto again;
-	}
-
 	return line;
 }
 
@@ -522,7 +608,7 @@ static uint32 get_json_pointer(struct http_request *req)
 	int32 checker_bracket = 0; /* checker of '['  ']' */
 	int32 checker_quote = 0;   /* checked of '"' */
 
-	for (i = 0; i < req->sz; i++) {
+	for (i = 0; i < req->next; i++) {
 		switch (req->buff[i]) {
 		case '{':
 			checker_brace++;
@@ -583,18 +669,22 @@ static int32 re_alloc_buff(struct http_request *req)
 		req->content_type_offset = (int32)(req->content_type - req->buff);
 	if (NULL != req->host)
 		req->host_offset = (int32)(req->host - req->buff);
+	if (NULL != req->if_none_match)
+		req->if_none_match_offset = (int32)(req->if_none_match - req->buff);
 	if (NULL != req->path)
 		req->path_offset = (int32)(req->path - req->buff);
 	if (NULL != req->query)
 		req->query_offset = (int32)(req->query - req->buff);
 
-	req->buff_size = req->content_length + MAX_HEADER_LEN + 1;
-	req->buff = (int8 *)realloc(req->buff, req->content_length + MAX_HEADER_LEN + 1);
-	if (NULL == req->buff)
+	req->buff = (int8 *)realloc(req->buff, req->hd_sz + req->content_length + 1);
+	if (NULL == req->buff) {
+		req->buff = orig;
 		return -1;
+	}
 
 	if (orig != req->buff)
-		HTTPD_DEBUG("\nrealloc buffer size from %d to %ld\n", BUFFSIZ, req->content_length + MAX_HEADER_LEN);
+		HTTPD_DEBUG("\nrealloc buffer size from %d to %ld\n", req->buff_size, req->hd_sz + req->content_length + 1);
+	req->buff_size = req->hd_sz + req->content_length + 1;
 
 	if (NULL != req->sec_websocket_key)
 		req->sec_websocket_key = req->buff + req->sec_websocket_key_offset;
@@ -604,6 +694,8 @@ static int32 re_alloc_buff(struct http_request *req)
 		req->content_type = req->buff + req->content_type_offset;
 	if (NULL != req->host)
 		req->host = req->buff + req->host_offset;
+	if (NULL != req->if_none_match)
+		req->if_none_match = req->buff + req->if_none_match_offset;
 	if (NULL != req->path)
 		req->path = req->buff + req->path_offset;
 	if (NULL != req->query)
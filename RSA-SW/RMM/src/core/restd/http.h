@@ -41,6 +41,12 @@
 #define HTTPD_RFC1123FMT	"%a, %d %b %Y %H:%M:%S GMT"
 #define HTTPD_TIMO			1	/* snd & rcv timeout in seconds, 1s */
 
+#define HTTPD_WORKER_NUM	4	/* threads processing requests */
+#define HTTPD_MAX_CONN		128	/* connections served at once, more wait in listen backlog */
+#define HTTPD_BACKLOG		64
+#define HTTPD_KEEPALIVE_TIMO	5	/* idle connection is closed after it, in seconds */
+#define HTTPD_MAX_CONTENT	(1024 * 1024)
+
 
 #include "librmmlog/rmmlog.h"
 #include "libutils/types.h"
@@ -60,6 +66,20 @@ typedef union {
 #define MAX_HEADER_LEN	1024
 #define BUFFSIZ			8192
 
+/* http_read_request() result */
+enum {
+	HTTP_REQ_ERROR = -1,
+	HTTP_REQ_PARTIAL,
+	HTTP_REQ_COMPLETE
+};
+
+/* http_process() result, what to do with the connection */
+enum {
+	HTTP_CONN_CLOSE = 0,
+	HTTP_CONN_KEEP_ALIVE,
+	HTTP_CONN_WEBSOCKET
+};
+
 enum {
 	M_GET = 1,
 	M_PUT,
@@ -76,8 +96,9 @@ struct http_request {
 	int32 hd_sz;  /*http header size*/
 	int32 sz;		/* how many we read */
 	int32 pos;	/* how many we consume */
+	int32 next;		/* start of the next pipelined request */
+	int32 keep_alive;
 
-	pthread_t tid_rest_req;
 	int32 method;
 	int8 *path;
 	int32 path_offset;
@@ -96,6 +117,8 @@ struct http_request {
 	int32 content_type_offset;
 	int8 *host;
 	int32 host_offset;
+	int8 *if_none_match;
+	int32 if_none_match_offset;
 
 	usockaddr from;
 
@@ -110,11 +133,14 @@ extern int32 hexit(int8 c);
 extern int32 http_read(int32 fd, int8 *buff, int32 len);
 extern int32 http_write(int32 fd, const int8 *data, int32 len);
 
-extern void send_file(int32 sockfd, const int8 *name);
+extern int32 send_file(struct http_request *req, const int8 *name);
 extern void send_error(int32 fd, int32 status, const int8 *title, const int8 *extra_header, const int8 *text);
-extern void *rest_req_thread(void *args);
 extern void build_rack_urls(void);
 
-extern void *http_process(void *args);
+extern int32 http_request_init(struct http_request *req, int32 fd, usockaddr *from);
+extern void http_request_free(struct http_request *req);
+extern int32 http_read_request(struct http_request *req);
+extern void http_next_request(struct http_request *req);
+extern int32 http_process(struct http_request *req);
 
 #endif
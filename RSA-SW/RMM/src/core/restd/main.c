@@ -23,6 +23,8 @@
 
 #include "http.h"
 #include "rest.h"
+#include "server.h"
+#include "cache.h"
 #include "handler/handler.h"
 #include "libjsonrpcapi/libjsonrpcapi.h"
 #include "libjsonrpcapi/assetd_socket.h"
@@ -72,7 +74,7 @@ static int32 open_listen_socket(uint16 port)
 	}
 	setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger_opt, sizeof(linger_opt));
 
-	if (listen(fd, 1) < 0) {
+	if (listen(fd, HTTPD_BACKLOG) < 0) {
 		HTTPD_ERR("Fail at socket listen: %s\n", strerror(errno));
 		goto fail;
 	}
@@ -84,41 +86,10 @@ fail:
 	return -1;
 }
 
-static void *ipmi_cb_thread(void *unused)
-{
-	int32	rc;
-	int32	max_fd;
-	fd_set	rfds;
-
-	prctl(PR_SET_NAME, "ipmi_cb_thread");
-	while (1) {
-		max_fd = -1;
-		FD_ZERO(&rfds);
-		libjipmi_callback_selectfds(&rfds, &max_fd);
-		rc = select(max_fd + 1, &rfds, NULL, NULL, NULL);
-		if (rc <= 0) {
-			HTTPD_IPMI_PRINT("select timeout\n");
-			continue;
-		}
-
-		libjipmi_callback_processfds(&rfds);
-	}
-	printf("ipmi_cb_thread task exit, errno:%d %s\n", errno, strerror(errno));
-	return NULL;
-}
-
-
 static int32 main_loop()
 {
-	int32 		rc = 0;
-	int32 		conn_fd = -1;
 	int32 		listen_fd = -1;
-	fd_set		rfds;
-	socklen_t	addrlen = 0;
-	usockaddr	usa;
-	pthread_t	tid_ipmi_cb;
 	struct sigaction	sa;
-	struct http_request *request = NULL;
 	int32 port  = 0;
 
 	/* ingore sigpipe */
@@ -126,6 +97,7 @@ static int32 main_loop()
 	sigaction(SIGPIPE, &sa, 0);
 	
 	rest_register_handlers();
+	rest_cache_init();
 
 	port = rmm_cfg_get_port(RESTD_PORT);
 	listen_fd = open_listen_socket(port);
@@ -136,42 +108,7 @@ static int32 main_loop()
 
 	fprintf(stderr, "Mini-HTTP Server is Running ...\n");
 
-	/* Create IPMI callback thread. */
-	if (pthread_create(&tid_ipmi_cb, NULL, ipmi_cb_thread, NULL) != 0) {
-		close(listen_fd);
-		HTTPD_ERR("Failed to create ipmi callback thread!\n");
-		return -1;
-	}
-
-	for (;;) {
-			FD_ZERO(&rfds);
-			FD_SET(listen_fd, &rfds);
-			rc = select(listen_fd + 1, &rfds, NULL, NULL, NULL);
-			if (rc <= 0)
-				continue;
-	
-			addrlen = sizeof(usa);
-			conn_fd = accept(listen_fd, &usa.sa, &addrlen);
-			if (conn_fd < 0)
-				continue;
-			HTTPD_INFO("restd accepted a new connection: fd = %d\n", conn_fd);
-	
-			request = malloc(sizeof(struct http_request));
-			if (NULL == request) {
-				HTTPD_ERR("Malloc error: %s\n", strerror(errno));
-				return -1;
-			}
-			memset(request, 0, sizeof(struct http_request));
-			request->fd = conn_fd;
-			request->from = usa;
-	
-			if (pthread_create(&request->tid_rest_req, NULL, http_process, (void *)request) != 0) {
-				HTTPD_ERR("Failed to create rest_req_thread!\n");
-				return -1;
-			}
-		}
-
-	return 0;
+	return http_server_run(listen_fd);
 }
 
 static int32 is_asset_module_ready(int32 max_retry)
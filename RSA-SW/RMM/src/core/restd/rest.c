@@ -15,6 +15,7 @@
 
 #include "rest.h"
 #include "libjson/json.h"
+#include "cache.h"
 #include "handler/handler.h"
 #include "librmmcfg/rmm_cfg.h"
 #include "libutils/string.h"
@@ -32,6 +33,27 @@ static struct rest_uri_node root_uri_node = {
 	.rest_handler  = NULL,
 };
 
+/*
+ * Registered URIs are collected in the tree of rest_uri_node above and
+ * compiled into rest_routes[] when all handlers are registered. The
+ * children of a route are stored next to each other, literal ones first
+ * and the variable one last, so matching a path segment only compares it
+ * with a few adjacent entries and a lookup never allocates.
+ */
+struct rest_route {
+	uint16 child;		/* first child in rest_routes[] */
+	uint8  child_num;
+	uint8  isvar;
+	int32  name_len;
+	const int8 *name;	/* variable name for a variable segment */
+	struct rest_handler *rest_handler;
+};
+
+static struct rest_route *rest_routes;
+
+static const int8 *rest_uris[MAX_REST_URIS];
+static int32 rest_uri_num;
+
 static const struct http_response_status http_resp[] = {
 	{HTTP_SUCCESS, "Success"},
 	{HTTP_CREATED, "Created"},
@@ -45,12 +67,14 @@ static const struct http_response_status http_resp[] = {
 
 
 static void compile_rest_uri(int32 num, int8 *ids[], const struct rest_handler *handler);
+static void compile_rest_routes(void);
 static int32 split_path(int8 *path, int8 *ids[]);
 static int32 parse_query_params(int8 *query, struct rest_param_key *params);
 static struct rest_uri_node *create_rest_node(int8 *name,
 											  struct list_head *parent);
-static void send_json_reply(int32 fd, int32 status, const int8 *title, const int8 *json, int32 jsonlen);
-static struct rest_handler *lookup_rest_handle(struct rest_uri_param *param);
+static void send_json_reply(struct http_request *req, int32 status, const int8 *title, const int8 *json, int32 jsonlen,
+							const int8 *etag);
+static void send_not_modified(struct http_request *req, const int8 *etag);
 static json_t *handle_rest_req(const struct rest_uri_param *param, const struct rest_handler *handler);
 
 
@@ -63,6 +87,8 @@ void rest_register_handlers(void)
 	register_drawer_handler();
 	register_tzone_handler();
 	register_fan_handler();
+
+	compile_rest_routes();
 }
 
 void register_handler(const int8 *url, const struct rest_handler *handler)
@@ -77,6 +103,8 @@ void register_handler(const int8 *url, const struct rest_handler *handler)
 	insert_str(new_link, url, 0, prefix);/// "http://%s:%d/rack/" --->http://%s:%d/prefix/rack/
 
 	strncpy_safe(path, new_link, MAX_HEADER_LEN, MAX_HEADER_LEN - 1);
+	if (rest_uri_num < MAX_REST_URIS)
+		rest_uris[rest_uri_num++] = strdup(path);
 	num = split_path(path, ids);
 
 	compile_rest_uri(num, ids, handler);
@@ -106,22 +134,83 @@ int8 *rest_query_value(struct rest_uri_param *param, int8 *name)
 	return NULL;
 }
 
+int32 rest_registered_uris(const int8 ***uris)
+{
+	*uris = rest_uris;
+	return rest_uri_num;
+}
+
 void update_response_info(struct rest_uri_param *param, int32 status)
 {
 	param->status = status;
 }
 
+/* Cached replies are keyed by the host too, it is part of the links. */
+static int32 make_cache_key(struct http_request *req, int8 *key)
+{
+	int32 len;
+
+	len = snprintf(key, REST_CACHE_KEY_LEN, "%s %s?%s",
+				   req->host ? req->host : "", req->path,
+				   req->query ? req->query : "");
+
+	return (len < REST_CACHE_KEY_LEN) ? 0 : -1;
+}
+
+static int32 etag_match(const int8 *if_none_match, const int8 *etag)
+{
+	int32 len = strlen(etag);
+	const int8 *cp = if_none_match;
+
+	if (cp == NULL)
+		return 0;
+
+	while (*cp != '\0') {
+		cp += strspn(cp, " \t,");
+		if (*cp == '*' || strncmp(cp, etag, len) == 0)
+			return 1;
+		cp += strcspn(cp, ",");
+	}
+
+	return 0;
+}
+
+static void send_rest_reply(struct http_request *req, int32 status, const int8 *body, int32 sz,
+							const int8 *etag)
+{
+	int32 i;
+
+	if (etag != NULL && etag_match(req->if_none_match, etag)) {
+		send_not_modified(req, etag);
+		return;
+	}
+
+	for (i = 0; i < sizeof(http_resp)/sizeof(struct http_response_status); i++) {
+		if (status == http_resp[i].status) {
+			send_json_reply(req, http_resp[i].status,
+							http_resp[i].title, body, sz, etag);
+			return;
+		}
+	}
+
+	send_json_reply(req, 200, "OK", body, sz, etag);
+}
+
 void rest_process(struct http_request *req)
 {
 	json_t *result = NULL;
 	struct rest_handler *handle;
 	struct rest_uri_param param;
+	int8 key[REST_CACHE_KEY_LEN];
+	int8 etag[REST_CACHE_ETAG_LEN];
+	int8 body[100*1024];
+	int32 cached = 0;
+	int32 sz;
 	int32 i = 0;
 
 	param.httpmethod     = req->method;
 	param.content_length = req->content_length;
 	param.fd             = req->fd;
-	param.num_nodes      = split_path(req->path, param.nodes);
 	param.num_query_keys = parse_query_params(req->query, param.query_keys);
 	param.status         = HTTP_ACCEPTED;
 	param.host           = req->host;
@@ -129,43 +218,54 @@ void rest_process(struct http_request *req)
 	param.json_data_sz = req->json_end - req->json_start + 1;
 	param.json_data = req->buff + req->json_start;
 
-	handle = lookup_rest_handle(&param);
-	if (handle != NULL)
-		result = handle_rest_req(&param, handle);
-	else
+	/* before the path is split by rest_route() */
+	if (req->method == M_GET && make_cache_key(req, key) == 0)
+		cached = 1;
+
+	handle = rest_route(&param, req->path);
+	if (handle == NULL) {
+		cached = 0;
 		result = NULL;
+	} else if (cached && handle->cache) {
+		if (rest_cache_get(key, body, sizeof(body), &sz, &param.status, etag) == 0) {
+			send_rest_reply(req, param.status, body, sz, etag);
+			return;
+		}
 
-	if (result != NULL) {
-		int32 sz;
-		int8 body[100*1024];
+		rest_cache_begin();
+		result = handle_rest_req(&param, handle);
+		rest_cache_end();
+	} else {
+		cached = 0;
+		result = handle_rest_req(&param, handle);
 
-		sz = json_format(result, body, sizeof(body));
+		/* the request may have changed what cached replies show */
+		if (req->method != M_GET)
+			rest_cache_flush();
+	}
 
-		for (i = 0; i < sizeof(http_resp)/sizeof(struct http_response_status); i++) {
-			if (param.status == http_resp[i].status) {
-				send_json_reply(req->fd, http_resp[i].status,
-								http_resp[i].title, body, sz);
+	if (result != NULL) {
+		sz = json_format(result, body, sizeof(body));
+		json_free(result);
 
-				json_free(result);
-				return;
-			}
+		/* errors are not cached, the next request may succeed */
+		if (cached && sz > 0 && param.status >= 200 && param.status < 300) {
+			rest_cache_put(key, param.status, body, sz, etag);
+			send_rest_reply(req, param.status, body, sz, etag);
+		} else {
+			send_rest_reply(req, param.status, body, sz, NULL);
 		}
-
-		send_json_reply(req->fd, 200, "OK", body, sz);
 	} else {
 		for (i = 0; i < sizeof(http_resp)/sizeof(struct http_response_status); i++) {
 			if (param.status == http_resp[i].status) {
-				send_json_reply(req->fd, http_resp[i].status,
-								http_resp[i].title, NULL, 0);
+				send_json_reply(req, http_resp[i].status,
+								http_resp[i].title, NULL, 0, NULL);
 				return;
 			}
 		}
 
-		send_json_reply(req->fd, 400, "Invalid REST request", "{}", 2);
+		send_json_reply(req, 400, "Invalid REST request", "{}", 2, NULL);
 	}
-
-	if (NULL != result)
-		json_free(result);
 }
 
 
@@ -275,6 +375,65 @@ static void compile_rest_uri(int32 num, int8 *ids[], const struct rest_handler *
 	leaf->rest_handler = (struct rest_handler *)handler;
 }
 
+static int32 count_rest_nodes(struct rest_uri_node *node)
+{
+	int32 num = 1;
+	struct rest_uri_node *n;
+
+	list_for_each_entry(n, &node->subnode, list)
+		num += count_rest_nodes(n);
+
+	return num;
+}
+
+static void add_rest_route(struct rest_uri_node **queue, int32 *num, struct rest_uri_node *node)
+{
+	struct rest_route *route = &rest_routes[*num];
+
+	route->isvar = node->isvar;
+	route->name = node->name;
+	route->name_len = strlen(node->name);
+	route->rest_handler = node->rest_handler;
+
+	queue[(*num)++] = node;
+}
+
+/* Lay out the URI tree breadth first, children of a node are adjacent. */
+static void compile_rest_routes(void)
+{
+	int32 i, num, total;
+	struct rest_uri_node *n;
+	struct rest_uri_node **queue;
+	struct rest_route *route;
+
+	total = count_rest_nodes(&root_uri_node);
+	rest_routes = calloc(total, sizeof(struct rest_route));
+	queue = malloc(total * sizeof(struct rest_uri_node *));
+	if (rest_routes == NULL || queue == NULL)
+		FATAL("No memory for restd REST, exiting ...\n");
+
+	num = 0;
+	add_rest_route(queue, &num, &root_uri_node);
+
+	for (i = 0; i < num; i++) {
+		route = &rest_routes[i];
+		route->child = num;
+
+		list_for_each_entry(n, &queue[i]->subnode, list) {
+			if (!n->isvar)
+				add_rest_route(queue, &num, n);
+		}
+		list_for_each_entry(n, &queue[i]->subnode, list) {
+			if (n->isvar)
+				add_rest_route(queue, &num, n);
+		}
+
+		route->child_num = num - route->child;
+	}
+
+	free(queue);
+}
+
 
 static int32 parse_query_params(int8 *query, struct rest_param_key *params)
 {
@@ -321,67 +480,104 @@ static int32 parse_query_params(int8 *query, struct rest_param_key *params)
 	return i;
 }
 
-static void send_json_reply(int32 fd, int32 status, const int8 *title, const int8 *json, int32 jsonlen)
+static void send_json_reply(struct http_request *req, int32 status, const int8 *title, const int8 *json, int32 jsonlen,
+							const int8 *etag)
 {
 	int32 len;
 	int8 header[1024];
 
+	if ((json == NULL) || (jsonlen <= 0)) {
+		json = "{}";
+		jsonlen = 2;
+	}
+
 	len = snprintf(header, sizeof(header),
 			"%s %d %s\r\n"
 			"Server: %s\r\n"
 			"Access-Control-Allow-Origin: *\r\n"
 			"Content-Type: application/json\r\n"
+			"Content-Length: %d\r\n"
+			"%s%s%s"
 			"Access-Control-Allow-Methods: GET,PUT,POST,DELETE\r\n"
 			"Access-Control-Allow-Headers: Content-Type\r\n"
 			"Proxy-Connection: Keep-Alive\r\n"
-			"Connection: close\r\n"
+			"Connection: %s\r\n"
 			"\r\n",
-			HTTPD_PROTOCOL, status, title, HTTPD_SERVER_NAME);
+			HTTPD_PROTOCOL, status, title, HTTPD_SERVER_NAME, jsonlen,
+			etag ? "ETag: " : "", etag ? etag : "", etag ? "\r\n" : "",
+			req->keep_alive ? "keep-alive" : "close");
 
-	http_write(fd, header, len);
-
-	if ((json != NULL) && (jsonlen > 0))
-		http_write(fd, json, jsonlen);
-	else
-		http_write(fd, "{}", 2);
+	http_write(req->fd, header, len);
+	http_write(req->fd, json, jsonlen);
 }
 
-static inline struct rest_uri_node *find_rest_node(const int8 *name, struct list_head *parent)
+static void send_not_modified(struct http_request *req, const int8 *etag)
 {
-	struct rest_uri_node *n, *var = NULL;
+	int32 len;
+	int8 header[512];
 
-	list_for_each_entry(n, parent, list) {
-		if (strcasecmp(n->name, name) == 0)
-			return n;
-		else if (n->isvar == 1)
-			var = n;
-	}
+	len = snprintf(header, sizeof(header),
+			"%s 304 Not Modified\r\n"
+			"Server: %s\r\n"
+			"Access-Control-Allow-Origin: *\r\n"
+			"ETag: %s\r\n"
+			"Connection: %s\r\n"
+			"\r\n",
+			HTTPD_PROTOCOL, HTTPD_SERVER_NAME, etag,
+			req->keep_alive ? "keep-alive" : "close");
 
-	return var;
+	http_write(req->fd, header, len);
 }
 
-static struct rest_handler *lookup_rest_handle(struct rest_uri_param *param)
+/*
+ * Split the path in place while it is matched, a segment matches a literal
+ * route or else the variable one, whose value is captured.
+ */
+struct rest_handler *rest_route(struct rest_uri_param *param, int8 *path)
 {
-	int32 i;
-	int32 num_keys = 0;
-	struct rest_uri_node *leaf, *parent;
+	int32 i, len;
+	int8 *cp = path;
+	const struct rest_route *route = rest_routes;
+	const struct rest_route *child, *var;
+
+	param->num_nodes = 0;
+	param->num_path_keys = 0;
+
+	if (route == NULL || cp == NULL || *cp != '/')
+		return NULL;
+
+	for (cp++; param->num_nodes < MAX_URI_NODES;) {
+		len = strcspn(cp, "/");
+		param->nodes[param->num_nodes++] = cp;
+
+		if (route != NULL) {
+			var = NULL;
+			child = &rest_routes[route->child];
+			for (i = 0; i < route->child_num; i++, child++) {
+				if (child->isvar)
+					var = child;
+				else if (child->name_len == len && strncasecmp(child->name, cp, len) == 0)
+					break;
+			}
 
-	leaf   = NULL;
-	parent = &root_uri_node;
-	for (i = 0; i < param->num_nodes; i++) {
-		if ((leaf = find_rest_node(param->nodes[i], &parent->subnode)) == NULL)
+			route = (i < route->child_num) ? child : var;
+			if (route != NULL && route->isvar) {
+				param->path_keys[param->num_path_keys].name = (int8 *)route->name;
+				param->path_keys[param->num_path_keys].value = cp;
+				param->num_path_keys++;
+			}
+		}
+
+		cp += len;
+		if (*cp == '\0')	/* end of path */
 			break;
 
-		parent = leaf;
-		if (leaf->isvar) {
-			param->path_keys[num_keys].name = leaf->name;
-			param->path_keys[num_keys].value = param->nodes[i];
-			num_keys++;
-		}
+		*cp++ = '\0';	/* replace '/' */
+		if (*cp == '\0')	/* end of path */
+			break;
 	}
-	param->num_path_keys = num_keys;
 
-	return leaf != NULL ? leaf->rest_handler : NULL;
+	return route != NULL ? route->rest_handler : NULL;
 }
 
 static json_t *handle_rest_req(const struct rest_uri_param *param, const struct rest_handler *handler)
@@ -65,6 +65,7 @@ struct rest_handler {
 	json_t* (*get)(struct rest_uri_param *req);
 	json_t* (*post)(struct rest_uri_param *req);
 	json_t* (*put)(struct rest_uri_param *req);
+	int32 cache;	/* GET reply is built from memdb only, see cache.c */
 };
 
 
@@ -78,8 +79,12 @@ struct rest_uri_node {
 };
 
 
+#define MAX_REST_URIS	64
+
 extern void rest_register_handlers(void);
 extern void register_handler(const int8 *url, const struct rest_handler *rest_handler);
+extern struct rest_handler *rest_route(struct rest_uri_param *param, int8 *path);
+extern int32 rest_registered_uris(const int8 ***uris);
 extern void update_response_info(struct rest_uri_param *param, int32 status);
 extern void rest_process(struct http_request *req);
 
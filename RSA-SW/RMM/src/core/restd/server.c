@@ -0,0 +1,321 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include "server.h"
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+
+#include "websocket.h"
+#include "libutils/list.h"
+
+/*
+ * Connections are watched by the main thread with epoll and are handed to
+ * a fixed pool of workers when they become readable. A worker reads what
+ * is available, processes complete requests and gives the connection back
+ * to epoll to wait for the next request (HTTP keep-alive).
+ *
+ * At most HTTPD_MAX_CONN connections are served, the listening socket is
+ * not watched while the limit is reached, so further clients wait in the
+ * listen backlog. Idle connections are closed after HTTPD_KEEPALIVE_TIMO.
+ *
+ * A WebSocket connection is long-lived, it gets a thread of its own.
+ */
+
+#define MAX_EVENTS	32
+
+struct http_conn {
+	struct list_head list;
+	struct http_request req;
+	int32 busy;				/* taken by a worker, not in epoll */
+	time_t last_active;
+};
+
+static int32 epoll_fd = -1;
+static int32 srv_listen_fd = -1;
+static int32 listen_paused;
+
+/* all below are protected by conn_lock */
+static pthread_mutex_t conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t conn_ready = PTHREAD_COND_INITIALIZER;
+static struct list_head conn_list = LIST_HEAD_INIT(conn_list);
+static int32 conn_num;
+
+/* ready connections, each one is queued at most once */
+static struct http_conn *ready_queue[HTTPD_MAX_CONN];
+static int32 ready_head;
+static int32 ready_num;
+
+static time_t now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+static int32 watch_listen(int32 op)
+{
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	return epoll_ctl(epoll_fd, op, srv_listen_fd, &ev);
+}
+
+/* called with conn_lock held */
+static int32 watch_conn(struct http_conn *conn, int32 op)
+{
+	struct epoll_event ev;
+
+	conn->busy = 0;
+	conn->last_active = now_sec();
+
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.ptr = conn;
+	return epoll_ctl(epoll_fd, op, conn->req.fd, &ev);
+}
+
+/* called with conn_lock held, the connection is no longer served */
+static void unlink_conn(struct http_conn *conn)
+{
+	list_del(&conn->list);
+	conn_num--;
+
+	if (listen_paused) {
+		if (watch_listen(EPOLL_CTL_ADD) == 0)
+			listen_paused = 0;
+	}
+}
+
+static void free_conn(struct http_conn *conn)
+{
+	close(conn->req.fd);
+	http_request_free(&conn->req);
+	free(conn);
+}
+
+static void close_conn(struct http_conn *conn)
+{
+	pthread_mutex_lock(&conn_lock);
+	unlink_conn(conn);
+	pthread_mutex_unlock(&conn_lock);
+
+	free_conn(conn);
+}
+
+static void accept_conns(void)
+{
+	int32 fd;
+	socklen_t addrlen;
+	usockaddr usa;
+	struct http_conn *conn;
+
+	for (;;) {
+		pthread_mutex_lock(&conn_lock);
+		if (conn_num >= HTTPD_MAX_CONN) {
+			if (!listen_paused && watch_listen(EPOLL_CTL_DEL) == 0)
+				listen_paused = 1;
+			pthread_mutex_unlock(&conn_lock);
+			return;
+		}
+		pthread_mutex_unlock(&conn_lock);
+
+		addrlen = sizeof(usa);
+		fd = accept4(srv_listen_fd, &usa.sa, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+		HTTPD_INFO("restd accepted a new connection: fd = %d\n", fd);
+
+		conn = malloc(sizeof(struct http_conn));
+		if (NULL == conn) {
+			HTTPD_ERR("Malloc error: %s\n", strerror(errno));
+			close(fd);
+			return;
+		}
+
+		if (http_request_init(&conn->req, fd, &usa) != 0) {
+			http_request_free(&conn->req);
+			free(conn);
+			close(fd);
+			return;
+		}
+
+		pthread_mutex_lock(&conn_lock);
+		list_add_tail(&conn->list, &conn_list);
+		conn_num++;
+		if (watch_conn(conn, EPOLL_CTL_ADD) != 0) {
+			unlink_conn(conn);
+			pthread_mutex_unlock(&conn_lock);
+			free_conn(conn);
+			continue;
+		}
+		pthread_mutex_unlock(&conn_lock);
+	}
+}
+
+static void close_idle_conns(void)
+{
+	time_t now = now_sec();
+	struct http_conn *conn, *tmp;
+
+	pthread_mutex_lock(&conn_lock);
+	list_for_each_entry_safe(conn, tmp, &conn_list, list) {
+		if (conn->busy || now - conn->last_active < HTTPD_KEEPALIVE_TIMO)
+			continue;
+
+		unlink_conn(conn);
+		free_conn(conn);
+	}
+	pthread_mutex_unlock(&conn_lock);
+}
+
+static void *ws_thread(void *args)
+{
+	struct http_conn *conn = (struct http_conn *)args;
+
+	prctl(PR_SET_NAME, "ws_thread");
+	ws_process(&conn->req);
+	free_conn(conn);
+
+	return NULL;
+}
+
+static void start_websocket(struct http_conn *conn)
+{
+	pthread_t tid;
+	pthread_attr_t attr;
+
+	pthread_mutex_lock(&conn_lock);
+	unlink_conn(conn);
+	pthread_mutex_unlock(&conn_lock);
+
+	/* WebSocket code uses blocking reads and writes */
+	fcntl(conn->req.fd, F_SETFL, fcntl(conn->req.fd, F_GETFL) & ~O_NONBLOCK);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&tid, &attr, ws_thread, conn) != 0) {
+		HTTPD_ERR("Failed to create ws_thread!\n");
+		free_conn(conn);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+static void serve_conn(struct http_conn *conn)
+{
+	int32 rc;
+
+	for (;;) {
+		rc = http_read_request(&conn->req);
+		if (rc == HTTP_REQ_ERROR)
+			break;
+
+		if (rc == HTTP_REQ_PARTIAL) {
+			pthread_mutex_lock(&conn_lock);
+			rc = watch_conn(conn, EPOLL_CTL_MOD);
+			pthread_mutex_unlock(&conn_lock);
+			if (rc == 0)
+				return;
+			break;
+		}
+
+		rc = http_process(&conn->req);
+		if (rc == HTTP_CONN_WEBSOCKET) {
+			start_websocket(conn);
+			return;
+		}
+		if (rc == HTTP_CONN_CLOSE)
+			break;
+
+		http_next_request(&conn->req);
+	}
+
+	close_conn(conn);
+}
+
+static void *worker_thread(void *unused)
+{
+	struct http_conn *conn;
+
+	prctl(PR_SET_NAME, "rest_worker");
+	for (;;) {
+		pthread_mutex_lock(&conn_lock);
+		while (ready_num == 0)
+			pthread_cond_wait(&conn_ready, &conn_lock);
+
+		conn = ready_queue[ready_head];
+		ready_head = (ready_head + 1) % HTTPD_MAX_CONN;
+		ready_num--;
+		pthread_mutex_unlock(&conn_lock);
+
+		serve_conn(conn);
+	}
+
+	return NULL;
+}
+
+static void queue_conn(struct http_conn *conn)
+{
+	pthread_mutex_lock(&conn_lock);
+	conn->busy = 1;
+	ready_queue[(ready_head + ready_num) % HTTPD_MAX_CONN] = conn;
+	ready_num++;
+	pthread_cond_signal(&conn_ready);
+	pthread_mutex_unlock(&conn_lock);
+}
+
+int32 http_server_run(int32 listen_fd)
+{
+	int32 i, n;
+	pthread_t tid;
+	time_t last_check = 0;
+	struct epoll_event events[MAX_EVENTS];
+
+	srv_listen_fd = listen_fd;
+	fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0 || watch_listen(EPOLL_CTL_ADD) != 0) {
+		HTTPD_ERR("Failed to create epoll: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < HTTPD_WORKER_NUM; i++) {
+		if (pthread_create(&tid, NULL, worker_thread, NULL) != 0) {
+			HTTPD_ERR("Failed to create rest worker thread!\n");
+			return -1;
+		}
+	}
+
+	for (;;) {
+		n = epoll_wait(epoll_fd, events, MAX_EVENTS, 1000);
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr == NULL)
+				accept_conns();
+			else
+				queue_conn((struct http_conn *)events[i].data.ptr);
+		}
+
+		if (now_sec() != last_check) {
+			last_check = now_sec();
+			close_idle_conns();
+		}
+	}
+
+	return 0;
+}
@@ -64,7 +64,7 @@ static memdb_integer sub_host_state_handle = -1;
 
 static enum ws_state ws_parse_frame(uint8 *frame, int32 *psz, struct ws_msg *msg);
 static int32 ws_send_frame(int32 fd, int32 type, const uint8 *payload, int32 sz);
-static void ws_process_cmd(const json_t *json);
+static void ws_process_cmd(const json_t *json, int32 sub);
 static int32 ws_compute_handshake(const int8 *key, int8 *out, int32 *out_sz);
 static void ws_handshake_reply(struct http_request *req);
 static void ws_node_event_callback_fn(struct event_info *evt, void *cb_data);
@@ -126,6 +126,7 @@ void ws_process(struct http_request *req)
 	int32 maxfd;
 	int32 alive;
 	int32 rc, sz;
+	int32 sub;
 	fd_set rfds;
 	uint32 count;
 	struct ws_msg *msg;
@@ -135,7 +136,8 @@ void ws_process(struct http_request *req)
 
 	ws_handshake_reply(req);
 
-	if (libdb_init_subscription(NOTIFY_BY_SELECT, ws_node_event_callback_fn, NULL) < 0) {
+	sub = libdb_init_subscription(NOTIFY_BY_SELECT, ws_node_event_callback_fn, NULL);
+	if (sub < 0) {
 		printf("Failed to init select subscirbe mode!\n");
 		exit(-1);
 	}
@@ -154,7 +156,7 @@ void ws_process(struct http_request *req)
 		FD_ZERO(&rfds);
 		FD_SET(fd, &rfds);
 		maxfd = fd;
-		libdb_event_selectfds(&rfds, &maxfd);
+		libdb_event_selectfds(sub, &rfds, &maxfd);
 
 		timo.tv_sec  = WS_KEEP_TIME;
 		timo.tv_usec = 0;
@@ -162,7 +164,7 @@ void ws_process(struct http_request *req)
 		if (rc < 0)
 			break;
 
-		libdb_event_processfds(&rfds);
+		libdb_event_processfds(sub, &rfds);
 
 		if (rc == 0) {
 			if (alive == 0)
@@ -203,7 +205,7 @@ again:
 				msg->payload[msg->payload_sz] = '\0';
 				json = json_parse((int8 *)msg->payload);
 				if (json != NULL) {
-					ws_process_cmd(json);
+					ws_process_cmd(json, sub);
 					json_free(json);
 				}
 			}
@@ -223,7 +225,8 @@ again:
 	if (sub_host_state_handle != -1)
 		libdb_unsubscribe_event(DB_RMM, sub_host_state_handle, LOCK_ID_NULL);
 
-	libdb_exit_memdb();
+	/* the memdb command socket is shared with the other restd threads */
+	libdb_exit_subscription(sub);
 }
 
 
@@ -603,7 +606,7 @@ static int32 handle_memdb_cmd(void)
  * 5. { "hostState" : "subscribe" }
  * 6. { "hostState" : "unsubscribe" }
  */
-static void ws_process_cmd(const json_t *json)
+static void ws_process_cmd(const json_t *json, int32 sub)
 {
 	json_t *target;
 	int8   *command;
@@ -625,7 +628,7 @@ static void ws_process_cmd(const json_t *json)
 			if (sub_node_add_handle != -1)
 				return;
 
-			sub_node_add_handle = libdb_subscribe_type_of_node_create(DB_RMM, MC_TYPE_DRAWER,
+			sub_node_add_handle = libdb_subscribe_type_of_node_create(DB_RMM, sub, MC_TYPE_DRAWER,
 										MC_TYPE_BMC, LOCK_ID_NULL);
 
 			/* Node has been added */
@@ -657,7 +660,7 @@ static void ws_process_cmd(const json_t *json)
 			if (sub_node_del_handle != -1)
 				return;
 
-			sub_node_del_handle = libdb_subscribe_type_of_node_delete(DB_RMM, MC_TYPE_DRAWER,
+			sub_node_del_handle = libdb_subscribe_type_of_node_delete(DB_RMM, sub, MC_TYPE_DRAWER,
 										MC_TYPE_BMC, LOCK_ID_NULL);
 		} else if (strcmp(command, "unsubscribe") == 0) {
 			if (sub_node_del_handle != -1) {
@@ -679,7 +682,7 @@ static void ws_process_cmd(const json_t *json)
 				return;
 			/* hc add for debug */
 			node = libdb_list_node_by_type(DB_RMM, MC_TYPE_PSU, MC_TYPE_PSU, &psu_num, NULL, LOCK_ID_NULL);
-			sub_host_state_handle = libdb_subscribe_attr_by_prefix(DB_RMM, node[0].node_id, PSU_HOSTSTATE_PREFIX, LOCK_ID_NULL);
+			sub_host_state_handle = libdb_subscribe_attr_by_prefix(DB_RMM, sub, node[0].node_id, PSU_HOSTSTATE_PREFIX, LOCK_ID_NULL);
 			libdb_free_node(node);
 			show_host_state();	/* hostState has been added */
 		} else if (strcmp(command, "unsubscribe") == 0) {
@@ -13,10 +13,13 @@
  */
 
 
+#include <sys/mman.h>
+
 #include "libjson/json.h"
 #include "libutils/log.h"
 #include "libutils/string.h"
 #include "librmmcfg/rmm_cfg.h"
+#include "librmmlog/shm.h"
 #include "log_manager.h"
 
 #define LOG_MODULES_MAX_NUM		(12)
@@ -27,6 +30,59 @@ struct log_module {
 };
 
 static struct log_module log_modules[LOG_MODULES_MAX_NUM];
+static struct rmmlog_shm_hdr *shm;
+
+/* Publish module levels to clients, see librmmlog/shm.h */
+static void log_mgr_shm_init(struct rmm_log_module *modules, int count)
+{
+	struct rmmlog_shm_hdr *old;
+	int fd;
+	int index;
+
+	/* tell clients still mapping the segment of previous rmmlogd to drop it */
+	fd = shm_open(RMMLOG_SHM_NAME, O_RDWR, 0);
+	if (fd >= 0) {
+		old = mmap(NULL, sizeof(*old), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (old != MAP_FAILED) {
+			old->valid = 0;
+			munmap(old, sizeof(*old));
+		}
+		close(fd);
+		shm_unlink(RMMLOG_SHM_NAME);
+	}
+
+	fd = shm_open(RMMLOG_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) {
+		printf("Fail to create shared memory %s\n", RMMLOG_SHM_NAME);
+		return;
+	}
+
+	if (ftruncate(fd, sizeof(struct rmmlog_shm_hdr)) < 0) {
+		printf("Fail to resize shared memory %s\n", RMMLOG_SHM_NAME);
+		close(fd);
+		shm_unlink(RMMLOG_SHM_NAME);
+		return;
+	}
+
+	shm = mmap(NULL, sizeof(struct rmmlog_shm_hdr), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		shm = NULL;
+		shm_unlink(RMMLOG_SHM_NAME);
+		return;
+	}
+
+	for (index = 0; index < count && index < RMMLOG_SHM_MODULE_NUM; index++) {
+		strncpy_safe(shm->modules[index].name, modules[index].name,
+					EVT_MODULE_LEN, EVT_MODULE_LEN - 1);
+		shm->modules[index].level = modules[index].level;
+	}
+	shm->module_num = index;
+	shm->magic = RMMLOG_SHM_MAGIC;
+	shm->version = RMMLOG_SHM_VERSION;
+	__sync_synchronize();
+	shm->valid = 1;
+}
 
 int log_mgr_init(void)
 {
@@ -53,6 +109,8 @@ int log_mgr_init(void)
 					RMM_LOG_MODULE_NAME_LEN - 1);
 	}
 
+	log_mgr_shm_init(rmm_log_modules, module_cnt);
+
 	return 0;
 }
 
@@ -63,6 +121,8 @@ void log_mgr_put(char *module_name, int level, const char *func_name, char *msg)
 	for (index = 0; index < LOG_MODULES_MAX_NUM; index++) {
 		if (strstr(log_modules[index].name, module_name) != 0) {
 				log_put(log_modules[index].handler, level, func_name, msg);
+			if (shm && index < RMMLOG_SHM_MODULE_NUM)
+				shm->modules[index].received++;
 			break;
 		}
 	}
@@ -79,3 +139,17 @@ void log_mgr_get(char *module_name, int count, char *data)
 		}
 	}
 }
+
+void log_mgr_dump_stats(void)
+{
+	int index = 0;
+
+	if (shm == NULL)
+		return;
+
+	printf("%-16s %10s %10s %10s\n", "module", "sent", "dropped", "received");
+	for (index = 0; index < (int)shm->module_num; index++)
+		printf("%-16s %10u %10u %10u\n", shm->modules[index].name,
+			shm->modules[index].sent, shm->modules[index].dropped,
+			shm->modules[index].received);
+}
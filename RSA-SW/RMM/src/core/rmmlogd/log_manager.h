@@ -43,4 +43,9 @@ void log_mgr_put(char *module_name, int level, const char *func_name, char *msg)
  */
 void log_mgr_get(char *module_name, int count, char *data);
 
+/**
+ * @brief print per module counters of sent, dropped and received records.
+ */
+void log_mgr_dump_stats(void);
+
 #endif
\ No newline at end of file
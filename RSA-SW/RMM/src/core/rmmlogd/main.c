@@ -15,6 +15,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 
@@ -24,6 +26,44 @@
 #include "librmmcfg/rmm_cfg.h"
 #include "libutils/dump.h"
 
+#define RMM_LOGD_RCVBUF_SIZE	(1024 * 1024)
+
+static volatile sig_atomic_t dump_stats;
+
+static void sigusr1_handler(int signum)
+{
+	dump_stats = 1;
+}
+
+static void put_batch(char *buf, int len)
+{
+	struct log_batch *batch = (struct log_batch *)buf;
+	struct log_rec rec;
+	char *p = buf + sizeof(struct log_batch);
+	char *end = buf + len;
+	char *fn_name;
+	char *msg;
+	int i;
+
+	batch->module_name[EVT_MODULE_LEN - 1] = '\0';
+	for (i = 0; i < batch->count; i++) {
+		if (p + sizeof(rec) > end)
+			break;
+		memcpy(&rec, p, sizeof(rec));
+		p += sizeof(rec);
+
+		if (rec.fn_len == 0 || rec.msg_len == 0 || p + rec.fn_len + rec.msg_len > end)
+			break;
+		fn_name = p;
+		msg = p + rec.fn_len;
+		p += rec.fn_len + rec.msg_len;
+		if (fn_name[rec.fn_len - 1] != '\0' || msg[rec.msg_len - 1] != '\0')
+			break;
+
+		log_mgr_put(batch->module_name, rec.level, fn_name, msg);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	int rc;
@@ -33,7 +73,8 @@ int main(int argc, char **argv)
 	int rmm_logd_port = 0;
 
 	struct sockaddr_in addr;
-	struct log_evt evt;
+	struct log_evt *evt;
+	char buf[EVT_BATCH_SIZE];
 
 	printf("RMM log daemon is Running ...\n");
 	enable_core_dump();
@@ -49,9 +90,20 @@ int main(int argc, char **argv)
 	if (fd < 0)
 		return -1;
 
+	/* clients send batches, leave room for bursts */
+	rc = RMM_LOGD_RCVBUF_SIZE;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rc, sizeof(rc));
+
 	log_mgr_init();
+	signal(SIGUSR1, sigusr1_handler);
 
+	evt = (struct log_evt *)buf;
 	for (;;) {
+		if (dump_stats) {
+			dump_stats = 0;
+			log_mgr_dump_stats();
+		}
+
 		FD_ZERO(&fds);
 		FD_SET(fd, &fds);
 
@@ -59,12 +111,17 @@ int main(int argc, char **argv)
 		if (rc < 0)
 			continue;
 
-		rc = recvfrom(fd, &evt, sizeof(struct log_evt), 0, (struct sockaddr *)&addr, &addrlen);
-		if (rc <= 0)
+		rc = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &addrlen);
+		if (rc < (int)sizeof(int))
 			continue;
 
-		if (evt.type == EVT_WRITE_LOG)
-			log_mgr_put(evt.module_name, evt.level, evt.fn_name, evt.msg);
+		if (evt->type == EVT_WRITE_LOG && rc >= (int)sizeof(struct log_evt)) {
+			evt->module_name[EVT_MODULE_LEN - 1] = '\0';
+			evt->fn_name[EVT_FN_LEN - 1] = '\0';
+			evt->msg[EVT_MSG_LEN - 1] = '\0';
+			log_mgr_put(evt->module_name, evt->level, evt->fn_name, evt->msg);
+		} else if (evt->type == EVT_WRITE_LOG_BATCH && rc >= (int)sizeof(struct log_batch))
+			put_batch(buf, rc);
 	}
 
 	close(fd);
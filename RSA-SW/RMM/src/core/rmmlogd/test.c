@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "libutils/log.h"
 #include "log_manager.h"
 
 int main(int argc, char **argv)
@@ -28,11 +29,11 @@ int main(int argc, char **argv)
 	for (i = 1; i < 1200; i++)
 		log_mgr_put("memdbd", 1, "call_test", "test log message.........\n");
 
-	data = (char *)malloc(256 * 10);
+	data = (char *)malloc(LOG_RECORD_SIZE * 10);
 
 	log_mgr_get("memdbd", 10, data);
 	for (i = 0; i < 10; i++)
-		printf("data: %s", data + 256 * i);
+		printf("data: %s", data + LOG_RECORD_SIZE * i);
 
 	free(data);
 
@@ -70,9 +70,11 @@ typedef enum{
 
 
 
+/*
+ * Callbacks are called on the rpc runtime thread (libjsonrpcapi/rpc_peer.h),
+ * a daemon does not poll for them.
+ */
 extern int  libjipmi_init(unsigned short async_listen_port);
-extern void libjipmi_callback_selectfds(fd_set *rfds, int *max_fd);
-extern void libjipmi_callback_processfds(fd_set *rfds);
 
 
 extern int libjipmi_ipmb_cmd(unsigned char sa, jipmi_msg_t *req,
@@ -31,6 +31,7 @@ typedef enum {
 /* MUST BE the first member of json_xxx_t */
 typedef struct json_value {
 	json_type type;
+	int flags;		/* private to libjson */
 	struct json_value *next;
 } json_t;
 
@@ -40,6 +41,11 @@ typedef struct json_pair {
 	json_t *value;
 
 	struct json_pair *next;
+
+	/* private to libjson */
+	struct json_pair *hnext;
+	unsigned int hash;
+	int flags;
 } json_pair_t;
 
 typedef struct  {
@@ -47,6 +53,11 @@ typedef struct  {
 
 	json_pair_t *next;
 	json_pair_t *tail;
+
+	/* members, indexed by hash once there are more than a few */
+	int size;
+	int hash_size;
+	json_pair_t **hash;
 } json_object_t;
 
 /* An array is an ordered collection of values. */
@@ -104,7 +115,14 @@ extern json_t *json_null(void);
 
 
 extern json_t *json_parse(char *string);
+/* at most len bytes of string are parsed, all of it up to '\0' if len <= 0 */
 extern json_t *json_parse_with_len(char *string, int len);
+/*
+ * Parse into one arena instead of an allocation per value, for documents
+ * dropped as a whole, like RPC requests. json_free of the root releases
+ * the arena. len is only a size hint, 0 to use strlen.
+ */
+extern json_t *json_parse_arena(char *string, int len);
 extern int     json_format(json_t *json, char *output, int sz);
 extern void    json_print(json_t *json);
 
@@ -124,6 +124,8 @@ extern int jrpc_get_result_value(json_t *rsp, json_type type, void *value);
 extern int jrpc_get_named_result_value(json_t *rsp, char *name, json_type type, void *value);
 extern int jrpc_get_error(json_t *rsp, int64 *code, char **message);
 extern int jrpc_parse_rsp_to_struct(char *string, jrpc_rsp_pkg_t *pkg);
+/* same for a response already parsed, pkg->json takes rsp over */
+extern int jrpc_rsp_to_struct(json_t *rsp, jrpc_rsp_pkg_t *pkg);
 extern void jrpc_rsp_pkg_free(jrpc_rsp_pkg_t *pkg);
 extern void jrpc_req_pkg_free(jrpc_req_pkg_t *pkg);
 
@@ -30,8 +30,8 @@ typedef struct _cmd_st {
 
 extern int libjsonrpcapi_init(unsigned int init_bitmap, unsigned int jipmi_port);
 
-extern void libjsonrpcapi_callback_selectfds(fd_set *readset, int *max_fd);
+extern void libjsonrpcapi_callback_selectfds(int sub, fd_set *readset, int *max_fd);
 
-extern void libjsonrpcapi_callback_processfds(fd_set *rfds);
+extern void libjsonrpcapi_callback_processfds(int sub, fd_set *rfds);
 #endif
 
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __LIBJSONRPCAPI_RPC_PEER_H__
+#define __LIBJSONRPCAPI_RPC_PEER_H__
+
+#include "libjson/json.h"
+#include "libutils/types.h"
+
+#define RPC_PEER_HASH_SIZE		256		/* pending requests buckets, per peer */
+#define RPC_PEER_TICK_MS		10		/* timeout resolution */
+
+#define RPC_MULTI_REPLY			(1 << 0)	/* every reply until the timeout, e.g. IPMB broadcast */
+
+/**
+ * @brief reply callback, rsp is NULL on timeout.
+ *
+ * Called on the runtime thread. rsp belongs to the callback which has to
+ * json_free it. The callback may expect and send other requests, even
+ * wait for them.
+ */
+typedef void (*rpc_reply_fn)(json_t *rsp, void *cb_arg);
+
+struct rpc_peer;
+
+/**
+ * @brief open a JSON-RPC peer on a loopback UDP port.
+ *
+ * All peers of a process share one runtime thread which receives the
+ * replies, matches them to the pending requests by id and times the
+ * requests out with a timer wheel, so any number of requests may be in
+ * flight from any thread.
+ *
+ * @param  port			port of the peer.
+ * @param  local_port	port to send from, 0 for any.
+ *
+ * @return peer, NULL on failure.
+ */
+struct rpc_peer *rpc_peer_open(int port, int local_port);
+
+/**
+ * @brief point a peer to another port, e.g. of a restarted daemon.
+ */
+int rpc_peer_connect(struct rpc_peer *peer, int port);
+
+/**
+ * @brief expect a reply for id, before sending the request.
+ *
+ * @param  id			request id, 0 to allocate a new one.
+ * @param  timeout_ms	cb_fn is called with NULL after it.
+ * @param  flags		RPC_MULTI_REPLY.
+ *
+ * @return id, -1 on failure.
+ */
+int64 rpc_peer_expect(struct rpc_peer *peer, int64 id, uint32 timeout_ms, int32 flags,
+					  rpc_reply_fn cb_fn, void *cb_arg);
+
+/**
+ * @brief forget an expected id without calling its callback, e.g. when
+ * its request could not be sent.
+ */
+void rpc_peer_cancel(struct rpc_peer *peer, int64 id);
+
+int rpc_peer_send(struct rpc_peer *peer, const char *msg, int len);
+
+/**
+ * @brief wait until id is no longer expected, its callback returned.
+ *
+ * An id expected again by its own callback, like a bridged IPMI request
+ * answered twice, is waited for again.
+ */
+void rpc_peer_wait(struct rpc_peer *peer, int64 id);
+
+#endif
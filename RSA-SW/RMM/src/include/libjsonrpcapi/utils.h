@@ -19,8 +19,9 @@
 #include <stdio.h>
 #include "libjson/json.h"
 #include "libjsonrpc/jsonrpc.h"
+#include "libjsonrpcapi/rpc_peer.h"
 
-int send_msg_to_fd(jrpc_req_pkg_t *req, jrpc_rsp_pkg_t *rsp, int evt_id, int fd);
+int send_msg_to_peer(jrpc_req_pkg_t *req, jrpc_rsp_pkg_t *rsp, int evt_id, struct rpc_peer *peer);
 int fill_param(jrpc_req_pkg_t * req, char * name, void * value, json_type type);
 
 #endif
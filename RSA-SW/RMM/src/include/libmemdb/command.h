@@ -54,6 +54,9 @@ enum {
 	CMD_LOCK,
 	CMD_UNLOCK,
 
+	CMD_ATTRS_GET,
+	CMD_ATTRS_SET,
+
 	CMD_MAX
 };
 
@@ -75,7 +78,9 @@ static struct _cmd_st {
 			{CMD_NODE_GET_BY_NODE_ID, "node_get_by_node_id"},
 			{CMD_NODE_CREATE_WITH_NODE_ID, "node_create_with_node_id"},
 			{CMD_LOCK, "lock"},
-			{CMD_UNLOCK, "unlock"} };
+			{CMD_UNLOCK, "unlock"},
+			{CMD_ATTRS_GET, "attrs_get"},
+			{CMD_ATTRS_SET, "attrs_set"} };
 
 
 enum {
@@ -154,6 +159,15 @@ struct node_attr_param {
 	memdb_integer type;
 };
 
+/*
+ * attrs_get: attributes of all nodes in @p_nodes (or of the request node),
+ * and of their descendants if @p_subtree is set. Only attributes named
+ * in @p_names are returned if it is given.
+ * attrs_set: every element of @p_attrs is {node, cookie, snapshot_flag,
+ * name, data}; all nodes are checked before any attribute is written.
+ * attrs_get stops at CMDMAXDATALEN bytes of attributes and sets r_truncated.
+ */
+
 /*******************************/
 
 struct subscibe_param {
@@ -34,12 +34,19 @@ static char *event_string[EVENT_END] = {
 	"event_node_attr"
 };
 
+/* several EVENT_NODE_ATTR of one node: node_id and an "attrs" array */
+#define EVENT_NODE_ATTRS_STR	"event_node_attrs"
+
+#define SUB_FLAG_COALESCE	0x1		/* attr events: only the latest value of a burst */
+
 struct subscription {
-	struct list_head list;
+	struct list_head list;		/* sublist or pod_sublist */
+	struct list_head index;		/* bucket of the event index */
 
 	memdb_integer	event;
 	memdb_integer	cb_port;
 	memdb_integer	cb_pid;
+	memdb_integer	flags;
 
 	union {
 		struct {	/* EVENT_NODE_XXXX : [type_min, type_max] */
@@ -118,6 +125,49 @@ extern void node_attr_notify(memdb_integer db_name, struct node_attr *a,
 
 extern void int_event_module(void);
 
+/**
+ * @brief hold the attribute events of the following changes until event_attrs_end.
+ */
+extern void event_attrs_begin(void);
+
+/**
+ * @brief send the attribute events held since event_attrs_begin.
+ *
+ * A subscriber gets the events of one node in one EVENT_NODE_ATTRS_STR
+ * notification, or one by one if it coalesces them.
+ */
+extern void event_attrs_end(void);
+
+/**
+ * @brief add a subscription to the list and the event index of a DB.
+ */
+extern void event_add_subscription(memdb_integer db_name, struct subscription *s);
+
+/**
+ * @brief remove a subscription added by event_add_subscription, the caller frees it.
+ */
+extern void event_del_subscription(memdb_integer db_name, struct subscription *s);
+
+/**
+ * @brief send the deferred notifications which are due.
+ *
+ * A subscriber gets one SIGEVT per flush whatever the number of events
+ * queued on its socket. Signals wait while requests are queued on memdbd,
+ * at most EVENT_SIGNAL_DELAY_MS. Coalesced attribute events wait
+ * EVENT_COALESCE_MS, a newer value of the same attribute replaces the
+ * queued one.
+ *
+ * @param  idle			no request is waiting.
+ */
+extern void event_flush(int idle);
+
+/**
+ * @brief time until event_flush has coalesced events to send.
+ *
+ * @return ms to wait, -1 if nothing is deferred.
+ */
+extern int event_flush_wait(void);
+
 
 #endif
 
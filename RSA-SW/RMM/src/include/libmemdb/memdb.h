@@ -106,6 +106,12 @@ extern memdb_integer   libdb_attr_get_short(unsigned char db_name, memdb_integer
 extern memdb_integer   libdb_attr_get_int(unsigned char db_name, memdb_integer node, char *name, int *output, lock_id_t lock_id);
 extern memdb_integer   libdb_attr_get_string(unsigned char db_name, memdb_integer node, char *name, char *output, int64 len, lock_id_t lock_id);
 
+/*
+ * @@ libdb_attr_get_* read attributes from shared memory published by
+ * memdbd if available and not locked. Pass 0 to always ask memdbd.
+ */
+extern void libdb_set_shm_read(int enable);
+
 
 /*
  * @@ libdb_list_attrs_by_cookie returns the attributes whose [cookie & cmask == cmask].
@@ -118,30 +124,86 @@ extern void *libdb_list_attrs_by_node(unsigned char db_name, memdb_integer node,
 extern void *libdb_list_attrs_by_cookie(unsigned char db_name, unsigned int cmask, int *size, lock_id_t lock_id);
 
 
+/*
+ * @@ libdb_attrs_get_by_node returns all attributes of @node, and of all its
+ * descendants if @subtree is set, in a single request.
+ *
+ * @@ libdb_attrs_get returns the attributes named in @names of every node in
+ * @nodes; all attributes of these nodes if @names is NULL. Missing nodes and
+ * attributes are left out.
+ *
+ * Both return a buffer of 'struct attr_info' with length in '*size', to be
+ * released by @@libdb_free_attrs, or NULL if failed. '*truncated' is set if
+ * the result did not fit into one response.
+ */
+extern void *libdb_attrs_get_by_node(unsigned char db_name, memdb_integer node,
+									 int subtree, int *size, int *truncated,
+									 lock_id_t lock_id);
+extern void *libdb_attrs_get(unsigned char db_name, memdb_integer *nodes, int node_num,
+							 char **names, int name_num, int *size, int *truncated,
+							 lock_id_t lock_id);
+extern void libdb_free_attrs(void *attrs);
+
+struct attr_set_info {
+	memdb_integer node;
+	unsigned int cookie;
+	unsigned char snapshot_flag;
+	char *name;
+	char *data;
+};
+
+/*
+ * @@ libdb_attrs_set writes @num attributes, of one or many nodes, in a single
+ * request. Nothing is written if any of the nodes does not exist.
+ */
+extern memdb_integer libdb_attrs_set(unsigned char db_name, struct attr_set_info *attrs,
+									 int num, lock_id_t lock_id);
+
+/*
+ * @@ libdb_set_read_hook reports to @hook the node ids read by the calling
+ * thread from now on, LIBDB_ANY_NODE if a read depends on a whole subtree.
+ * Pass NULL to stop reporting.
+ */
+#define LIBDB_ANY_NODE	((memdb_integer)-1)
+
+extern void libdb_set_read_hook(void (*hook)(memdb_integer node_id, void *data), void *data);
+
+/*
+ * @@ libdb_init_subscription returns a subscriber handle, -1 on failure.
+ * The handle is passed to libdb_subscribe_* and libdb_event_* and released
+ * with libdb_exit_subscription; several threads may each own one.
+ */
 extern int  libdb_init_subscription(enum event_mode mode,
 									void (*callback)(struct event_info *, void*),
 									void *cb_data);
-extern void libdb_event_selectfds(fd_set *readset, int *max_fd);
-extern void libdb_event_processfds(fd_set *readset);
-extern memdb_integer libdb_subscribe_node_create(unsigned char db_name, lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_node_create_by_type(unsigned char db_name,
+extern void libdb_exit_subscription(int sub);
+extern void libdb_event_selectfds(int sub, fd_set *readset, int *max_fd);
+extern void libdb_event_processfds(int sub, fd_set *readset);
+extern memdb_integer libdb_subscribe_node_create(unsigned char db_name, int sub, lock_id_t lock_id);
+extern memdb_integer libdb_subscribe_node_create_by_type(unsigned char db_name, int sub,
 												 unsigned int node_type, lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name,
+extern memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name, int sub,
 												 unsigned int node_type_min,
 												 unsigned int node_type_max,
 												 lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_node_delete(unsigned char db_name, lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_node_delete_by_type(unsigned char db_name,
+extern memdb_integer libdb_subscribe_node_delete(unsigned char db_name, int sub, lock_id_t lock_id);
+extern memdb_integer libdb_subscribe_node_delete_by_type(unsigned char db_name, int sub,
 												 unsigned int node_type,
 												 lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name,
+extern memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name, int sub,
 												 unsigned int node_type_min,
 												 unsigned int node_type_max,
 												 lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_attr_all(unsigned char db_name, lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_attr_special(unsigned char db_name, memdb_integer node_id, char *prefix, lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_attr_by_prefix(unsigned char db_name, memdb_integer node_id, char *prefix, lock_id_t lock_id);
-extern memdb_integer libdb_subscribe_attr_by_node(unsigned  char db_name, memdb_integer node_id, lock_id_t lock_id);
+extern memdb_integer libdb_subscribe_attr_all(unsigned char db_name, int sub, lock_id_t lock_id);
+extern memdb_integer libdb_subscribe_attr_special(unsigned char db_name, int sub, memdb_integer node_id, char *prefix, lock_id_t lock_id);
+extern memdb_integer libdb_subscribe_attr_by_prefix(unsigned char db_name, int sub, memdb_integer node_id, char *prefix, lock_id_t lock_id);
+extern memdb_integer libdb_subscribe_attr_by_node(unsigned  char db_name, int sub, memdb_integer node_id, lock_id_t lock_id);
+/*
+ * @@ libdb_subscribe_attr_coalesced subscribes like libdb_subscribe_attr_special
+ * for readers which only need the latest value: memdbd holds the events a
+ * short while and sends one per attribute for a burst of changes.
+ */
+extern memdb_integer libdb_subscribe_attr_coalesced(unsigned char db_name, int sub, memdb_integer node_id, char *prefix, lock_id_t lock_id);
 extern memdb_integer libdb_unsubscribe_event(unsigned char db_name, memdb_integer handle, lock_id_t lock_id);
 extern memdb_integer libdb_is_ready(unsigned char db_name, lock_id_t lock_id, memdb_integer timeout_s);
 extern void libdb_exit_memdb(void);
@@ -85,6 +85,8 @@ struct node {
 	struct node *parent;
 
 	struct list_head list;
+	struct list_head hash;		/* linkage in node id hash bucket */
+	struct list_head type_list;	/* linkage in list of nodes with my type */
 	struct list_head attrs;		/* list with node_attr's group */
 	struct list_head children;	/* list of my children */
 	struct list_head sibling;	/* linkage in my parent's children list */
@@ -93,6 +95,7 @@ struct node {
 struct node_attr {
 	struct list_head group;	/* linkage in node's attrs list */
 	struct list_head list;  /* linkage in global search list */
+	struct list_head hash;	/* linkage in attribute hash bucket */
 
 	struct node *node;
 
@@ -108,6 +111,8 @@ struct node_attr {
 	memdb_integer type;
 	/* struct node_attr_params end */
 
+	unsigned int name_hash;
+
 	/* 'data' points to 'buf' if 'datalen' <= ATTR_DATA_BUFFSIZE */
 #define ATTR_DATA_BUFFSIZE		8
 	unsigned char buf[ATTR_DATA_BUFFSIZE];
@@ -116,6 +121,12 @@ struct node_attr {
 	char name[0];
 };
 
+/* Memory reserved for one set_node_attr_reserved() call, so it cannot fail */
+struct attr_reserve {
+	struct node_attr *pa;
+	unsigned char *data;
+};
+
 enum {
 	DB_RMM = 0,
 	DB_POD,
@@ -147,24 +158,47 @@ extern struct node *insert_node_with_node_id(memdb_integer db_name,
 										  memdb_integer node_id,
 										  memdb_integer type,
 										  memdb_integer snapshot_flag);
+extern struct node *load_image_node(memdb_integer db_name,
+									struct node *parent,
+									memdb_integer node_id,
+									memdb_integer type,
+									const struct timespec *now);
+extern int load_image_attr(memdb_integer db_name, struct node *node,
+						   memdb_integer cookie,
+						   const unsigned char *name, unsigned short namelen,
+						   const unsigned char *data, unsigned short datalen,
+						   memdb_integer type);
+extern void unload_image(memdb_integer db_name);
 extern void destroy_node(memdb_integer db_name, struct node *root);
 extern void dump_all_nodes(memdb_integer db_name);
 extern void dump_all_subscribes(memdb_integer db_name);
 
 extern struct node *find_node_by_node_id(memdb_integer db_name,
 									  memdb_integer node_id);
+extern struct list_head *node_type_list_head(memdb_integer db_name,
+											 memdb_integer type);
 
 extern int set_node_attr(memdb_integer db_name, struct node *node,
 						 memdb_integer cookie,
 						 unsigned char *name, unsigned short namelen,
 						 unsigned char *data, unsigned short datalen,
 						 memdb_integer snapshot_flag, memdb_integer type);
+extern int set_node_attr_reserved(memdb_integer db_name, struct node *node,
+								  memdb_integer cookie,
+								  unsigned char *name, unsigned short namelen,
+								  unsigned char *data, unsigned short datalen,
+								  memdb_integer snapshot_flag, memdb_integer type,
+								  struct attr_reserve *res);
+extern int reserve_node_attr(struct attr_reserve *res, unsigned short namelen,
+							 unsigned short datalen);
+extern void release_node_attr(struct attr_reserve *res);
 extern int get_node_attr(struct node *node, unsigned char *name,
 						 unsigned short namelen, memdb_integer *cookie,
 						 char **data_ptr);
 extern int remove_node_attr(memdb_integer db_name, struct node *node,
 							unsigned char *name,
 							unsigned short namelen);
+extern void publish_attr_change(void);
 extern void publish_subscription(void);
 
 extern void int_node_module(void);
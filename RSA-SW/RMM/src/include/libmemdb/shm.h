@@ -0,0 +1,98 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __LIBMEMDB_SHM_H__
+#define __LIBMEMDB_SHM_H__
+
+#include "libutils/types.h"
+
+/*
+ * Read-only copy of memdb attributes published by memdbd in a POSIX
+ * shared memory segment, so clients can read attributes without a
+ * request to memdbd.
+ *
+ * The segment is an open addressing hash table keyed by db name, node id
+ * and attribute name. memdbd is the only writer. Every slot is protected
+ * by its own sequence counter, which is odd while the slot is written;
+ * a reader copies the slot and retries if the counter changed meanwhile.
+ * Slots never move, deleted attributes leave a tombstone.
+ *
+ * Attributes with too long name or data, or which do not fit in the table,
+ * are not published. Readers fall back to memdbd if an attribute is not
+ * found, so the table only has to be correct for what it contains.
+ */
+
+#define MEMDB_SHM_NAME			"/memdb"
+#define MEMDB_SHM_MAGIC			0x4d444253	/* "MDBS" */
+#define MEMDB_SHM_VERSION		1
+
+#define MEMDB_SHM_SLOT_NUM		16384		/* power of 2 */
+#define MEMDB_SHM_MAX_PROBE		32
+#define MEMDB_SHM_NAME_LEN		48
+#define MEMDB_SHM_DATA_LEN		128
+
+enum {
+	MEMDB_SHM_SLOT_EMPTY = 0,
+	MEMDB_SHM_SLOT_USED,
+	MEMDB_SHM_SLOT_DELETED
+};
+
+struct memdb_shm_slot {
+	volatile uint32 seq;	/* odd while the slot is being written */
+	uint32 state;
+
+	memdb_integer node_id;
+	memdb_integer cookie;
+	uint32 db_name;
+	uint32 datalen;			/* including the terminating '\0' */
+
+	char name[MEMDB_SHM_NAME_LEN];
+	char data[MEMDB_SHM_DATA_LEN];
+};
+
+struct memdb_shm_hdr {
+	uint32 magic;
+	uint32 version;
+	uint32 slot_num;
+	volatile uint32 valid;	/* cleared when memdbd replaces the segment */
+	volatile uint32 locked;	/* db is locked by a client, read from memdbd */
+	uint32 reserved[3];
+
+	struct memdb_shm_slot slots[0];
+};
+
+#define MEMDB_SHM_SIZE	\
+	(sizeof(struct memdb_shm_hdr) + MEMDB_SHM_SLOT_NUM * sizeof(struct memdb_shm_slot))
+
+static inline uint32 memdb_shm_hash(uint32 db_name, memdb_integer node_id, const char *name)
+{
+	uint32 h = 2166136261u;		/* FNV-1a */
+	int i;
+
+	for (i = 0; i < (int)sizeof(node_id); i++) {
+		h ^= (uint8)(node_id >> (i * 8));
+		h *= 16777619u;
+	}
+	h ^= db_name;
+	h *= 16777619u;
+	while (*name) {
+		h ^= (uint8)*name++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+#endif
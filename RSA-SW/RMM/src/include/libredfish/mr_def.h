@@ -0,0 +1,39 @@
+/*This is a generated file: DO NOT EDIT!
+  Generated by "util/mrgenfile"*/
+#ifndef __MR_DEF__
+#define __MR_DEF__
+
+
+#define MSGRackChange		0x00000001			/* Evt/Log: Rack Status Change*/
+#define MSGRackUpdate		0x00000002			/* Log: Rack Info Update*/
+#define MSGPsuChange		0x00000003			/* Evt/Log: PSU Status Change*/
+#define MSGPsuUpdate		0x00000004			/* Log: PSU Info Update*/
+#define MSGPsuAdd		0x00000005			/* Evt/Log: PSU Add*/
+#define MSGPsuRemove		0x00000006			/* Evt/Log: PSU Remove*/
+#define MSGFanChange		0x00000007			/* Evt/Log: FAN Status Change*/
+#define MSGFanUpdate		0x00000008			/* Log: FAN Info Update*/
+#define MSGFanAdd		0x00000009			/* Evt/Log: FAN Add*/
+#define MSGFanRemove		0x0000000A			/* Evt/Log: FAN Remove*/
+#define MSGMbpChange		0x0000000B			/* Evt/Log: MBP Status Change*/
+#define MSGMbpUpdate		0x0000000C			/* Log: MBP Info update*/
+#define MSGMbpAdd		0x0000000D			/* Evt/Log: MBP Add*/
+#define MSGMbpRemove		0x0000000E			/* Evt/Log: MBP Remove*/
+#define MSGDrawerChange		0x0000000F			/* Evt/Log: Drawer Status Change*/
+#define MSGDrawerUpdate		0x00000010			/* Log: Drawer update*/
+#define MSGDrawerAdd		0x00000011			/* Evt/Log: Drawer Add*/
+#define MSGDrawerRemove		0x00000012			/* Evt/Log: Drawer Remove*/
+#define MSGDrawerAlert		0x00000013			/* Evt/Log: Drawer Alert*/
+#define MSGPZoneUpdate		0x00000014			/* Log: Power Zone Info update*/
+#define MSGPZoneAdd		0x00000015			/* Evt/Log Power Zone Add*/
+#define MSGPZoneRemove		0x00000016			/* Evt/Log: Power Zone Remove*/
+#define MSGTZoneUpdate		0x00000017			/* Log: Cooling Zone Info update*/
+#define MSGTZoneAdd		0x00000018			/* Evt/Log: Cooling Zone Add*/
+#define MSGTZoneRemove		0x00000019			/* Evt/Log: Cooling Zone Remove*/
+#define MSGDZoneUpdate		0x0000001A			/* Log: Drawer Zone Info update*/
+#define MSGDZoneAdd		0x0000001B			/* Evt/Log: Drawer Zone Add*/
+#define MSGDZoneRemove		0x0000001C			/* Evt/Log: Drawer Zone Remove*/
+#define RF_PRE_FIX_INFO		"rsa_rmm"
+#define RF_PRE_VER_INFO		"1.0.1"
+
+
+#endif
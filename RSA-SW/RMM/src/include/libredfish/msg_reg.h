@@ -154,9 +154,9 @@ extern int msg_reg_get_msg_id_str(char *identity, int max_len, int num);
 /**
  * @brief get redfish message entity.
  *
- * @param  msg 				message entity.
- * @param  max_len 			max length of message entity.
+ * @param  msg 				message entity, at least RF_MSG_MAX_LEN bytes.
  * @param  num 				the num of redfish message.
+ * @param  args 			args of message, such as "psu1,2".
  */
 extern int msg_reg_get_msg_str(char *msg, int num, char *args);
 
@@ -31,6 +31,7 @@
 #define PROC_SENSORD			"sensord"
 #define PROC_RMM_KEEPERD		"rmm_keeperd"
 #define PROC_AUTO_TEST			"auto_test"
+#define PROC_COOLING_CTRL		"cooling_ctrl"
 
 #define ATTR_VM_HEADER			"vm" 
 #define ATTR_VM_ROOT_PASSWORD	"root_password"
@@ -48,6 +49,11 @@
 #define ATTR_SNAPSHOT_SYNC_PORT	"SnapshotSyncPort"
 #define ATTR_REST_PREFIX     	"restful_prefix"
 
+#define ATTR_COOLING_TEMP_MIN	"TempMin"
+#define ATTR_COOLING_TEMP_MAX	"TempMax"
+#define ATTR_COOLING_PWM_MIN	"PwmMin"
+#define ATTR_COOLING_PWM_MAX	"PwmMax"
+
 #define ATTR_RACK_PLATFORM		"Platform"
 #define ATTR_RACK_PLATFORM_BDCA	"BDC-A"
 #define ATTR_RACK_PLATFORM_BDCR	"BDC-R"
@@ -95,6 +95,13 @@ int rmm_cfg_get_rmcp_password(char *password, int max_len);
 int rmm_cfg_get_vm_root_password(char *password, int max_len, int vm_idx);
 int rmm_cfg_get_rest_prefix(char *prefix, int max_len);
 
+/**
+ * @brief get the thermal curve of the aggregated_thermal cooling policy
+ *
+ * @return 0 if all four values were found, -1 otherwise.
+ */
+int rmm_cfg_get_cooling_curve(int *temp_min, int *temp_max, int *pwm_min, int *pwm_max);
+
 int rmm_cfg_get_platform(char *platform);
 int is_platform_bdcr(void);
 
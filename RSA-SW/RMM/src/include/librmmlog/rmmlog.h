@@ -22,13 +22,23 @@
 
 extern const char *__progname;
 
-#define rmm_log(level, fmt, args...) rmm_log_request(level, __func__, fmt, ##args)
+/* level of this module in rmmlogd, see rmm_log_init */
+extern volatile int32 *rmm_log_level;
 
-#define rmm_log_ex(module_name, func_name, level, fmt, args...) rmm_log_request(level, func_name, fmt, ##args)
+#define rmm_log_enabled(level)	((level) <= *rmm_log_level)
+
+/* Disabled levels cost one compare, the arguments are not evaluated. */
+#define rmm_log(level, fmt, args...) \
+	(rmm_log_enabled(level) ? rmm_log_request(level, __func__, fmt, ##args) : 0)
+
+#define rmm_log_ex(module_name, func_name, level, fmt, args...) \
+	(rmm_log_enabled(level) ? rmm_log_request(level, func_name, fmt, ##args) : 0)
 
 /**
  * @brief rmm log initialize.
  *
+ * Maps the module levels published by rmmlogd and starts the thread
+ * which flushes batched records.
  */
 int rmm_log_init(void);
 
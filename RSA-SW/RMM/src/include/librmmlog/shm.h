@@ -0,0 +1,66 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __LIBRMMLOG_SHM_H__
+#define __LIBRMMLOG_SHM_H__
+
+#include "libutils/types.h"
+#include "libutils/log_level.h"
+
+/*
+ * Log modules table published by rmmlogd in a POSIX shared memory segment.
+ * Clients read the level of their module from it, so disabled messages
+ * are dropped before they are formatted, and count what they sent. rmmlogd
+ * counts what it received.
+ */
+
+#define RMMLOG_SHM_NAME			"/rmmlog"
+#define RMMLOG_SHM_MAGIC		0x53474c52	/* "RLGS" */
+#define RMMLOG_SHM_VERSION		1
+
+#define RMMLOG_SHM_MODULE_NUM	16
+
+struct rmmlog_shm_module {
+	char name[EVT_MODULE_LEN];
+	volatile int32 level;
+
+	volatile uint32 sent;		/* records sent by clients */
+	volatile uint32 dropped;	/* records clients failed to send */
+	volatile uint32 received;	/* records written by rmmlogd */
+};
+
+struct rmmlog_shm_hdr {
+	uint32 magic;
+	uint32 version;
+	uint32 module_num;
+	volatile uint32 valid;	/* cleared when rmmlogd replaces the segment */
+
+	struct rmmlog_shm_module modules[RMMLOG_SHM_MODULE_NUM];
+};
+
+/* module names in the rmm config contain the process name */
+static inline struct rmmlog_shm_module *rmmlog_shm_find(struct rmmlog_shm_hdr *shm, const char *name)
+{
+	uint32 i;
+
+	for (i = 0; i < shm->module_num && i < RMMLOG_SHM_MODULE_NUM; i++) {
+		if (strstr(shm->modules[i].name, name) != NULL)
+			return &shm->modules[i];
+	}
+
+	return NULL;
+}
+
+#endif
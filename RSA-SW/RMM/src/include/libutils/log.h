@@ -47,21 +47,47 @@ static char *log_severity[5] = {EVT_SEVERITY_CRITICAL,
 								EVT_SEVERITY_INFO,
 								EVT_SEVERITY_DBG};
 
+/*
+ * Every module logs into a fixed size ring of fixed size records, kept in
+ * a memory mapped file /var/log/<module>/logring. The header holds the
+ * sequence id of the newest record, record <seq> lives in slot
+ * (seq - 1) % record_num, so the last N lines are found without reading
+ * the rest of the log. A record is written before the head is moved, a
+ * crash never exposes a half written line.
+ */
+#define LOG_RING_MAGIC			0x474f4c52	/* "RLOG" */
+#define LOG_RING_VERSION		1
+#define LOG_RECORD_SIZE			256
+#define LOG_DEFAULT_MAX_LINES	1000
+
+struct log_ring {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int record_size;
+	unsigned int record_num;
+	volatile unsigned int head;		/* sequence id of the newest record, 0 if empty */
+	unsigned int reserved[3];
+
+	char records[0];
+};
+
+#define LOG_RING_SIZE(num)	(sizeof(struct log_ring) + (size_t)(num) * LOG_RECORD_SIZE)
+
 struct loginfo {
 	char module[MAX_PATH_SIZE];
-	char logfile_curr[MAX_PATH_SIZE];
+	char logfile[MAX_PATH_SIZE];
 	char logfile_tmp[MAX_PATH_SIZE];
-	char logfile_old[MAX_PATH_SIZE];
 	int  level;
 	int  max_lines;
-	int  fd;
-	unsigned int curr_index;
+	struct log_ring *ring;		/* mapped on first use */
 };
 
 long log_init(const char *module_name);
 void log_set_level(long hander, int level);
 void log_set_max_lines(long handler, int max_lines);
 void log_put(long handler, const int level, const const char *func, const char *msg);
+/* Copies the last <last_count> lines, oldest first, into <data> which holds
+ * last_count * LOG_RECORD_SIZE bytes; returns the number of lines copied. */
 int log_get(long handler, int last_count, char *data);
 
 void log_close(long handler);
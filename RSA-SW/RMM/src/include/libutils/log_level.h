@@ -23,6 +23,9 @@
 #define EVT_MSG_LEN				(1024)
 
 #define EVT_WRITE_LOG 			0
+#define EVT_WRITE_LOG_BATCH		1
+
+#define EVT_BATCH_SIZE			(8 * 1024)
 
 enum log_level {
 	CRITICAL,
@@ -41,4 +44,21 @@ struct log_evt {
 	char	msg[EVT_MSG_LEN];
 };
 
+/*
+ * EVT_WRITE_LOG_BATCH datagram: struct log_batch, then <count> records.
+ * A record is struct log_rec followed by fn_len + msg_len bytes, the
+ * function name and the message, both '\0' terminated.
+ */
+struct log_batch {
+	int		type;
+	int		count;
+	char	module_name[EVT_MODULE_LEN];
+};
+
+struct log_rec {
+	int		level;
+	unsigned short	fn_len;
+	unsigned short	msg_len;
+};
+
 #endif
@@ -24,6 +24,9 @@
 
 int create_udp_listen(unsigned int host, int port, int broadcast, int reuse);
 int udp_create(void);
+int create_tcp_listen(unsigned int host, int port, int backlog);
+/* blocking stream socket, reads and writes time out after timeout_ms */
+int tcp_connect(unsigned int host, int port, int timeout_ms);
 int udp_connect(unsigned int host, int port);
 int udp_sendto(int sock_fd,  unsigned long host, int port, unsigned char* snd_buf, int snd_len);
 int udp_recv(int sock_fd, unsigned char* recv_buf, int len, int timeout_ms);
@@ -36,7 +39,7 @@ static inline ssize_t socket_recv(int sockfd, void *buf, size_t len)
 	ssize_t total = 0;
 	int retry = 0;
 
-	while (retry < 3) {
+	while (retry < 3 && (size_t)total < len) {
 		tmp = recv(sockfd, buf+total, len-total, 0);
 		if (tmp < 0) {
 			if (errno == EAGAIN || errno == EINTR) {
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __LIBUTILS_TIMER_WHEEL_H__
+#define __LIBUTILS_TIMER_WHEEL_H__
+
+#include "libutils/list.h"
+
+#define TIMER_WHEEL_BITS	6
+#define TIMER_WHEEL_SIZE	(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS	4	/* 64^4 ticks */
+
+struct wheel_timer {
+	struct list_head list;
+	unsigned long long expires;		/* in ticks */
+
+	void (*handle_timer)(struct wheel_timer *timer);
+};
+
+/*
+ * Hierarchical timer wheel: level 0 has one slot per tick, each upper
+ * level one slot per turn of the level below. Adding, deleting and
+ * running a timer are O(1); a timer moves down at most LEVELS - 1 times.
+ */
+struct timer_wheel {
+	unsigned long long now;			/* next tick to run */
+	struct list_head slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+};
+
+void timer_wheel_init(struct timer_wheel *wheel, unsigned long long now);
+void wheel_timer_init(struct wheel_timer *timer, void (*handle_timer)(struct wheel_timer *));
+
+/**
+  *  @brief (re)arm a timer to expire after ticks, at least one
+  */
+void wheel_timer_add(struct timer_wheel *wheel, struct wheel_timer *timer, unsigned int ticks);
+void wheel_timer_del(struct wheel_timer *timer);
+
+static inline int wheel_timer_pending(struct wheel_timer *timer)
+{
+	return !list_empty(&timer->list);
+}
+
+/**
+  *  @brief run the timers expired up to tick now, the handler may add or
+  *  delete any timer.
+  */
+void timer_wheel_run(struct timer_wheel *wheel, unsigned long long now);
+
+#endif
@@ -16,6 +16,9 @@
 #ifndef __AM_API_H__
 #define __AM_API_H__
 
+#include "libmemdb/memdb.h"
+#include "libjsonrpc/jsonrpc.h"
+
 int am_get_fan_pwm_by_id(memdb_integer* cm_node_id, memdb_integer* fan_node_id, int64 fan_idx);
 int am_set_fan_pwm(int64 tzone_idx, int64 fan_idx, int64 pwm);
 int am_peripheral_hard_reset(int64 cm_idx, int64 peripheral_id, int32 * result);
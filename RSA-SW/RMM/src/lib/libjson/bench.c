@@ -0,0 +1,217 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libjson/json.h"
+#include "libutils/test.h"
+
+/*
+ * Parse, format and member lookup throughput on RMM JSON-RPC messages,
+ * the memdb, jipmi and assetd messages below or one message per line of
+ * a file.
+ *
+ * usage: jsonbench [messages file] [rounds]
+ */
+
+#define MAX_MESSAGES	8192
+#define MAX_MSG_LEN		(64 * 1024)
+
+static char *builtin[] = {
+	/* memdb attrbute_set */
+	"{\"json_rpc\": \"2.0\",\"id\": 1548,\"method\": \"attrbute_set\",\"params\": {\"p_cookie\": 0,\"p_snapshot_flag\": 0,\"p_name\": \"aggregated_thermal\",\"p_data\": \"31\",\"db_name\": \"RMM\",\"node_id\": 10000021,\"lock_id\": 0}}",
+	/* memdb result */
+	"{\"json_rpc\": \"2.0\",\"id\": 1548,\"result\": {\"node_id\": 10000021}}",
+	/* memdb event_node_attr */
+	"{\"json_rpc\": \"2.0\",\"method\": \"event_node_attr\",\"params\": {\"node_id\": 10000021,\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_thermal\",\"data\": \"31\"}}",
+	/* memdb attrs_set, 6 fans */
+	"{\"json_rpc\": \"2.0\",\"id\": 1549,\"method\": \"attrs_set\",\"params\": {\"p_attrs\": [{\"node\": 10000040,\"cookie\": 0,\"snapshot_flag\": 1,\"name\": \"desired_pwm_spd\",\"data\": \"55\"},{\"node\": 10000041,\"cookie\": 0,\"snapshot_flag\": 1,\"name\": \"desired_pwm_spd\",\"data\": \"55\"},{\"node\": 10000042,\"cookie\": 0,\"snapshot_flag\": 1,\"name\": \"desired_pwm_spd\",\"data\": \"55\"},{\"node\": 10000043,\"cookie\": 0,\"snapshot_flag\": 1,\"name\": \"desired_pwm_spd\",\"data\": \"55\"},{\"node\": 10000044,\"cookie\": 0,\"snapshot_flag\": 1,\"name\": \"desired_pwm_spd\",\"data\": \"55\"},{\"node\": 10000045,\"cookie\": 0,\"snapshot_flag\": 1,\"name\": \"desired_pwm_spd\",\"data\": \"55\"}],\"db_name\": \"RMM\",\"node_id\": 10000040,\"lock_id\": 0}}",
+	/* memdb event_node_attrs, drawer */
+	"{\"json_rpc\": \"2.0\",\"method\": \"event_node_attrs\",\"params\": {\"node_id\": 10000022,\"attrs\": [{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_thermal\",\"data\": \"40\"},{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_pwm0\",\"data\": \"41\"},{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_pwm1\",\"data\": \"42\"},{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_pwm2\",\"data\": \"43\"},{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_pwm3\",\"data\": \"44\"},{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_pwm4\",\"data\": \"45\"},{\"cookie\": 0,\"action\": 3,\"name\": \"aggregated_pwm5\",\"data\": \"46\"},{\"cookie\": 0,\"action\": 3,\"name\": \"pwm_presence\",\"data\": \"47\"},{\"cookie\": 0,\"action\": 3,\"name\": \"thermal_presence\",\"data\": \"48\"},{\"cookie\": 0,\"action\": 3,\"name\": \"health_state\",\"data\": \"49\"},{\"cookie\": 0,\"action\": 3,\"name\": \"power_consumption\",\"data\": \"50\"},{\"cookie\": 0,\"action\": 3,\"name\": \"tray_ruuid\",\"data\": \"51\"}]}}",
+	/* memdb attrs_get result, psu */
+	"{\"json_rpc\": \"2.0\",\"id\": 1550,\"result\": {\"r_attrs\": [{\"node\": 10000031,\"cookie\": 0,\"name\": \"loc_id\",\"data\": \"value_0\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"uuid\",\"data\": \"value_1\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"name\",\"data\": \"value_2\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"description\",\"data\": \"value_3\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"create_date\",\"data\": \"value_4\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"update_date\",\"data\": \"value_5\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"health_state\",\"data\": \"value_6\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"enable_state\",\"data\": \"value_7\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"power_in\",\"data\": \"value_8\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"current_out\",\"data\": \"value_9\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"power_out\",\"data\": \"value_10\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"power_cap\",\"data\": \"value_11\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"serial_num\",\"data\": \"value_12\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"manufacture\",\"data\": \"value_13\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"model\",\"data\": \"value_14\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"part_num\",\"data\": \"value_15\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"fw_ver\",\"data\": \"value_16\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"redundancy_set\",\"data\": \"value_17\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"x_location\",\"data\": \"value_18\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"u_location\",\"data\": \"value_19\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"u_height\",\"data\": \"value_20\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"total_power_capacity\",\"data\": \"value_21\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"tch_power\",\"data\": \"value_22\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"redundancy_mode\",\"data\": \"value_23\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"aggregated_power\",\"data\": \"value_24\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"psu_present\",\"data\": \"value_25\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"fru_data\",\"data\": \"value_26\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"ac_status\",\"data\": \"value_27\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"in_voltage\",\"data\": \"value_28\"},{\"node\": 10000031,\"cookie\": 0,\"name\": \"out_voltage\",\"data\": \"value_29\"}],\"r_truncated\": 0,\"node_id\": 10000031}}",
+	/* memdb create_node */
+	"{\"json_rpc\": \"2.0\",\"id\": 1551,\"method\": \"create_node\",\"params\": {\"p_parent\": 10000001,\"p_type\": \"DRAWER\",\"p_snapshot_flag\": 0,\"db_name\": \"RMM\",\"node_id\": 0,\"lock_id\": 0}}",
+	/* memdb add_subscription */
+	"{\"json_rpc\": \"2.0\",\"id\": 1552,\"method\": \"add_subscription\",\"params\": {\"p_event\": 2,\"p_cb_port\": 38698,\"p_cb_pid\": 0,\"p_node_id\": 10000022,\"p_name_prefix\": \"aggregated_\",\"p_prefix_len\": 11,\"p_coalesce\": 1,\"db_name\": \"RMM\",\"node_id\": 0,\"lock_id\": 0}}",
+	/* memdb error */
+	"{\"json_rpc\": \"2.0\",\"id\": 1553,\"error\": {\"code\": -32001,\"message\": \"Node requried not found.\"}}",
+	/* jipmi rmcp_req */
+	"{\"json_rpc\": \"2.0\",\"id\": 37,\"method\": \"rmcp_req\",\"params\": {\"target_ip\": \"192.168.0.2\",\"target_port\": \"623\",\"rsp_type\": \"UDP\",\"netfn\": \"48\",\"cmd\": \"152\",\"name\": \"admin\",\"password\": \"admin\",\"data_len\": \"4\",\"data\": \"0a0b0c0d\"}}",
+	/* jipmi result */
+	"{\"json_rpc\": \"2.0\",\"id\": 37,\"result\": {\"data\": \"00fe01fe02fe03fe04fe05fe06fe07fe08fe09fe0afe0bfe0cfe0dfe0efe0ffe\"}}",
+	/* assetd on_changed */
+	"{\"json_rpc\": \"2.0\",\"id\": 902,\"method\": \"on_changed\",\"params\": {\"evt_type\": 3,\"module_name\": \"Drawer\",\"component\": \"8a2b3c4d-5e6f-4711-8899-aabbccddeeff\",\"parent\": \"1f2e3d4c-5b6a-4788-9900-ffeeddccbbaa\",\"dz_lid\": 1,\"tray_lid\": 2,\"drawer_lid\": 2}}",
+};
+
+static char *messages[MAX_MESSAGES];
+static int msg_num;
+static long total_len;
+
+static int load_messages(char *path)
+{
+	static char line[MAX_MSG_LEN];
+	FILE *fp = fopen(path, "r");
+
+	if (fp == NULL)
+		return -1;
+
+	while (msg_num < MAX_MESSAGES && fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0')
+			continue;
+		messages[msg_num++] = strdup(line);
+	}
+	fclose(fp);
+
+	return msg_num ? 0 : -1;
+}
+
+static void report(char *what, double ns, int rounds, long bytes)
+{
+	printf("%-16s %10.1f MB/s %10.0f ns/msg\n", what,
+		   bytes * 1e3 / ns, ns / ((double)rounds * msg_num));
+}
+
+static int run_parse(int rounds, int arena)
+{
+	struct timespec start;
+	json_t *json;
+	int errors = 0;
+	int i, j;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < msg_num; j++) {
+			json = arena ? json_parse_arena(messages[j], 0) : json_parse(messages[j]);
+			if (json == NULL) {
+				errors++;
+				continue;
+			}
+			json_free(json);
+		}
+	}
+	report(arena ? "parse, arena" : "parse", elapsed_ns(&start), rounds, total_len * rounds);
+
+	return errors;
+}
+
+static void run_format(json_t **docs, int rounds)
+{
+	struct timespec start;
+	static char out[MAX_MSG_LEN];
+	long bytes = 0;
+	int i, j;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < msg_num; j++)
+			bytes += json_format(docs[j], out, sizeof(out));
+	}
+	report("format", elapsed_ns(&start), rounds, bytes);
+}
+
+/* Every member of every object, looked up by name. */
+static long lookup(json_t *json)
+{
+	json_pair_t *pair;
+	json_t *elem;
+	long found = 0;
+
+	if (json->type == JSON_OBJECT) {
+		for (pair = json_to_object(json)->next; pair != NULL; pair = pair->next) {
+			found += json_object_get(json, pair->name) == pair->value;
+			found += lookup(pair->value);
+		}
+	} else if (json->type == JSON_ARRAY) {
+		for (elem = json_to_array(json)->next; elem != NULL; elem = elem->next)
+			found += lookup(elem);
+	}
+
+	return found;
+}
+
+static void run_lookup(json_t **docs, int rounds)
+{
+	struct timespec start;
+	long found = 0;
+	int i, j;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < msg_num; j++)
+			found += lookup(docs[j]);
+	}
+	printf("%-16s %10.0f ns/msg, %ld members found\n", "object get",
+		   elapsed_ns(&start) / ((double)rounds * msg_num), found / rounds);
+}
+
+int main(int argc, char **argv)
+{
+	static char out[MAX_MSG_LEN];
+	json_t **docs;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20000;
+	int from_file = argc > 1 && strcmp(argv[1], "-") != 0;
+	int errors = 0;
+	int i;
+
+	if (from_file) {
+		if (load_messages(argv[1]) != 0) {
+			printf("usage: %s [messages file] [rounds]\n", argv[0]);
+			return -1;
+		}
+	} else {
+		for (i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++)
+			messages[msg_num++] = builtin[i];
+	}
+
+	if (rounds <= 0) {
+		printf("usage: %s [messages file] [rounds]\n", argv[0]);
+		return -1;
+	}
+
+	docs = calloc(msg_num, sizeof(json_t *));
+	if (docs == NULL)
+		return -1;
+
+	for (i = 0; i < msg_num; i++) {
+		total_len += strlen(messages[i]);
+		docs[i] = json_parse(messages[i]);
+		if (docs[i] == NULL) {
+			printf("FAIL: message %d does not parse\n", i);
+			return -1;
+		}
+		/* the built-in messages are written as json_format writes them */
+		if (!from_file && (json_format(docs[i], out, sizeof(out)) <= 0 || strcmp(out, messages[i]) != 0)) {
+			printf("FAIL: message %d formats differently\n", i);
+			errors++;
+		}
+	}
+
+	printf("%d messages, %ld bytes, %d rounds\n", msg_num, total_len, rounds);
+	errors += run_parse(rounds, 0);
+	errors += run_parse(rounds, 1);
+	run_format(docs, rounds);
+	run_lookup(docs, rounds);
+
+	for (i = 0; i < msg_num; i++)
+		json_free(docs[i]);
+	free(docs);
+
+	return errors ? -1 : 0;
+}
@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
@@ -21,378 +22,509 @@
 /*****************************************************************************/
 /*****************************************************************************/
 
-#define TOKEN_INVALID         -1
-#define TOKEN_EOF              0
-#define TOKEN_STRING         256
-#define TOKEN_INTEGER        257
-#define TOKEN_REAL           258
-#define TOKEN_TRUE           259
-#define TOKEN_FALSE          260
-#define TOKEN_NULL           261
+/* character classes, parsing and formatting scan runs of plain bytes */
+#define C_SPACE		0x01
+#define C_DIGIT		0x02
+#define C_ALPHA		0x04
+#define C_STR		0x08	/* ends a run of string bytes: '"' '\\' '\0' */
+#define C_FMT		0x10	/* escaped or refused by format_string */
+
+static const unsigned char char_class[256] = {
+	[0]				= C_STR | C_FMT,
+	[1 ... 8]		= C_FMT,
+	['\t']			= C_SPACE | C_FMT,
+	['\n']			= C_SPACE | C_FMT,
+	[11 ... 12]		= C_FMT,
+	['\r']			= C_SPACE | C_FMT,
+	[14 ... 31]		= C_FMT,
+	[' ']			= C_SPACE,
+	['"']			= C_STR | C_FMT,
+	['0' ... '9']	= C_DIGIT,
+	['A' ... 'Z']	= C_ALPHA,
+	['\\']			= C_STR | C_FMT,
+	['a' ... 'z']	= C_ALPHA,
+	[128 ... 255]	= C_FMT,
+};
+
+#define char_is(c, class)	(char_class[(unsigned char)(c)] & (class))
+
+#define JSON_F_ARENA	0x01	/* memory belongs to an arena */
+#define JSON_F_ROOT		0x02	/* root of an arena, json_free releases the arena */
+
+#define HASH_MIN_SIZE	8		/* objects with more members get a hash index */
+
+#define ARENA_MIN_SIZE	1024
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	int size;
+	int used;
+	long long data[0];
+};
 
 typedef struct {
-	char *data;
-	int   pos;
-} stream_t;	
+	char *pos;
+	struct arena_chunk *arena;	/* first chunk, NULL if values are malloc'ed */
+	struct arena_chunk *chunk;	/* chunk being filled */
+} parser_t;
 
-typedef struct {
-#define TOKENSZ	4095
-	int  _len;
-	//char _buf[TOKENSZ + 1];
-	char *_buf;
-	int  _max_len;
-} token_t;
-
-typedef struct {
-	int result;		/* TOKEN_XXX */
-
-	union {
-		char *string;
-		int64 integer;
-		double real;
-	} value;
-
-	stream_t stream;
-	token_t  token;
-} lex_t;
-
-/*** Token ***/
-static inline void token_init(token_t *token)
+static inline void json_init(json_t *json, json_type type)
 {
-	token->_len = 0;
+	json->type = type;
+	json->flags = 0;
+	json->next = NULL;
 }
 
-static inline char *token_string(token_t *token)
+/*** Arena ***/
+static struct arena_chunk *arena_chunk_new(int size)
 {
-	token->_buf[token->_len] = '\0';
-	return token->_buf;
+	struct arena_chunk *chunk = malloc(sizeof(struct arena_chunk) + size);
+
+	if (chunk == NULL)
+		return NULL;
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
 }
 
-static inline void token_replace(token_t *token, char c)
+static void arena_release(struct arena_chunk *chunk)
 {
-	if (token->_len > 0)
-		token->_buf[token->_len - 1] = c;
+	struct arena_chunk *next;
+
+	for (; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
 }
 
-static inline void token_push(token_t *token, char c)
+static void *parser_alloc(parser_t *p, int size)
 {
-	//if (token->_len == TOKENSZ) {
-	if (token->_len == token->_max_len) {
-		printf("ERROR: TOKENSZ(%d) is small!\n", token->_max_len);
-		return;
+	struct arena_chunk *chunk = p->chunk;
+	void *ptr;
+
+	if (p->arena == NULL)
+		return malloc(size);
+
+	size = (size + 7) & ~7;
+	if (chunk->used + size > chunk->size) {
+		chunk = arena_chunk_new(size > chunk->size * 2 ? size : chunk->size * 2);
+		if (chunk == NULL)
+			return NULL;
+		/* the first chunk starts with the root, later ones are linked after it */
+		chunk->next = p->arena->next;
+		p->arena->next = chunk;
+		p->chunk = chunk;
 	}
 
-	token->_buf[token->_len++] = c;
+	ptr = (char *)chunk->data + chunk->used;
+	chunk->used += size;
+	return ptr;
 }
 
-static inline void token_pop(token_t *token)
+static inline int parser_flags(parser_t *p)
 {
-	if (token->_len > 0)
-		--token->_len;
+	return p->arena ? JSON_F_ARENA : 0;
 }
 
-/*** Stream ***/
-static inline void stream_init(stream_t *stream, char *data)
+/*** Object members ***/
+static unsigned int hash_key(const char *key)
 {
-	stream->data = data;
-	stream->pos = 0;
+	unsigned int hash = 2166136261u;
+
+	while (*key != '\0')
+		hash = (hash ^ (unsigned char)*key++) * 16777619u;
+
+	return hash;
 }
 
-static inline char stream_get(stream_t *stream)
+static int object_rehash(json_object_t *object, int size)
 {
-	char c;
+	json_pair_t **hash = calloc(size, sizeof(json_pair_t *));
+	json_pair_t *pair;
 
-	c = stream->data[stream->pos];
-	if (c == '\0')
-		return (char)EOF;
+	if (hash == NULL)
+		return 0;
 
-	stream->pos++;
-	return c;
-}
+	for (pair = object->next; pair != NULL; pair = pair->next) {
+		pair->hnext = hash[pair->hash & (size - 1)];
+		hash[pair->hash & (size - 1)] = pair;
+	}
 
-static inline void stream_unget(stream_t *stream)
-{
-	if (stream->pos > 0)
-		stream->pos--;
+	free(object->hash);
+	object->hash = hash;
+	object->hash_size = size;
+	return 1;
 }
 
-/*** Lex ***/
-static void lex_init(lex_t *lex, char *data)
+static json_pair_t *object_find(const json_object_t *object, const char *key, unsigned int hash)
 {
-	lex->result = TOKEN_INVALID;
+	json_pair_t *pair;
 
-	stream_init(&lex->stream, data);
-	token_init(&lex->token);
-}
+	if (object->hash != NULL) {
+		pair = object->hash[hash & (object->hash_size - 1)];
+		for (; pair != NULL; pair = pair->hnext) {
+			if (pair->hash == hash && strcmp(pair->name, key) == 0)
+				return pair;
+		}
+		return NULL;
+	}
 
-static void lex_close(lex_t *lex)
-{
-	if (lex->result == TOKEN_STRING && lex->value.string != NULL) {
-		free(lex->value.string);
-		lex->value.string = NULL;
+	for (pair = object->next; pair != NULL; pair = pair->next) {
+		if (pair->hash == hash && strcmp(pair->name, key) == 0)
+			return pair;
 	}
+
+	return NULL;
 }
 
-static inline char *lex_token(lex_t *lex)
+/* Append a member, fails if the key is already there. */
+static int object_insert(json_object_t *object, json_pair_t *pair)
 {
-	return token_string(&lex->token);
+	if (object_find(object, pair->name, pair->hash) != NULL)
+		return 0;
+
+	if (object->size + 1 > HASH_MIN_SIZE && object->size + 1 > object->hash_size / 2 &&
+		!object_rehash(object, object->hash_size ? object->hash_size * 2 : HASH_MIN_SIZE * 4))
+		return 0;
+
+	pair->next = NULL;
+	if (object->tail == NULL)
+		object->next = pair;
+	else
+		object->tail->next = pair;
+	object->tail = pair;
+	object->size++;
+
+	if (object->hash != NULL) {
+		pair->hnext = object->hash[pair->hash & (object->hash_size - 1)];
+		object->hash[pair->hash & (object->hash_size - 1)] = pair;
+	}
+
+	return 1;
 }
 
-static char lex_get(lex_t *lex)
+static json_t *new_object(parser_t *p)
 {
-	return stream_get(&lex->stream);
+	json_object_t *object = parser_alloc(p, sizeof(json_object_t));
+
+	if (object == NULL)
+		return NULL;
+
+	json_init(&object->json, JSON_OBJECT);
+	object->json.flags = parser_flags(p);
+	object->next = NULL;
+	object->tail = NULL;
+	object->size = 0;
+	object->hash_size = 0;
+	object->hash = NULL;
+
+	return &object->json;
 }
 
-static void lex_save(lex_t *lex, char c)
+static json_t *new_array(parser_t *p)
 {
-	token_push(&lex->token, c);
+	json_array_t *array = parser_alloc(p, sizeof(json_array_t));
+
+	if (array == NULL)
+		return NULL;
+
+	json_init(&array->json, JSON_ARRAY);
+	array->json.flags = parser_flags(p);
+	array->size = 0;
+	array->next = NULL;
+	array->tail = NULL;
+
+	return &array->json;
 }
 
-static char lex_read(lex_t *lex)
+static json_t *new_value(parser_t *p, json_type type, int size)
 {
-	char c;
+	json_t *json = parser_alloc(p, size);
 
-	c = stream_get(&lex->stream);
-	token_push(&lex->token, c);
+	if (json == NULL)
+		return NULL;
 
-	return c;
+	json_init(json, type);
+	json->flags = parser_flags(p);
+	return json;
 }
 
-static void lex_back(lex_t *lex)
+/*** Parse ***/
+static inline void skip_space(parser_t *p)
 {
-	stream_unget(&lex->stream);
-	token_pop(&lex->token);
+	while (char_is(*p->pos, C_SPACE))
+		p->pos++;
 }
 
-static void lex_replace(lex_t *lex, char c)
+/* Length of the string from s up to its closing quote, -1 if not closed. */
+static int scan_string(char *s, int *escaped)
 {
-	token_replace(&lex->token, c);
+	char *end = s;
+
+	for (;;) {
+		while (!char_is(*end, C_STR))
+			end++;
+
+		if (*end == '"')
+			return end - s;
+		if (*end == '\0' || end[1] == '\0')
+			return -1;
+
+		*escaped = 1;
+		end += 2;
+	}
 }
 
-static void lex_scan_string(lex_t *lex)
+/* Copy len bytes of string to dest, unescaped. */
+static int copy_string(char *dest, char *src, int len, int escaped)
 {
-	char c, t;
-	char *token;
-
-	lex->value.string = NULL;
-	lex->result = TOKEN_INVALID;
+	char *end = src + len;
+	char c;
 
-	c = lex_read(lex);
-	while (c != '"') {
-		if (c == (char)EOF)
-			return;
+	if (!escaped) {
+		memcpy(dest, src, len);
+		dest[len] = '\0';
+		return 1;
+	}
 
+	while (src < end) {
+		c = *src++;
 		if (c != '\\') {
-			c = lex_read(lex);
+			*dest++ = c;
 			continue;
 		}
 
-		c = lex_get(lex);
+		c = *src++;
 		switch (c) {
-			case '"': 
-			case '\\': 
+			case '"':
+			case '\\':
 			case '/':
-				t = c;
 				break;
 
-			case 'b': t = '\b'; break;
-			case 'f': t = '\f'; break;
-			case 'n': t = '\n'; break;
-			case 'r': t = '\r'; break;
-			case 't': t = '\t'; break;
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
 
 			default:
 				printf("Invalid Escape value: %c!\n", c);
-				return;
+				return 0;
 		}
-		lex_replace(lex, t);
-
-		c = lex_read(lex);
+		*dest++ = c;
 	}
+	*dest = '\0';
 
-	lex_replace(lex, '\0');	/* overwite the last \" */
-	token = lex_token(lex);
-	lex->value.string = strdup(token + 1);	/* skip the first \" */
-	if (!lex->value.string)
-		return;
-
-	lex->result = TOKEN_STRING;
+	return 1;
 }
 
-static void lex_scan_number(lex_t *lex, char c)
+static json_pair_t *parse_key(parser_t *p)
 {
-	double real;
-	char *token, *end;
+	json_pair_t *pair;
+	int escaped = 0;
+	int len;
 
-	lex->result = TOKEN_INVALID;
+	len = scan_string(p->pos + 1, &escaped);
+	if (len < 0)
+		return NULL;
 
-	if (c == '-')
-		c = lex_read(lex);
+	/* the name is kept right after the pair */
+	pair = parser_alloc(p, sizeof(json_pair_t) + len + 1);
+	if (pair == NULL)
+		return NULL;
 
-	if (c == '0') {
-		c = lex_read(lex);
-		if (isdigit(c))
-			return;
-	} else if (isdigit(c)) {
-		c = lex_read(lex);
-		while (isdigit(c))
-			c = lex_read(lex);
-	} else {
-		return;
+	pair->name = (char *)(pair + 1);
+	pair->value = NULL;
+	pair->next = NULL;
+	pair->hnext = NULL;
+	pair->flags = parser_flags(p);
+	if (!copy_string(pair->name, p->pos + 1, len, escaped)) {
+		if (p->arena == NULL)
+			free(pair);
+		return NULL;
 	}
+	pair->hash = hash_key(pair->name);
 
-	if (c != '.' && c != 'E' && c != 'e') {
-		int64 integer;
+	p->pos += len + 2;
+	return pair;
+}
 
-		lex_back(lex);
-		token = lex_token(lex);
-		errno = 0;
-		integer = strtoll(token, &end, 10);
-		if (errno == ERANGE)
-			return;
+static json_t *parse_string(parser_t *p)
+{
+	json_string_t *string;
+	int escaped = 0;
+	int len;
 
-		lex->result = TOKEN_INTEGER;
-		lex->value.integer = integer;
-		return;
+	len = scan_string(p->pos + 1, &escaped);
+	if (len < 0)
+		return NULL;
+
+	string = (json_string_t *)new_value(p, JSON_STRING, sizeof(json_string_t) + len + 1);
+	if (string == NULL)
+		return NULL;
+
+	string->value = (char *)(string + 1);
+	if (!copy_string(string->value, p->pos + 1, len, escaped)) {
+		json_free(&string->json);
+		return NULL;
 	}
 
-	if (c == '.') {
-		c = lex_get(lex);
-		if (!isdigit(c))
-			return;
-		lex_save(lex, c);
+	p->pos += len + 2;
+	return &string->json;
+}
+
+static json_t *parse_number(parser_t *p)
+{
+	char *start = p->pos;
+	char *s = start;
+	json_t *json;
+	uint64 integer = 0;
+	double real;
+
+	if (*s == '-')
+		s++;
 
-		c = lex_read(lex);
-		while (isdigit(c))
-			c = lex_read(lex);
+	if (*s == '0') {
+		s++;
+		if (char_is(*s, C_DIGIT))
+			return NULL;
+	} else if (char_is(*s, C_DIGIT)) {
+		while (char_is(*s, C_DIGIT))
+			s++;
+	} else {
+		return NULL;
 	}
 
-	if (c == 'E' || c == 'e') {
-		c = lex_read(lex);
-		if (c == '+' || c == '-')
-			c = lex_read(lex);
+	if (*s != '.' && *s != 'E' && *s != 'e') {
+		char *digit = start + (*start == '-');
+
+		/* up to 18 digits fit, longer ones are checked for range */
+		if (s - digit <= 18) {
+			for (; digit < s; digit++)
+				integer = integer * 10 + (*digit - '0');
+			if (*start == '-')
+				integer = -integer;
+		} else {
+			errno = 0;
+			integer = strtoll(start, NULL, 10);
+			if (errno == ERANGE)
+				return NULL;
+		}
 
-		if (!isdigit(c))
-			return;
+		json = new_value(p, JSON_INTEGER, sizeof(json_integer_t));
+		if (json == NULL)
+			return NULL;
+		json_to_integer(json)->value = (int64)integer;
+		p->pos = s;
+		return json;
+	}
 
-		c = lex_read(lex);
-		while (isdigit(c))
-			c = lex_read(lex);
+	if (*s == '.') {
+		s++;
+		if (!char_is(*s, C_DIGIT))
+			return NULL;
+		while (char_is(*s, C_DIGIT))
+			s++;
+	}
+
+	if (*s == 'E' || *s == 'e') {
+		s++;
+		if (*s == '+' || *s == '-')
+			s++;
+		if (!char_is(*s, C_DIGIT))
+			return NULL;
+		while (char_is(*s, C_DIGIT))
+			s++;
 	}
 
-	lex_back(lex);
-	token = lex_token(lex);
 	errno = 0;
-	real = strtod(token, &end);
+	real = strtod(start, NULL);
 	if (errno == ERANGE && real != 0)
-		return;
+		return NULL;
 
-	lex->result = TOKEN_REAL;
-	lex->value.real = real;
+	json = new_value(p, JSON_REAL, sizeof(json_real_t));
+	if (json == NULL)
+		return NULL;
+	json_to_real(json)->value = real;
+	p->pos = s;
+	return json;
 }
 
-static void lex_scan(lex_t *lex)
+static json_t *parse_literal(parser_t *p)
 {
-	char c;
+	char *end = p->pos;
+	json_type type;
 
-	token_init(&lex->token);
-
-	if (lex->result == TOKEN_STRING && lex->value.string != NULL) {
-		free(lex->value.string);
-		lex->value.string = NULL;
-	}
-
-	c = lex_get(lex);
-	while (c == ' ' || c == '\t' || c == '\n' || c == '\r')
-		c = lex_get(lex);
+	while (char_is(*end, C_ALPHA))
+		end++;
 
-	if (c == (char)EOF) {
-		lex->result = TOKEN_EOF;
-		return;
-	}
+	if (end - p->pos == 4 && strncasecmp(p->pos, "true", 4) == 0)
+		type = JSON_TRUE;
+	else if (end - p->pos == 5 && strncasecmp(p->pos, "false", 5) == 0)
+		type = JSON_FALSE;
+	else if (end - p->pos == 4 && strncasecmp(p->pos, "null", 4) == 0)
+		type = JSON_NULL;
+	else
+		return NULL;
 
-	lex_save(lex, c);
-
-	if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') {
-		lex->result = c;
-	} else if (c == '"') {
-		lex_scan_string(lex);
-	} else if (isdigit(c) || c == '-') {
-		lex_scan_number(lex, c);
-	} else if (isalpha(c)) {
-		char *token;
-
-		c = lex_read(lex);
-		while (isalpha(c))
-			c = lex_read(lex);
-		lex_back(lex);
-
-		token = lex_token(lex);
-		if (strcasecmp(token, "true") == 0)
-			lex->result = TOKEN_TRUE;
-		else if(strcasecmp(token, "false") == 0)
-			lex->result = TOKEN_FALSE;
-		else if(strcasecmp(token, "null") == 0)
-			lex->result = TOKEN_NULL;
-		else
-			lex->result = TOKEN_INVALID;
-	} else {
-		lex->result = TOKEN_INVALID;
-	}
+	p->pos = end;
+	return new_value(p, type, sizeof(json_t));
 }
 
-static json_t *parse_value(lex_t *lex);
+static json_t *parse_value(parser_t *p);
 
-static json_t *parse_object(lex_t *lex)
+static json_t *parse_object(parser_t *p)
 {
-	json_t *object = json_object();
+	json_t *object = new_object(p);
+	json_pair_t *pair;
+
 	if (!object)
 		return NULL;
 
-	lex_scan(lex);
-	if (lex->result == '}')
+	p->pos++;
+	skip_space(p);
+	if (*p->pos == '}') {
+		p->pos++;
 		return object;
+	}
 
 	for (;;) {
-		char *key;
-		json_t *value;
-
-		if (lex->result != TOKEN_STRING)
+		if (*p->pos != '"')
 			goto err;
 
-		key = lex->value.string;
-		lex->value.string = NULL;
-
-		lex_scan(lex);
-		if (lex->result != ':') {
-			free(key);
+		pair = parse_key(p);
+		if (pair == NULL)
 			goto err;
-		}
 
-		lex_scan(lex);
-		value = parse_value(lex);
-		if (!value) {
-			free(key);
-			goto err;
+		skip_space(p);
+		if (*p->pos == ':') {
+			p->pos++;
+			skip_space(p);
+			pair->value = parse_value(p);
 		}
 
-		if (!json_object_add(object, key, value)) {
-			free(key);
+		if (pair->value == NULL || !object_insert(json_to_object(object), pair)) {
+			if (pair->value)
+				json_free(pair->value);
+			if (p->arena == NULL)
+				free(pair);
 			goto err;
 		}
 
-		free(key);
-
-		lex_scan(lex);
-		if (lex->result != ',')
+		skip_space(p);
+		if (*p->pos != ',')
 			break;
 
-		lex_scan(lex);
+		p->pos++;
+		skip_space(p);
 	}
 
-	if (lex->result != '}')
+	if (*p->pos != '}')
 		goto err;
 
+	p->pos++;
 	return object;
 
 err:
@@ -400,33 +532,40 @@ err:
 	return NULL;
 }
 
-static json_t *parse_array(lex_t *lex)
+static json_t *parse_array(parser_t *p)
 {
-	json_t *array = json_array();
+	json_t *array = new_array(p);
+	json_t *elem;
+
 	if (!array)
 		return NULL;
 
-	lex_scan(lex);
-	if (lex->result == ']')
+	p->pos++;
+	skip_space(p);
+	if (*p->pos == ']') {
+		p->pos++;
 		return array;
+	}
 
-	while (lex->result != TOKEN_EOF && lex->result != TOKEN_INVALID) {
-		json_t *elem = parse_value(lex);
+	for (;;) {
+		elem = parse_value(p);
 		if (!elem)
 			goto err;
 
 		json_array_add(array, elem);
 
-		lex_scan(lex);
-		if (lex->result != ',')
+		skip_space(p);
+		if (*p->pos != ',')
 			break;
 
-		lex_scan(lex);
+		p->pos++;
+		skip_space(p);
 	}
 
-	if (lex->result != ']')
+	if (*p->pos != ']')
 		goto err;
 
+	p->pos++;
 	return array;
 
 err:
@@ -434,113 +573,99 @@ err:
 	return NULL;
 }
 
-static json_t *parse_value(lex_t *lex)
+static json_t *parse_value(parser_t *p)
 {
-	switch (lex->result) {
-	case TOKEN_STRING:
-		return json_string(lex->value.string);
-
-	case TOKEN_INTEGER:
-		return json_integer(lex->value.integer);
-
-	case TOKEN_REAL:
-		return json_real(lex->value.real);
-			
-	case TOKEN_TRUE:
-		return json_true();
+	char c = *p->pos;
 
-	case TOKEN_FALSE:
-		return json_false();
+	if (c == '"')
+		return parse_string(p);
 
-	case TOKEN_NULL:
-		return json_null();
+	if (c == '{')
+		return parse_object(p);
 
-	case '{':
-		return parse_object(lex);
+	if (c == '[')
+		return parse_array(p);
 
-	case '[':
-		return parse_array(lex);
+	if (c == '-' || char_is(c, C_DIGIT))
+		return parse_number(p);
 
-	default:
-		return NULL;
-	}
+	if (char_is(c, C_ALPHA))
+		return parse_literal(p);
 
 	return NULL;
 }
 
-json_t *json_parse(char *string)
+/* A whole document, an object or an array followed by nothing but spaces. */
+static json_t *parse_document(parser_t *p)
 {
-	lex_t lex;
-	json_t *result = NULL;
-
-	lex.token._buf = malloc(TOKENSZ + 1);
-	lex.token._len = TOKENSZ;
-	lex.token._max_len = TOKENSZ;
-	lex.value.integer = 0;
-	lex.value.real = 0;
-	lex.value.string = NULL;
-	
-	lex_init(&lex, string);
-	lex_scan(&lex);
-	if (lex.result != '[' && lex.result != '{')
-		goto out;
+	json_t *result;
+
+	skip_space(p);
+	if (*p->pos != '[' && *p->pos != '{')
+		return NULL;
 
-	result = parse_value(&lex);
+	result = parse_value(p);
 	if (!result)
-		goto out;
+		return NULL;
 
-	lex_scan(&lex);
-	if (lex.result != TOKEN_EOF) {
+	skip_space(p);
+	if (*p->pos != '\0') {
 		json_free(result);
-		result = NULL;
+		return NULL;
 	}
 
-out:
-	lex_close(&lex);
-	free(lex.token._buf);
 	return result;
 }
 
+json_t *json_parse(char *string)
+{
+	parser_t p = {string, NULL, NULL};
+
+	return parse_document(&p);
+}
+
 json_t *json_parse_with_len(char *string, int len)
 {
-	lex_t lex;
-	json_t *result = NULL;
+	json_t *result;
+	char *copy;
 
-	lex.token._buf = NULL;
-	lex.token._buf = malloc(len + 1);
+	/* the parser stops at '\0', a string running past len is cut there */
+	if (len <= 0 || memchr(string, '\0', len) != NULL)
+		return json_parse(string);
 
-	if(NULL == lex.token._buf)
-	{
-		printf("\n%s %d %s malloc %d fail\n", __FILE__, __LINE__, __FUNCTION__, len);
+	copy = malloc(len + 1);
+	if (copy == NULL)
 		return NULL;
-	}
+	memcpy(copy, string, len);
+	copy[len] = '\0';
 
-	memset(lex.token._buf, 0, len+1);
+	result = json_parse(copy);
+	free(copy);
+	return result;
+}
 
-	lex.token._len = len;
-	lex.token._max_len = len;
-	lex.value.integer = 0;
-	lex.value.real = 0;
-	lex.value.string = NULL;
+json_t *json_parse_arena(char *string, int len)
+{
+	parser_t p = {string, NULL, NULL};
+	json_t *result;
 
-	lex_init(&lex, string);
-	lex_scan(&lex);
-	if (lex.result != '[' && lex.result != '{')
-		goto out;
+	if (len <= 0)
+		len = strlen(string);
 
-	result = parse_value(&lex);
-	if (!result)
-		goto out;
+	/* most RMM messages fit in the first chunk */
+	p.arena = arena_chunk_new(len * 3 > ARENA_MIN_SIZE ? len * 3 : ARENA_MIN_SIZE);
+	if (p.arena == NULL)
+		return NULL;
+	p.chunk = p.arena;
 
-	lex_scan(&lex);
-	if (lex.result != TOKEN_EOF) {
-		json_free(result);
-		result = NULL;
+	result = parse_document(&p);
+	if (result == NULL) {
+		arena_release(p.arena);
+		return NULL;
 	}
 
-out:
-	lex_close(&lex);
-	free(lex.token._buf);
+	/* the root is the first value allocated, at the start of the arena */
+	result->flags |= JSON_F_ROOT;
 	return result;
 }
 
@@ -572,7 +697,7 @@ static void strbuf_init(strbuff_t *strbuf, char *buf, int sz)
 	strbuf->data_avail = sz - 1; /* Reserve one for '\0' */
 }
 
-static int strbuf_append(strbuff_t *strbuf, char *str, int len)
+static inline int strbuf_append(strbuff_t *strbuf, char *str, int len)
 {
 	char *ptr;
 
@@ -584,6 +709,16 @@ static int strbuf_append(strbuff_t *strbuf, char *str, int len)
 	return 1;
 }
 
+static inline int strbuf_putc(strbuff_t *strbuf, char c)
+{
+	if (strbuf->data_avail < 1)
+		return 0;
+
+	*strbuf->data++ = c;
+	strbuf->data_avail--;
+	return 1;
+}
+
 static inline void strbuf_finish(strbuff_t *strbuf)
 {
 	strbuf->data[0] = '\0';
@@ -592,30 +727,23 @@ static inline void strbuf_finish(strbuff_t *strbuf)
 static int format_string(strbuff_t *strbuf, char *str)
 {
 	char *esc;
-	char c, *pos, *end;
+	char *pos;
 
-	if (str == NULL || !strbuf_append(strbuf, "\"", 1))
+	if (str == NULL || !strbuf_putc(strbuf, '"'))
 		return 0;
 
-	end = pos = str;
 	for (;;) {
-		while ((c = *end) != '\0') {
-			if (c == '\\' || c == '"' || c < 0x20)
-				break;
-
-			end++;
-		}
-
-		if (end == pos)
-			break;
+		pos = str;
+		while (!char_is(*str, C_FMT))
+			str++;
 
-		if (!strbuf_append(strbuf, pos, end - pos))
+		if (str != pos && !strbuf_append(strbuf, pos, str - pos))
 			return 0;
 
-		if (c == '\0')
+		if (*str == '\0')
 			break;
 
-		switch (c) {
+		switch (*str) {
 		case '\\': esc = "\\\\"; break;
 		case '\"': esc = "\\\""; break;
 		case '\b': esc = "\\b"; break;
@@ -624,17 +752,33 @@ static int format_string(strbuff_t *strbuf, char *str)
 		case '\r': esc = "\\r"; break;
 		case '\t': esc = "\\t"; break;
 		default:
-			printf("JSON Invalid : %d\n", c);
+			printf("JSON Invalid : %d\n", *str);
 			return 0;
 		}
 		if (!strbuf_append(strbuf, esc, 2))
 			return 0;
 
-		end++;
-		pos = end;
+		str++;
 	}
 
-	return strbuf_append(strbuf, "\"", 1);
+	return strbuf_putc(strbuf, '"');
+}
+
+static int format_integer(strbuff_t *strbuf, int64 value)
+{
+	char data[24];
+	char *pos = data + sizeof(data);
+	uint64 n = value < 0 ? -(uint64)value : (uint64)value;
+
+	do {
+		*--pos = '0' + n % 10;
+		n /= 10;
+	} while (n != 0);
+
+	if (value < 0)
+		*--pos = '-';
+
+	return strbuf_append(strbuf, pos, data + sizeof(data) - pos);
 }
 
 static int do_format(json_t *json, strbuff_t *strbuf)
@@ -653,16 +797,7 @@ static int do_format(json_t *json, strbuff_t *strbuf)
 		return format_string(strbuf, json_string_value(json));
 
 	case JSON_INTEGER:
-	{
-		int  size;
-		char data[128];
-
-		size = snprintf(data, sizeof(data), "%lld", json_integer_value(json));
-		if (size >= sizeof(data))
-			return 0;
-
-		return strbuf_append(strbuf, data, size);
-	}
+		return format_integer(strbuf, json_to_integer(json)->value);
 				
 	case JSON_REAL:
 	{
@@ -690,7 +825,7 @@ static int do_format(json_t *json, strbuff_t *strbuf)
 		json_pair_t *pair;
 		json_object_t *obj = json_to_object(json);
 
-		if (!strbuf_append(strbuf, "{", 1))
+		if (!strbuf_putc(strbuf, '{'))
 			return 0;
 
 		for (pair = obj->next; pair != NULL; pair = pair->next) {
@@ -701,11 +836,11 @@ static int do_format(json_t *json, strbuff_t *strbuf)
 			if (!do_format(pair->value, strbuf))
 				return 0;
 
-			if (pair->next != NULL && !strbuf_append(strbuf, ",", 1))
+			if (pair->next != NULL && !strbuf_putc(strbuf, ','))
 				return 0;
 		}
 
-		return strbuf_append(strbuf, "}", 1);
+		return strbuf_putc(strbuf, '}');
 	}
 
 	case JSON_ARRAY:
@@ -713,18 +848,18 @@ static int do_format(json_t *json, strbuff_t *strbuf)
 		json_t *elem;
 		json_array_t *array = json_to_array(json);
 
-		if (!strbuf_append(strbuf, "[", 1))
+		if (!strbuf_putc(strbuf, '['))
 			return 0;
 
 		for (elem = array->next; elem != NULL; elem = elem->next) {
 			if (!do_format(elem, strbuf))
 				return 0;
 
-			if (elem->next != NULL && !strbuf_append(strbuf, ",", 1))
+			if (elem->next != NULL && !strbuf_putc(strbuf, ','))
 				return 0;
 		}
 
-		return strbuf_append(strbuf, "]", 1);
+		return strbuf_putc(strbuf, ']');
 	}
 
 	default:
@@ -826,19 +961,10 @@ void json_print(json_t *json)
 /*****************************************************************************/
 /*****************************************************************************/
 
-static inline void json_init(json_t *json, json_type type)
-{
-	json->type = type;
-	json->next = NULL;
-}
-
 void json_free(json_t *json)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return;
-	}
 
 	if (json->type == JSON_OBJECT) {
 		json_pair_t   *pair;
@@ -848,9 +974,10 @@ void json_free(json_t *json)
 			object->next = pair->next;
 
 			json_free(pair->value);
-			free(pair->name);
-			free(pair);
+			if (!(pair->flags & JSON_F_ARENA))
+				free(pair);
 		}
+		free(object->hash);
 	} else if (json->type == JSON_ARRAY) {
 		json_t *item;
 		json_array_t *array = json_to_array(json);
@@ -860,12 +987,13 @@ void json_free(json_t *json)
 
 			json_free(item);
 		}
-	} else if (json->type == JSON_STRING) {
-		json_string_t *string = json_to_string(json);
-		free(string->value);
-	} 
+	}
 
-	free(json);
+	/* names and string values are allocated with their pair or value */
+	if (json->flags & JSON_F_ROOT)
+		arena_release((struct arena_chunk *)((char *)json - offsetof(struct arena_chunk, data)));
+	else if (!(json->flags & JSON_F_ARENA))
+		free(json);
 }
 
 
@@ -878,6 +1006,9 @@ json_t *json_object(void)
 
 	object->next = NULL;
 	object->tail = NULL;
+	object->size = 0;
+	object->hash_size = 0;
+	object->hash = NULL;
 
 	return &object->json;
 }
@@ -890,10 +1021,7 @@ int json_object_remove(json_t *json, char *key)
 	json_object_t *object = NULL;
 
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type != JSON_OBJECT)
 		return 0;
@@ -914,10 +1042,19 @@ int json_object_remove(json_t *json, char *key)
 		object->tail = pre;
 	if(object->next == rm_pair)
 		object->next = rm_pair->next;
-	
+	object->size--;
+
+	if (object->hash != NULL) {
+		json_pair_t **link = &object->hash[rm_pair->hash & (object->hash_size - 1)];
+
+		while (*link != rm_pair)
+			link = &(*link)->hnext;
+		*link = rm_pair->hnext;
+	}
+
 	json_free(rm_pair->value);
-	free(rm_pair->name);
-	free(rm_pair);
+	if (!(rm_pair->flags & JSON_F_ARENA))
+		free(rm_pair);
 
 	return 1;
 
@@ -926,63 +1063,42 @@ int json_object_remove(json_t *json, char *key)
 json_t *json_object_get(const json_t *json, const char *key)
 {
 	json_pair_t   *pair;
-	json_object_t *object;
 
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return NULL;
-	}
 
 	if (json->type != JSON_OBJECT)
 		return NULL;
 
-	object = json_to_object(json);
-	for (pair = object->next; pair != NULL; pair = pair->next) {
-		if (strcmp(pair->name, key) == 0)
-			return pair->value;
-	}
+	pair = object_find(json_to_object(json), key, hash_key(key));
 
-	return NULL;
+	return pair ? pair->value : NULL;
 }
 
 int json_object_add(json_t *json, const char *key, json_t *value)
 {
 	json_pair_t   *pair;
-	json_object_t *object;
+	int len;
 
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type != JSON_OBJECT || value == NULL)
 		return 0;
 
-	object = json_to_object(json);
-	for (pair = object->next; pair != NULL; pair = pair->next) {
-		if (strcmp(pair->name, key) == 0)
-			return 0;
-	}
-
-	if ((pair = malloc(sizeof(*pair))) == NULL)
-		return 0;
-
-	if ((pair->name = strdup(key)) == NULL) {
-		free(pair);
+	len = strlen(key);
+	if ((pair = malloc(sizeof(*pair) + len + 1)) == NULL)
 		return 0;
-	}
 
+	pair->name = (char *)(pair + 1);
+	memcpy(pair->name, key, len + 1);
+	pair->hash = hash_key(key);
 	pair->value = value;
-	pair->next = NULL;
+	pair->flags = 0;
 
-	if (object->tail == NULL) {
-		object->next = pair;
-		object->tail = pair;
-	} else {
-		object->tail->next = pair;
-		object->tail = pair;
+	if (!object_insert(json_to_object(json), pair)) {
+		free(pair);
+		return 0;
 	}
 
 	return 1;
@@ -1005,10 +1121,7 @@ json_t *json_array(void)
 int json_array_size(json_t *json)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type != JSON_ARRAY)
 		return 0;
@@ -1023,10 +1136,7 @@ json_t *json_array_get(json_t *json, int index)
 	json_array_t *array;
 
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return NULL;
-	}
 
 	if (json->type != JSON_ARRAY)
 		return NULL;
@@ -1045,10 +1155,7 @@ int json_array_add(json_t *json, json_t *value)
 	json_array_t *array;
 
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type != JSON_ARRAY || value == NULL)
 		return 0;
@@ -1068,16 +1175,14 @@ int json_array_add(json_t *json, json_t *value)
 
 json_t *json_string(char *value)
 {
-	json_string_t *string = malloc(sizeof(json_string_t));
+	int len = strlen(value);
+	json_string_t *string = malloc(sizeof(json_string_t) + len + 1);
 	if (string == NULL)
 		return NULL;
 	json_init(&string->json, JSON_STRING);
 
-	string->value = strdup(value);
-	if (!string->value) {
-		free(string);
-		return NULL;
-	}
+	string->value = (char *)(string + 1);
+	memcpy(string->value, value, len + 1);
 
 	return &string->json;
 }
@@ -1085,10 +1190,7 @@ json_t *json_string(char *value)
 char *json_string_value(json_t *json)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return NULL;
-	}
 
 	if (json->type != JSON_STRING)
 		return NULL;
@@ -1110,10 +1212,7 @@ json_t *json_integer(int64 value)
 int64 json_integer_value(json_t *json)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return -1;
-	}
 	
 	if (json->type != JSON_INTEGER)
 		return -1;
@@ -1124,10 +1223,7 @@ int64 json_integer_value(json_t *json)
 int json_integer_set(json_t *json, int64 value)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type != JSON_INTEGER)
 		return 0;
@@ -1151,10 +1247,7 @@ json_t *json_real(double value)
 double json_real_value(json_t *json)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type != JSON_REAL)
 		return 0;
@@ -1175,10 +1268,7 @@ int json_real_set(json_t *json, double value)
 double json_number_value(json_t *json)
 {
 	if (NULL == json)
-	{
-		printf("\n%s:%d:%s return NULL\n", __FILE__, __LINE__, __FUNCTION__);
 		return 0;
-	}
 
 	if (json->type == JSON_INTEGER)
 		return (double)json_to_integer(json)->value;
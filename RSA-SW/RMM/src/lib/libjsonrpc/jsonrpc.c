@@ -316,11 +316,16 @@ json_t * jrpc_parse_string(char * string)
 {
 	json_t * obj = NULL;
 	
+	/* messages are parsed and freed whole, so one arena each */
 	if(jrpc_verify_string(string) ||
-		NULL == (obj = json_parse(string)) || 
-		jrpc_verify_version(obj))
+		NULL == (obj = json_parse_arena(string, 0)))
 		return NULL;
 
+	if (jrpc_verify_version(obj)) {
+		json_free(obj);
+		return NULL;
+	}
+
 	return obj;
 }
 
@@ -748,13 +753,8 @@ int jrpc_parse_rsp(char * string, json_t ** rsp, jrpc_rsp_type_t *type)
 	return JSONRPC_SUCCESS;
 }
 
-int jrpc_parse_rsp_to_struct(char *string, jrpc_rsp_pkg_t *pkg)
+static int rsp_pkg_fill(jrpc_rsp_pkg_t *pkg)
 {
-	if (NULL == string || pkg == NULL ||
-		jrpc_parse_rsp(string, &pkg->json, &pkg->rsp_type) ||
-		jrpc_get_id(pkg->json, &pkg->id_type, &pkg->id))
-		return JSONRPC_FAILED;
-
 	switch (pkg->rsp_type) {
 	case JSONRPC_RSP_RESULT:
 		if (NULL == (pkg->data.result.value_obj = jrpc_get_result_object(pkg->json)))
@@ -772,6 +772,31 @@ int jrpc_parse_rsp_to_struct(char *string, jrpc_rsp_pkg_t *pkg)
 	return JSONRPC_SUCCESS;
 }
 
+int jrpc_parse_rsp_to_struct(char *string, jrpc_rsp_pkg_t *pkg)
+{
+	if (NULL == string || pkg == NULL ||
+		jrpc_parse_rsp(string, &pkg->json, &pkg->rsp_type) ||
+		jrpc_get_id(pkg->json, &pkg->id_type, &pkg->id))
+		return JSONRPC_FAILED;
+
+	return rsp_pkg_fill(pkg);
+}
+
+int jrpc_rsp_to_struct(json_t *rsp, jrpc_rsp_pkg_t *pkg)
+{
+	json_t * result = json_object_get(rsp, "result");
+	json_t * error = json_object_get(rsp, "error");
+
+	pkg->json = rsp;
+	if (jrpc_verify_version(rsp) || (result && error) || (!result && !error) ||
+		jrpc_get_id(rsp, &pkg->id_type, &pkg->id))
+		return JSONRPC_FAILED;
+
+	pkg->rsp_type = result ? JSONRPC_RSP_RESULT : JSONRPC_RSP_ERROR;
+
+	return rsp_pkg_fill(pkg);
+}
+
 void jrpc_rsp_pkg_free(jrpc_rsp_pkg_t *pkg)
 {
 	if (pkg ==NULL)
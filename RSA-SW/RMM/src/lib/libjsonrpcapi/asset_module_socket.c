@@ -26,12 +26,15 @@
 #include "librmmlog/rmmlog.h"
 #include "libjsonrpcapi/utils.h"
 
-static int fd = 0;
+static struct rpc_peer *peer;
 
 int connect_asset_module(int port)
 {
-	fd = udp_connect(INADDR_LOOPBACK, port);
-	if (fd < 0) {
+	if (peer)
+		return rpc_peer_connect(peer, port);
+
+	peer = rpc_peer_open(port, 0);
+	if (peer == NULL) {
 		rmm_log(ERROR, "Connect asset module failed...\n");
 		return -1;
 	}
@@ -41,6 +44,6 @@ int connect_asset_module(int port)
 int send_msg_to_asset_module(jrpc_req_pkg_t *req, jrpc_rsp_pkg_t *rsp, int evt_id)
 {
 	int rc = -1;
-	rc = send_msg_to_fd(req, rsp, evt_id, fd);
+	rc = send_msg_to_peer(req, rsp, evt_id, peer);
 	return rc;
 }
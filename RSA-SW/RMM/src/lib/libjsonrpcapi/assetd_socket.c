@@ -27,12 +27,15 @@
 #include "libjsonrpcapi/utils.h"
 #include "librmmlog/rmmlog.h"
 
-static int fd = 0;
+static struct rpc_peer *peer;
 
 int connect_assetd(int port)
 {
-	fd = udp_connect(INADDR_LOOPBACK, port);
-	if (fd < 0) {
+	if (peer)
+		return rpc_peer_connect(peer, port);
+
+	peer = rpc_peer_open(port, 0);
+	if (peer == NULL) {
 		rmm_log(ERROR, "Connect assetd failed...\n");
 		return -1;
 	}
@@ -43,7 +46,7 @@ int send_msg_to_assetd(jrpc_req_pkg_t *req, int evt_id)
 {
 	int rc = -1;
 	jrpc_rsp_pkg_t rsp = {};
-	rc = send_msg_to_fd(req, &rsp, evt_id, fd);
+	rc = send_msg_to_peer(req, &rsp, evt_id, peer);
 	jrpc_rsp_pkg_free(&rsp);
 	return rc;
 }
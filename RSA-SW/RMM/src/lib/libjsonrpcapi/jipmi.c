@@ -35,89 +35,47 @@
 #include "libjsonrpc/jsonrpc.h"
 #include "libutils/base64.h"
 #include "librmmcfg/rmm_cfg.h"
+#include "libjsonrpcapi/rpc_peer.h"
 
 #define MAX_RPC_LEN     20
 
 struct jipmi_rsp_hndl {
-	struct list_head list;
-
-	unsigned int timeout;
 	int          broadcast;
 
-	int64        jrpc_id;
-
 	jipmi_rsp_callback_fn cb_fn;
 	void                *cb_arg;
 };
 
-static int async_jipmi_fd = -1;
-static int sync_jipmi_fd = -1;
-static unsigned short user_port;
-
-static struct list_head rsp_hndl_head = LIST_HEAD_INIT(rsp_hndl_head);
-static struct list_head req_hndl_head = LIST_HEAD_INIT(req_hndl_head);
-
-static pthread_mutex_t libjipmi_lock = PTHREAD_MUTEX_INITIALIZER;
-
-
-static int64 gen_req_jrpc_id(void)
-{
-	static unsigned int jrpc_id;
-	struct jipmi_rsp_hndl *hndl;
-
-again:
-	if (++jrpc_id == 0)
-		jrpc_id = 1;
-
-	list_for_each_entry(hndl, &rsp_hndl_head, list) {
-		if (hndl->jrpc_id == jrpc_id)
-			goto again;
-	}
-
-	return jrpc_id;
-}
-
-static struct jipmi_rsp_hndl *find_resp_hndl(unsigned int jrpc_id)
-{
-	struct jipmi_rsp_hndl *hndl;
+static struct rpc_peer *jipmi_peer;
 
-	list_for_each_entry(hndl, &rsp_hndl_head, list) {
-		if (hndl->jrpc_id == jrpc_id)
-			return hndl;
-	}
 
-	return NULL;
-}
-
-static int handle_jipmi_msg(char *msg)
+/* reply or timeout of a request, on the rpc runtime thread */
+static void handle_jipmi_msg(json_t *rsp, void *arg)
 {
-	json_t *rsp = NULL;
+	struct jipmi_rsp_hndl *hndl = (struct jipmi_rsp_hndl *)arg;
 	json_t *result = NULL;
-	int ret = 0;
-	int jrpc_id = 0;
-	int netfn, cmd = 0;
+	int ret = -1;
 	int64 err_code = 0;
+	unsigned char fake_rsp[1] = { IPMI_CC_TIMEOUT };
 	unsigned char *rsp_data = NULL;
 	char* origin_data = NULL;
 	int  data_len = 0;
-	struct jipmi_rsp_hndl *hndl = NULL;
-	jipmi_rsp_callback_fn rsp_cb_fn;
-	void                *rsp_cb_arg = NULL;
-	
-	rsp = json_parse(msg);
+
+	if (rsp == NULL)
+		goto timeout;
 
 	result = json_object_get(rsp, STR_RESULT);
 
 	if (result == NULL) {
 		result = json_object_get(rsp, STR_ERROR);
 		if (result == NULL)
-			goto end;
+			goto timeout;
 
 		err_code = json_integer_value(json_object_get(result, STR_CODE));
 
 		rsp_data = malloc(sizeof(int64));
 		if (rsp_data == NULL)
-			goto end;
+			goto timeout;
 
 		memcpy(rsp_data, &err_code, sizeof(int64));
 		ret = -1;
@@ -126,217 +84,66 @@ static int handle_jipmi_msg(char *msg)
 		origin_data = json_string_value(json_object_get(result, STR_DATA));
 		if(origin_data == NULL) {
 			IPMI_DEBUG("jipmi: fail to get data field!\n");
-			goto end;
+			goto timeout;
 		}
-		/*rsp_data = (unsigned char *)base64_decode(origin_data, strlen(origin_data), &data_len);*/
 		rsp_data = malloc(strlen(origin_data));
 		if (rsp_data == NULL) {
 			IPMI_DEBUG("jipmi: fail to alloc buffer\n");
-			goto end;
+			goto timeout;
 		}
-        	data_len = hexstr2buf(origin_data, strlen(origin_data), (char *)rsp_data);
-		/*if (rsp_data == NULL) {
-			IPMI_DEBUG("jipmi: fail to get base64 code!\n");
-			goto end;
-		}*/
+		data_len = hexstr2buf(origin_data, strlen(origin_data), (char *)rsp_data);
 		ret = 0;
 	}
 
-	jrpc_id = json_integer_value(json_object_get(rsp, STR_JRPC_ID));
-	
-	pthread_mutex_lock(&libjipmi_lock);
-	hndl = find_resp_hndl(jrpc_id);
-	if (hndl == NULL) {
-		pthread_mutex_unlock(&libjipmi_lock);
-		IPMI_DEBUG("jipmi: No handle for this IPMI response!\n");
-		jrpc_id = -1;
-		goto end;
-	}
-	rsp_cb_fn  = hndl->cb_fn;
-	rsp_cb_arg = hndl->cb_arg;
-
-	if (!hndl->broadcast) {
-		list_del(&hndl->list);
-	}
-	else
-		hndl = NULL; /* Free until timeout for broadcast */
-
-	pthread_mutex_unlock(&libjipmi_lock);
-
-	rsp_cb_fn(ret, rsp_data, data_len, rsp_cb_arg);
+	hndl->cb_fn(ret, rsp_data, data_len, hndl->cb_arg);
+	free(rsp_data);
+	json_free(rsp);
 
-end:
-	if (hndl != NULL)
+	/* broadcast is answered until its timeout */
+	if (!hndl->broadcast)
 		free(hndl);
+	return;
 
-	if (rsp_data)
-		free(rsp_data);
-
+timeout:
+	/* a reply which can not be used counts as none */
+	if (!hndl->broadcast)
+		hndl->cb_fn(-1, fake_rsp, 1, hndl->cb_arg);
 	if (rsp)
 		json_free(rsp);
-
-	return jrpc_id;
-
+	if (!hndl->broadcast || rsp == NULL)
+		free(hndl);
 }
 
 
-
-static int send_jmsg_to_ipmid(char *msg, int msg_id, unsigned int timeout, sync_mode_t mode, bool bridge_level)
+static int send_jmsg_to_ipmid(char *msg, int64 msg_id, sync_mode_t mode)
 {
-	struct sockaddr_in dest;
-	int port;
-	struct timeval timeo;
-	int rc, rc_id, retries = 2;	/* only allow 2 retries */
-	fd_set fds;
-	int bridge_cnt = 1;
-
-	port = rmm_cfg_get_port(IPMIJSONRPC_SERVER_PORT);
-	if (port == 0) {
-		printf("Failed to call rmm_cfg_get_ipmi_json_rpc_server_port!\n");
-		exit(-1);
-	}
-
-	memset(&dest, 0, sizeof(dest));
-	dest.sin_family = AF_INET;
-	dest.sin_port = htons(port);
-	dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-
-	//printf("\nmsg sent out is:%s.\n", msg);
-
-	if(mode == JIPMI_NON_SYNC) {
-		if (sendto(async_jipmi_fd, msg, IPMI_JSONRPC_MAX_MSG_LEN, 0, (struct sockaddr *)&dest, sizeof(dest)) == -1)
-			return -1;
-
-		return 0;
-	} else {
-		char rsp_string[IPMI_JSONRPC_MAX_MSG_LEN] = {0};
-
-		sendto(sync_jipmi_fd, msg, IPMI_JSONRPC_MAX_MSG_LEN, 0, (struct sockaddr *)&dest, sizeof(dest));
-		
-		for (;;) {
-			if (--retries < 0)
-				break;
-			
-			FD_ZERO(&fds);
-			FD_SET(sync_jipmi_fd, &fds);
-
-			if(timeout > IPMI_MAX_SYNC_TIMEOUT_MS) {
-				timeo.tv_sec = IPMI_MAX_SYNC_TIMEOUT_MS/1000;
-				timeo.tv_usec = (IPMI_MAX_SYNC_TIMEOUT_MS%1000)*1000;
-			}
-			else {
-				timeo.tv_sec = timeout/1000;
-				timeo.tv_usec = (timeout%1000)*1000;
-			}
-
-			rc = select(sync_jipmi_fd + 1, &fds, NULL, NULL, &timeo);
-			if (rc < 0) 
-				break;
-			
-			rc = recv(sync_jipmi_fd, rsp_string, sizeof(rsp_string), 0);
-
-			if (rc <= 0)
-				break;
-
-			rsp_string[rc] = '\0';
-
-			rc_id = handle_jipmi_msg(rsp_string);
-			
-			if (rc_id != msg_id) {
-				printf("received rc_id %d, expect %d.\n", rc_id, msg_id);
-				continue;
-			}
-			else {
-				if (bridge_level && bridge_cnt) {
-					bridge_cnt --;
-					continue;;
-				}
-				return 0;
-			}
-		}
+	if (msg_id < 0)
+		return -1;
 
-		printf("sync mode command process fail!");
+	if (rpc_peer_send(jipmi_peer, msg, strlen(msg) + 1) != 0) {
+		rpc_peer_cancel(jipmi_peer, msg_id);
 		return -1;
 	}
 
-	return 0;
-}
-
-
-static void *libjipmi_time_thread(void *unused)
-{
-	unsigned char fake_rsp[1];
-	struct timespec expire;
-	struct list_head timeout;
-	struct jipmi_rsp_hndl *hndl, *nxt;
-	pthread_cond_t nul_cond = PTHREAD_COND_INITIALIZER;
-
-	fake_rsp[0] = IPMI_CC_TIMEOUT;
-
-	for (;;) {
-		INIT_LIST_HEAD(&timeout);
-		clock_gettime(CLOCK_REALTIME, &expire);
-		expire.tv_sec += (IPMI_PERIOD_TIME_MS/1000);
-		expire.tv_nsec += (IPMI_PERIOD_TIME_MS % 1000) * (1000*1000);
-		if (expire.tv_nsec >= BILLION) {
-		    expire.tv_sec += expire.tv_nsec / BILLION;
-		    expire.tv_nsec %= BILLION;
-		}
-
-		pthread_mutex_lock(&libjipmi_lock);
-		while (pthread_cond_timedwait(&nul_cond, &libjipmi_lock,
-				&expire) != ETIMEDOUT) /* Nothing! */;
-
-		list_for_each_entry_safe(hndl, nxt, &rsp_hndl_head, list) {
-			hndl->timeout -= IPMI_PERIOD_TIME_MS;
-			if (hndl->timeout > 0)
-				continue;
-
-			list_del(&hndl->list);
-			list_add_tail(&hndl->list, &timeout);
-		}
-		pthread_mutex_unlock(&libjipmi_lock);
-
-		list_for_each_entry_safe(hndl, nxt, &timeout, list) {
-			list_del(&hndl->list);
-			if (!hndl->broadcast)
-				hndl->cb_fn(-1, fake_rsp, 1, hndl->cb_arg);
-			free(hndl);
-		}
-    }
+	/* done when the callback returned, bridged requests are answered twice */
+	if (mode == JIPMI_SYNC)
+		rpc_peer_wait(jipmi_peer, msg_id);
 
-	return NULL;
+	return 0;
 }
 
 int libjipmi_init(unsigned short async_listen_port)
 {
-	int fd;
-	int rc, val;
 	int jipmi_port;
-	pthread_t tid;
-
-	/* create async mode fd */
-	fd = create_udp_listen(INADDR_LOOPBACK, async_listen_port, 0, 1);
-	if(fd == -1)
-		return -1;
 
-	if (pthread_create(&tid, NULL, libjipmi_time_thread, NULL) != 0) {
-		printf("Failed to create libjipmi time thread!\n");
-		return -1;
-	}
-	
-	async_jipmi_fd = fd;
-	user_port = htons(async_listen_port);
-
-	/* create sync mode fd */
 	jipmi_port = rmm_cfg_get_port(IPMIJSONRPC_SERVER_PORT);
 	if(jipmi_port == 0) {
 		printf("Get json rpc ipmi port from rmm config fail....\n");
 		return -1;
 	}
-	sync_jipmi_fd= udp_connect(INADDR_LOOPBACK, jipmi_port);
-	if (sync_jipmi_fd < 0)
-	{
+
+	jipmi_peer = rpc_peer_open(jipmi_port, async_listen_port);
+	if (jipmi_peer == NULL) {
 		printf("Connect json rpc ipmi port failed...\n");
 		return -1;
 	}
@@ -346,39 +153,6 @@ int libjipmi_init(unsigned short async_listen_port)
 	return 1;
 }
 
-void libjipmi_callback_selectfds(fd_set *rfds, int *max_fd)
-{
-	if (async_jipmi_fd == -1) {
-		printf("Error: need call libjipmi_init function firstly!\n");
-		return;
-	}
-
-	FD_SET(async_jipmi_fd, rfds);
-	if (async_jipmi_fd > *max_fd)
-		*max_fd = async_jipmi_fd;
-}
-
-void libjipmi_callback_processfds(fd_set *rfds)
-{
-	int rc;
-	int fd = async_jipmi_fd;
-	char msg[IPMI_JSONRPC_MAX_MSG_LEN] = {0};
-
-	if (fd == -1 || !FD_ISSET(fd, rfds))
-		return;
-
-	for (;;) {
-		rc = recv(fd, &msg, sizeof(msg), 0);
-		if (rc <= 0)
-			break;
-
-		msg[rc] = '\0';
-
-		handle_jipmi_msg(msg);
-
-	}
-}
-
 
 static void send_msg_payload_callback_handler(jipmi_br_msg_t* req, unsigned int timeo, void *cb_arg)
 {
@@ -403,20 +177,13 @@ static void send_msg_payload_callback_handler(jipmi_br_msg_t* req, unsigned int
 		return;
 	}
 
-	hndl_br->timeout = timeo;
 	hndl_br->broadcast = 0;
 	hndl_br->cb_fn  = req->br_cb_fn;
 	hndl_br->cb_arg = cb_arg;
 
-
-	pthread_mutex_lock(&libjipmi_lock);
-
-	hndl_br->jrpc_id  = req->br_rpcid;
-	list_add_tail(&hndl_br->list, &rsp_hndl_head);
-
-
-	pthread_mutex_unlock(&libjipmi_lock);
-
+	/* the same id answers the bridged request */
+	if (rpc_peer_expect(jipmi_peer, req->br_rpcid, timeo, 0, handle_jipmi_msg, hndl_br) < 0)
+		free(hndl_br);
 }
 
 
@@ -463,18 +230,14 @@ static int64 join_handle_list(jipmi_rsp_callback_fn cb_fn, void *cb_arg,
 	if (timeo == 0)
 		timeo = IPMI_DFLT_TIMEOUT_MS;
 
-	hndl->timeout = timeo;
 	hndl->broadcast = broadcast;
 	hndl->cb_fn  = cb_fn;
 	hndl->cb_arg = cb_arg;
 
-	pthread_mutex_lock(&libjipmi_lock);
-
-	jrpc_id = gen_req_jrpc_id();
-	hndl->jrpc_id  = jrpc_id;
-	list_add_tail(&hndl->list, &rsp_hndl_head);
-
-	pthread_mutex_unlock(&libjipmi_lock);
+	jrpc_id = rpc_peer_expect(jipmi_peer, 0, timeo, broadcast ? RPC_MULTI_REPLY : 0,
+							  handle_jipmi_msg, hndl);
+	if (jrpc_id < 0)
+		free(hndl);
 
 	return jrpc_id;
 }
@@ -600,7 +363,7 @@ static int jipmi_br_cmd_timeout(unsigned int host, unsigned int port, jipmi_br_m
 
 	if (jreq)
 		json_free(jreq);
-	return send_jmsg_to_ipmid(buffer, jrpc_id, timeo, mode, true);
+	return send_jmsg_to_ipmid(buffer, jrpc_id, mode);
 
 }
 
@@ -639,7 +402,7 @@ static int jipmi_rmcp_cmd_timeout(unsigned int host, unsigned int port, jipmi_ms
 	if (jreq)
 		json_free(jreq);
 
-	return send_jmsg_to_ipmid(buffer, jrpc_id, timeo, mode, false);
+	return send_jmsg_to_ipmid(buffer, jrpc_id, mode);
 }
 
 static int jipmi_serial_cmd_timeout(jipmi_serial_msg_t *req,
@@ -689,7 +452,7 @@ static int jipmi_serial_cmd_timeout(jipmi_serial_msg_t *req,
 	jrpc_format_string(jreq, buffer, sizeof(buffer));
 
 	json_free(jreq);
-	return send_jmsg_to_ipmid(buffer, jrpc_id, timeo, mode, false);
+	return send_jmsg_to_ipmid(buffer, jrpc_id, mode);
 
 }
 
@@ -717,7 +480,7 @@ static int jipmi_ipmb_cmd_timeout(unsigned char sa, jipmi_msg_t *req,
 	jrpc_format_string(jreq, buffer, sizeof(buffer));
 	if (jreq)
 		json_free(jreq);
-	return send_jmsg_to_ipmid(buffer, jrpc_id, timeo, mode, false);
+	return send_jmsg_to_ipmid(buffer, jrpc_id, mode);
 
 }
 
@@ -53,15 +53,13 @@ int libjsonrpcapi_init(unsigned int init_bitmap, unsigned int jipmi_port)
 }
 
 
-void libjsonrpcapi_callback_selectfds(fd_set *readset, int *max_fd)
+void libjsonrpcapi_callback_selectfds(int sub, fd_set *readset, int *max_fd)
 {
-	libjipmi_callback_selectfds(readset, max_fd);
-	libdb_event_selectfds(readset,max_fd);
+	libdb_event_selectfds(sub, readset,max_fd);
 }
 
-void libjsonrpcapi_callback_processfds(fd_set *rfds)
+void libjsonrpcapi_callback_processfds(int sub, fd_set *rfds)
 {
-	libjipmi_callback_processfds(rfds);
-	libdb_event_processfds(rfds);
+	libdb_event_processfds(sub, rfds);
 }
 
@@ -25,9 +25,12 @@
 #include <pthread.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/mman.h>
 
 #include "libmemdb/memdb.h"
 #include "libmemdb/command.h"
+#include "libmemdb/shm.h"
 #include "libutils/sock.h"
 #include "librmmcfg/rmm_cfg.h"
 #include "libutils/rack.h"
@@ -36,14 +39,29 @@
 
 #define DB_ALIGN(s)		(((s) + 7) & ~7)
 
+#define MAX_SUBSCRIBERS		32
+
 static int cmdfd = -1;	/* fd used for send commands */
-static int subfd = -1;	/* fd used for subscribe events */
 
-static unsigned short subport;
+/*
+ * Process wide: a SIGEVT may be handled by any thread, so the subscribers
+ * are not thread local. Each caller passes the handle it got from
+ * libdb_init_subscription.
+ */
+static struct subscriber {
+	int used;
+	int fd;				/* fd used for subscribe events */
+	unsigned short port;
+	enum event_mode mode;
+	void (* event_cb)(struct event_info *, void *);
+	void *cb_data;
+} subscribers[MAX_SUBSCRIBERS];
+static pthread_mutex_t sub_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static int            subpid;
 
-static void (* event_cb)(struct event_info *, void *);
-static void *memdb_cb_data;
+static __thread void (* read_hook)(memdb_integer, void *);
+static __thread void *read_hook_data;
 
 
 static int type_str2int(memdb_integer *type, char *type_str)
@@ -63,7 +81,7 @@ static int type_str2int(memdb_integer *type, char *type_str)
 	return -1;
 }
 
-static int open_subscibe_socket(void)
+static int open_subscibe_socket(struct subscriber *s)
 {
 #define ERR_RET(msg)	do { perror(msg); goto err; } while (0)
 	int fd;
@@ -99,8 +117,8 @@ static int open_subscibe_socket(void)
 	if (rc < 0)
 		ERR_RET("getsockname failed...\n");
 
-	subfd = fd;
-	subport = ntohs(addr.sin_port);
+	s->fd = fd;
+	s->port = ntohs(addr.sin_port);
 
 	return 0;
 
@@ -111,6 +129,7 @@ err:
 
 void libdb_init()
 {
+	int rcvbuf = 1024 * 1024;
 	int port = rmm_cfg_get_port(MEMDBD_PORT);
 	if(port == 0) {
 		printf("Get memdb port from rmm config fail....\n");
@@ -122,13 +141,81 @@ void libdb_init()
 		printf("Connect memdbd failed...\n");
 		exit(-1);
 	}
+
+	/* room for responses of all requests in flight */
+	setsockopt(cmdfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
 }
 
-static void sigevt_handler(int unused)
+static struct event_info *new_attr_event(memdb_integer node_id, memdb_integer cookie,
+										 memdb_integer action, char *name, char *data)
+{
+	struct event_info *evt;
+	int namelen = strlen(name) + 1;
+	int datalen = strlen(data) + 1;
+
+	evt = malloc(sizeof(struct event_info) + namelen + datalen);
+	if (NULL == evt)
+		return NULL;
+
+	evt->event = EVENT_NODE_ATTR;
+	evt->info.attr.nodeid = node_id;
+	evt->info.attr.cookie = cookie;
+	evt->info.attr.action = action;
+	evt->info.attr.namelen = namelen;
+	evt->info.attr.datalen = datalen;
+	memcpy(&evt->info.attr.elems[0], name, namelen);
+	memcpy(&evt->info.attr.elems[namelen], data, datalen);
+
+	return evt;
+}
+
+/* Attribute changes of one node in one notification, passed on one by one. */
+static void attrs_event_cb(struct subscriber *s, json_t *json)
+{
+	jrpc_data_integer node_id = 0;
+	json_t *attrs = NULL;
+	json_t *attr;
+	struct event_info *evt;
+	char *name, *data;
+	int i, num;
+
+	if (jrpc_get_named_param_value(json, "node_id", JSON_INTEGER, &node_id) ||
+		jrpc_get_named_param_value(json, "attrs", JSON_ARRAY, &attrs))
+		return;
+
+	num = json_array_size(attrs);
+	for (i = 0; i < num; i++) {
+		attr = json_array_get(attrs, i);
+		if (attr == NULL)
+			continue;
+		name = json_string_value(json_object_get(attr, "name"));
+		data = json_string_value(json_object_get(attr, "data"));
+		if (name == NULL || data == NULL)
+			continue;
+
+		evt = new_attr_event((memdb_integer)node_id,
+							 json_integer_value(json_object_get(attr, "cookie")),
+							 json_integer_value(json_object_get(attr, "action")),
+							 name, data);
+		if (evt == NULL)
+			continue;
+		s->event_cb(evt, s->cb_data);
+		free(evt);
+	}
+}
+
+static struct subscriber *get_subscriber(int sub)
+{
+	if (sub < 0 || sub >= MAX_SUBSCRIBERS || !subscribers[sub].used)
+		return NULL;
+
+	return &subscribers[sub];
+}
+
+static void process_events(struct subscriber *s)
 {
 	int rc;
 	int i;
-	sigset_t sigset;
 	char evt_string[JSONRPC_MAX_STRING_LEN] = {0};
 	char * method = NULL;
 	struct event_info * evt = NULL;
@@ -136,23 +223,28 @@ static void sigevt_handler(int unused)
 	jrpc_req_type_t type;
 	memdb_integer event;
 
-	sigemptyset(&sigset);
-	sigaddset(&sigset, SIGEVT);
-
-	sigprocmask(SIG_BLOCK, &sigset, NULL);
 	for (;;) {
-		rc = socket_recv(subfd, &evt_string, sizeof(evt_string));
+		/* one event per datagram, socket_recv() would join queued ones */
+		rc = recv(s->fd, evt_string, sizeof(evt_string) - 1, 0);
 		if (rc <= 0)
 			break;
+		evt_string[rc] = '\0';
 
+		json = NULL;
+		evt = NULL;
 		if(jrpc_parse_req(evt_string, &json, &type) ||
 			type != JSONRPC_REQ_NOTFICATION ||
 			jrpc_get_method(json, &method))
-			return;
+			goto next;
+
+		if (strcmp(method, EVENT_NODE_ATTRS_STR) == 0) {
+			attrs_event_cb(s, json);
+			goto next;
+		}
 
 		for (i=0; i<=EVENT_END; i++) {
 			if (i==EVENT_END)
-				return;
+				goto next;
 			if (strcmp(method, event_string[i]) == 0) {
 				event = i;
 				break;
@@ -165,7 +257,7 @@ static void sigevt_handler(int unused)
 			{
 				evt = malloc(sizeof(struct event_info));
 				if (NULL == evt)
-					return;
+					goto next;
 				evt->event = event;
 				
 				jrpc_data_integer node_id = 0;
@@ -176,7 +268,8 @@ static void sigevt_handler(int unused)
 					jrpc_get_named_param_value(json, "type", JSON_STRING, &type) ||
 					type_str2int(&evt->ntype, type)) {
 					free(evt);
-					return;
+					evt = NULL;
+					goto next;
 				}
 
 				evt->nnodeid = (memdb_integer)node_id;
@@ -196,89 +289,135 @@ static void sigevt_handler(int unused)
 					jrpc_get_named_param_value(json, "action", JSON_INTEGER, &action) ||
 					jrpc_get_named_param_value(json, "name", JSON_STRING, &name) ||
 					jrpc_get_named_param_value(json, "data", JSON_STRING, &data))
-					return;
-				evt = malloc(sizeof(struct event_info)+strlen(name)+1+strlen(data)+1);
+					goto next;
+				evt = new_attr_event(node_id, cookie, action, name, data);
 				if (NULL == evt)
-					return;
-				evt->event = event;
-
-				evt->info.attr.nodeid = (memdb_integer)node_id;
-				evt->info.attr.cookie= (memdb_integer)cookie;
-				evt->info.attr.action = (memdb_integer)action;
-				evt->info.attr.namelen = (memdb_integer)(strlen(name)+1);
-				evt->info.attr.datalen = (memdb_integer)(strlen(data)+1);
-				memcpy(&evt->info.attr.elems[0], name, strlen(name)+1);
-				memcpy(&evt->info.attr.elems[strlen(name)+1], data, strlen(data)+1);
+					goto next;
 			}
 			break;
 			
 		default:
-			return;
+			goto next;
 		}
 		
-		event_cb(evt, memdb_cb_data);
+		s->event_cb(evt, s->cb_data);
 		free(evt);
+next:
+		if (json != NULL)
+			json_free(json);
+	}
+}
+
+static void sigevt_handler(int unused)
+{
+	int i;
+	sigset_t sigset;
+
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGEVT);
+
+	sigprocmask(SIG_BLOCK, &sigset, NULL);
+	for (i = 0; i < MAX_SUBSCRIBERS; i++) {
+		if (subscribers[i].used && subscribers[i].mode == NOTIFY_BY_SIGNAL)
+			process_events(&subscribers[i]);
 	}
 	sigprocmask(SIG_UNBLOCK, &sigset, NULL);
 }
 
-void libdb_event_selectfds(fd_set *readset, int *max_fd)
+void libdb_event_selectfds(int sub, fd_set *readset, int *max_fd)
 {
-	if (subfd == -1)
+	struct subscriber *s = get_subscriber(sub);
+
+	if (s == NULL)
 		return;
 
-	FD_SET(subfd, readset);
-	if (subfd > *max_fd)
-		*max_fd = subfd;
+	FD_SET(s->fd, readset);
+	if (s->fd > *max_fd)
+		*max_fd = s->fd;
 }
 
-void libdb_event_processfds(fd_set *readset)
+void libdb_event_processfds(int sub, fd_set *readset)
 {
-	if (subfd != -1 && FD_ISSET(subfd, readset))
-		sigevt_handler(0);
+	struct subscriber *s = get_subscriber(sub);
+
+	if (s != NULL && FD_ISSET(s->fd, readset))
+		process_events(s);
 }
 
 int libdb_init_subscription(enum event_mode mode, void (*callback)(struct event_info *, void*), void* cb_data)
 {
+	struct subscriber *s = NULL;
+	int sub;
+
 	if (callback == NULL) {
 		printf("callback for process event is empty!\n");
 		return -1;
 	}
 
-	if (open_subscibe_socket() != 0)
+	pthread_mutex_lock(&sub_mutex);
+	for (sub = 0; sub < MAX_SUBSCRIBERS; sub++) {
+		if (!subscribers[sub].used) {
+			s = &subscribers[sub];
+			break;
+		}
+	}
+	if (s == NULL) {
+		pthread_mutex_unlock(&sub_mutex);
+		printf("too many subscribers!\n");
 		return -1;
+	}
+
+	if (open_subscibe_socket(s) != 0) {
+		pthread_mutex_unlock(&sub_mutex);
+		return -1;
+	}
+	s->mode = mode;
+	s->event_cb = callback;
+	s->cb_data = cb_data;
+	/* the signal handler may look at it as soon as it is used */
+	__sync_synchronize();
+	s->used = 1;
+	pthread_mutex_unlock(&sub_mutex);
 
 	if (mode == NOTIFY_BY_SIGNAL) {
 		if (signal(SIGEVT, sigevt_handler) == SIG_ERR) {
 			printf("signal failed!\n");
-			goto err;
+			libdb_exit_subscription(sub);
+			return -1;
 		}
 
 		subpid  = getpid();
 	}
 
-	event_cb = callback;
-	memdb_cb_data = cb_data;
-
-	return 0;
+	return sub;
+}
 
-err:
-	close(subfd);
-	subfd = -1;
-	return -1;
+void libdb_exit_subscription(int sub)
+{
+	struct subscriber *s;
+
+	pthread_mutex_lock(&sub_mutex);
+	s = get_subscriber(sub);
+	if (s != NULL) {
+		s->used = 0;
+		__sync_synchronize();
+		close(s->fd);
+		s->fd = -1;
+	}
+	pthread_mutex_unlock(&sub_mutex);
 }
 
 void libdb_exit_memdb(void)
 {
+	int sub;
+
 	if (cmdfd >= 0) {
 		close(cmdfd);
 		cmdfd = -1;
 	}
 
-	if (subfd >= 0) {
-		close(subfd);
-		subfd = -1;
-	}
+	for (sub = 0; sub < MAX_SUBSCRIBERS; sub++)
+		libdb_exit_subscription(sub);
 }
 
 static int libdb_fill_param(struct request_pkg * req, char * name, void * value, json_type type)
@@ -340,109 +479,223 @@ int libdb_parse_rsp(char *string, struct response_pkg *rsp)
 	return 0;
 }
 
-static memdb_integer libdb_process_cmd(struct request_pkg *req, struct response_pkg *rsp)
+/*
+ * Requests are multiplexed over the one command socket: every request is
+ * tagged with its own id and waits in 'pending' until a response with that
+ * id arrives. There is no receiving thread, one of the waiters reads the
+ * socket at a time and hands out responses to the others.
+ */
+#define LIBDB_MAX_INFLIGHT	64
+#define LIBDB_RSP_TIMEOUT	10	/* seconds, longer than memdbd MAX_LOCK_TIME */
+#define LIBDB_POLL_USEC		(50 * 1000)
+
+struct pending_req {
+	int64 id;					/* 0 if the slot is free */
+	int done;
+	struct response_pkg *rsp;
+};
+
+static struct pending_req pending[LIBDB_MAX_INFLIGHT];
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+static int receiving;
+static int64 seqnum;
+
+static struct pending_req *get_pending_slot(void)
 {
-	static unsigned int seqnum = 0;
-	static pthread_mutex_t socket_mutex = PTHREAD_MUTEX_INITIALIZER;
+	int i;
 
-	int rc = 0;
-	int retry = 0;
-	fd_set fds;
+	for (;;) {
+		for (i = 0; i < LIBDB_MAX_INFLIGHT; i++) {
+			if (pending[i].id == 0) {
+				pending[i].id = ++seqnum;
+				pending[i].done = 0;
+				return &pending[i];
+			}
+		}
+		pthread_cond_wait(&pending_cond, &pending_mutex);
+	}
+}
+
+static void put_pending_slot(struct pending_req *slot)
+{
+	slot->id = 0;
+	slot->rsp = NULL;
+	pthread_cond_broadcast(&pending_cond);
+}
+
+/*
+ * Best effort id of a response libdb_parse_rsp rejected, so that its owner
+ * gets the error at once instead of waiting for LIBDB_RSP_TIMEOUT.
+ */
+static int64 get_bad_rsp_id(const char *string, struct response_pkg *rsp)
+{
+	const char *p = NULL;
+
+	if (rsp->jrpc_pkg.id_type == JSONRPC_ID_TYPE_NORMAL && rsp->jrpc_pkg.id != 0)
+		return rsp->jrpc_pkg.id;
+
+	p = strstr(string, "\"id\"");
+	if (p == NULL)
+		return 0;
+	p += strlen("\"id\"");
+	while (*p == ' ' || *p == '\t' || *p == ':')
+		p++;
+
+	return strtoll(p, NULL, 10);
+}
+
+/* Called with pending_mutex released, by the only receiving thread. */
+static void receive_response(void)
+{
+	/* only used by the receiving thread, see 'receiving' */
+	static char rsp_string[JSONRPC_MAX_STRING_LEN];
+	struct response_pkg tmp = {};
 	struct timeval timeo;
+	fd_set fds;
+	ssize_t len;
+	int64 id = 0;
+	int i;
+
+	FD_ZERO(&fds);
+	FD_SET(cmdfd, &fds);
+	timeo.tv_sec = 0;
+	timeo.tv_usec = LIBDB_POLL_USEC;
+
+	if (select(cmdfd + 1, &fds, NULL, NULL, &timeo) <= 0 || !FD_ISSET(cmdfd, &fds))
+		return;
+
+	/* one datagram is one response, socket_recv would merge several */
+	len = recv(cmdfd, rsp_string, sizeof(rsp_string) - 1, 0);
+	if (len <= 0)
+		return;
+	rsp_string[len] = '\0';
+
+	if (libdb_parse_rsp(rsp_string, &tmp) != 0) {
+		/* fail the owner with LIBDB_PARSE_ERROR, the json is not usable */
+		id = get_bad_rsp_id(rsp_string, &tmp);
+		rmm_log(ERROR, "fail at libdb_parse_rsp, response id %ld.\n", id);
+		jrpc_rsp_pkg_free(&tmp.jrpc_pkg);
+		tmp.jrpc_pkg.rsp_type = JSONRPC_RSP_INVALID;
+		tmp.rcode = LIBDB_PARSE_ERROR;
+	} else if (tmp.jrpc_pkg.id_type == JSONRPC_ID_TYPE_NORMAL)
+		id = tmp.jrpc_pkg.id;
+
+	pthread_mutex_lock(&pending_mutex);
+	for (i = 0; i < LIBDB_MAX_INFLIGHT; i++) {
+		if (pending[i].id != 0 && !pending[i].done && pending[i].id == id) {
+			*pending[i].rsp = tmp;
+			pending[i].done = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pending_mutex);
+
+	if (i == LIBDB_MAX_INFLIGHT) {
+		/* response to a request which has already timed out */
+		rmm_log(WARNING, "unexpected memdb response id %ld.\n", id);
+		jrpc_rsp_pkg_free(&tmp.jrpc_pkg);
+	}
+}
+
+void libdb_set_read_hook(void (*hook)(memdb_integer node_id, void *data), void *data)
+{
+	read_hook = hook;
+	read_hook_data = data;
+}
+
+static void note_read(memdb_integer node_id)
+{
+	if (read_hook != NULL)
+		read_hook(node_id, read_hook_data);
+}
+
+static memdb_integer libdb_process_cmd(struct request_pkg *req, struct response_pkg *rsp)
+{
+	int rc = 0;
 	char *req_str = NULL;
-	char rsp_string[JSONRPC_MAX_STRING_LEN] = {0};
+	struct pending_req *slot = NULL;
+	struct timespec now;
+	time_t deadline;
 
 	assert(cmdfd > 0);
 
-	pthread_mutex_lock(&socket_mutex);
-	req->jrpc_pkg.id = ++seqnum;
+	note_read(req->node_id);
+
+	pthread_mutex_lock(&pending_mutex);
+	slot = get_pending_slot();
+	slot->rsp = rsp;
+	req->jrpc_pkg.id = slot->id;
+	pthread_mutex_unlock(&pending_mutex);
 
 	if (libdb_fill_general_params(req)) {
 		rmm_log(ERROR, "fail at libdb_fill_general_params.\n");
-		goto failed;
+		goto release;
 	}
 
 	req_str = jrpc_create_req_string(req->jrpc_pkg.id, memdb_cmd_t[req->cmd].cmd_name,
 			req->jrpc_pkg.num_of_params, req->jrpc_pkg.params);
 	if (NULL == req_str) {
 		rmm_log(ERROR, "fail at jrpc_create_req_string.\n");
-		goto failed;
-
+		goto release;
 	}
 
+	/* a datagram is sent atomically, no need to serialize senders */
 	rc = socket_send(cmdfd, req_str, strlen(req_str) + 1);
+	jrpc_free_string(req_str);
 	if (rc < 0) {
 		rmm_log(ERROR, "fail at socket_send.\n");
-		goto failed;
+		rsp->rcode = LIBDB_SEND_ERROR;
+		goto release;
 	}
 
 	req->jrpc_pkg.json = NULL;
 
-	for(;;) {
-		if (retry >= 2) {
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	deadline = now.tv_sec + LIBDB_RSP_TIMEOUT;
+
+	pthread_mutex_lock(&pending_mutex);
+	while (!slot->done) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec >= deadline) {
+			rmm_log(ERROR, "memdb request %ld timeout.\n", req->jrpc_pkg.id);
 			rsp->rcode = LIBDB_RETRY_FAIL;
-			goto failed;
+			put_pending_slot(slot);
+			pthread_mutex_unlock(&pending_mutex);
+			return rsp->rcode;
 		}
 
-		FD_ZERO(&fds);
-		FD_SET(cmdfd, &fds);
-		timeo.tv_sec = 0;
-		timeo.tv_usec = 50 * 1000;
-
-		rc = select(cmdfd + 1, &fds, NULL, NULL, &timeo);
-		if (rc > 0 && FD_ISSET(cmdfd, &fds)) {
-			rc = socket_recv(cmdfd, rsp_string, sizeof(rsp_string));
-			if (rc < 0) {
-				rmm_log(ERROR, "fail at socket_recv.\n");
-				rsp->rcode = LIBDB_RECV_ERROR;
-				goto failed;
-			}
-
-			if(libdb_parse_rsp(rsp_string, rsp) != 0) {
-				rmm_log(ERROR, "fail at libdb_parse_rsp.\n");
-				goto failed;
-			}
-
-			if (rsp->jrpc_pkg.id_type == JSONRPC_ID_TYPE_NORMAL &&
-					rsp->jrpc_pkg.id == req->jrpc_pkg.id) {
-				if (rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_ERROR) {
-					//rmm_log(DBG, "rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_ERROR.\n");
-					jrpc_rsp_pkg_free(&(rsp->jrpc_pkg));
-					goto failed;
-				} else if (rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_INVALID) {
-					rmm_log(ERROR, "rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_INVALID.\n");
-					jrpc_rsp_pkg_free(&(rsp->jrpc_pkg));
-					goto failed;
-				} else {
-					if (req_str != NULL) {
-						jrpc_free_string(req_str);
-						req_str = NULL;
-					}
-					pthread_mutex_unlock(&socket_mutex);
-					/* process memdb command successfully. */
-					return 0;
-				}
-			} else if (rsp->jrpc_pkg.id < req->jrpc_pkg.id) {
-				rmm_log(WARNING, "rsp->jrpc_pkg.id < req->jrpc_pkg.id.\n");
-				jrpc_rsp_pkg_free(&(rsp->jrpc_pkg));
-				retry++;
-				continue;
-			} else {
-				rmm_log(ERROR, "rsponse data: rsp->jrpc_pkg.id_type=%d, rsp->jrpc_pkg.id=%ld, req->jrpc_pkg.id=%ld\n",
-						rsp->jrpc_pkg.id_type, rsp->jrpc_pkg.id, req->jrpc_pkg.id);
-				jrpc_rsp_pkg_free(&(rsp->jrpc_pkg));
-				goto failed;
-			}
+		if (!receiving) {
+			receiving = 1;
+			pthread_mutex_unlock(&pending_mutex);
+			receive_response();
+			pthread_mutex_lock(&pending_mutex);
+			receiving = 0;
+			/* wake up owners of delivered responses and the next receiver */
+			pthread_cond_broadcast(&pending_cond);
+		} else {
+			pthread_cond_wait(&pending_cond, &pending_mutex);
 		}
 	}
-
-failed:
-	if (req_str != NULL) {
-		jrpc_free_string(req_str);
-		req_str = NULL;
+	put_pending_slot(slot);
+	pthread_mutex_unlock(&pending_mutex);
+
+	if (rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_ERROR) {
+		jrpc_rsp_pkg_free(&(rsp->jrpc_pkg));
+		return rsp->rcode;
+	} else if (rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_INVALID) {
+		rmm_log(ERROR, "rsp->jrpc_pkg.rsp_type == JSONRPC_RSP_INVALID.\n");
+		jrpc_rsp_pkg_free(&(rsp->jrpc_pkg));
+		return rsp->rcode;
 	}
 
-	pthread_mutex_unlock(&socket_mutex);
+	/* process memdb command successfully. */
+	return 0;
+
+release:
+	pthread_mutex_lock(&pending_mutex);
+	put_pending_slot(slot);
+	pthread_mutex_unlock(&pending_mutex);
 	return rsp->rcode;
 }
 
@@ -836,14 +1089,129 @@ static memdb_integer set_attr_data(unsigned char db_name, memdb_integer node,
 }
 
 
+/*
+ * Attributes published by memdbd in shared memory, see libmemdb/shm.h.
+ * A segment replaced by a restarted memdbd is never unmapped, other
+ * threads may still be reading it.
+ */
+#define SHM_MAX_SPIN		1000
+
+static struct memdb_shm_hdr *shm;
+static pthread_mutex_t shm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static time_t shm_retry_time;
+static int shm_read_enabled = 1;
+
+void libdb_set_shm_read(int enable)
+{
+	shm_read_enabled = enable;
+}
+
+static struct memdb_shm_hdr *shm_map(void)
+{
+	struct memdb_shm_hdr *hdr = shm;
+	struct memdb_shm_hdr *new_hdr;
+	time_t now;
+	int fd;
+
+	if (hdr && hdr->valid)
+		return hdr;
+
+	pthread_mutex_lock(&shm_mutex);
+	now = time(NULL);
+	/* do not try to open the segment on every read while memdbd is down */
+	if (shm == hdr && now != shm_retry_time) {
+		shm_retry_time = now;
+
+		fd = shm_open(MEMDB_SHM_NAME, O_RDONLY, 0);
+		if (fd >= 0) {
+			new_hdr = mmap(NULL, MEMDB_SHM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (new_hdr != MAP_FAILED) {
+				if (new_hdr->magic == MEMDB_SHM_MAGIC &&
+					new_hdr->version == MEMDB_SHM_VERSION &&
+					new_hdr->slot_num == MEMDB_SHM_SLOT_NUM && new_hdr->valid) {
+					__sync_synchronize();
+					shm = new_hdr;
+				} else
+					munmap(new_hdr, MEMDB_SHM_SIZE);
+			}
+		}
+	}
+	hdr = shm;
+	pthread_mutex_unlock(&shm_mutex);
+
+	return (hdr && hdr->valid) ? hdr : NULL;
+}
+
+/*
+ * Copy attribute from shared memory to 'out'. Return -1 if the attribute
+ * has to be read from memdbd.
+ */
+static int shm_attr_get(unsigned char db_name, memdb_integer node, char *name,
+						struct memdb_shm_slot *out)
+{
+	struct memdb_shm_hdr *hdr;
+	struct memdb_shm_slot *slot;
+	uint32 idx, seq;
+	int i, spin;
+
+	if (!shm_read_enabled || strlen(name) >= MEMDB_SHM_NAME_LEN)
+		return -1;
+
+	hdr = shm_map();
+	if (hdr == NULL || hdr->locked)
+		return -1;
+
+	idx = memdb_shm_hash(db_name, node, name);
+	for (i = 0; i < MEMDB_SHM_MAX_PROBE; i++, idx++) {
+		slot = &hdr->slots[idx & (MEMDB_SHM_SLOT_NUM - 1)];
+
+		for (spin = 0; ; spin++) {
+			if (spin == SHM_MAX_SPIN)
+				return -1;
+			seq = slot->seq;
+			if (seq & 1)
+				continue;
+			__sync_synchronize();
+			memcpy(out, slot, sizeof(*out));
+			__sync_synchronize();
+			if (slot->seq == seq)
+				break;
+		}
+
+		if (out->state == MEMDB_SHM_SLOT_EMPTY)
+			return -1;
+
+		if (out->state == MEMDB_SHM_SLOT_USED && out->node_id == node &&
+			out->db_name == db_name && strcmp(out->name, name) == 0) {
+			/* the value may be a part of a locked transaction */
+			__sync_synchronize();
+			return hdr->locked ? -1 : 0;
+		}
+	}
+
+	return -1;
+}
+
 static memdb_integer get_attr_data(unsigned char db_name, memdb_integer node,
 									char *name, struct response_pkg *rsp, lock_id_t lock_id, char *output, int len)
 {
 	struct request_pkg req = {};
+	struct memdb_shm_slot slot;
 	memdb_integer rc = 0;
 	char *data = NULL;
 	int data_len;
 
+	note_read(node);
+	if (lock_id == LOCK_ID_NULL && shm_attr_get(db_name, node, name, &slot) == 0) {
+		if (slot.data[0] == '\0')
+			return 0;
+		if (slot.datalen > len)
+			return MEMDB_OEM_STRING_LEN_EXCEED;
+		strncpy_safe(output, slot.data, len, len - 1);
+		return 0;
+	}
+
 	req.db_name = db_name;
 	req.cmd = CMD_ATTRBUTE_GET;
 	req.node_id = node;
@@ -1203,7 +1571,215 @@ end:
 
 }
 
-memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name,
+static void *attrs_from_json(json_t *attr_array, int *size)
+{
+	int i = 0;
+	int total = 0;
+	int attr_array_size = 0;
+	char *name = NULL;
+	char *data = NULL;
+	json_t *element = NULL;
+	struct attr_info *info = NULL;
+	void *attrs = NULL;
+
+	attr_array_size = json_array_size(attr_array);
+
+	for (i = 0; i < attr_array_size; i++) {
+		element = json_array_get(attr_array, i);
+		if (NULL == element ||
+			NULL == (name = json_string_value(json_object_get(element, "name"))) ||
+			NULL == (data = json_string_value(json_object_get(element, "data"))))
+			return NULL;
+		total += DB_ALIGN(sizeof(*info) + strlen(name) + 1 + strlen(data) + 1);
+	}
+
+	/* keep a valid buffer for empty results, NULL means failure */
+	attrs = malloc(total ? total : sizeof(*info));
+	if (attrs == NULL)
+		return NULL;
+
+	info = (struct attr_info *)attrs;
+	for (i = 0; i < attr_array_size; i++) {
+		element = json_array_get(attr_array, i);
+		name = json_string_value(json_object_get(element, "name"));
+		data = json_string_value(json_object_get(element, "data"));
+
+		info->node = json_integer_value(json_object_get(element, "node"));
+		info->cookie = json_integer_value(json_object_get(element, "cookie"));
+		info->snapshot_flag = 0;
+		info->data_offset = strlen(name) + 1;
+		info->data_len = strlen(data) + 1;
+		info->next_offset = DB_ALIGN(sizeof(*info) + info->data_offset + info->data_len);
+		memcpy(&info->elems[0], name, info->data_offset);
+		memcpy(&info->elems[info->data_offset], data, info->data_len);
+
+		info = (void *)info + info->next_offset;
+	}
+
+	*size = total;
+	return attrs;
+}
+
+static void *attrs_get(struct request_pkg *req, int *size, int *truncated)
+{
+	struct response_pkg rsp = {};
+	void *ret = NULL;
+	json_t *attr_array = NULL;
+	jrpc_data_integer r_truncated = 0;
+
+	*size = 0;
+	if (truncated)
+		*truncated = 0;
+
+	req->cmd = CMD_ATTRS_GET;
+
+	if (libdb_process_cmd(req, &rsp) != 0)
+		goto end;
+
+	if (JSONRPC_SUCCESS != jrpc_get_named_result_value(rsp.jrpc_pkg.json, "r_attrs", JSON_ARRAY, &attr_array))
+		goto end;
+
+	jrpc_get_named_result_value(rsp.jrpc_pkg.json, "r_truncated", JSON_INTEGER, &r_truncated);
+	if (truncated)
+		*truncated = (int)r_truncated;
+
+	ret = attrs_from_json(attr_array, size);
+
+end:
+	jrpc_rsp_pkg_free(&(rsp.jrpc_pkg));
+	return ret;
+}
+
+void *libdb_attrs_get_by_node(unsigned char db_name, memdb_integer node,
+							  int subtree, int *size, int *truncated,
+							  lock_id_t lock_id)
+{
+	struct request_pkg req = {};
+	jrpc_data_integer p_subtree = subtree ? 1 : 0;
+
+	req.db_name = db_name;
+	req.node_id = node;
+	req.lock_id = lock_id;
+
+	if (subtree)
+		note_read(LIBDB_ANY_NODE);
+
+	if (libdb_fill_param(&req, "p_subtree", &p_subtree, JSON_INTEGER)) {
+		*size = 0;
+		return NULL;
+	}
+
+	return attrs_get(&req, size, truncated);
+}
+
+void *libdb_attrs_get(unsigned char db_name, memdb_integer *nodes, int node_num,
+					  char **names, int name_num, int *size, int *truncated,
+					  lock_id_t lock_id)
+{
+	int i = 0;
+	struct request_pkg req = {};
+	json_t *p_nodes = NULL;
+	json_t *p_names = NULL;
+
+	*size = 0;
+	req.db_name = db_name;
+	req.node_id = 0;
+	req.lock_id = lock_id;
+
+	p_nodes = json_array();
+	if (NULL == p_nodes)
+		return NULL;
+	for (i = 0; i < node_num; i++) {
+		note_read(nodes[i]);
+		if (JSON_SUCCESS != json_array_add(p_nodes, json_integer(nodes[i])))
+			goto err;
+	}
+
+	if (names != NULL) {
+		p_names = json_array();
+		if (NULL == p_names)
+			goto err;
+		for (i = 0; i < name_num; i++) {
+			if (JSON_SUCCESS != json_array_add(p_names, json_string(names[i])))
+				goto err;
+		}
+	}
+
+	/* the request owns the arrays once they are filled in */
+	if (libdb_fill_param(&req, "p_nodes", p_nodes, JSON_ARRAY))
+		goto err;
+	p_nodes = NULL;
+	if (p_names != NULL) {
+		if (libdb_fill_param(&req, "p_names", p_names, JSON_ARRAY))
+			goto err;
+		p_names = NULL;
+	}
+
+	return attrs_get(&req, size, truncated);
+
+err:
+	if (p_nodes)
+		json_free(p_nodes);
+	if (p_names)
+		json_free(p_names);
+	return NULL;
+}
+
+void libdb_free_attrs(void *attrs)
+{
+	free(attrs);
+}
+
+memdb_integer libdb_attrs_set(unsigned char db_name, struct attr_set_info *attrs,
+							  int num, lock_id_t lock_id)
+{
+	int i = 0;
+	struct request_pkg req = {};
+	struct response_pkg rsp = {};
+	json_t *p_attrs = NULL;
+	json_t *element = NULL;
+	memdb_integer rc = 0;
+
+	if (num <= 0)
+		return 0;
+
+	req.db_name = db_name;
+	req.cmd = CMD_ATTRS_SET;
+	req.node_id = attrs[0].node;
+	req.lock_id = lock_id;
+
+	p_attrs = json_array();
+	if (NULL == p_attrs)
+		return -1;
+
+	for (i = 0; i < num; i++) {
+		element = json_object();
+		if (NULL == element ||
+			JSON_SUCCESS != json_object_add(element, "node", json_integer(attrs[i].node)) ||
+			JSON_SUCCESS != json_object_add(element, "cookie", json_integer(attrs[i].cookie)) ||
+			JSON_SUCCESS != json_object_add(element, "snapshot_flag", json_integer(attrs[i].snapshot_flag)) ||
+			JSON_SUCCESS != json_object_add(element, "name", json_string(attrs[i].name)) ||
+			JSON_SUCCESS != json_object_add(element, "data", json_string(attrs[i].data)) ||
+			JSON_SUCCESS != json_array_add(p_attrs, element)) {
+			if (element)
+				json_free(element);
+			json_free(p_attrs);
+			return -1;
+		}
+	}
+
+	if (libdb_fill_param(&req, "p_attrs", p_attrs, JSON_ARRAY)) {
+		json_free(p_attrs);
+		return -1;
+	}
+
+	rc = libdb_process_cmd(&req, &rsp);
+	jrpc_rsp_pkg_free(&(rsp.jrpc_pkg));
+
+	return rc == 0 ? 0 : -1;
+}
+
+memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name, int sub,
 										  unsigned int node_type_min,
 										  unsigned int node_type_max,
 										  lock_id_t lock_id)
@@ -1212,14 +1788,18 @@ memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name,
 	struct subscibe_node_param data = {};
 	struct response_pkg rsp = {};
 	struct request_pkg req = {};
+	struct subscriber *s = get_subscriber(sub);
 	memdb_integer rc = 0;
 
+	if (s == NULL)
+		return -1;
+
 	req.db_name = db_name;
 	req.cmd = CMD_ADD_SUBSCRIPTION;
 	req.node_id = 0;
 
 	param.event   = EVENT_NODE_CREATE;
-	param.cb_port = subport;
+	param.cb_port = s->port;
 	param.cb_pid  = subpid;
 
 	data.type_min = node_type_min;
@@ -1249,18 +1829,18 @@ memdb_integer libdb_subscribe_type_of_node_create(unsigned char db_name,
 	return rc;
 }
 
-memdb_integer libdb_subscribe_node_create(unsigned char db_name, lock_id_t lock_id)
+memdb_integer libdb_subscribe_node_create(unsigned char db_name, int sub, lock_id_t lock_id)
 {
-	return libdb_subscribe_type_of_node_create(db_name, 0, 0xFFFFFFFF, lock_id);
+	return libdb_subscribe_type_of_node_create(db_name, sub, 0, 0xFFFFFFFF, lock_id);
 }
 
-memdb_integer libdb_subscribe_node_create_by_type(unsigned char db_name,
+memdb_integer libdb_subscribe_node_create_by_type(unsigned char db_name, int sub,
 										  unsigned int node_type, lock_id_t lock_id)
 {
-	return libdb_subscribe_type_of_node_create(db_name, node_type, node_type, lock_id);
+	return libdb_subscribe_type_of_node_create(db_name, sub, node_type, node_type, lock_id);
 }
 
-memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name,
+memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name, int sub,
 										  unsigned int node_type_min,
 										  unsigned int node_type_max,
 										  lock_id_t lock_id)
@@ -1269,15 +1849,19 @@ memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name,
 	struct subscibe_node_param data;
 	struct response_pkg rsp = {};
 	struct request_pkg req = {};
+	struct subscriber *s = get_subscriber(sub);
 	memdb_integer rc = 0;
 
+	if (s == NULL)
+		return -1;
+
 	req.db_name = db_name;
 	req.cmd = CMD_ADD_SUBSCRIPTION;
 	req.node_id = 0;
 	req.lock_id = lock_id;
 
 	param.event   = EVENT_NODE_DELETE;
-	param.cb_port = subport;
+	param.cb_port = s->port;
 	param.cb_pid  = subpid;
 
 	data.type_min = node_type_min;
@@ -1307,20 +1891,20 @@ memdb_integer libdb_subscribe_type_of_node_delete(unsigned char db_name,
 	return rc;
 }
 
-memdb_integer libdb_subscribe_node_delete(unsigned char db_name, lock_id_t lock_id)
+memdb_integer libdb_subscribe_node_delete(unsigned char db_name, int sub, lock_id_t lock_id)
 {
-	return libdb_subscribe_type_of_node_delete(db_name, 0, 0xFFFFFFFF, lock_id);
+	return libdb_subscribe_type_of_node_delete(db_name, sub, 0, 0xFFFFFFFF, lock_id);
 }
 
-memdb_integer libdb_subscribe_node_delete_by_type(unsigned char db_name,
+memdb_integer libdb_subscribe_node_delete_by_type(unsigned char db_name, int sub,
 										  unsigned int node_type, lock_id_t lock_id)
 {
-	return libdb_subscribe_type_of_node_delete(db_name, node_type, node_type, lock_id);
+	return libdb_subscribe_type_of_node_delete(db_name, sub, node_type, node_type, lock_id);
 }
 
 
-memdb_integer libdb_subscribe_attr_special(unsigned char db_name,
-								   memdb_integer node_id, char *prefix, lock_id_t lock_id)
+static memdb_integer subscribe_attr(unsigned char db_name, int sub, memdb_integer node_id,
+									char *prefix, memdb_integer coalesce, lock_id_t lock_id)
 {
 	unsigned int prefix_len;
 	memdb_integer rc = 0;
@@ -1329,6 +1913,10 @@ memdb_integer libdb_subscribe_attr_special(unsigned char db_name,
 
 	struct request_pkg req = {};
 	struct response_pkg rsp = {};
+	struct subscriber *s = get_subscriber(sub);
+
+	if (s == NULL)
+		return -1;
 
 	prefix_len = prefix != NULL ? strlen(prefix) : 0;
 
@@ -1338,7 +1926,7 @@ memdb_integer libdb_subscribe_attr_special(unsigned char db_name,
 	req.lock_id = lock_id;
 
 	param.event   = EVENT_NODE_ATTR;
-	param.cb_port = subport;
+	param.cb_port = s->port;
 	param.cb_pid  = subpid;
 	data.prefix_len = prefix_len;
 	data.node_id = node_id;
@@ -1349,7 +1937,8 @@ memdb_integer libdb_subscribe_attr_special(unsigned char db_name,
 		libdb_fill_param(&req, "p_cb_pid", &param.cb_pid, JSON_INTEGER) ||
 		libdb_fill_param(&req, "p_node_id", &data.node_id, JSON_INTEGER) ||
 		(data.prefix_len != 0 && libdb_fill_param(&req, "p_name_prefix", data.name_prefix, JSON_STRING)) ||
-		libdb_fill_param(&req, "p_prefix_len", &data.prefix_len, JSON_INTEGER))
+		libdb_fill_param(&req, "p_prefix_len", &data.prefix_len, JSON_INTEGER) ||
+		(coalesce && libdb_fill_param(&req, "p_coalesce", &coalesce, JSON_INTEGER)))
 		return -1;
 
 	rc = libdb_process_cmd(&req, &rsp);
@@ -1363,21 +1952,33 @@ memdb_integer libdb_subscribe_attr_special(unsigned char db_name,
 	return rc;
 }
 
-memdb_integer libdb_subscribe_attr_by_prefix(unsigned char db_name,
+memdb_integer libdb_subscribe_attr_special(unsigned char db_name, int sub,
+								   memdb_integer node_id, char *prefix, lock_id_t lock_id)
+{
+	return subscribe_attr(db_name, sub, node_id, prefix, 0, lock_id);
+}
+
+memdb_integer libdb_subscribe_attr_coalesced(unsigned char db_name, int sub,
+									 memdb_integer node_id, char *prefix, lock_id_t lock_id)
+{
+	return subscribe_attr(db_name, sub, node_id, prefix, 1, lock_id);
+}
+
+memdb_integer libdb_subscribe_attr_by_prefix(unsigned char db_name, int sub,
 									 memdb_integer node_id, char* prefix, lock_id_t lock_id)
 {
-	return libdb_subscribe_attr_special(db_name, node_id, prefix, lock_id);
+	return libdb_subscribe_attr_special(db_name, sub, node_id, prefix, lock_id);
 
 }
 
-memdb_integer libdb_subscribe_attr_by_node(unsigned char db_name, memdb_integer node_id, lock_id_t lock_id)
+memdb_integer libdb_subscribe_attr_by_node(unsigned char db_name, int sub, memdb_integer node_id, lock_id_t lock_id)
 {
-	return libdb_subscribe_attr_special(db_name, node_id, NULL, lock_id);
+	return libdb_subscribe_attr_special(db_name, sub, node_id, NULL, lock_id);
 }
 
-memdb_integer libdb_subscribe_attr_all(unsigned char db_name, lock_id_t lock_id)
+memdb_integer libdb_subscribe_attr_all(unsigned char db_name, int sub, lock_id_t lock_id)
 {
-	return libdb_subscribe_attr_special(db_name, 0, NULL, lock_id);
+	return libdb_subscribe_attr_special(db_name, sub, 0, NULL, lock_id);
 }
 
 memdb_integer libdb_unsubscribe_event(unsigned char db_name, memdb_integer handle, lock_id_t lock_id)
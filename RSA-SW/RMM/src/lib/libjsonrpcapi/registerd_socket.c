@@ -26,7 +26,7 @@
 #include "librmmlog/rmmlog.h"
 #include "libjsonrpcapi/utils.h"
 
-static int fd = 0;
+static struct rpc_peer *peer;
 
 int connect_registerd()
 {
@@ -35,8 +35,11 @@ int connect_registerd()
 		rmm_log(ERROR, "Can't get registerd port...\n");
 		return -1;
 	}
-	fd = udp_connect(INADDR_LOOPBACK, port);
-	if (fd < 0) {
+	if (peer)
+		return rpc_peer_connect(peer, port);
+
+	peer = rpc_peer_open(port, 0);
+	if (peer == NULL) {
 		rmm_log(ERROR, "Connect registerd failed...\n");
 		return -1;
 	}
@@ -48,7 +51,7 @@ int send_msg_to_registerd(jrpc_req_pkg_t *req, int evt_id)
 {
 	int rc = -1;
 	jrpc_rsp_pkg_t rsp = {};
-	rc = send_msg_to_fd(req, &rsp, evt_id, fd);
+	rc = send_msg_to_peer(req, &rsp, evt_id, peer);
 	jrpc_rsp_pkg_free(&rsp);
 	return rc;
 }
@@ -0,0 +1,432 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libutils/list.h"
+#include "libutils/sock.h"
+#include "libutils/timer_wheel.h"
+#include "libjsonrpc/jsonrpc.h"
+#include "libjsonrpcapi/rpc_peer.h"
+#include "librmmlog/rmmlog.h"
+
+#define RPC_EVENTS_BATCH	16
+#define RPC_RCVBUF_SIZE		(512 * 1024)	/* replies of many requests in flight */
+#define RPC_MAX_ID			0x7fffffff
+
+struct rpc_pending {
+	struct list_head list;		/* in the id hash of the peer */
+	struct list_head expired;
+	struct wheel_timer timer;
+	int64 id;
+	int32 flags;
+	int32 running;				/* callback being called, not matched again */
+	rpc_reply_fn cb_fn;
+	void *cb_arg;
+};
+
+struct rpc_peer {
+	int fd;
+	uint32 last_id;
+	struct list_head hash[RPC_PEER_HASH_SIZE];
+};
+
+static pthread_once_t rt_once = PTHREAD_ONCE_INIT;
+static pthread_t rt_tid;
+static int epoll_fd = -1;
+static int timer_fd = -1;
+
+/* protects the pending requests of all peers and the wheel, never held in callbacks */
+static pthread_mutex_t rt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rt_done = PTHREAD_COND_INITIALIZER;	/* a callback returned */
+static struct timer_wheel wheel;
+static struct list_head expired = LIST_HEAD_INIT(expired);
+static int32 pending_num;
+static int32 ticking;				/* timer_fd armed, only while requests are pending */
+
+static uint64 now_ticks(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000) / RPC_PEER_TICK_MS;
+}
+
+static void set_ticking(int32 on)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	if (on) {
+		its.it_interval.tv_nsec = RPC_PEER_TICK_MS * 1000 * 1000;
+		its.it_value = its.it_interval;
+	}
+
+	if (timerfd_settime(timer_fd, 0, &its, NULL) == 0)
+		ticking = on;
+}
+
+static struct rpc_pending *find_pending(struct rpc_peer *peer, int64 id, int32 running)
+{
+	struct rpc_pending *p;
+
+	list_for_each_entry(p, &peer->hash[id & (RPC_PEER_HASH_SIZE - 1)], list) {
+		if (p->id == id && (running || !p->running))
+			return p;
+	}
+
+	return NULL;
+}
+
+/* called by timer_wheel_run, rt_lock held */
+static void handle_timeout(struct wheel_timer *timer)
+{
+	struct rpc_pending *p = container_of(timer, struct rpc_pending, timer);
+
+	/* a multi reply callback is still running, come back after it */
+	if (p->running) {
+		wheel_timer_add(&wheel, timer, 1);
+		return;
+	}
+
+	p->running = 1;
+	list_add_tail(&p->expired, &expired);
+}
+
+static void finish_pending(struct rpc_pending *p, int32 done)
+{
+	pthread_mutex_lock(&rt_lock);
+	if (done || !(p->flags & RPC_MULTI_REPLY)) {
+		list_del(&p->list);
+		wheel_timer_del(&p->timer);
+		free(p);
+		pending_num--;
+	} else {
+		p->running = 0;
+	}
+	pthread_cond_broadcast(&rt_done);
+	pthread_mutex_unlock(&rt_lock);
+}
+
+static void handle_tick(void)
+{
+	struct rpc_pending *p;
+	uint64_t ticks;
+
+	if (read(timer_fd, &ticks, sizeof(ticks)) != sizeof(ticks))
+		return;
+
+	pthread_mutex_lock(&rt_lock);
+	timer_wheel_run(&wheel, now_ticks());
+	if (pending_num == 0 && ticking)
+		set_ticking(0);
+
+	while (!list_empty(&expired)) {
+		p = list_entry(expired.next, struct rpc_pending, expired);
+		list_del(&p->expired);
+		pthread_mutex_unlock(&rt_lock);
+
+		p->cb_fn(NULL, p->cb_arg);
+		finish_pending(p, 1);
+
+		pthread_mutex_lock(&rt_lock);
+	}
+	pthread_mutex_unlock(&rt_lock);
+}
+
+static void recv_replies(struct rpc_peer *peer)
+{
+	char buf[JSONRPC_MAX_STRING_LEN];
+	struct rpc_pending *p;
+	json_t *rsp;
+	json_t *id;
+	int rc;
+
+	for (;;) {
+		rc = recv(peer->fd, buf, sizeof(buf) - 1, 0);
+		if (rc <= 0)
+			break;
+		buf[rc] = '\0';
+
+		rsp = json_parse_arena(buf, rc);
+		if (rsp == NULL)
+			continue;
+
+		id = json_object_get(rsp, "id");
+		if (id == NULL || id->type != JSON_INTEGER) {
+			json_free(rsp);
+			continue;
+		}
+
+		pthread_mutex_lock(&rt_lock);
+		p = find_pending(peer, json_integer_value(id), 0);
+		if (p == NULL) {
+			/* late reply of a request timed out */
+			pthread_mutex_unlock(&rt_lock);
+			json_free(rsp);
+			continue;
+		}
+		if (!(p->flags & RPC_MULTI_REPLY))
+			wheel_timer_del(&p->timer);
+		p->running = 1;
+		pthread_mutex_unlock(&rt_lock);
+
+		p->cb_fn(rsp, p->cb_arg);
+		finish_pending(p, 0);
+	}
+}
+
+static void dispatch(int timeout_ms)
+{
+	struct epoll_event evs[RPC_EVENTS_BATCH];
+	int i, n;
+
+	n = epoll_wait(epoll_fd, evs, RPC_EVENTS_BATCH, timeout_ms);
+	for (i = 0; i < n; i++) {
+		if (evs[i].data.ptr == NULL)
+			handle_tick();
+		else
+			recv_replies(evs[i].data.ptr);
+	}
+}
+
+static void *rt_thread(void *unused)
+{
+	prctl(PR_SET_NAME, "rpc_peer");
+
+	for (;;)
+		dispatch(-1);
+
+	return NULL;
+}
+
+static void rt_start(void)
+{
+	struct epoll_event ev;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1)
+		goto err;
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer_fd == -1)
+		goto err;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) == -1)
+		goto err;
+
+	timer_wheel_init(&wheel, now_ticks());
+
+	if (pthread_create(&rt_tid, NULL, rt_thread, NULL) != 0)
+		goto err;
+	pthread_detach(rt_tid);
+
+	return;
+
+err:
+	rmm_log(ERROR, "Failed to start the rpc runtime!\n");
+	if (timer_fd != -1)
+		close(timer_fd);
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	timer_fd = -1;
+	epoll_fd = -1;
+}
+
+static int connect_port(int fd, int port)
+{
+	struct sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	return connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+struct rpc_peer *rpc_peer_open(int port, int local_port)
+{
+	struct rpc_peer *peer;
+	struct epoll_event ev;
+	int size;
+	int fd;
+	int i;
+
+	pthread_once(&rt_once, rt_start);
+	if (epoll_fd == -1)
+		return NULL;
+
+	if (local_port) {
+		fd = create_udp_listen(INADDR_LOOPBACK, local_port, 0, 1);
+		if (fd == -1)
+			return NULL;
+		if (connect_port(fd, port) < 0)
+			goto err;
+	} else {
+		fd = udp_connect(INADDR_LOOPBACK, port);
+		if (fd < 0)
+			return NULL;
+	}
+
+	size = RPC_RCVBUF_SIZE;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	peer = malloc(sizeof(struct rpc_peer));
+	if (peer == NULL)
+		goto err;
+
+	peer->fd = fd;
+	peer->last_id = 0;
+	for (i = 0; i < RPC_PEER_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&peer->hash[i]);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = peer;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		free(peer);
+		goto err;
+	}
+
+	return peer;
+
+err:
+	rmm_log(ERROR, "Failed to open rpc peer on port %d\n", port);
+	close(fd);
+	return NULL;
+}
+
+int rpc_peer_connect(struct rpc_peer *peer, int port)
+{
+	if (peer == NULL || connect_port(peer->fd, port) < 0)
+		return -1;
+
+	return 0;
+}
+
+int64 rpc_peer_expect(struct rpc_peer *peer, int64 id, uint32 timeout_ms, int32 flags,
+					  rpc_reply_fn cb_fn, void *cb_arg)
+{
+	struct rpc_pending *p;
+
+	if (peer == NULL || cb_fn == NULL)
+		return -1;
+
+	p = malloc(sizeof(struct rpc_pending));
+	if (p == NULL)
+		return -1;
+
+	p->flags = flags;
+	p->running = 0;
+	p->cb_fn = cb_fn;
+	p->cb_arg = cb_arg;
+	wheel_timer_init(&p->timer, handle_timeout);
+
+	pthread_mutex_lock(&rt_lock);
+	if (id == 0) {
+		do {
+			if (++peer->last_id > RPC_MAX_ID)
+				peer->last_id = 1;
+			id = peer->last_id;
+		} while (find_pending(peer, id, 1) != NULL);
+	} else if (find_pending(peer, id, 0) != NULL) {
+		pthread_mutex_unlock(&rt_lock);
+		free(p);
+		return -1;
+	}
+
+	p->id = id;
+	list_add_tail(&p->list, &peer->hash[id & (RPC_PEER_HASH_SIZE - 1)]);
+
+	/* the wheel is empty, catch it up at once */
+	if (pending_num++ == 0)
+		timer_wheel_init(&wheel, now_ticks());
+	if (!ticking)
+		set_ticking(1);
+	wheel_timer_add(&wheel, &p->timer, (timeout_ms + RPC_PEER_TICK_MS - 1) / RPC_PEER_TICK_MS);
+	pthread_mutex_unlock(&rt_lock);
+
+	return id;
+}
+
+void rpc_peer_cancel(struct rpc_peer *peer, int64 id)
+{
+	struct rpc_pending *p;
+
+	if (peer == NULL)
+		return;
+
+	pthread_mutex_lock(&rt_lock);
+	p = find_pending(peer, id, 0);
+	if (p) {
+		list_del(&p->list);
+		wheel_timer_del(&p->timer);
+		free(p);
+		pending_num--;
+		pthread_cond_broadcast(&rt_done);
+	}
+	pthread_mutex_unlock(&rt_lock);
+}
+
+int rpc_peer_send(struct rpc_peer *peer, const char *msg, int len)
+{
+	if (peer == NULL || send(peer->fd, msg, len, 0) != len)
+		return -1;
+
+	return 0;
+}
+
+static int32 is_pending(struct rpc_peer *peer, int64 id)
+{
+	int32 found;
+
+	pthread_mutex_lock(&rt_lock);
+	found = find_pending(peer, id, 1) != NULL;
+	pthread_mutex_unlock(&rt_lock);
+
+	return found;
+}
+
+void rpc_peer_wait(struct rpc_peer *peer, int64 id)
+{
+	if (peer == NULL)
+		return;
+
+	/* called back on the runtime thread, run it meanwhile */
+	if (pthread_equal(pthread_self(), rt_tid)) {
+		while (is_pending(peer, id))
+			dispatch(RPC_PEER_TICK_MS);
+		return;
+	}
+
+	pthread_mutex_lock(&rt_lock);
+	while (find_pending(peer, id, 1) != NULL)
+		pthread_cond_wait(&rt_done, &rt_lock);
+	pthread_mutex_unlock(&rt_lock);
+}
@@ -0,0 +1,295 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Requests against a local JSON-RPC peer which answers in reverse order,
+ * never answers some ids and answers others three times. Checks that each
+ * callback gets the reply of its own id or its timeout exactly once, that
+ * many threads have requests in flight at the same time, that a callback
+ * can wait for a request of its own and that a multi reply request gets
+ * every reply before its timeout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "libjson/json.h"
+#include "libutils/test.h"
+#include "libjsonrpcapi/rpc_peer.h"
+
+#define SERVER_PORT		18191
+#define REVERSE_BATCH	8		/* replies sent in reverse order per batch */
+
+#define THREADS			4
+#define REQUESTS		2000	/* per thread */
+#define TIMEOUT_MS		300
+
+#define DROPPED(id)		((id) % 10 == 0)
+#define MULTI_REPLIES	3
+
+struct request {
+	int64 id;
+	volatile int32 replies;
+	volatile int32 timeouts;
+	volatile int32 wrong;
+};
+
+static struct rpc_peer *peer;
+static struct request requests[THREADS][REQUESTS];
+static int32 done_num;
+
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void reply(int fd, struct sockaddr_in *addr, int64 id)
+{
+	char buf[128];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "{\"jsonrpc\": \"2.0\", \"id\": %lld, \"result\": {\"id\": %lld}}",
+				   (long long)id, (long long)id);
+	sendto(fd, buf, len + 1, 0, (struct sockaddr *)addr, sizeof(*addr));
+}
+
+static void *server_thread(void *arg)
+{
+	int fd = *(int *)arg;
+	struct sockaddr_in addr[REVERSE_BATCH];
+	int64 ids[REVERSE_BATCH];
+	socklen_t addr_len;
+	struct timeval tv = {0, 20 * 1000};
+	int size = 1 << 20;
+	char buf[1024];
+	json_t *req;
+	int n = 0;
+	int rc, i;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	for (;;) {
+		addr_len = sizeof(addr[n]);
+		rc = recvfrom(fd, buf, sizeof(buf) - 1, 0, (struct sockaddr *)&addr[n], &addr_len);
+		if (rc > 0) {
+			buf[rc] = '\0';
+			req = json_parse(buf);
+			if (req == NULL)
+				continue;
+			ids[n] = json_integer_value(json_object_get(req, "id"));
+			if (strcmp(json_string_value(json_object_get(req, "method")), "multi") == 0) {
+				for (i = 0; i < MULTI_REPLIES; i++)
+					reply(fd, &addr[n], ids[n]);
+			} else if (!DROPPED(ids[n])) {
+				n++;
+			}
+			json_free(req);
+		}
+
+		/* a full batch, or the last requests of a pause */
+		if (n == REVERSE_BATCH || (rc <= 0 && n > 0)) {
+			while (n > 0) {
+				n--;
+				reply(fd, &addr[n], ids[n]);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* id is set before the request is sent, its reply may come at once */
+static int64 send_request(const char *method, int32 flags, rpc_reply_fn cb_fn, void *cb_arg, int64 *id_out)
+{
+	char buf[128];
+	int64 id;
+	int len;
+
+	id = rpc_peer_expect(peer, 0, TIMEOUT_MS, flags, cb_fn, cb_arg);
+	if (id < 0)
+		return -1;
+	if (id_out)
+		*id_out = id;
+
+	len = snprintf(buf, sizeof(buf), "{\"jsonrpc\": \"2.0\", \"method\": \"%s\", \"id\": %lld}",
+				   method, (long long)id);
+	if (rpc_peer_send(peer, buf, len + 1) != 0) {
+		rpc_peer_cancel(peer, id);
+		return -1;
+	}
+
+	return id;
+}
+
+static void request_done(json_t *rsp, void *cb_arg)
+{
+	struct request *req = (struct request *)cb_arg;
+	json_t *result;
+
+	if (rsp == NULL) {
+		req->timeouts++;
+	} else {
+		result = json_object_get(rsp, "result");
+		if (result == NULL || json_integer_value(json_object_get(result, "id")) != req->id)
+			req->wrong++;
+		req->replies++;
+		json_free(rsp);
+	}
+
+	pthread_mutex_lock(&done_lock);
+	done_num++;
+	pthread_mutex_unlock(&done_lock);
+}
+
+static void *client_thread(void *arg)
+{
+	struct request *reqs = (struct request *)arg;
+	int32 i;
+
+	for (i = 0; i < REQUESTS; i++) {
+		reqs[i].id = -1;
+		send_request("async", 0, request_done, &reqs[i], &reqs[i].id);
+		/* let the server keep up, the socket buffer is the limit otherwise */
+		if (i % 16 == 15)
+			usleep(1000);
+	}
+
+	return NULL;
+}
+
+static void nested_done(json_t *rsp, void *cb_arg)
+{
+	*(json_t **)cb_arg = rsp;
+}
+
+/* waits for another request, on the runtime thread */
+static void outer_done(json_t *rsp, void *cb_arg)
+{
+	json_t *inner = NULL;
+	int64 id;
+
+	id = send_request("inner", 0, nested_done, &inner, NULL);
+	rpc_peer_wait(peer, id);
+	*(int32 *)cb_arg = inner != NULL;
+
+	json_free(inner);
+	json_free(rsp);
+}
+
+static void multi_done(json_t *rsp, void *cb_arg)
+{
+	int32 *counts = (int32 *)cb_arg;
+
+	if (rsp == NULL) {
+		counts[1]++;
+		return;
+	}
+	/* the timeout is the last call */
+	if (counts[1] == 0)
+		counts[0]++;
+	json_free(rsp);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t tid[THREADS];
+	struct sockaddr_in addr;
+	struct request sync_req = {0};
+	int32 replies = 0, timeouts = 0, wrong = 0, twice = 0, dropped = 0, not_timed_out = 0;
+	int32 served = 0, served_replies = 0;
+	int32 nested_ok = 0;
+	int32 multi[2] = {0, 0};
+	uint64 start;
+	int64 id;
+	int fd;
+	int32 t, i;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(SERVER_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		printf("FAIL: bind port %d\n", SERVER_PORT);
+		return -1;
+	}
+	pthread_create(&tid[0], NULL, server_thread, &fd);
+
+	peer = rpc_peer_open(SERVER_PORT, 0);
+	if (peer == NULL) {
+		printf("FAIL: rpc_peer_open\n");
+		return -1;
+	}
+
+	/* one request, waited for by the sender */
+	id = send_request("sync", 0, request_done, &sync_req, &sync_req.id);
+	rpc_peer_wait(peer, id);
+	check(sync_req.replies + sync_req.timeouts == 1 && sync_req.wrong == 0, "wait returns after the callback");
+
+	done_num = 0;
+	start = now_ms();
+	for (t = 0; t < THREADS; t++)
+		pthread_create(&tid[t], NULL, client_thread, requests[t]);
+	for (t = 0; t < THREADS; t++)
+		pthread_join(tid[t], NULL);
+
+	for (;;) {
+		pthread_mutex_lock(&done_lock);
+		i = done_num;
+		pthread_mutex_unlock(&done_lock);
+		if (i == THREADS * REQUESTS || now_ms() - start > 60 * 1000)
+			break;
+		usleep(10 * 1000);
+	}
+	printf("%d requests from %d threads in %llu ms\n", THREADS * REQUESTS, THREADS,
+		   (unsigned long long)(now_ms() - start));
+
+	for (t = 0; t < THREADS; t++) {
+		for (i = 0; i < REQUESTS; i++) {
+			struct request *req = &requests[t][i];
+
+			replies += req->replies;
+			timeouts += req->timeouts;
+			wrong += req->wrong;
+			twice += req->replies + req->timeouts != 1;
+			if (req->id > 0 && DROPPED(req->id)) {
+				dropped++;
+				not_timed_out += req->timeouts != 1;
+			} else if (req->id > 0) {
+				served++;
+				served_replies += req->replies;
+			}
+		}
+	}
+	printf("%d replies, %d timeouts, %d never answered\n", replies, timeouts, dropped);
+	check(twice == 0, "every callback called exactly once");
+	check(wrong == 0, "replies go to the callback of their id");
+	check(not_timed_out == 0, "requests never answered time out");
+	/* answered ones may time out too on a loaded host, but not most of them */
+	check(served_replies * 2 > served, "most answered requests get their reply");
+
+	id = send_request("outer", 0, outer_done, &nested_ok, NULL);
+	rpc_peer_wait(peer, id);
+	check(nested_ok, "a callback waits for its own request");
+
+	id = send_request("multi", RPC_MULTI_REPLY, multi_done, multi, NULL);
+	rpc_peer_wait(peer, id);
+	check(multi[0] == MULTI_REPLIES && multi[1] == 1, "multi reply gets every reply, then its timeout");
+
+	return test_result();
+}
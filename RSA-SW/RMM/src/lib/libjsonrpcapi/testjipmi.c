@@ -191,13 +191,13 @@ int main(int argc, char **argv)
 		max_fd = -1;
 		FD_ZERO(&rfds);
 
-		libjsonrpcapi_callback_selectfds(&rfds, &max_fd);
+		libjsonrpcapi_callback_selectfds(-1, &rfds, &max_fd);
 
 		rc = select(max_fd + 1, &rfds, NULL, NULL, NULL);
 		if (rc <= 0)
 			continue;
 
-		libjsonrpcapi_callback_processfds(&rfds);
+		libjsonrpcapi_callback_processfds(-1, &rfds);
 	}
 
 	return 0;
@@ -24,90 +24,57 @@
 #include "librmmcfg/rmm_cfg.h"
 
 #include "libjsonrpcapi/assetd_socket.h"
+#include "libjsonrpcapi/rpc_peer.h"
 #include "libutils/sock.h"
 #include "libjsonrpcapi/parser.h"
 #include "libassetd/assetd_type.h"
 #include "libassetd/assetd_jrpc_def.h"
 #include "librmmlog/rmmlog.h"
 
-int send_msg_to_fd(jrpc_req_pkg_t *req, jrpc_rsp_pkg_t *resp, int evt_id, int fd)
+static void store_rsp(json_t *rsp, void *cb_arg)
 {
-#define MAX_RETRIES		2
-#define RECV_TIMEO		5000000 /* in useconds */
-	int rc, retries = MAX_RETRIES;
-	fd_set fds;
-	struct timeval timeo;
-	static unsigned int seqnum;
+	*(json_t **)cb_arg = rsp;
+}
+
+int send_msg_to_peer(jrpc_req_pkg_t *req, jrpc_rsp_pkg_t *resp, int evt_id, struct rpc_peer *peer)
+{
+#define RECV_TIMEO_MS	10000
 	char * req_str = NULL;
-	static pthread_mutex_t socket_mutex = PTHREAD_MUTEX_INITIALIZER;
-	char rsp_string[JSONRPC_MAX_STRING_LEN] = {0};
-	int64 error_code = 0;
+	json_t *rsp = NULL;
+	int64 error_code = -1;
+	int64 id;
 
 	memset(resp, 0, sizeof(jrpc_rsp_pkg_t));
 
-	pthread_mutex_lock(&socket_mutex);
-	if (fd < 0) {
-		exit(-1);
-	}
-	req->id = ++seqnum;
+	/* the reply is matched by id, any number of threads may wait for theirs */
+	id = rpc_peer_expect(peer, 0, RECV_TIMEO_MS, 0, store_rsp, &rsp);
+	if (id < 0)
+		return -1;
+
+	req->id = id;
 	if (NULL == (req_str = jrpc_create_req_string(req->id, am_cmd_map[evt_id].cmd_name, req->num_of_params, req->params))) {
-		error_code = -1;
-		goto end;
+		rpc_peer_cancel(peer, id);
+		return -1;
 	}
 
 	rmm_log(INFO, "evt_id: %d ,req_str: %s.\n", evt_id, req_str);
 
-	if((rc = socket_send(fd, req_str, strlen(req_str) + 1)) < 0) {
-		error_code = -1;
+	if (rpc_peer_send(peer, req_str, strlen(req_str) + 1) < 0) {
+		rpc_peer_cancel(peer, id);
 		goto end;
 	}
 
-	for (;;) {
-		if (--retries < 0)
-			break;
-
-		FD_ZERO(&fds);
-		FD_SET(fd, &fds);
-		timeo.tv_sec = RECV_TIMEO/1000000;//RECV_TIMEO;
-		timeo.tv_usec = RECV_TIMEO%1000000;
-
-		rc = select(fd + 1, &fds, NULL, NULL, &timeo);
-		if (rc <= 0)
-			continue;
-
-		rc = socket_recv(fd, rsp_string, sizeof(rsp_string));
-
-		if(-1 == rc || 0 != parse_rsp(rsp_string, resp)) {
-			error_code = -1;
-			goto end;
-		}
-		
-		if (resp->id_type == JSONRPC_ID_TYPE_NORMAL &&
-			resp->id == req->id) {
-			if (resp->rsp_type == JSONRPC_RSP_ERROR) {
-				error_code = resp->data.error.code;
-			} else if (resp->rsp_type == JSONRPC_RSP_INVALID) {
-				error_code = -1;
-			} else {
-				error_code = 0;
-				goto end;
-			}
-		} else if (resp->id < req->id) {
-			jrpc_rsp_pkg_free(resp);
-			continue;
-		} else {
-			goto end;
-		}
+	rpc_peer_wait(peer, id);
+	if (rsp == NULL || 0 != jrpc_rsp_to_struct(rsp, resp))
+		goto end;
 
-	}
+	if (resp->rsp_type == JSONRPC_RSP_ERROR)
+		error_code = resp->data.error.code;
+	else
+		error_code = 0;
 
 end:
-	if (req_str != NULL) {
-		jrpc_free_string(req_str);
-		req_str = NULL;
-	}
-	
-	pthread_mutex_unlock(&socket_mutex);
+	jrpc_free_string(req_str);
 	return (int)error_code;
 }
 
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libredfish/msg_reg.h"
+#include "libredfish/rf_types.h"
+#include "libutils/test.h"
+
+/*
+ * Render a burst of events the way redfishd does for each of them:
+ * location index, message text and message id, plus the args format
+ * rf_event.c builds the args with. Every message of the registry is
+ * used in turn, the args are "<n>" for numbers and "<name><n>" for strings.
+ *
+ * usage: msgregbench [MR.json] [events]
+ */
+
+#define DEFAULT_EVENTS	1000000
+#define MAX_SN			1024
+
+static char args[MAX_SN][RF_MSG_MAX_LEN];
+static int sn_num;
+
+/* Build the args of each message from its args format, "%s,%d" => "psu1,2" */
+static void build_args(void)
+{
+	char fmt[RF_MSG_MAX_LEN];
+	char *p;
+	int len;
+	int n;
+
+	for (sn_num = 1; sn_num < MAX_SN; sn_num++) {
+		memset(fmt, 0, sizeof(fmt));
+		if (msg_reg_get_args_format(fmt, sizeof(fmt), sn_num) != RF_SUCCESS)
+			break;
+
+		len = 0;
+		n = 1;
+		for (p = fmt; *p && len < RF_MSG_MAX_LEN - 16; p++) {
+			if (*p != '%')
+				continue;
+			if (len)
+				args[sn_num][len++] = ',';
+			if (p[1] == 'd')
+				len += sprintf(args[sn_num] + len, "%d", n);
+			else
+				len += sprintf(args[sn_num] + len, "psu%d", n);
+			n++;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	char *path = argc > 1 ? argv[1] : NULL;
+	long events = argc > 2 ? atol(argv[2]) : DEFAULT_EVENTS;
+	char msg[RF_MSG_MAX_LEN];
+	char msg_id_str[RF_MSG_MAX_LEN];
+	char args_fmt[RF_MSG_MAX_LEN];
+	struct timespec start;
+	unsigned long sum = 0;
+	double ns;
+	long i;
+	int sn;
+	int k;
+
+	if (msg_reg_init(path) != RF_SUCCESS) {
+		printf("fail to load message registry %s\n", path ? path : "");
+		return -1;
+	}
+
+	build_args();
+	if (sn_num <= 1) {
+		printf("no message in the registry\n");
+		return -1;
+	}
+	printf("%d messages, %ld events\n", sn_num - 1, events);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < events; i++) {
+		sn = i % (sn_num - 1) + 1;
+		sum += msg_reg_get_location_idx(sn, args[sn]);
+		msg_reg_get_msg_str(msg, sn, args[sn]);
+		msg_id_str[0] = '\0';
+		msg_reg_get_msg_id_str(msg_id_str, sizeof(msg_id_str), sn);
+		for (k = 0; msg[k]; k++)
+			sum = sum * 31 + (unsigned char)msg[k];
+		sum += msg_id_str[0];
+	}
+	ns = elapsed_ns(&start);
+	printf("rf_msg_handler   %8.0f ns/event  %10.0f events/s\n", ns / events, events / ns * 1e9);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < events; i++) {
+		sn = i % (sn_num - 1) + 1;
+		msg_reg_get_args_format(args_fmt, sizeof(args_fmt), sn);
+		sum += args_fmt[0];
+	}
+	ns = elapsed_ns(&start);
+	printf("args format      %8.0f ns/event  %10.0f events/s\n", ns / events, events / ns * 1e9);
+
+	/* the same for the same registry and events, to compare the output */
+	printf("checksum %lx\n", sum);
+
+	msg_reg_destory();
+	return 0;
+}
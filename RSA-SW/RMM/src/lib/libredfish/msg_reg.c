@@ -42,81 +42,182 @@ struct type_map rf_evt_params_convet_map[2] = {
  */
 static struct message_registry *g_mr;
 
-static int get_args_count(const char *buf, char **args)
+/*
+ * The registry compiled at load time, indexed by msg_sn. The message is
+ * cut into literal runs, each but the last one followed by an argument,
+ * so rendering is a single pass of copies.
+ */
+#define MR_MAX_PARTS		(MAX_PARAM_TYPES + 1)
+
+struct mr_part {
+	int			lit_off;	/* literal run in text of the entry */
+	int			lit_len;
+	int			arg;		/* -1 for the last run */
+};
+
+struct mr_entry {
+	struct mr_message *pmsg;
+	int			part_num;
+	struct mr_part parts[MR_MAX_PARTS];
+	char		text[MAX_MESSAGE_SIZE];			/* literals of the message */
+	char		fmt[MAX_MESSAGE_SIZE];			/* message with %d and %s */
+	char		args_fmt[MAX_PARAM_TYPES * 3];	/* such as "%s,%d" */
+	char		id_str[MAX_IDENTITY_SIZE];
+};
+
+static struct mr_entry *mr_table;	/* entry 0 is unused, msg_sn begins with 1 */
+static int mr_table_size;
+
+static struct mr_entry *mr_get(int msg_sn)
+{
+	if (msg_sn <= 0 || msg_sn >= mr_table_size)
+		return NULL;
+
+	return &mr_table[msg_sn];
+}
+
+/* Split args "a,b,c" without copying them, empty args are skipped */
+static int split_args(const char *arg_data, const char **args, int *lens)
 {
-	char tmp[256] = {0};
-	const char *split = ",";
-	char *p = NULL;
-	int i = 0;
-
-	strncpy_safe(tmp, buf, sizeof(tmp), sizeof(tmp) - 1);
-	p = strtok(tmp, split);
-	while (p != NULL) {
-		args[i] = strdup(p);
-		p = strtok(NULL, split);
-		i++;
+	const char *p = arg_data;
+	const char *end;
+	const char *limit;
+	int count = 0;
+
+	if (p == NULL)
+		return 0;
+
+	limit = p + strnlen(p, RF_MSG_MAX_LEN - 1);
+	while (p < limit && count < MAX_PARAM_TYPES) {
+		end = memchr(p, ',', limit - p);
+		if (end == NULL)
+			end = limit;
+		if (end != p) {
+			args[count] = p;
+			lens[count] = end - p;
+			count++;
+		}
+		p = end + 1;
 	}
 
-	return i;
+	return count;
 }
 
-/*Get message data through the message format("%d,%s,%s") and args*/
-static int parse_msg(char *msg, char *msg_fmt, char **args, int count)
+/* Replace %integer and %string in the message by %d and %s */
+static void convert_format(char *fmt, int max_len, const char *msg)
 {
-	char	*str;
-	char	*arg;
-	int		index = 0;
-	int		size = 0;
-	int		i = 0;
-
-	for (str = msg; *msg_fmt; ++msg_fmt) {
-		if (*msg_fmt != '%') {
-			*str++ = *msg_fmt;
+	int len = 0;
+	int rep_len;
+	int i;
+
+	while (*msg && len < max_len - 1) {
+		for (i = 0; i < 2; i++) {
+			if (strncmp(msg, rf_evt_params_convet_map[i].src, strlen(rf_evt_params_convet_map[i].src)) == 0)
+				break;
+		}
+		if (i == 2) {
+			fmt[len++] = *msg++;
 			continue;
 		}
-		msg_fmt++;
-		switch (*msg_fmt) {
-		case 's':
-		case 'd': {
-			arg = args[index];
-			index++;
-			size = strlen(arg);
-			for (i = 0; i < size; ++i)
-				*str++ = *arg++;
+
+		rep_len = strlen(rf_evt_params_convet_map[i].rep);
+		if (len + rep_len > max_len - 1)
 			break;
-			}
-		default:
+		memcpy(fmt + len, rf_evt_params_convet_map[i].rep, rep_len);
+		len += rep_len;
+		msg += strlen(rf_evt_params_convet_map[i].src);
+	}
+	fmt[len] = '\0';
+}
+
+/* %s and %d take the args in order, any other % pair is dropped */
+static void compile_template(struct mr_entry *entry)
+{
+	const char *p = entry->fmt;
+	struct mr_part *part = entry->parts;
+	int len = 0;
+	int arg = 0;
+
+	part->lit_off = 0;
+	part->lit_len = 0;
+
+	while (*p) {
+		if (*p != '%') {
+			entry->text[len++] = *p++;
+			part->lit_len++;
+			continue;
+		}
+		if (p[1] == '\0')
 			break;
+		if ((p[1] == 's' || p[1] == 'd') && arg < MAX_PARAM_TYPES) {
+			part->arg = arg++;
+			part++;
+			part->lit_off = len;
+			part->lit_len = 0;
 		}
+		p += 2;
 	}
-	*str = '\0';
+	entry->text[len] = '\0';
 
-	return str - msg;
+	part->arg = -1;
+	entry->part_num = part - entry->parts + 1;
 }
 
-static void str_replace(char *target, int max_len, char *old, char *str_new)
+static void compile_args_format(struct mr_entry *entry)
 {
-	char *buffer = (char *)malloc(max_len);
-	char *beg_of_substr = NULL;
+	struct mr_message *pmsg = entry->pmsg;
+	int len = 0;
+	int index;
+
+	for (index = 0; index < pmsg->num_of_args && index < MAX_PARAM_TYPES; index++) {
+		if (index != 0)
+			entry->args_fmt[len++] = ',';
+
+		if (pmsg->types[index] == TYPE_STR_ID) {
+			memcpy(entry->args_fmt + len, "%s", 2);
+			len += 2;
+		} else if (pmsg->types[index] == TYPE_INT_ID) {
+			memcpy(entry->args_fmt + len, "%d", 2);
+			len += 2;
+		} else
+			printf("error message type: %d\n", pmsg->types[index]);
+	}
+	entry->args_fmt[len] = '\0';
+}
 
-	if (buffer == NULL)
-		return;
+static int mr_compile(struct message_registry *mr)
+{
+	struct mr_message *pmsg;
+	struct mr_entry *entry;
+	int size = 1;
 
-	beg_of_substr = strstr(target, old);
-	if (beg_of_substr == NULL) {
-		free(buffer);
-		return;
+	for (pmsg = mr->msg_header; pmsg != NULL; pmsg = pmsg->pnext) {
+		if (pmsg->msg_sn >= size)
+			size = pmsg->msg_sn + 1;
 	}
 
-	strncpy_safe(buffer, target, max_len, beg_of_substr - target);
-	buffer[beg_of_substr-target] = '\0';
-
-	snprintf(buffer + (beg_of_substr - target), max_len - (beg_of_substr - target), "%s%s", str_new, beg_of_substr + strlen(old));
-	target[0] = '\0';
-	strncpy_safe(target, buffer, max_len, max_len - 1);
-	free(buffer);
+	mr_table = (struct mr_entry *)calloc(size, sizeof(struct mr_entry));
+	if (mr_table == NULL)
+		return -1;
+	mr_table_size = size;
+
+	for (pmsg = mr->msg_header; pmsg != NULL; pmsg = pmsg->pnext) {
+		entry = &mr_table[pmsg->msg_sn];
+		entry->pmsg = pmsg;
+		convert_format(entry->fmt, MAX_MESSAGE_SIZE, pmsg->msg);
+		compile_template(entry);
+		compile_args_format(entry);
+		if (snprintf(entry->id_str, MAX_IDENTITY_SIZE, "%s%s%s",
+					 mr->prefix, mr->ver, pmsg->msg_sn_str) >= MAX_IDENTITY_SIZE) {
+			printf("message id %s%s%s is too long\n", mr->prefix, mr->ver, pmsg->msg_sn_str);
+			free(mr_table);
+			mr_table = NULL;
+			mr_table_size = 0;
+			return -1;
+		}
+	}
 
-	return str_replace(target, max_len, old, str_new);
+	return 0;
 }
 
 static int get_json_int(json_t *jobj, char *name)
@@ -295,38 +396,17 @@ static struct message_registry *mr_init(char *data)
 */
 int msg_reg_get_args_format(char *msg_args_fmt, int max_len, int msg_sn)
 {
-	struct mr_message *pmsg		= NULL;
-	int		index				= 0;
-	va_list args;
-	int		ret;
-	char	tmp[256]			= {0};
+	struct mr_entry *entry;
 
 	if (!g_mr)
-			return RF_NOT_INIT;
-
-	pmsg = g_mr->msg_header;
-	while (pmsg) {
-		/*Search all all msg, find msg idx is equal.*/
-		if (msg_sn == pmsg->msg_sn) {
-			for (index = 0; index < pmsg->num_of_args; index++) {
-				if (index != 0)
-					strncat(tmp, ",", 1);
-
-				if (pmsg->types[index] == TYPE_STR_ID)
-					strncat(tmp, "%s", 2);
-				else if (pmsg->types[index] == TYPE_INT_ID)
-					strncat(tmp, "%d", 2);
-				else
-					printf("error message type: %d\n", pmsg->types[index]);
-			}
-
-			strncpy_safe(msg_args_fmt, tmp, max_len, max_len - 1);
-			return RF_SUCCESS;
-		}
-		pmsg = pmsg->pnext;
-	}
+		return RF_NOT_INIT;
 
-	return RF_NOT_FOUND;
+	entry = mr_get(msg_sn);
+	if (entry == NULL)
+		return RF_NOT_FOUND;
+
+	strncpy_safe(msg_args_fmt, entry->args_fmt, max_len, max_len - 1);
+	return RF_SUCCESS;
 }
 
 static struct message_registry *mr_init_via_file(const char *file_path)
@@ -351,61 +431,56 @@ static struct message_registry *mr_init_via_file(const char *file_path)
 
 int msg_reg_get_location_idx(int msg_sn, char *arg_data)
 {
-	char *args[10];
-	int location_idx = INVAILD_IDX;
-	int count = get_args_count(arg_data, args);
-	int location_offset = -1;
-	struct mr_message *pmsg = NULL;
+	const char *args[MAX_PARAM_TYPES];
+	int lens[MAX_PARAM_TYPES];
+	struct mr_entry *entry;
+	int offset;
 
 	if (!g_mr)
 		return RF_NOT_INIT;
 
-	pmsg = g_mr->msg_header;
-
-	while (pmsg) {
-		if (msg_sn == pmsg->msg_sn) {
-			location_offset = pmsg->index;
-			break;
-		}
-		pmsg = pmsg->pnext;
-	}
+	entry = mr_get(msg_sn);
+	if (entry == NULL)
+		return INVAILD_IDX;
 
-	if (count > location_offset && location_offset != -1)
-		location_idx = atoi(args[location_offset]);
+	/* no _ArgPos in the message */
+	offset = entry->pmsg->index;
+	if (offset < 0 || offset == INVAILD_IDX || offset >= split_args(arg_data, args, lens))
+		return INVAILD_IDX;
 
-	return location_idx;
+	return atoi(args[offset]);
 }
 
 int msg_reg_get_msg_id_str(char *identity, int max_len, int msg_sn)
 {
-	struct mr_message *pmsg = NULL;
+	struct mr_entry *entry;
 
 	if (!g_mr)
 		return RF_NOT_INIT;
 
-	pmsg = g_mr->msg_header;
-
-	while (pmsg) {
-		if (msg_sn == pmsg->msg_sn) {
-			strncat(identity, g_mr->prefix, max_len);
-			strncat(identity, g_mr->ver, max_len);
-			strncat(identity, pmsg->msg_sn_str, max_len);
-			break;
-		}
-		pmsg = pmsg->pnext;
-	}
+	entry = mr_get(msg_sn);
+	if (entry)
+		strncat(identity, entry->id_str, max_len);
 
 	return RF_SUCCESS;
 }
 
 int msg_reg_init(const char *path)
 {
-	if (g_mr == NULL)
-		g_mr = mr_init_via_file(path);
 	if (g_mr)
 		return RF_SUCCESS;
-	else
+
+	g_mr = mr_init_via_file(path);
+	if (g_mr == NULL)
 		return RF_ERR;
+
+	if (mr_compile(g_mr) != 0) {
+		free(g_mr);
+		g_mr = NULL;
+		return RF_ERR;
+	}
+
+	return RF_SUCCESS;
 }
 
 int msg_reg_destory(void)
@@ -415,6 +490,10 @@ int msg_reg_destory(void)
 		g_mr = NULL;
 	}
 
+	free(mr_table);
+	mr_table = NULL;
+	mr_table_size = 0;
+
 	return RF_SUCCESS;
 }
 
@@ -455,45 +534,56 @@ extern json_t *rf_get_standard_msg_reg_json()
 
 int msg_reg_get_msg_format(char *msg_fmt, int len, int msg_sn)
 {
-	struct mr_message *pmsg		= NULL;
-	int index					= 0;
-	va_list args;
-	int ret;
+	struct mr_entry *entry;
 
 	if (!g_mr)
 		return RF_NOT_INIT;
 
-	pmsg = g_mr->msg_header;
-	while (pmsg) {
-		if (msg_sn == pmsg->msg_sn) {
-			strncpy_safe(msg_fmt, pmsg->msg, len, len - 1);
-			break;
-		}
-		pmsg = pmsg->pnext;
-	}
-	if (!pmsg)
+	entry = mr_get(msg_sn);
+	if (entry == NULL)
 		return RF_NOT_FOUND;
 
-	for (index = 0; index < 2; index++)
-		str_replace(msg_fmt, len, rf_evt_params_convet_map[index].src, rf_evt_params_convet_map[index].rep);
-
+	strncpy_safe(msg_fmt, entry->fmt, len, len - 1);
 	return RF_SUCCESS;
 }
 
 int msg_reg_get_msg_str(char *msg, int msg_sn, char *arg_data)
 {
+	const char *args[MAX_PARAM_TYPES];
+	int lens[MAX_PARAM_TYPES];
+	struct mr_entry *entry;
+	struct mr_part *part;
+	int count;
+	int copy;
+	int len = 0;
+	int i;
+
 	if (!g_mr)
 		return RF_NOT_INIT;
 
-	int ret = 0;
-	char *args[10];
-	int count = get_args_count(arg_data, args);
-	char msg_fmt[512] = {0};
+	entry = mr_get(msg_sn);
+	if (entry == NULL)
+		return RF_NOT_FOUND;
+
+	count = split_args(arg_data, args, lens);
+	for (i = 0; i < entry->part_num; i++) {
+		part = &entry->parts[i];
+
+		copy = part->lit_len;
+		if (copy > RF_MSG_MAX_LEN - 1 - len)
+			copy = RF_MSG_MAX_LEN - 1 - len;
+		memcpy(msg + len, entry->text + part->lit_off, copy);
+		len += copy;
 
-	ret = msg_reg_get_msg_format(msg_fmt, sizeof(msg_fmt), msg_sn);
-	if (ret)
-		return ret;
-	parse_msg(msg, msg_fmt, args, count);
+		if (part->arg < 0 || part->arg >= count)
+			continue;
+		copy = lens[part->arg];
+		if (copy > RF_MSG_MAX_LEN - 1 - len)
+			copy = RF_MSG_MAX_LEN - 1 - len;
+		memcpy(msg + len, args[part->arg], copy);
+		len += copy;
+	}
+	msg[len] = '\0';
 
 	return RF_SUCCESS;
 }
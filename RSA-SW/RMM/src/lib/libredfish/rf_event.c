@@ -26,6 +26,8 @@
 extern const char *__progname;
 
 static int redfish_fd	= -1;
+static unsigned int redfish_host;
+static int redfish_port;
 static int snmp_subagentd_fd = -1;
 
 int rf_connect(unsigned int host, int port)
@@ -34,6 +36,8 @@ int rf_connect(unsigned int host, int port)
 	if (redfish_fd < 0) {
 		return -1;
 	}
+	redfish_host = host;
+	redfish_port = port;
 
 	msg_reg_init(NULL);
 
@@ -67,46 +71,47 @@ static int _msg_sent(int fd, const char *func_name, int level, int is_evt, int m
 	return socket_send(fd,	&req_info, sizeof(struct rf_log_req_info));
 }
 
+#define RF_LOG_GET_TIMEOUT_MS	2000
+
+/*
+ * Logs are read over a TCP connection to the redfishd port, the reply is
+ * the descriptor followed by the records. <data> holds at most
+ * MAX_RF_EVT_MSG_LOG_COUNT records.
+ */
 int rf_log_get_by_limit(int count, struct rf_log_desc *desc_rsp, char *data)
 {
 	int rc = -1;
-	int val;
-	int index = 0;
-	int msg_length = 0;
+	int fd;
 	struct rf_log_req_info req_info;
 
+	if (count > MAX_RF_EVT_MSG_LOG_COUNT)
+		count = MAX_RF_EVT_MSG_LOG_COUNT;
+
+	memset(desc_rsp, 0, sizeof(struct rf_log_desc));
+	memset(&req_info, 0, sizeof(struct rf_log_req_info));
 	req_info.type = RF_GET_LOG_BY_LIMIT;
 	req_info.data.fmt2.count = count;
-	val = fcntl(redfish_fd, F_GETFL, 0);
-	if (fcntl(redfish_fd, F_SETFL, val & ~O_NONBLOCK) < 0)
+
+	fd = tcp_connect(redfish_host, redfish_port, RF_LOG_GET_TIMEOUT_MS);
+	if (fd < 0)
 		return -1;
 
-	rc = send(redfish_fd, &req_info, sizeof(struct rf_log_req_info), 0);
-	if (rc < 0)
+	if (socket_send(fd, &req_info, sizeof(struct rf_log_req_info)) < 0)
 		goto expt_end;
 
-	usleep(10);
-	rc = socket_recv(redfish_fd, desc_rsp, sizeof(struct rf_log_desc));
-	if (rc <= 0) {
+	if (socket_recv(fd, desc_rsp, sizeof(struct rf_log_desc)) != sizeof(struct rf_log_desc))
+		goto expt_end;
+
+	if (desc_rsp->length < 0 || desc_rsp->length > count * RF_MSG_MAX_LEN ||
+		socket_recv(fd, data, desc_rsp->length) != desc_rsp->length) {
+		desc_rsp->count = 0;
+		desc_rsp->length = 0;
 		goto expt_end;
-	}
-	printf("info length: %d", desc_rsp->length);
-	if (desc_rsp->length) {
-		while (index * BUF_SIZE < desc_rsp->length) {
-			if ((index  + 1) * BUF_SIZE > desc_rsp->length)
-				msg_length = desc_rsp->length - index * BUF_SIZE;
-			else
-				msg_length = BUF_SIZE;
-			rc = socket_recv(redfish_fd, data + index * BUF_SIZE, msg_length);
-			if (rc <= 0) {
-				goto expt_end;
-			}
-			index++;
-		}
 	}
 	rc = 0;
+
 expt_end:
-	fcntl(redfish_fd, F_SETFL, val & O_NONBLOCK);
+	close(fd);
 	return rc;
 }
 
@@ -387,6 +387,32 @@ int rmm_cfg_get_vm_root_password(char *password, int max_len, int vm_idx)
 	return 0;
 }
 
+int rmm_cfg_get_cooling_curve(int *temp_min, int *temp_max, int *pwm_min, int *pwm_max)
+{
+	char *attrs[4] = {ATTR_COOLING_TEMP_MIN, ATTR_COOLING_TEMP_MAX, ATTR_COOLING_PWM_MIN, ATTR_COOLING_PWM_MAX};
+	int *values[4] = {temp_min, temp_max, pwm_min, pwm_max};
+	json_t *jattr;
+	int i;
+
+	json_t *conf = load_rmm_cfg();
+	if (conf == 0) {
+		printf("Load rmm config file fail...\n");
+		return -1;
+	}
+
+	for (i = 0; i < 4; i++) {
+		jattr = get_json_attr(conf, PROC_COOLING_CTRL, attrs[i]);
+		if (jattr == NULL) {
+			json_free(conf);
+			return -1;
+		}
+		*values[i] = json_integer_value(jattr);
+	}
+
+	json_free(conf);
+	return 0;
+}
+
 int rmm_cfg_get_platform(char *platform)
 {
 	return get_str_attr(PROC_RMM, ATTR_RACK_PLATFORM, platform, sizeof(platform));
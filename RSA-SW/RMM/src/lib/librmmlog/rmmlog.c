@@ -17,53 +17,180 @@
 #include <stdlib.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "libutils/sock.h"
 #include "libutils/string.h"
 #include "librmmlog/rmmlog.h"
+#include "librmmlog/shm.h"
 #include "libutils/log_level.h"
 #include "libutils/sock.h"
 #include "librmmcfg/rmm_cfg.h"
 
 #define _GNU_SOURCE
 
+#define RMMLOG_FLUSH_INTERVAL_MS	100
+
 static int rmm_logd_fd = -1;	/* used for sending log to rmmlog daemon. */
 
-static int send_rmm_log(const char *module_name, int level, const char *func, char *msg)
+/*
+ * Level of this module, read from the rmmlogd shared memory. Until it is
+ * mapped all levels are sent and rmmlogd filters them.
+ */
+static int32 default_level = LEVEL_MAX;
+volatile int32 *rmm_log_level = &default_level;
+
+static char module_name[EVT_MODULE_LEN];
+static struct rmmlog_shm_hdr *shm;
+static struct rmmlog_shm_module *shm_module;
+
+/*
+ * Records are batched into one datagram, sent when it is full, every
+ * RMMLOG_FLUSH_INTERVAL_MS and at exit. Errors are sent at once.
+ */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static char batch_buf[EVT_BATCH_SIZE];
+static int batch_len = sizeof(struct log_batch);
+static int batch_count;
+
+/* Called with batch_lock held */
+static void shm_map(void)
 {
-	struct log_evt evt;
+	struct rmmlog_shm_hdr *hdr;
+	int fd;
 
-	if (rmm_logd_fd < 0)
-		exit(0);
-	evt.type = EVT_WRITE_LOG;
-	evt.level = level;
-	strncpy_safe(evt.module_name, module_name, EVT_MODULE_LEN, EVT_MODULE_LEN - 1);
-	strncpy_safe(evt.fn_name, func, EVT_FN_LEN, EVT_FN_LEN - 1);
-	strncpy_safe(evt.msg, msg, EVT_MSG_LEN, EVT_MSG_LEN - 1);
-	return socket_send(rmm_logd_fd, &evt, sizeof(struct log_evt));
+	if (shm && shm->valid)
+		return;
+
+	/*
+	 * rmmlogd replaced the segment. The old one stays mapped, other threads
+	 * may still be reading the level from it.
+	 */
+	if (shm) {
+		rmm_log_level = &default_level;
+		shm_module = NULL;
+		shm = NULL;
+	}
+
+	fd = shm_open(RMMLOG_SHM_NAME, O_RDWR, 0);
+	if (fd < 0)
+		return;
+
+	hdr = mmap(NULL, sizeof(struct rmmlog_shm_hdr), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED)
+		return;
+
+	if (hdr->magic != RMMLOG_SHM_MAGIC || hdr->version != RMMLOG_SHM_VERSION || !hdr->valid) {
+		munmap(hdr, sizeof(struct rmmlog_shm_hdr));
+		return;
+	}
+
+	shm = hdr;
+	shm_module = rmmlog_shm_find(shm, module_name);
+	if (shm_module)
+		rmm_log_level = &shm_module->level;
+}
+
+/* Called with batch_lock held */
+static void batch_flush(void)
+{
+	struct log_batch *batch = (struct log_batch *)batch_buf;
+
+	if (batch_count == 0)
+		return;
+
+	batch->type = EVT_WRITE_LOG_BATCH;
+	batch->count = batch_count;
+	strncpy_safe(batch->module_name, module_name, EVT_MODULE_LEN, EVT_MODULE_LEN - 1);
+
+	if (socket_send(rmm_logd_fd, batch_buf, batch_len) < 0) {
+		if (shm_module)
+			__sync_fetch_and_add(&shm_module->dropped, batch_count);
+	} else {
+		if (shm_module)
+			__sync_fetch_and_add(&shm_module->sent, batch_count);
+	}
+
+	batch_len = sizeof(struct log_batch);
+	batch_count = 0;
+}
+
+static void *flush_thread(void *arg)
+{
+	for (;;) {
+		usleep(RMMLOG_FLUSH_INTERVAL_MS * 1000);
+
+		pthread_mutex_lock(&batch_lock);
+		batch_flush();
+		shm_map();
+		pthread_mutex_unlock(&batch_lock);
+	}
+
+	return NULL;
+}
+
+static void flush_at_exit(void)
+{
+	pthread_mutex_lock(&batch_lock);
+	batch_flush();
+	pthread_mutex_unlock(&batch_lock);
 }
 
 int rmm_log_request(int level, const char *func, const char *fmt, ...)
 {
-	char module_name[32];
 	va_list args;
-	char msg[EVT_MSG_LEN] = {0};
+	char msg[EVT_MSG_LEN];
+	struct log_rec rec;
+	char *p;
+	int fn_len;
+	int msg_len;
 
-	memset(module_name, 0, 32);
-	prctl(PR_GET_NAME, (unsigned long)module_name);
+	if (rmm_logd_fd < 0)
+		exit(0);
 
 	va_start(args, fmt);
-	vsnprintf(msg, sizeof(msg), fmt, args);
+	msg_len = vsnprintf(msg, sizeof(msg), fmt, args);
 	va_end(args);
+	if (msg_len < 0)
+		return -1;
+	if (msg_len > EVT_MSG_LEN - 1)
+		msg_len = EVT_MSG_LEN - 1;
+	msg_len++;
+	fn_len = strnlen(func, EVT_FN_LEN - 1) + 1;
+
+	rec.level = level;
+	rec.fn_len = fn_len;
+	rec.msg_len = msg_len;
+
+	pthread_mutex_lock(&batch_lock);
+	if (batch_len + sizeof(rec) + fn_len + msg_len > EVT_BATCH_SIZE)
+		batch_flush();
 
-	return send_rmm_log(module_name, level, func, msg);
+	p = batch_buf + batch_len;
+	memcpy(p, &rec, sizeof(rec));
+	p += sizeof(rec);
+	memcpy(p, func, fn_len - 1);
+	p[fn_len - 1] = '\0';
+	p += fn_len;
+	memcpy(p, msg, msg_len);
+	batch_len += sizeof(rec) + fn_len + msg_len;
+	batch_count++;
+
+	if (level <= ERROR)
+		batch_flush();
+	pthread_mutex_unlock(&batch_lock);
+
+	return 0;
 }
 
 int rmm_log_init(void)
 {
 	int rmm_logd_port = 0;
+	pthread_t tid;
 
 	rmm_logd_port = rmm_cfg_get_port(LOGD_PORT);
 	if (rmm_logd_port == 0) {
@@ -76,5 +203,16 @@ int rmm_log_init(void)
 		fprintf(stderr, "%s failed to connect rmmlog daemon.", __progname);
 		return -1;
 	}
+
+	prctl(PR_GET_NAME, (unsigned long)module_name);
+
+	pthread_mutex_lock(&batch_lock);
+	shm_map();
+	pthread_mutex_unlock(&batch_lock);
+
+	if (pthread_create(&tid, NULL, flush_thread, NULL) == 0)
+		pthread_detach(tid);
+	atexit(flush_at_exit);
+
 	return 0;
 }
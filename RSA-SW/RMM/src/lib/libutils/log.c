@@ -16,55 +16,11 @@
 #include <limits.h>
 #include <math.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include "libutils/types.h"
 #include "libutils/log.h"
 #include "libutils/string.h"
 
-static int get_seqid(const char *data, int max_len)
-{
-	int ret = 0;
-	char ch_id[256] = {0};
-	int len = (max_len < 256 ? max_len : 256 - 1);
-	strncpy_safe(ch_id, data, sizeof(ch_id), len);
-	char* temp = strtok(ch_id, " ");
-
-	if (temp)
-		ret = (int)strtol(temp, NULL, 10);
-	else 
-		ret = 0;
-
-	return ret;
-}
-
-static int get_last_line(const char *file_path, char *line)
-{
-	FILE *fd;
-	int ret;
-
-	if ((fd = fopen(file_path, "r")) != NULL) // open file
-	{
-		fseek(fd, 0, SEEK_SET); // make sure start from 0
-
-		while(!feof(fd))
-		{
-			memset(line, 0x00, 256); // clean buffer
-			ret = fscanf(fd, "%255[^\n]\n", line); // read file *prefer using fscanf
-			if(ret == -1)
-				continue;
-		}
-		printf("Last Line :: %s\n", line);
-	}
-	return 0;
-}
-
-static int get_log_last_index(const char *file_path)
-{
-	char last_line[256] = {0};
-	/*Get the last index of current log file*/
-	get_last_line(file_path, last_line);
-	return get_seqid(last_line, 256 - 1);
-}
-
 static char *get_severity_by_level(const int level)
 {
 	if(level < LEVEL_MAX)
@@ -92,142 +48,205 @@ static void get_time_stamp(char* out)
 	return;
 }
 
-static void log_init_handler(struct loginfo *phandler)
+static char *ring_record(struct log_ring *ring, unsigned int seq)
 {
-	char path[128];
+	return ring->records + (size_t)((seq - 1) % ring->record_num) * LOG_RECORD_SIZE;
+}
 
-	assert(phandler->module);
-	snprintf(path, sizeof(path), "/var/log/%s", phandler->module);
-	if (access(path, F_OK) != 0) {
-		if (mkdir(path, 0755) == -1) {
-			fprintf(stderr, "Failed to create log directory\n");
-			exit(-1);
-		}
+static void ring_unmap(struct log_ring *ring)
+{
+	munmap(ring, LOG_RING_SIZE(ring->record_num));
+}
+
+/* Map an existing ring, NULL if there is none or it is not valid. */
+static struct log_ring *ring_open(const char *path)
+{
+	struct log_ring *ring;
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDWR);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct log_ring)) {
+		close(fd);
+		return NULL;
 	}
 
-	phandler->fd = open(phandler->logfile_curr, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR
-				  | S_IRGRP | S_IWGRP | S_IROTH);
-	assert(phandler->fd != -1);
+	ring = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED)
+		return NULL;
+
+	if (ring->magic != LOG_RING_MAGIC || ring->version != LOG_RING_VERSION ||
+		ring->record_size != LOG_RECORD_SIZE || ring->record_num == 0 ||
+		st.st_size != (off_t)LOG_RING_SIZE(ring->record_num)) {
+		munmap(ring, st.st_size);
+		return NULL;
+	}
 
-	phandler->curr_index = get_log_last_index(phandler->logfile_curr);
+	return ring;
 }
 
-static void reversal_file(struct loginfo *phander)
+static struct log_ring *ring_create(const char *path, unsigned int num)
 {
-	close(phander->fd);
-	
-	if (access(phander->logfile_old,F_OK) != 0) {
-		rename(phander->logfile_curr, phander->logfile_old);
-		phander->fd = open(phander->logfile_curr, O_WRONLY | O_CREAT| O_TRUNC, S_IRUSR | S_IWUSR
-				  | S_IRGRP | S_IWGRP | S_IROTH);
-		assert(phander->fd != -1);
-	}
-	else {
-		rename(phander->logfile_curr, phander->logfile_tmp);
-		rename(phander->logfile_old, phander->logfile_curr);
-		rename(phander->logfile_tmp, phander->logfile_old);
-		phander->fd = open(phander->logfile_curr, O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR
+	struct log_ring *ring;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR
 				  | S_IRGRP | S_IWGRP | S_IROTH);
-		assert(phander->fd != -1);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, LOG_RING_SIZE(num)) < 0) {
+		close(fd);
+		return NULL;
 	}
+
+	ring = mmap(NULL, LOG_RING_SIZE(num), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED)
+		return NULL;
+
+	ring->magic = LOG_RING_MAGIC;
+	ring->version = LOG_RING_VERSION;
+	ring->record_size = LOG_RECORD_SIZE;
+	ring->record_num = num;
+	ring->head = 0;
+
+	return ring;
 }
 
-static int get_log_from_file(int beg_line, char *path, char *data)
+/*
+ * Map the ring of the module. If max lines changed since the ring was
+ * created, the newest lines are moved to a ring of the new size.
+ */
+static int log_map(struct loginfo *phandler)
 {
-	int read_lines_count = 0;
-	FILE *pfile;
-	char *line = NULL;
-	size_t len = 0;
-	int index = 0;
-	int read = 0;
-
-	pfile = fopen(path, "r");
-	if(!pfile) {
-		read_lines_count = 0;
-		goto expt_end;
+	struct log_ring *old;
+	struct log_ring *ring;
+	unsigned int num;
+	unsigned int keep;
+	unsigned int seq;
+
+	num = phandler->max_lines > 0 ? phandler->max_lines : LOG_DEFAULT_MAX_LINES;
+
+	old = ring_open(phandler->logfile);
+	if (old && old->record_num == num) {
+		phandler->ring = old;
+		return 0;
+	}
+
+	ring = ring_create(phandler->logfile_tmp, num);
+	if (ring == NULL) {
+		fprintf(stderr, "Failed to create log ring for %s\n", phandler->module);
+		if (old)
+			ring_unmap(old);
+		return -1;
 	}
-	while ((read = getline(&line, &len, pfile)) != -1) {
-		if(index >= beg_line)
-			memcpy(data + (index - beg_line) * 256, line, strlen(line));
-		index++;
+
+	if (old) {
+		keep = old->head;
+		if (keep > old->record_num)
+			keep = old->record_num;
+		if (keep > num)
+			keep = num;
+		for (seq = old->head - keep + 1; seq <= old->head && keep; seq++)
+			memcpy(ring_record(ring, seq), ring_record(old, seq), LOG_RECORD_SIZE);
+		ring->head = old->head;
+		ring_unmap(old);
 	}
-	read_lines_count = index - beg_line;
-	if (read_lines_count <=0)
-		read_lines_count = 0;
-
-expt_end:
-	if(pfile)
-		fclose(pfile);
-	return read_lines_count;
+
+	rename(phandler->logfile_tmp, phandler->logfile);
+	phandler->ring = ring;
+	return 0;
 }
 
 void log_put(long handler, const int level, const char *func, const char *msg)
 {
-	va_list args;
 	char time_stamp[MAX_PATH_SIZE];
 	char *serverity;
-	char buf[MAX_LOG_MSG_SIZE] = {0};
+	char *record;
+	unsigned int seq;
 	int len = 0;
 
 	struct loginfo *phandler = (struct loginfo *)handler;
 	if(level > phandler->level)
 		return;
 
+	if (phandler->ring == NULL && log_map(phandler) < 0)
+		return;
+
 	get_time_stamp(time_stamp);
 	serverity = get_severity_by_level(level);
 
-	phandler->curr_index++;
-	len = snprintf(buf, MAX_LOG_MSG_SIZE, "%010d %s[%s] %s: %s", phandler->curr_index, time_stamp, serverity, func, msg);
-	len = write(phandler->fd, buf, len);
-	if(len == -1)
+	seq = phandler->ring->head + 1;
+	record = ring_record(phandler->ring, seq);
+	len = snprintf(record, LOG_RECORD_SIZE, "%010u %s[%s] %s: %s", seq, time_stamp, serverity, func, msg);
+	if (len < 0)
 		return;
-	if (phandler->curr_index >= phandler->max_lines) {
-		reversal_file(phandler);
-		phandler->curr_index = 0;
-	}
+	if (len >= LOG_RECORD_SIZE)
+		record[LOG_RECORD_SIZE - 2] = '\n';
+	else
+		memset(record + len, 0, LOG_RECORD_SIZE - len);
+
+	__sync_synchronize();
+	phandler->ring->head = seq;
 }
 
 int log_get(long handler, int last_count, char *data)
 {
-	int beg = 0;
-	int old_beg = 0;
-	int old_end = 0;
-	int is_in_old_file = 0;
-	int read_lines_count = 0;
-	int temp = 0;
 	struct loginfo* phandler = (struct loginfo*)handler;
-	
-	if (phandler->curr_index >= last_count) {
-		beg = phandler->curr_index - last_count;
-	} else {
-		old_end = get_log_last_index(phandler->logfile_old);
-		old_beg = old_end + last_count - phandler->curr_index;
-		if (old_beg < 0)
-			old_beg = 0;
-		is_in_old_file = 1;
-	}
+	struct log_ring *ring;
+	unsigned int head;
+	unsigned int count;
+	unsigned int i;
 
-	if (is_in_old_file) {
-		read_lines_count = get_log_from_file(old_beg, phandler->logfile_old, data);
-	}
+	if (last_count <= 0)
+		return 0;
 
-	temp = get_log_from_file(beg, phandler->logfile_curr, data + read_lines_count * 256);
-	return read_lines_count + temp;
+	if (phandler->ring == NULL && log_map(phandler) < 0)
+		return 0;
+
+	ring = phandler->ring;
+	head = ring->head;
+	count = last_count;
+	if (count > head)
+		count = head;
+	if (count > ring->record_num)
+		count = ring->record_num;
+
+	for (i = 0; i < count; i++)
+		memcpy(data + i * LOG_RECORD_SIZE, ring_record(ring, head - count + 1 + i), LOG_RECORD_SIZE);
+
+	return count;
 }
 
 static void set_path_by_module_name(struct loginfo *phandler, const char *module_name)
 {
-	snprintf(phandler->logfile_curr, MAX_PATH_SIZE, "/var/log/%s/logfile", module_name);
-	snprintf(phandler->logfile_tmp, MAX_PATH_SIZE, "/var/log/%s/logfile_tmp", module_name);
-	snprintf(phandler->logfile_old, MAX_PATH_SIZE, "/var/log/%s/logfile_old", module_name);
+	snprintf(phandler->logfile, MAX_PATH_SIZE, "/var/log/%s/logring", module_name);
+	snprintf(phandler->logfile_tmp, MAX_PATH_SIZE, "/var/log/%s/logring_tmp", module_name);
 }
 
 long log_init(const char *module_name)
 {
+	char path[128];
 	struct loginfo* phandler = (struct loginfo*)malloc(sizeof(struct loginfo));
+
+	assert(phandler);
+	memset(phandler, 0, sizeof(struct loginfo));
 	set_path_by_module_name(phandler, module_name);
 	strncpy_safe(phandler->module, module_name, MAX_PATH_SIZE, MAX_PATH_SIZE - 1);
-	log_init_handler(phandler);
+
+	snprintf(path, sizeof(path), "/var/log/%s", phandler->module);
+	if (access(path, F_OK) != 0) {
+		if (mkdir(path, 0755) == -1) {
+			fprintf(stderr, "Failed to create log directory\n");
+			exit(-1);
+		}
+	}
+
 	return (long)phandler;
 }
 
@@ -243,10 +262,18 @@ void log_set_max_lines(long handler, int max_lines)
 	struct loginfo* phandler = (struct loginfo*)handler;
 	phandler->max_lines= max_lines;
 	printf("%s[%s]%s:max_num=%d\n", COLOR_LIGHT_CYAN, phandler->module, COLOR_NONE, phandler->max_lines);
+
+	/* resized on next use */
+	if (phandler->ring && phandler->ring->record_num != (unsigned int)max_lines) {
+		ring_unmap(phandler->ring);
+		phandler->ring = NULL;
+	}
 }
 
 void log_close(long handler)
 {
 	struct loginfo* phandler = (struct loginfo*)handler;
+	if (phandler->ring)
+		ring_unmap(phandler->ring);
 	free(phandler);
 }
@@ -138,6 +138,82 @@ err:
 	return -1;
 }
 
+int create_tcp_listen(unsigned int host, int port, int backlog)
+{
+	int fd;
+	int val;
+	struct sockaddr_in addr;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		rmm_log(ERROR, "socket failed: %s\n", strerror(errno));
+		return -1;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	val = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void*)&val, sizeof(val));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(host == INADDR_LOOPBACK)
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	else
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		rmm_log(ERROR, "Failed to bind: %s\n", strerror(errno));
+		goto err;
+	}
+
+	if (listen(fd, backlog) < 0) {
+		rmm_log(ERROR, "Failed to listen: %s\n", strerror(errno));
+		goto err;
+	}
+
+	return fd;
+
+err:
+	close(fd);
+	return -1;
+}
+
+int tcp_connect(unsigned int host, int port, int timeout_ms)
+{
+	int fd;
+	struct sockaddr_in addr;
+	struct timeval tv;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		rmm_log(ERROR, "socket failed: %s\n", strerror(errno));
+		return -1;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(host == INADDR_LOOPBACK)
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	else
+		addr.sin_addr.s_addr = htonl(host);
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		rmm_log(ERROR, "connect fail: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
 int udp_create(void)
 {
 	int fd, val;
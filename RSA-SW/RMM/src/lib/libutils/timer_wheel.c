@@ -0,0 +1,121 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+
+#include "libutils/timer_wheel.h"
+
+static void wheel_place(struct timer_wheel *wheel, struct wheel_timer *timer)
+{
+	unsigned long long expires = timer->expires;
+	unsigned long long delta;
+	int level;
+
+	if (expires < wheel->now)
+		expires = wheel->now;
+	delta = expires - wheel->now;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+			break;
+	}
+
+	/* beyond the top level, expire at its end and be placed again then */
+	if (delta >= (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+		expires = wheel->now + (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+		level = TIMER_WHEEL_LEVELS - 1;
+	}
+
+	list_add_tail(&timer->list,
+				  &wheel->slots[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK]);
+}
+
+/* move the timers of the upper level slot due now to the levels below */
+static int wheel_cascade(struct timer_wheel *wheel, int level)
+{
+	struct wheel_timer *timer, *next;
+	int index;
+
+	index = (wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+
+	/* they all land in lower levels, never in this slot again */
+	list_for_each_entry_safe(timer, next, &wheel->slots[level][index], list) {
+		list_del(&timer->list);
+		wheel_place(wheel, timer);
+	}
+
+	return index;
+}
+
+void timer_wheel_init(struct timer_wheel *wheel, unsigned long long now)
+{
+	int i, j;
+
+	wheel->now = now;
+	for (i = 0; i < TIMER_WHEEL_LEVELS; i++)
+		for (j = 0; j < TIMER_WHEEL_SIZE; j++)
+			INIT_LIST_HEAD(&wheel->slots[i][j]);
+}
+
+void wheel_timer_init(struct wheel_timer *timer, void (*handle_timer)(struct wheel_timer *))
+{
+	INIT_LIST_HEAD(&timer->list);
+	timer->expires = 0;
+	timer->handle_timer = handle_timer;
+}
+
+void wheel_timer_add(struct timer_wheel *wheel, struct wheel_timer *timer, unsigned int ticks)
+{
+	if (wheel_timer_pending(timer))
+		list_del(&timer->list);
+
+	timer->expires = wheel->now + (ticks ? ticks : 1);
+	wheel_place(wheel, timer);
+}
+
+void wheel_timer_del(struct wheel_timer *timer)
+{
+	if (wheel_timer_pending(timer)) {
+		list_del(&timer->list);
+		INIT_LIST_HEAD(&timer->list);
+	}
+}
+
+void timer_wheel_run(struct timer_wheel *wheel, unsigned long long now)
+{
+	struct list_head *slot;
+	struct wheel_timer *timer;
+	int level;
+
+	while (wheel->now <= now) {
+		slot = &wheel->slots[0][wheel->now & TIMER_WHEEL_MASK];
+
+		for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+			if (((wheel->now >> (TIMER_WHEEL_BITS * (level - 1))) & TIMER_WHEEL_MASK) != 0)
+				break;
+			if (wheel_cascade(wheel, level) != 0)
+				break;
+		}
+
+		while (!list_empty(slot)) {
+			timer = list_entry(slot->next, struct wheel_timer, list);
+			list_del(&timer->list);
+			INIT_LIST_HEAD(&timer->list);
+			timer->handle_timer(timer);
+		}
+
+		wheel->now++;
+	}
+}
@@ -56,7 +56,7 @@
 #include "libutils/types.h"
 #include "libassetmodule/am_action.h"
 
-#include "am_api.h"
+#include "libwrap/am_api.h"
 
 wrap_msg_t wrap_ipmi_msg;
 static pthread_mutex_t wrap_mutex[MAX_REQ_PROCESS];
@@ -371,33 +371,125 @@ static int get_db_info_string(unsigned char db_name, memdb_integer node_id, char
 }
 
 
-static int get_base_element(base_element_t* be, unsigned char db_name, memdb_integer node_id)
+/*
+ * Attributes read from memdb with a single request. Lookups of attributes
+ * that are not in the set fall back to separate requests, unless the set
+ * is known to be complete.
+ */
+struct db_attrs {
+	unsigned char db_name;
+	void *buf;
+	int size;
+	int complete;
+};
+
+static void db_attrs_load(struct db_attrs *attrs, unsigned char db_name, memdb_integer node_id)
+{
+	int truncated = 0;
+
+	attrs->db_name = db_name;
+	attrs->buf = libdb_attrs_get_by_node(db_name, node_id, 0, &attrs->size, &truncated, LOCK_ID_NULL);
+	attrs->complete = (attrs->buf != NULL && !truncated);
+}
+
+static void db_attrs_load_nodes(struct db_attrs *attrs, unsigned char db_name,
+								memdb_integer *nodes, int node_num,
+								char **names, int name_num)
+{
+	int truncated = 0;
+
+	attrs->db_name = db_name;
+	attrs->buf = libdb_attrs_get(db_name, nodes, node_num, names, name_num,
+								 &attrs->size, &truncated, LOCK_ID_NULL);
+	attrs->complete = (attrs->buf != NULL && !truncated);
+}
+
+static void db_attrs_free(struct db_attrs *attrs)
+{
+	libdb_free_attrs(attrs->buf);
+	attrs->buf = NULL;
+	attrs->size = 0;
+	attrs->complete = 0;
+}
+
+static char *db_attrs_find(struct db_attrs *attrs, memdb_integer node_id, char *name)
+{
+	int offset;
+	struct attr_info *info;
+
+	if (attrs->buf == NULL)
+		return NULL;
+
+	foreach_attr_info(info, offset, attrs->buf, attrs->size) {
+		if (info->node == node_id && strcmp(attr_name(info), name) == 0)
+			return (char *)attr_data(info);
+	}
+
+	return NULL;
+}
+
+static int get_attrs_info_string(struct db_attrs *attrs, memdb_integer node_id, char* name, uint8* output, unsigned int len)
+{
+	char *result = db_attrs_find(attrs, node_id, name);
+	char *offset;
+
+	if (result == NULL) {
+		if (!attrs->complete)
+			return get_db_info_string(attrs->db_name, node_id, name, output, len);
+		return 0;
+	}
+
+	/* same limit as get_db_info_string */
+	if (strlen(result) >= 128)
+		return -1;
+
+	if(strstr(result, HARD_CODE_FLAG)) {
+		offset = result + (sizeof(HARD_CODE_FLAG)-1);
+	}
+	else {
+		offset = result;
+	}
+	memcpy((char*)output, offset, (strlen(offset)>len)?len:strlen(offset));
+
+	return 0;
+}
+
+static int get_attrs_info_num(struct db_attrs *attrs, memdb_integer node_id, char* name)
+{
+	char result[128] = {0};
+
+	get_attrs_info_string(attrs, node_id, name, (uint8 *)result, sizeof(result) - 1);
+
+	return atoi(result);
+}
+
+static int get_base_element(base_element_t* be, struct db_attrs *attrs, memdb_integer node_id)
 {
-	be->id = get_db_info_num(db_name, node_id, RACK_LOC_ID_STR);
+	be->id = get_attrs_info_num(attrs, node_id, RACK_LOC_ID_STR);
 
-	get_db_info_string(db_name, node_id, RACK_UUID_STR, be->uuid, UUID_LEN);
-	get_db_info_string(db_name, node_id, RACK_NAME_STR, be->name, RMM_NAME_LEN);
-	get_db_info_string(db_name, node_id, RACK_DESCRIPT_STR, be->desc, DESCRIPTION_LEN);
-	get_db_info_string(db_name, node_id, RACK_CREATE_DATE_STR, be->create_date, DATE_LEN);
-	get_db_info_string(db_name, node_id, RACK_UPDATE_DATE_STR, be->update_date, DATE_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_UUID_STR, be->uuid, UUID_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_NAME_STR, be->name, RMM_NAME_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_DESCRIPT_STR, be->desc, DESCRIPTION_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_CREATE_DATE_STR, be->create_date, DATE_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_UPDATE_DATE_STR, be->update_date, DATE_LEN);
 
 	return 0;
 }
 
 
-static int get_asset_info(unsigned char db_name, asset_info_t* asset, memdb_integer node_id)
+static int get_asset_info(struct db_attrs *attrs, asset_info_t* asset, memdb_integer node_id)
 {
-	get_db_info_string(db_name, node_id, RACK_SER_NUM_STR, asset->fru.serial_num, REST_RACK_STRING_LEN);
-	get_db_info_string(db_name, node_id, RACK_MANUFACT_STR, asset->fru.manufacture, REST_RACK_STRING_LEN);
-	get_db_info_string(db_name, node_id, RACK_MODEL_STR, asset->fru.model, REST_RACK_STRING_LEN);
-	get_db_info_string(db_name, node_id, RACK_PART_NUM_STR, asset->fru.part_num, REST_RACK_STRING_LEN);
-	get_db_info_string(db_name, node_id, RACK_FW_VER_STR, asset->fru.fw_ver, REST_RACK_STRING_LEN);
-	get_db_info_string(db_name, node_id, RACK_ASSET_TAG_STR, asset->asset_tag, REST_ASSET_TAG_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_SER_NUM_STR, asset->fru.serial_num, REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_MANUFACT_STR, asset->fru.manufacture, REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_MODEL_STR, asset->fru.model, REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_PART_NUM_STR, asset->fru.part_num, REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_FW_VER_STR, asset->fru.fw_ver, REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_ASSET_TAG_STR, asset->asset_tag, REST_ASSET_TAG_LEN);
 
 	return  0;
 }
 
-static int get_rack_availible_action(unsigned char db_name, avail_action_t* _action, memdb_integer node_id)
+static int get_rack_availible_action(struct db_attrs *attrs, avail_action_t* _action, memdb_integer node_id)
 {
 	char buff[RMM_NAME_LEN] = {0};
 	avail_action_t *action = _action;
@@ -406,13 +498,13 @@ static int get_rack_availible_action(unsigned char db_name, avail_action_t* _act
 	strncpy_safe((char*)action->cap[0].property, RMM_JSON_RESET_TYPE, RMM_NAME_LEN, RMM_NAME_LEN - 1);
 
 	memset(buff, 0, RMM_NAME_LEN);
-	get_db_info_string(db_name,node_id, RACK_AV_RST_1_STR, (uint8*)buff, RMM_NAME_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_AV_RST_1_STR, (uint8*)buff, RMM_NAME_LEN);
 	strncpy_safe((char*)action->cap[0].av, buff, RMM_NAME_LEN, RMM_NAME_LEN - 1);
 
 	strncpy_safe((char*)action->cap[1].property, RMM_JSON_RESET_TYPE, RMM_NAME_LEN, RMM_NAME_LEN - 1);
 
 	memset(buff, 0, RMM_NAME_LEN);
-	get_db_info_string(db_name,node_id, RACK_AV_RST_2_STR, (uint8*)buff, RMM_NAME_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_AV_RST_2_STR, (uint8*)buff, RMM_NAME_LEN);
 	strncpy_safe((char*)action->cap[1].av, buff, REST_RACK_STRING_LEN, RMM_NAME_LEN - 1);
 
 	action++;
@@ -426,13 +518,13 @@ static int get_rack_availible_action(unsigned char db_name, avail_action_t* _act
 	return 0;
 }
 
-static int get_rack_href(unsigned char db_name, href_t* href, memdb_integer node_id)
+static int get_rack_href(struct db_attrs *attrs, href_t* href, memdb_integer node_id)
 {
-	get_db_info_string(db_name,node_id, RACK_HREF_DRAWER_STR, (uint8*)(href->drawer), REST_RACK_STRING_LEN);
-	get_db_info_string(db_name,node_id, RACK_HREF_PZONE_STR, (uint8*)(href->powerzones), REST_RACK_STRING_LEN);
-	get_db_info_string(db_name,node_id, RACK_HREF_TZONE_STR, (uint8*)(href->thermalzones), REST_RACK_STRING_LEN);
-	get_db_info_string(db_name,node_id, RACK_HREF_EVENT_STR, (uint8*)(href->rf_event), REST_RACK_STRING_LEN);
-	get_db_info_string(db_name,node_id, RACK_HREF_MBP_STR, (uint8*)(href->mbps), REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_HREF_DRAWER_STR, (uint8*)(href->drawer), REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_HREF_PZONE_STR, (uint8*)(href->powerzones), REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_HREF_TZONE_STR, (uint8*)(href->thermalzones), REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_HREF_EVENT_STR, (uint8*)(href->rf_event), REST_RACK_STRING_LEN);
+	get_attrs_info_string(attrs, node_id, RACK_HREF_MBP_STR, (uint8*)(href->mbps), REST_RACK_STRING_LEN);
 	return 0;
 }
 
@@ -447,60 +539,125 @@ result_t libwrap_get_time(char* name, char* value)
 #endif
 
 
+/* Read loc_id and uuid of all @nodes with one request */
+static void load_node_ids(struct db_attrs *attrs, memdb_integer *nodes, int node_num)
+{
+	char *names[] = {WRAP_LOC_ID_STR, WRAP_UUID_STR};
+
+	db_attrs_load_nodes(attrs, DB_RMM, nodes, node_num, names, sizeof(names)/sizeof(names[0]));
+}
+
+/* Same as memdb_filter, for nodes loaded by load_node_ids */
+static int attrs_filter(struct db_attrs *attrs, memdb_integer node_id)
+{
+	char uuid[128] = {0};
+
+	if (get_attrs_info_string(attrs, node_id, WRAP_UUID_STR, (uint8 *)uuid, sizeof(uuid) - 1) != 0)
+		return 1;
+
+	return strlen(uuid) == 0;
+}
+
 static void get_mbp_pres(unsigned char *pres)
 {
-	memdb_integer cm_node_id;
+	struct node_info *subnode = NULL;
+	struct db_attrs attrs = {};
+	memdb_integer nodes[MAX_MBP_PRESENCE] = {0};
+	int subnode_num = 0;
+	int node_num = 0;
 	int i = 0;
+	int lid = 0;
 
-	for(i = 1; i <= MAX_MBP_PRESENCE; i++) {
-		cm_node_id = get_subnode_id_by_lid(i, MC_TYPE_RMC, MC_TYPE_CM);
-		if(cm_node_id != 0) {
-			pres[MAX_MBP_PRESENCE-i] = '1';
-		}
-		else {
-			pres[MAX_MBP_PRESENCE-i] = '0';
-		}
-	}
+	memset(pres, '0', MAX_MBP_PRESENCE);
 	pres[MAX_MBP_PRESENCE] = '\0';
+
+	subnode = libdb_list_subnode_by_type(DB_RMM, MC_TYPE_RMC, MC_TYPE_CM, &subnode_num, NULL, LOCK_ID_NULL);
+	if (subnode == NULL || subnode_num == 0)
+		return;
+
+	for (i = 0; i < subnode_num && node_num < MAX_MBP_PRESENCE; i++)
+		nodes[node_num++] = subnode[i].node_id;
+
+	load_node_ids(&attrs, nodes, node_num);
+	for (i = 0; i < node_num; i++) {
+		lid = get_attrs_info_num(&attrs, nodes[i], WRAP_LOC_ID_STR);
+		if (lid >= 1 && lid <= MAX_MBP_PRESENCE)
+			pres[MAX_MBP_PRESENCE-lid] = '1';
+	}
+	db_attrs_free(&attrs);
 }
 
 static int get_drawer_pres_from_cm(char *pres)
 {
-    struct node_info *subnode = NULL;
+	struct node_info *subnode = NULL;
+	struct node_info *dr_subnode = NULL;
+	struct db_attrs attrs = {};
+	memdb_integer *nodes = NULL;
+	memdb_integer *parents = NULL;
+	memdb_integer *tmp = NULL;
 	int subnode_num = 0;
-	int i,j;
-	int cm_lid = 0;
-	int drawer_pres = 0;;
-	int tmp = 0;
 	int dr_number = 0;
-	struct node_info *dr_subnode = NULL;
+	int node_num = 0;
+	int i, j;
+	int cm_lid = 0;
+	int drawer_pres = 0;
 	int dr_lid = 0;
-	memdb_integer dz_node_id = 0;
-	memdb_integer cm_node_id = 0;
 
-	subnode = libdb_list_node_by_type(MC_TYPE_RMC, MC_TYPE_DZONE, MC_TYPE_DZONE, &subnode_num, memdb_filter, LOCK_ID_NULL);
+	subnode = libdb_list_node_by_type(DB_RMM, MC_TYPE_DZONE, MC_TYPE_DZONE, &subnode_num, memdb_filter, LOCK_ID_NULL);
 
 	if (subnode_num == 0) {
 		libdb_free_node(subnode);
 		return RESULT_NO_NODE;
 	}
 
+	/*
+	 * Collect cm and drawer nodes of all drawer zones first, so their
+	 * attributes are read with one request. 'parents' keeps cm of drawers.
+	 */
 	for (i = 0; i < subnode_num; i++) {
-		dz_node_id = subnode[i].node_id;
-		cm_node_id = subnode[i].parent;
-		dr_subnode = libdb_list_subnode_by_type(DB_RMM, dz_node_id, MC_TYPE_DRAWER, &dr_number, &memdb_filter, LOCK_ID_NULL);
-		libdb_attr_get_int(DB_RMM, cm_node_id, MBP_LOC_ID_STR, &cm_lid, LOCK_ID_NULL);
+		dr_subnode = libdb_list_subnode_by_type(DB_RMM, subnode[i].node_id, MC_TYPE_DRAWER, &dr_number, NULL, LOCK_ID_NULL);
+		if (dr_subnode == NULL || dr_number == 0)
+			continue;
+
+		tmp = realloc(nodes, (node_num + dr_number + 1) * sizeof(memdb_integer));
+		if (tmp == NULL)
+			goto end;
+		nodes = tmp;
+
+		tmp = realloc(parents, (node_num + dr_number + 1) * sizeof(memdb_integer));
+		if (tmp == NULL)
+			goto end;
+		parents = tmp;
+
+		nodes[node_num] = subnode[i].parent;
+		parents[node_num++] = 0;
 		for (j = 0; j < dr_number; j++) {
-			dr_lid = get_db_info_num(DB_RMM, dr_subnode[j].node_id, WRAP_LOC_ID_STR);
-			drawer_pres = (1 << (dr_lid - 1 + ((cm_lid - 1) * 4)))|drawer_pres;
-			printf("cm[%d] dr_number[%d] dr_idx[%d] drawer_pres[%d]\n", cm_lid, dr_number, dr_lid, drawer_pres);
+			nodes[node_num] = dr_subnode[j].node_id;
+			parents[node_num++] = subnode[i].parent;
 		}
 	}
 
+	if (node_num == 0)
+		goto end;
+
+	load_node_ids(&attrs, nodes, node_num);
+	for (i = 0; i < node_num; i++) {
+		if (parents[i] == 0 || attrs_filter(&attrs, nodes[i]))
+			continue;
+
+		cm_lid = get_attrs_info_num(&attrs, parents[i], MBP_LOC_ID_STR);
+		dr_lid = get_attrs_info_num(&attrs, nodes[i], WRAP_LOC_ID_STR);
+		drawer_pres = (1 << (dr_lid - 1 + ((cm_lid - 1) * 4)))|drawer_pres;
+	}
+	db_attrs_free(&attrs);
+
 	for (i = 0; i < 8; i++) {
 		strncat(pres, ((0x80 == (0x80 & (drawer_pres << i)))? "1" : "0"), 1);		
 	}
 
+end:
+	free(nodes);
+	free(parents);
 	libdb_free_node(subnode);
 
 	return subnode_num;
@@ -508,31 +665,37 @@ static int get_drawer_pres_from_cm(char *pres)
 
 result_t libwrap_get_rack(rack_info_t *rack_info)
 {
-	get_base_element(&rack_info->be, DB_RMM, MC_TYPE_RMC);
+	struct db_attrs attrs = {};
+
+	db_attrs_load(&attrs, DB_RMM, MC_TYPE_RMC);
+
+	get_base_element(&rack_info->be, &attrs, MC_TYPE_RMC);
 
-	rack_info->rack_puid = get_db_info_num(DB_RMM, MC_TYPE_RMC,
-										   RACK_PUID_STR);
+	rack_info->rack_puid = get_attrs_info_num(&attrs, MC_TYPE_RMC,
+											  RACK_PUID_STR);
 
-	get_db_info_string(DB_RMM, MC_TYPE_RMC, RACK_GEOTAG_STR,
-					   rack_info->geo_tag, RACK_TAG_LEN);
-	get_db_info_string(DB_RMM, MC_TYPE_RMC, RACK_DCUID_STR,
-					   rack_info->rack_dcuid, DCUID_LEN);
-	get_db_info_string(DB_RMM, MC_TYPE_RMC, POD_DCUID_STR,
-					   rack_info->pod_dcuid, DCUID_LEN);
-	get_db_info_string(DB_RMM, MC_TYPE_RMC, RACK_API_VER_STR,
-					   rack_info->api_ver, VERSION_LEN);
-	get_db_info_string(DB_RMM, MC_TYPE_RMC, RACK_PODM_ADDR_STR,
-					   rack_info->podm_addr, REST_RACK_STRING_LEN);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_GEOTAG_STR,
+						  rack_info->geo_tag, RACK_TAG_LEN);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_DCUID_STR,
+						  rack_info->rack_dcuid, DCUID_LEN);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, POD_DCUID_STR,
+						  rack_info->pod_dcuid, DCUID_LEN);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_API_VER_STR,
+						  rack_info->api_ver, VERSION_LEN);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_PODM_ADDR_STR,
+						  rack_info->podm_addr, REST_RACK_STRING_LEN);
 
-	get_asset_info(DB_RMM, &rack_info->asset, MC_TYPE_RMC);
+	get_asset_info(&attrs, &rack_info->asset, MC_TYPE_RMC);
 
 	memset((char *)rack_info->drawer_pres, 0, MAX_DRAWER_PRESENCE + 1);
 	get_drawer_pres_from_cm((char *)rack_info->drawer_pres);
 	memset((char *)rack_info->mbp_pres, 0, MAX_MBP_PRESENCE + 1);
 	get_mbp_pres(rack_info->mbp_pres);
 
-	get_rack_availible_action(DB_RMM, rack_info->av_action, MC_TYPE_RMC);
-	get_rack_href(DB_RMM, &(rack_info->href), MC_TYPE_RMC);
+	get_rack_availible_action(&attrs, rack_info->av_action, MC_TYPE_RMC);
+	get_rack_href(&attrs, &(rack_info->href), MC_TYPE_RMC);
+
+	db_attrs_free(&attrs);
 
     #ifdef ODATA_ADD_ATTR
 	//get_db_info_string(DB_RMM, MC_TYPE_RMC, RACK_RMM_PRES, (uint8*)(rack_info->rmm_present), REST_RACK_STRING_LEN);
@@ -549,82 +712,41 @@ result_t libwrap_get_rack(rack_info_t *rack_info)
 result_t libwrap_pre_put_rack(put_rack_info_t *put_rack_info)
 {
 	char buff[32] = {0};
-	char output[32] = {0};
+	struct db_attrs attrs = {};
 
-	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, RACK_DESCRIPT_STR, output, sizeof(output), LOCK_ID_NULL);
-	strncpy_safe((char*)put_rack_info->descr, output, DESCRIPTION_LEN, DESCRIPTION_LEN - 1);
-	memset(output, 0, sizeof(output));
-	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, RACK_GEOTAG_STR, output, sizeof(output), LOCK_ID_NULL);
-	strncpy_safe((char*)put_rack_info->geo_tag, output, RACK_TAG_LEN, RACK_TAG_LEN - 1);
-	memset(output, 0, sizeof(output));
-	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, RACK_PODM_ADDR_STR, output, sizeof(output), LOCK_ID_NULL);
-	strncpy_safe((char*)put_rack_info->podm_addr, output, REST_RACK_STRING_LEN, REST_RACK_STRING_LEN - 1);
-	memset(output, 0, sizeof(output));
-	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, POD_DCUID_STR, output, sizeof(output), LOCK_ID_NULL);
-	strncpy_safe((char*)put_rack_info->pod_dcuid, output, DCUID_LEN, DCUID_LEN - 1);
-	memset(output, 0, sizeof(output));
-	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, RACK_ASSET_TAG_STR, output, sizeof(output), LOCK_ID_NULL);
-	strncpy_safe((char*)put_rack_info->asset_tag, output, REST_RACK_STRING_LEN, REST_RACK_STRING_LEN - 1);
-	memset(output, 0, sizeof(output));
-	libdb_attr_get_string(DB_RMM, MC_TYPE_RMC, RACK_PUID_STR, output, sizeof(output), LOCK_ID_NULL);
-	strncpy_safe(buff, output, sizeof(buff), sizeof(buff) - 1);
+	memset(put_rack_info, 0, sizeof(*put_rack_info));
+	db_attrs_load(&attrs, DB_RMM, MC_TYPE_RMC);
+
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_DESCRIPT_STR, put_rack_info->descr, DESCRIPTION_LEN - 1);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_GEOTAG_STR, put_rack_info->geo_tag, RACK_TAG_LEN - 1);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_PODM_ADDR_STR, put_rack_info->podm_addr, REST_RACK_STRING_LEN - 1);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, POD_DCUID_STR, put_rack_info->pod_dcuid, DCUID_LEN - 1);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_ASSET_TAG_STR, put_rack_info->asset_tag, REST_RACK_STRING_LEN - 1);
+	get_attrs_info_string(&attrs, MC_TYPE_RMC, RACK_PUID_STR, (uint8 *)buff, sizeof(buff) - 1);
 	put_rack_info->rack_puid = (int32)atoi(buff);
 
+	db_attrs_free(&attrs);
+
 	return RESULT_OK;
 }
 
 result_t libwrap_put_rack(const put_rack_info_t put_rack_info)
 {
 	char buff[32] = {0};
-	int rc = 0;
-
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_DESCRIPT_STR,
-						  0x0, (char*)put_rack_info.descr, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
-
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_GEOTAG_STR,
-						  0x0, (char*)put_rack_info.geo_tag, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
-
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_PODM_ADDR_STR,
-						  0x0, (char*)put_rack_info.podm_addr, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
-
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, POD_DCUID_STR,
-						  0x0, (char*)put_rack_info.pod_dcuid, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_ASSET_TAG_STR,
-						  0x0, (char*)put_rack_info.asset_tag, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
-
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_ASSET_TAG_STR,
-						  0x0, (char*)put_rack_info.asset_tag, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
+	struct attr_set_info attrs[] = {
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, RACK_DESCRIPT_STR, (char*)put_rack_info.descr},
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, RACK_GEOTAG_STR, (char*)put_rack_info.geo_tag},
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, RACK_PODM_ADDR_STR, (char*)put_rack_info.podm_addr},
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, POD_DCUID_STR, (char*)put_rack_info.pod_dcuid},
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, RACK_ASSET_TAG_STR, (char*)put_rack_info.asset_tag},
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, RACK_PUID_STR, buff},
+		{MC_TYPE_RMC, 0x0, SNAPSHOT_NEED, RACK_LOC_ID_STR, buff},
+	};
 
 	snprintf(buff, sizeof(buff), "%d", (int32)put_rack_info.rack_puid);
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_PUID_STR,
-						  0x0, buff, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
-		return RESULT_ATTR_ERR;
-	}
 
-	rc = libdb_attr_set_string(DB_RMM, MC_TYPE_RMC, RACK_LOC_ID_STR,
-						  0x0, buff, SNAPSHOT_NEED, LOCK_ID_NULL);
-	if (rc == -1) {
+	if (libdb_attrs_set(DB_RMM, attrs, sizeof(attrs)/sizeof(attrs[0]), LOCK_ID_NULL) == -1)
 		return RESULT_ATTR_ERR;
-	}
 
 	return RESULT_OK;
 }
@@ -2361,18 +2483,33 @@ memdb_integer get_subnode_id_by_lid(unsigned int lid, memdb_integer parent, int
 {
 	int i, loc_id = 0;
 	struct node_info *subnode = NULL;
+	struct db_attrs attrs = {};
+	memdb_integer *nodes = NULL;
+	memdb_integer node_id = 0;
 	int subnode_num = 0;
 
 	subnode = libdb_list_subnode_by_type(DB_RMM, parent, type, &subnode_num, NULL,LOCK_ID_NULL);
+	if (subnode == NULL || subnode_num == 0)
+		return 0;
+
+	nodes = malloc(subnode_num * sizeof(memdb_integer));
+	if (nodes == NULL)
+		return 0;
+	for (i = 0; i < subnode_num; i++)
+		nodes[i] = subnode[i].node_id;
 
+	load_node_ids(&attrs, nodes, subnode_num);
 	for (i = 0; i < subnode_num; i++) {
-		loc_id = get_db_info_num(DB_RMM, subnode[i].node_id, WRAP_LOC_ID_STR);
+		loc_id = get_attrs_info_num(&attrs, nodes[i], WRAP_LOC_ID_STR);
 		if (loc_id == lid) {
-			return subnode[i].node_id;
+			node_id = nodes[i];
+			break;
 		}
 	}
 
-	return 0;
+	db_attrs_free(&attrs);
+	free(nodes);
+	return node_id;
 }
 
 
@@ -13,60 +13,146 @@
  */
 
 
-#include <sys/time.h>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdint.h>
 #include <unistd.h>
 
 #include "ipmi.h"
 #include "event.h"
+#include "ipmi_log.h"
+
+#define FD_EVENTS_BATCH		32
+
+/** every fd_event is registered once, epoll data points back to it */
+static int epoll_fd = -1;
+static pthread_once_t epoll_once = PTHREAD_ONCE_INIT;
 
-/** socket fd list */
-static struct list_head fd_event_head = LIST_HEAD_INIT(fd_event_head);
+static void fd_events_init(void)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1)
+		FATAL("Failed to create epoll fd!\n");
+}
 
 /**
-  *  @brief add socket fd to the monitor socket fd list
+  *  @brief add socket fd to the monitored socket fds
   *
   *  @param[in] event include socket fd and handle routine
   */
 void fd_event_add(struct fd_event *event)
 {
-	list_add_tail(&event->list, &fd_event_head);
+	struct epoll_event ev;
+
+	pthread_once(&epoll_once, fd_events_init);
+
+	if (event->fd == -1)
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	if (event->flags & FD_EVENT_EDGE)
+		ev.events |= EPOLLET;
+	ev.data.ptr = event;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event->fd, &ev) == -1)
+		IPMI_LOG_ERR("Failed to monitor fd %d\n", event->fd);
+}
+
+/**
+  *  @brief replace the fd of an event, -1 stops monitoring it. A closed
+  *  fd has already left the epoll set, so the old fd may be closed before.
+  *
+  *  @param[in] event event added by fd_event_add
+  *  @param[in] fd new socket fd
+  */
+void fd_event_set_fd(struct fd_event *event, int fd)
+{
+	pthread_once(&epoll_once, fd_events_init);
+
+	if (event->fd != -1)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, event->fd, NULL);
+
+	event->fd = fd;
+	fd_event_add(event);
+}
+
+/**
+  *  @brief run handle_timer of the timer every period in the main loop
+  *
+  *  @param[in] timer timer with handle_timer set
+  *  @param[in] period_ms timer period
+  *  @return
+  *  @retval -1 failure
+  *  @retval 0 successful
+  */
+int timer_event_add(struct timer_event *timer, int period_ms)
+{
+	struct itimerspec its;
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd == -1)
+		return -1;
+
+	its.it_interval.tv_sec = period_ms / 1000;
+	its.it_interval.tv_nsec = (period_ms % 1000) * 1000 * 1000;
+	its.it_value = its.it_interval;
+	if (timerfd_settime(fd, 0, &its, NULL) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	timer->event.fd = fd;
+	timer->event.flags = FD_EVENT_TIMER;
+	timer->event.handle_fd = NULL;
+	fd_event_add(&timer->event);
+
+	return 0;
+}
+
+static void timer_event_run(struct timer_event *timer)
+{
+	uint64_t ticks;
+
+	if (read(timer->event.fd, &ticks, sizeof(ticks)) != sizeof(ticks))
+		return;
+
+	timer->handle_timer((unsigned int)ticks);
 }
 
 /**
-  *  @brief select and receive socket packets from every socket,
-  *  then call the corresponding handle routines.
+  *  @brief wait for the monitored fds and timers, then call the
+  *  corresponding handle routines.
   *
   *  @param
   *  @return
   */
 void fd_events_main_loop(void)
 {
-	int max_fd;
-	fd_set rfds;
+	struct epoll_event evs[FD_EVENTS_BATCH];
 	struct fd_event *event;
+	int i, n;
+
+	pthread_once(&epoll_once, fd_events_init);
 
 	while (!ipmi_module_exit) {
-		FD_ZERO(&rfds);
+		n = epoll_wait(epoll_fd, evs, FD_EVENTS_BATCH, -1);
 
-		max_fd = -1;
-		list_for_each_entry(event, &fd_event_head, list) {
-			if (event->fd > max_fd)
-				max_fd = event->fd;
+		for (i = 0; i < n; i++) {
+			event = (struct fd_event *)evs[i].data.ptr;
+			/* a handler before may have stopped it */
 			if (event->fd == -1)
 				continue;
-			FD_SET(event->fd, &rfds);
-		}
-
-		if (select(max_fd + 1, &rfds, NULL, NULL, NULL) <= 0)
-			continue;
 
-		list_for_each_entry(event, &fd_event_head, list) {
-			if (event->fd == -1)
-				continue;
-			if (FD_ISSET(event->fd, &rfds))
+			if (event->flags & FD_EVENT_TIMER)
+				timer_event_run(container_of(event, struct timer_event, event));
+			else
 				event->handle_fd(event->fd);
 		}
 	}
 }
-
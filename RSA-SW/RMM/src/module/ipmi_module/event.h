@@ -18,16 +18,26 @@
 
 #include "libutils/list.h"
 
-struct fd_event {
-	struct list_head list;
+#define FD_EVENT_EDGE		0x1		/* edge triggered, handle_fd reads until EAGAIN */
+#define FD_EVENT_TIMER		0x2		/* set by timer_event_add */
 
+struct fd_event {
 	int fd;
+	int flags;
 
 	void (*handle_fd)(int sockfd);
 };
 
+struct timer_event {
+	struct fd_event event;
+
+	/** called in the main loop, ticks is the number of periods elapsed */
+	void (*handle_timer)(unsigned int ticks);
+};
+
 void fd_event_add(struct fd_event *event);
+void fd_event_set_fd(struct fd_event *event, int fd);
+int timer_event_add(struct timer_event *timer, int period_ms);
 void fd_events_main_loop(void);
 
 #endif
-
@@ -25,6 +25,7 @@
 #include "ipmi.h"
 #include "ipmi_log.h"
 #include "rmcp.h"
+#include "event.h"
 
 #define IPMB_REQ_MIN_LEN		7
 #define IPMB_RSP_MIN_LEN		8
@@ -77,62 +78,47 @@ struct rsp_ipmb_table {
 	struct list_head all_hndls;
 	struct list_head seq_table[IPMB_SEQ_SIZE];	/** Fast indexed handle by seq */
 
-	pthread_t time_tid;
+	struct timer_event timer;
 };
 
 static struct rsp_ipmb_table ipmb_rsp_table;
 
 /**
-  *  @brief IPMB timeout monitor thread
+  *  @brief IPMB timeout monitor, run by the main loop timer
   *
-  *  @param[in] unused
+  *  @param[in] ticks number of periods elapsed
   *  @return
   */
-static void *ipmb_time_thread(void *unused)
+static void ipmb_timer_tick(unsigned int ticks)
 {
+#ifdef DEBUG_IPMI
 	struct timespec expire;
+#endif
 	struct rsp_ipmb_hndl *hndl, *nxt;
 	struct rsp_ipmb_table *table = &ipmb_rsp_table;
-	pthread_cond_t nul_cond = PTHREAD_COND_INITIALIZER;
 
-	prctl(PR_SET_NAME, "ipmb_time_thread");
-
-	for (; ipmi_module_exit == false;) {
-		clock_gettime(CLOCK_REALTIME, &expire);
-		expire.tv_sec += IPMI_PERIOD_TIME_MS;
-		expire.tv_nsec += (IPMI_PERIOD_TIME_MS % 1000) * (1000*1000);
-		if (expire.tv_nsec >= BILLION) {
-			expire.tv_sec += expire.tv_nsec / BILLION;
-			expire.tv_nsec %= BILLION;
-		}
-
-		pthread_mutex_lock(&table->lock);
-		while (pthread_cond_timedwait(&nul_cond, &table->lock, &expire) != ETIMEDOUT)
-			/* Nothing! */;
+	pthread_mutex_lock(&table->lock);
 
 #ifdef DEBUG_IPMI
-		clock_gettime(CLOCK_REALTIME, &expire);
+	clock_gettime(CLOCK_REALTIME, &expire);
 #endif
-		list_for_each_entry_safe(hndl, nxt, &table->all_hndls, list) {
-			hndl->timeout -= IPMI_PERIOD_TIME_MS;
-			if (hndl->timeout > 0)
-				continue;
+	list_for_each_entry_safe(hndl, nxt, &table->all_hndls, list) {
+		hndl->timeout -= ticks * IPMI_PERIOD_TIME_MS;
+		if ((int)hndl->timeout > 0)
+			continue;
 
-			IPMI_LOG_DEBUG("IPMB(%02X:%02X) Response handle timeout %ld:%ld -> %ld:%ld\n",
-						   hndl->match.netfn, hndl->match.cmd,
-						   hndl->start_time.tv_sec, hndl->start_time.tv_nsec,
-						   expire.tv_sec, expire.tv_nsec);
+		IPMI_LOG_DEBUG("IPMB(%02X:%02X) Response handle timeout %ld:%ld -> %ld:%ld\n",
+					   hndl->match.netfn, hndl->match.cmd,
+					   hndl->start_time.tv_sec, hndl->start_time.tv_nsec,
+					   expire.tv_sec, expire.tv_nsec);
 
-			list_del(&hndl->list);
-			list_del(&hndl->seq_list);
+		list_del(&hndl->list);
+		list_del(&hndl->seq_list);
 
-			hndl->next = table->freelist;
-			table->freelist = hndl;
-		}
-		pthread_mutex_unlock(&table->lock);
+		hndl->next = table->freelist;
+		table->freelist = hndl;
 	}
-
-	return NULL;
+	pthread_mutex_unlock(&table->lock);
 }
 
 /**
@@ -541,7 +527,8 @@ void init_ipmb_msg_handler(void)
 
 	table->curr_seq = 0;
 
-	if (pthread_create(&table->time_tid, NULL, ipmb_time_thread, NULL) != 0)
-		FATAL("Failed to create IPMB time thread!\n");
+	table->timer.handle_timer = ipmb_timer_tick;
+	if (timer_event_add(&table->timer, IPMI_PERIOD_TIME_MS) != 0)
+		FATAL("Failed to create IPMB timer!\n");
 }
 
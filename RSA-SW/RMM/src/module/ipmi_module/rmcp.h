@@ -18,6 +18,7 @@
 
 #include "ipmi.h"
 #include "rmcp+.h"
+#include "libutils/timer_wheel.h"
 /* IPMI v1.5 on LAN */
 
 /* Display an IP address in readable format */
@@ -180,14 +181,13 @@ struct ipmi_session {
 
 
 	struct list_head hash;	/* hashed by IP */
-	struct list_head list;	/* added in single list for time thread scanning */
 
 	int state;
 
 #ifdef DEBUG_IPMI
 	struct timespec start_time;
 #endif
-	unsigned int timeout;
+	struct wheel_timer timer;	/* expires the session */
 
 	struct list_head msg_list;	/* user ipmi msg waiting for sending before session up */
 	struct list_head req_list;
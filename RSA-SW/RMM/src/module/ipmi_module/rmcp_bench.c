@@ -0,0 +1,257 @@
+/**
+ * Copyright (c)  2015, Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "ipmi.h"
+#include "rmcp.h"
+
+/*
+ * RMCP session layer against simulated BMCs: rmcp_send_outbound_msg()
+ * queues the requests and the fake BMCs answer them through
+ * handle_rmcp_ipmi_msg(). Measures the cost of matching responses with
+ * many requests in flight and the longest call while the time thread
+ * runs.
+ *
+ * usage: rmcpbench [sessions] [requests in flight per session]
+ */
+
+#define BENCH_HOST_BASE		0x0A000000
+#define BENCH_NETFN			0x06
+#define BENCH_CMD			0x01
+
+struct sent_msg {
+	unsigned int host;
+	unsigned int port;
+	unsigned char netfn;
+	unsigned char cmd;
+	unsigned char seq;
+};
+
+static struct sent_msg *sent;
+static int sent_num;
+static int sent_max;
+static int delivered;
+static ipmi_json_ipc_header_t bench_header;
+
+/* the main loop is not run, its timers never fire */
+bool ipmi_module_exit;
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* auth type NONE, no auth code in the packets */
+static void parse_msg(unsigned char *msg, unsigned int host, unsigned int port, struct sent_msg *out)
+{
+	unsigned char *ipmi = msg + sizeof(struct rmcp_hdr) + IPMI_MSG_AUTH_CODE_OFFSET + 1;
+
+	out->host  = host;
+	out->port  = port;
+	out->netfn = ipmi[IPMI_NETFN_OFFSET] >> 2;
+	out->cmd   = ipmi[IPMI_CMD_OFFSET];
+	out->seq   = ipmi[IPMI_RQSEQ_OFFSET] >> 2;
+}
+
+void rmcp_send_outbound_msg(unsigned char *msg, int len, unsigned int host, unsigned int port)
+{
+	if (sent_num < sent_max)
+		parse_msg(msg, host, port, &sent[sent_num++]);
+}
+
+void deliver_app_msg_to_user(struct app_msg_hdr *msg, unsigned short port, ipmi_json_ipc_header_t header)
+{
+	delivered++;
+}
+
+static unsigned int bench_host(int i)
+{
+	return htonl(BENCH_HOST_BASE + i);
+}
+
+/* the temporary and the activated session id of a fake BMC */
+static unsigned int temp_id(unsigned int host)
+{
+	return (ntohl(host) - BENCH_HOST_BASE) * 2 + 1;
+}
+
+static unsigned int active_id(unsigned int host)
+{
+	return (ntohl(host) - BENCH_HOST_BASE) * 2 + 2;
+}
+
+static void bmc_reply(struct sent_msg *req)
+{
+	struct rmcp_ipmi_info info;
+	unsigned char data[32];
+	unsigned int id;
+
+	memset(&info, 0, sizeof(info));
+	memset(data, 0, sizeof(data));
+	info.host = req->host;
+	info.port = req->port;
+	info.auth_type = IPMI_SESSION_AUTHTYPE_NONE;
+	info.seq = req->seq;
+	info.netfn = req->netfn | 1;
+	info.cmd = req->cmd;
+	info.ipmi_data = data;
+	info.data_len = 1;
+
+	if (req->netfn == IPMI_NETFN_APP && req->cmd == IPMI_GET_CHAN_AUTH_CAP) {
+		data[2] = IPMI_SESSION_AUTHTYPE_NONE_BIT;
+		info.data_len = 9;
+	} else if (req->netfn == IPMI_NETFN_APP && req->cmd == IPMI_GET_SESSION_CHALL) {
+		id = temp_id(req->host);
+		memcpy(&data[1], &id, 4);
+		info.data_len = 21;
+	} else if (req->netfn == IPMI_NETFN_APP && req->cmd == IPMI_ACTIVATE_SESSION) {
+		info.session_id = temp_id(req->host);
+		id = active_id(req->host);
+		memcpy(&data[2], &id, 4);
+		data[6] = 1;
+		data[10] = IPMI_SESSION_PRIV_ADMIN;
+		info.data_len = 11;
+	} else {
+		info.session_id = active_id(req->host);
+		data[1] = IPMI_SESSION_PRIV_ADMIN;
+		info.data_len = 2;
+	}
+
+	handle_rmcp_ipmi_msg(&info);
+}
+
+/* answer what was sent until nothing is left */
+static void bmc_answer_all(void)
+{
+	struct sent_msg req;
+
+	while (sent_num > 0) {
+		req = sent[--sent_num];
+		bmc_reply(&req);
+	}
+}
+
+static int send_request(int session, struct sent_msg *out)
+{
+	struct ipmi_addr addr;
+	struct ipmi_msg msg;
+	unsigned char buff[IPMI_MAX_MSG_LENGTH];
+	int len;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.type = IPMI_ADDR_TYPE_RMCP;
+	addr.addr.rmcp.host = bench_host(session);
+	addr.addr.rmcp.port = htons(IPMI_RMCP_PORT);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.netfn = BENCH_NETFN;
+	msg.cmd = BENCH_CMD;
+
+	len = format_rmcp_ipmi_msg(buff, &msg, session, IPMI_MAX_TIMEOUT_MS, &addr,
+							   "", "", 0, bench_header);
+	if (len <= 0)
+		return -1;
+
+	if (out)
+		parse_msg(buff, addr.addr.rmcp.host, addr.addr.rmcp.port, out);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int sessions = argc > 1 ? atoi(argv[1]) : 2048;
+	int inflight = argc > 2 ? atoi(argv[2]) : 8;
+	struct sent_msg *pending;
+	int pending_num = 0;
+	double start, t, max_us = 0;
+	int i, j, calls = 0;
+
+	if (sessions <= 0 || inflight <= 0 || inflight >= IPMB_SEQ_SIZE) {
+		printf("usage: %s [sessions] [requests in flight per session < %d]\n", argv[0], IPMB_SEQ_SIZE);
+		return -1;
+	}
+
+	sent_max = sessions * 4;
+	sent = malloc(sent_max * sizeof(*sent));
+	pending = malloc(sessions * inflight * sizeof(*pending));
+	if (sent == NULL || pending == NULL)
+		return -1;
+
+	init_rmcp_session();
+
+	/* open the sessions, the first message waits for the handshake */
+	start = now_us();
+	for (i = 0; i < sessions; i++) {
+		send_request(i, NULL);
+		while (sent_num > 0)
+			bmc_answer_all();
+	}
+	printf("%d sessions opened in %.1f ms, %d replies delivered\n",
+		   sessions, (now_us() - start) / 1000, delivered);
+
+	/* keep requests in flight on every session */
+	start = now_us();
+	for (j = 0; j < inflight; j++) {
+		for (i = 0; i < sessions; i++) {
+			if (send_request(i, &pending[pending_num]) == 0)
+				pending_num++;
+		}
+	}
+	printf("%d requests sent: %.2f us per request\n", pending_num, (now_us() - start) / pending_num);
+
+	/* answer in an order other than sent */
+	delivered = 0;
+	start = now_us();
+	for (i = pending_num - 1; i >= 0; i--)
+		bmc_reply(&pending[i]);
+	printf("%d responses matched: %.2f us per response, %d delivered\n",
+		   pending_num, (now_us() - start) / pending_num, delivered);
+
+	/* refill, then measure single calls while the time thread ticks */
+	pending_num = 0;
+	for (j = 0; j < inflight; j++) {
+		for (i = 0; i < sessions; i++) {
+			if (send_request(i, &pending[pending_num]) == 0)
+				pending_num++;
+		}
+	}
+
+	start = now_us();
+	while (now_us() - start < 3 * 1000 * 1000) {
+		struct sent_msg req;
+
+		t = now_us();
+		if (send_request(calls % sessions, &req) == 0)
+			bmc_reply(&req);
+		t = now_us() - t;
+		if (t > max_us)
+			max_us = t;
+		calls++;
+		usleep(200);
+	}
+	printf("%d request/response pairs with %d in flight, longest %.1f us\n",
+		   calls, pending_num, max_us);
+
+	return 0;
+}
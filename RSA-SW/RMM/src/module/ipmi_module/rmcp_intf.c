@@ -13,10 +13,12 @@
  */
 
 
+#define _GNU_SOURCE
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <pthread.h>
+#include <errno.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +32,7 @@
 #include "librmmcfg/rmm_cfg.h"
 
 #define RMCP_MSG_QUEUE_NUM		512
+#define RMCP_RECV_BATCH			16
 
 struct rmcp_recv_msg {
 	struct rmcp_recv_msg *next;		/* free buffer link */
@@ -113,36 +116,52 @@ void rmcp_send_outbound_msg(unsigned char *msg, int len, unsigned int host, unsi
 }
 
 /**
-  *  @brief receive RMCP inband msg
+  *  @brief receive RMCP inband msg, the socket is edge triggered so
+  *  read batches of datagrams until it is drained.
   *
   *  @param[in] fd socket fd
   *  @return
   */
 static void rmcp_recv_inbound_msg(int fd)
 {
-	int rc;
-	socklen_t addrlen;
-	struct sockaddr_in addr;
-	struct rmcp_recv_msg msg = {0};
-
-	addrlen	= sizeof(addr);
+	int i, rc;
+	struct sockaddr_in addr[RMCP_RECV_BATCH];
+	struct iovec iov[RMCP_RECV_BATCH];
+	struct mmsghdr hdr[RMCP_RECV_BATCH];
+	unsigned char msg[RMCP_RECV_BATCH][IPMI_MAX_MSG_LENGTH];
 
 	for (;;) {
-		memset(&msg, 0, sizeof(struct rmcp_recv_msg));
+		memset(hdr, 0, sizeof(hdr));
+		for (i = 0; i < RMCP_RECV_BATCH; i++) {
+			iov[i].iov_base = msg[i];
+			iov[i].iov_len = sizeof(msg[i]);
+			hdr[i].msg_hdr.msg_iov = &iov[i];
+			hdr[i].msg_hdr.msg_iovlen = 1;
+			hdr[i].msg_hdr.msg_name = &addr[i];
+			hdr[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+		}
 
-		rc = recvfrom(fd, msg.msg, sizeof(msg.msg), 0, (struct sockaddr *)&addr, &addrlen);
+		rc = recvmmsg(fd, hdr, RMCP_RECV_BATCH, 0, NULL);
+		if (rc < 0 && errno == EINTR)
+			continue;
 		if (rc <= 0)
 			return;
 
-		IPMI_LOG_DEBUG("RMCP Message from "NIPQUAD_FMT":%u\n",
-					   NIPQUAD(addr.sin_addr.s_addr),
-					   ntohs(addr.sin_port));
+		for (i = 0; i < rc; i++) {
+			if (hdr[i].msg_len == 0)
+				continue;
 
-		msg.host = addr.sin_addr.s_addr;
-		msg.port = addr.sin_port;
-		msg.len = rc;
+			IPMI_LOG_DEBUG("RMCP Message from "NIPQUAD_FMT":%u\n",
+						   NIPQUAD(addr[i].sin_addr.s_addr),
+						   ntohs(addr[i].sin_port));
 
-		handle_rmcp_msg(msg.msg, msg.len, msg.host, msg.port);
+			handle_rmcp_msg(msg[i], hdr[i].msg_len,
+							addr[i].sin_addr.s_addr, addr[i].sin_port);
+		}
+
+		/* queue drained, the next datagram raises a new edge */
+		if (rc < RMCP_RECV_BATCH)
+			return;
 	}
 }
 
@@ -158,6 +177,7 @@ void register_rmcp_resp(void)
 	rmcp_fd_event.fd = open_rmcp_interface();
 	if (rmcp_fd_event.fd == -1)
 		FATAL("Failed to open RMCP interface!\n");
+	rmcp_fd_event.flags = FD_EVENT_EDGE;
 	rmcp_fd_event.handle_fd = rmcp_recv_inbound_msg;
 	fd_event_add(&rmcp_fd_event);
 
@@ -24,19 +24,37 @@
 
 #include "ipmi.h"
 #include "rmcp.h"
+#include "event.h"
 #include "ipmi_log.h"
 #include "ipmi20_crypto.h"
 #include "libutils/string.h"
 
+#ifndef IPMI_SESSION_QUEUE_SIZE
 #define IPMI_SESSION_QUEUE_SIZE		256
+#endif
+#ifndef IPMI_REQUEST_QUEUE_SIZE
 #define IPMI_REQUEST_QUEUE_SIZE		512
+#endif
+#ifndef IPMI_MSGSENT_QUEUE_SIZE
 #define IPMI_MSGSENT_QUEUE_SIZE		256
+#endif
 
+#ifndef IPMI_SESSION_TABLE_SIZE
 #define IPMI_SESSION_TABLE_SIZE		(64)
+#endif
 #define IPMI_SESSION_TABLE_MASK		(IPMI_SESSION_TABLE_SIZE - 1)
 #define IPMI_SESSION_TABLE_HASH(host)	\
 		((ntohl(host)) & IPMI_SESSION_TABLE_MASK)
 
+/* requests in flight hashed by (session, seq, netfn, cmd), 2 buckets per request */
+#ifndef IPMI_REQUEST_TABLE_BITS
+#define IPMI_REQUEST_TABLE_BITS		10
+#endif
+#define IPMI_REQUEST_TABLE_SIZE		(1 << IPMI_REQUEST_TABLE_BITS)
+
+#define RMCP_TIMER_TICK_MS			100
+#define RMCP_MS_TO_TICKS(ms)		(((ms) + RMCP_TIMER_TICK_MS - 1) / RMCP_TIMER_TICK_MS)
+
 enum ipmi_session_state {
 	IPMI_SESS_STATE_AUTH_CAP_REQ_SENT = 1,
 	IPMI_SESS_STATE_SESSION_CHALLENGE_SENT,
@@ -69,7 +87,9 @@ struct ipmi_req_entry {
 
 
 	struct list_head link;	/* Link to "struct ipmi_session" */
-	struct list_head list;	/* ALL the IPMI Req we have sent */
+	struct list_head hash;	/* Link to the request table */
+
+	struct ipmi_session *sess;
 
 	unsigned int msgid;
 	unsigned short user_port;
@@ -80,7 +100,7 @@ struct ipmi_req_entry {
 #ifdef DEBUG_IPMI
 	struct timespec start_time;
 #endif
-	unsigned int timeout;
+	struct wheel_timer timer;
 };
 
 struct ipmi_session_table {
@@ -90,17 +110,71 @@ struct ipmi_session_table {
 	struct ipmi_msg_sent  *msg_freelist;
 	struct ipmi_req_entry *req_freelist;
 
-	/* Scaned by time thread */
-	struct list_head request_list;
-	struct list_head session_list;
+	/* Expires sessions and requests, run by the main loop timer */
+	struct timer_wheel wheel;
 
+	struct list_head request_table[IPMI_REQUEST_TABLE_SIZE];
 	struct list_head session_table[IPMI_SESSION_TABLE_SIZE];
 
-	pthread_t time_tid;
+	struct timer_event timer;
 };
 
 static struct ipmi_session_table session_table;
 
+static void rmcp_req_expired(struct wheel_timer *timer);
+
+static unsigned long long rmcp_timer_ticks(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000) / RMCP_TIMER_TICK_MS;
+}
+
+static struct list_head *rmcp_req_bucket(struct ipmi_session *sess, unsigned char seq,
+			unsigned char netfn, unsigned char cmd)
+{
+	unsigned int key;
+
+	key = (unsigned int)((unsigned long)sess >> 4) ^ (seq << 16 | netfn << 8 | cmd);
+	key *= 2654435761U;
+
+	return &session_table.request_table[key >> (32 - IPMI_REQUEST_TABLE_BITS)];
+}
+
+static struct ipmi_req_entry *rmcp_req_lookup(struct ipmi_session *sess, unsigned char seq,
+			unsigned char netfn, unsigned char cmd)
+{
+	struct ipmi_req_entry *req;
+
+	list_for_each_entry(req, rmcp_req_bucket(sess, seq, netfn, cmd), hash) {
+		if (req->sess == sess &&
+		    req->match.seq == seq &&
+		    req->match.netfn == netfn &&
+		    req->match.cmd == cmd)
+			return req;
+	}
+
+	return NULL;
+}
+
+static void rmcp_req_free(struct ipmi_req_entry *req)
+{
+	struct ipmi_session_table *table = &session_table;
+
+	wheel_timer_del(&req->timer);
+	list_del(&req->link);
+	list_del(&req->hash);
+
+	req->next = table->req_freelist;
+	table->req_freelist = req;
+}
+
+static void rmcp_sess_set_timeout(struct ipmi_session *sess, unsigned int ms)
+{
+	wheel_timer_add(&session_table.wheel, &sess->timer, RMCP_MS_TO_TICKS(ms));
+}
+
 /**
   *  @brief convert to little-endian 32bits
   *
@@ -162,18 +236,9 @@ static int rmcp_intf_find_seq(struct ipmi_session *sess,
 {
 	int rv = -1;
 	unsigned char netfn = match->netfn & 0x3E;	/* request netfn */
-	struct ipmi_req_entry *req = NULL, *pos;
-	struct ipmi_session_table *table = &session_table;
-
-	list_for_each_entry(pos, &sess->req_list, link) {
-		if (pos->match.seq == match->seq &&
-		    pos->match.netfn == netfn &&
-		    pos->match.cmd == match->cmd) {
-			req = pos;
-			break;
-		}
-	}
+	struct ipmi_req_entry *req;
 
+	req = rmcp_req_lookup(sess, match->seq, netfn, match->cmd);
 	if (req == NULL) {
 		IPMI_LOG_ERR("Req found is NULL...\n");
 		goto ret;
@@ -190,10 +255,7 @@ static int rmcp_intf_find_seq(struct ipmi_session *sess,
 	if (strlen((const char *)(req->header.method)) < JRPC_METHOD_MAX)
 		memcpy(header->method, req->header.method, strlen((const char *)(req->header.method)));
 
-	list_del(&req->link);
-	list_del(&req->list);
-	req->next = table->req_freelist;
-	table->req_freelist = req;
+	rmcp_req_free(req);
 
 	rv = 0;
 
@@ -223,7 +285,7 @@ static int rmcp_intf_next_seq(struct ipmi_session *sess,
 	unsigned int i;
 	unsigned char netfn = match->netfn & 0x3E;	/* request netfn */
 	unsigned char seq = IPMB_SEQ_SIZE;
-	struct ipmi_req_entry *req, *pos;
+	struct ipmi_req_entry *req;
 	struct ipmi_session_table *table = &session_table;
 
 	req = table->req_freelist;
@@ -234,18 +296,7 @@ static int rmcp_intf_next_seq(struct ipmi_session *sess,
 	}
 
 	for (i = sess->curr_seq; IPMB_SEQ_HASH(i+1) != sess->curr_seq; i = IPMB_SEQ_HASH(i+1)) {
-		int conflict = 0;
-
-		list_for_each_entry(pos, &sess->req_list, link) {
-			if (pos->match.seq == i &&
-			    pos->match.netfn == netfn &&
-			    pos->match.cmd == match->cmd) {
-				conflict = 1;
-				break;
-			}
-		}
-
-		if (!conflict) {
+		if (rmcp_req_lookup(sess, i, netfn, match->cmd) == NULL) {
 			IPMI_LOG_DEBUG("RMCP IPMI to "NIPQUAD_FMT" NetFn:%02X,Cmd:%02X uses Seq:%02X\n",
 						   NIPQUAD(sess->host),
 						   netfn, match->cmd, i);
@@ -262,9 +313,7 @@ static int rmcp_intf_next_seq(struct ipmi_session *sess,
 	table->req_freelist = req->next;
 	req->next = NULL;
 
-	list_add_tail(&req->link, &sess->req_list);
-	list_add_tail(&req->list, &table->request_list);
-
+	req->sess = sess;
 	req->msgid = msgid;
 	req->user_port = user_port;
 	req->match.seq = seq;
@@ -282,7 +331,11 @@ static int rmcp_intf_next_seq(struct ipmi_session *sess,
 #ifdef DEBUG_IPMI
 	clock_gettime(CLOCK_REALTIME, &req->start_time);
 #endif
-	req->timeout = timeo;
+	list_add_tail(&req->link, &sess->req_list);
+	list_add_tail(&req->hash, rmcp_req_bucket(sess, seq, netfn, match->cmd));
+
+	wheel_timer_init(&req->timer, rmcp_req_expired);
+	wheel_timer_add(&table->wheel, &req->timer, RMCP_MS_TO_TICKS(timeo));
 
 	match->seq = seq;
 	sess->curr_seq = IPMB_SEQ_HASH(seq + 1);
@@ -305,7 +358,7 @@ static void relase_ipmi_session(struct ipmi_session *sess)
 	struct ipmi_req_entry *req, *req_next;
 	struct ipmi_session_table *table = &session_table;
 
-	list_del(&sess->list);
+	wheel_timer_del(&sess->timer);
 	list_del(&sess->hash);
 
 	list_for_each_entry_safe(msg, msg_next, &sess->msg_list, list) {
@@ -315,86 +368,61 @@ static void relase_ipmi_session(struct ipmi_session *sess)
 		table->msg_freelist = msg;
 	}
 
-	list_for_each_entry_safe(req, req_next, &sess->req_list, link) {
-		list_del(&req->link);
-		list_del(&req->list);
-
-		req->next = table->req_freelist;
-		table->req_freelist = req;
-	}
+	list_for_each_entry_safe(req, req_next, &sess->req_list, link)
+		rmcp_req_free(req);
 
 	sess->next = table->ses_freelist;
 	table->ses_freelist = sess;
 }
 
 /**
-  *  @brief
+  *  @brief expire an IPMI session, called by the timer wheel
   *
-  *  @param
+  *  @param[in] timer session timer
   *  @return
   */
-static void *rmcp_time_thread(void *unused)
+static void rmcp_sess_expired(struct wheel_timer *timer)
 {
-	struct timespec expire;
-	struct ipmi_session *sess, *sess_next;
-	struct ipmi_req_entry *req, *req_next;
-	struct ipmi_session_table *table = &session_table;
-	pthread_cond_t nul_cond = PTHREAD_COND_INITIALIZER;
-
-	prctl(PR_SET_NAME, "rmcp_time_thread");
-
-	for (;;) {
-		clock_gettime(CLOCK_REALTIME, &expire);
-		expire.tv_sec += (IPMI_PERIOD_TIME_MS/1000);
-		expire.tv_nsec += (IPMI_PERIOD_TIME_MS % 1000) * (1000*1000);
-		if (expire.tv_nsec >= BILLION) {
-			expire.tv_sec += expire.tv_nsec / BILLION;
-			expire.tv_nsec %= BILLION;
-		}
-
-		pthread_mutex_lock(&table->lock);
-
-		while (pthread_cond_timedwait(&nul_cond, &table->lock, &expire) != ETIMEDOUT)
-			/* Nothing! */;
-
-#ifdef DEBUG_IPMI
-		clock_gettime(CLOCK_REALTIME, &expire);
-#endif
-
-		list_for_each_entry_safe(sess, sess_next, &table->session_list, list) {
-			sess->timeout -= IPMI_PERIOD_TIME_MS;
-			if (sess->timeout > 0)
-				continue;
-
-			IPMI_LOG_INFO("RMCP session to "NIPQUAD_FMT" expired %ld:%ld -> %ld:%ld\n",
-						  NIPQUAD(sess->host),
-						  sess->start_time.tv_sec, sess->start_time.tv_nsec,
-						  expire.tv_sec, expire.tv_nsec);
+	struct ipmi_session *sess = container_of(timer, struct ipmi_session, timer);
 
-			relase_ipmi_session(sess);
-		}
+	IPMI_LOG_INFO("RMCP session to "NIPQUAD_FMT" expired, started %ld:%ld\n",
+				  NIPQUAD(sess->host),
+				  sess->start_time.tv_sec, sess->start_time.tv_nsec);
 
-		list_for_each_entry_safe(req, req_next, &table->request_list, list) {
-			req->timeout -= IPMI_PERIOD_TIME_MS;
-			if (req->timeout > 0)
-				continue;
+	relase_ipmi_session(sess);
+}
 
-			IPMI_LOG_INFO("RMCP request (%02X:%02X) expired %ld:%ld -> %ld:%ld\n",
-						  req->match.netfn, req->match.cmd,
-						  req->start_time.tv_sec, req->start_time.tv_nsec,
-						  expire.tv_sec, expire.tv_nsec);
+/**
+  *  @brief expire a request without response, called by the timer wheel
+  *
+  *  @param[in] timer request timer
+  *  @return
+  */
+static void rmcp_req_expired(struct wheel_timer *timer)
+{
+	struct ipmi_req_entry *req = container_of(timer, struct ipmi_req_entry, timer);
 
-			list_del(&req->list);
-			list_del(&req->link);
+	IPMI_LOG_INFO("RMCP request (%02X:%02X) expired, sent %ld:%ld\n",
+				  req->match.netfn, req->match.cmd,
+				  req->start_time.tv_sec, req->start_time.tv_nsec);
 
-			req->next = table->req_freelist;
-			table->req_freelist = req;
-		}
+	rmcp_req_free(req);
+}
 
-		pthread_mutex_unlock(&table->lock);
-	}
+/**
+  *  @brief run the expired timers every tick, the lock is held for the
+  *  expired sessions and requests only.
+  *
+  *  @param[in] ticks unused, the wheel catches up with the clock
+  *  @return
+  */
+static void rmcp_timer_tick(unsigned int ticks)
+{
+	struct ipmi_session_table *table = &session_table;
 
-	return NULL;
+	pthread_mutex_lock(&table->lock);
+	timer_wheel_run(&table->wheel, rmcp_timer_ticks());
+	pthread_mutex_unlock(&table->lock);
 }
 
 
@@ -660,7 +688,7 @@ static void flush_ipmi_user_msg(struct ipmi_session *sess)
 	unsigned char buff[IPMI_MAX_MSG_LENGTH];
 
 	memset(buff, 0, IPMI_MAX_MSG_LENGTH);
-	sess->timeout = RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS;
+	rmcp_sess_set_timeout(sess, RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS);
 
 	list_for_each_entry_safe(msg, msg_next, &sess->msg_list, list) {
 		list_del(&msg->list);
@@ -1913,7 +1941,7 @@ static void flush_ipmi20_user_msg(struct ipmi_session *sess)
 	struct rmcp_plus_ipmi_info ipmi_info = {0};
 	unsigned char *msg_to_send = NULL;
 
-	sess->timeout = RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS;
+	rmcp_sess_set_timeout(sess, RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS);
 
 	if (sess->crypt_alg != CRYPT_ALG_NONE)
 		ipmi_info.payload_type |= IPMI20_PAYLOAD_ENCRYPTED_MASK;
@@ -2182,14 +2210,14 @@ static void setup_ipmi_session(struct ipmi_session *sess, struct ipmi_addr *addr
 	struct ipmi_session_table *table = &session_table;
 
 	list_add_tail(&sess->hash, &table->session_table[IPMI_SESSION_TABLE_HASH(addr->addr.rmcp.host)]);
-	list_add_tail(&sess->list, &table->session_list);
 	INIT_LIST_HEAD(&sess->msg_list);
 	INIT_LIST_HEAD(&sess->req_list);
 
 #ifdef DEBUG_IPMI
 	clock_gettime(CLOCK_REALTIME, &sess->start_time);
 #endif
-	sess->timeout = RMCP_IPMI_SESSION_SETUP_TIMEOUT_MS;
+	wheel_timer_init(&sess->timer, rmcp_sess_expired);
+	rmcp_sess_set_timeout(sess, RMCP_IPMI_SESSION_SETUP_TIMEOUT_MS);
 	sess->host = addr->addr.rmcp.host;
 	sess->port = addr->addr.rmcp.port;
 	sess->session_id  = 0;
@@ -2347,7 +2375,7 @@ int format_rmcp_ipmi_msg(unsigned char *buff, struct ipmi_msg *ipmi,
 		}
 #endif
 
-		/*sess->timeout = RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS;*/	/* update the session time */
+		/*rmcp_sess_set_timeout(sess, RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS);*/	/* update the session time */
 	}
 
 ret:
@@ -2496,7 +2524,7 @@ void handle_rmcp_ipmi_msg(struct rmcp_ipmi_info *ipmi_info)
 			if (sess->state != IPMI_SESS_STATE_ACTIVE)
 				handle_ipmi_sess_msg(sess, ipmi_info);
 			else {
-				sess->timeout = RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS;	/* update the session time */
+				rmcp_sess_set_timeout(sess, RMCP_IPMI_SESSION_IDLE_TIMEOUT_MS);	/* update the session time */
 				handle_ipmi_user_msg(sess, ipmi_info);
 			}
 
@@ -2537,13 +2565,16 @@ void init_rmcp_session(void)
 		FATAL("Failed to create the RMCP session freelist!\n");
 	}
 
-	INIT_LIST_HEAD(&table->request_list);
-	INIT_LIST_HEAD(&table->session_list);
+	timer_wheel_init(&table->wheel, rmcp_timer_ticks());
+
+	for (i = 0; i < IPMI_REQUEST_TABLE_SIZE; i++)
+		INIT_LIST_HEAD(&table->request_table[i]);
 
 	for (i = 0; i < IPMI_SESSION_TABLE_SIZE; i++)
 		INIT_LIST_HEAD(&table->session_table[i]);
 
-	if (pthread_create(&table->time_tid, NULL, rmcp_time_thread, NULL) != 0)
-		FATAL("Failed to create RMCP time thread!\n");
+	table->timer.handle_timer = rmcp_timer_tick;
+	if (timer_event_add(&table->timer, RMCP_TIMER_TICK_MS) != 0)
+		FATAL("Failed to create RMCP timer!\n");
 }
 
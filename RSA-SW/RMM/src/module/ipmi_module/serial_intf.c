@@ -469,7 +469,7 @@ void start_serial_intf(char *dev, unsigned char netfn, unsigned char cmd,
 	if (SERIAL_PORT_IS_OPENED == rc) {
 		if (serial_port_is_updated(cur_serial_port, (long)sb.st_ino)) {
 			serial_close(serial_fd_event[cur_serial_port].fd);
-			serial_fd_event[cur_serial_port].fd = open_serial_interface(dev);
+			fd_event_set_fd(&serial_fd_event[cur_serial_port], open_serial_interface(dev));
 			serial_port_update(cur_serial_port,
 							   serial_fd_event[cur_serial_port].fd,
 							   (long)sb.st_ino);
@@ -480,7 +480,7 @@ void start_serial_intf(char *dev, unsigned char netfn, unsigned char cmd,
 		return;
 	} else if (SERIAL_PORT_IS_CLOSED == rc) {
 		IPMI_LOG_DEBUG("This serial port is exist but closed!\n");
-		serial_fd_event[cur_serial_port].fd = open_serial_interface(dev);
+		fd_event_set_fd(&serial_fd_event[cur_serial_port], open_serial_interface(dev));
 		if (serial_fd_event[cur_serial_port].fd == -1) {
 			IPMI_LOG_ERR("Failed to open %s\n", dev);
 		}
@@ -548,7 +548,7 @@ void start_serial_intf(char *dev, unsigned char netfn, unsigned char cmd,
 		}
 
 		serial_close(serial_fd_event[cur_serial_port].fd);
-		serial_fd_event[cur_serial_port].fd = -1;
+		fd_event_set_fd(&serial_fd_event[cur_serial_port], -1);
 		free(serialmsg_freelist[cur_serial_port]);
 		send_back_result_to_app(fd, netfn, cmd, msgid, user_port, header);
 
@@ -602,7 +602,7 @@ void stop_serial_intf(char *dev, unsigned char netfn, unsigned char cmd,
 	send_back_result_to_app(serial_fd_event[cur_serial_port].fd,
 							netfn, cmd, msgid, user_port, header);
 
-	serial_fd_event[cur_serial_port].fd = -1;
+	fd_event_set_fd(&serial_fd_event[cur_serial_port], -1);
 	set_serial_port_unused(cur_serial_port);
 
 	IPMI_LOG_DEBUG("SERIAL-Intf is stopped successfully!\n");